@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include "message/Buffer.h"
+
+static void BM_BufferAppendDword(benchmark::State &state) {
+  for (auto _ : state) {
+    Buffer buffer;
+    for (int64_t i = 0; i < state.range(0); i++)
+      buffer.append((uint32_t) i);
+    benchmark::DoNotOptimize(buffer.getDataPtr());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferAppendDword)->Arg(8)->Arg(256);
+
+static void BM_BufferAppendString(benchmark::State &state) {
+  std::string chars((size_t) state.range(0), 'x');
+  for (auto _ : state) {
+    Buffer buffer;
+    buffer.append((uint32_t) chars.size());
+    buffer.append(chars);
+    benchmark::DoNotOptimize(buffer.getDataPtr());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferAppendString)->RangeMultiplier(16)->Range(16, 64 << 10);
+
+static void BM_BufferGetDword(benchmark::State &state) {
+  Buffer buffer;
+  for (int64_t i = 0; i < state.range(0); i++)
+    buffer.append((uint32_t) i);
+  for (auto _ : state) {
+    buffer.reset();
+    for (int64_t i = 0; i < state.range(0); i++)
+      benchmark::DoNotOptimize(buffer.get<uint32_t>());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferGetDword)->Arg(8)->Arg(256);
+
+static void BM_BufferGetBytes(benchmark::State &state) {
+  std::string chars((size_t) state.range(0), 'x');
+  Buffer buffer((const uint8_t *) chars.data(), chars.size());
+  for (auto _ : state) {
+    buffer.reset();
+    benchmark::DoNotOptimize(buffer.get<char>((uint32_t) chars.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferGetBytes)->RangeMultiplier(16)->Range(16, 64 << 10);
@@ -0,0 +1,21 @@
+#include <benchmark/benchmark.h>
+#include "crypto/CryptoInterface.h"
+
+static const std::string KEY = "1ZNDH6P00ABZJN";
+static const std::string IV = "dji-alpha";
+
+static void BM_AES256Encrypt(benchmark::State &state) {
+  std::string input((size_t) state.range(0), 'x');
+  for (auto _ : state)
+    benchmark::DoNotOptimize(Crypto::AES256::encryptData(input, KEY, IV));
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AES256Encrypt)->RangeMultiplier(4)->Range(16, 64 << 10);
+
+static void BM_AES256Decrypt(benchmark::State &state) {
+  auto input = Crypto::AES256::encryptData(std::string((size_t) state.range(0), 'x'), KEY, IV);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(Crypto::AES256::decryptData(input, KEY, IV));
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AES256Decrypt)->RangeMultiplier(4)->Range(16, 64 << 10);
@@ -0,0 +1,17 @@
+#include <benchmark/benchmark.h>
+#include "message/MessageParser.h"
+
+static const std::string KEY = "1ZNDH6P00ABZJN";
+static const std::string IV = "dji-alpha";
+
+/**
+ * @brief wraps output of a size into the envelope every frame travels in
+ */
+static void BM_EncryptedMessageCreate(benchmark::State &state, WireFormat format) {
+  Message::Ptr msg = MessageFactory::create<PutCharMessage>(std::string((size_t) state.range(0), 'x'));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(MessageFactory::create<EncryptedMessage>(msg, KEY, IV, format));
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_EncryptedMessageCreate, Legacy, WireFormat::Legacy)->RangeMultiplier(16)->Range(1, 16 << 10);
+BENCHMARK_CAPTURE(BM_EncryptedMessageCreate, Compact, WireFormat::Compact)->RangeMultiplier(16)->Range(1, 16 << 10);
@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include <streambuf>
+#include "logger/Logger.h"
+
+/**
+ * @brief formats and writes log lines like a verbose client, the output goes nowhere while measuring
+ */
+class LoggerFixture : public benchmark::Fixture {
+private:
+  class NullBuffer : public std::streambuf {
+  protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+      return count;
+    }
+
+    int overflow(int c) override {
+      return c;
+    }
+  };
+  NullBuffer fSink;
+  std::streambuf *fOutput = nullptr;
+public:
+  void SetUp(const benchmark::State &) override {
+    Logger::init(Logger::LogLevel::LogLevelDebug);
+    fOutput = std::cout.rdbuf(&fSink);
+  }
+
+  void TearDown(const benchmark::State &) override {
+    std::cout.rdbuf(fOutput);
+  }
+};
+
+BENCHMARK_F(LoggerFixture, BM_LoggerLog)(benchmark::State &state) {
+  for (auto _ : state)
+    Logger::log(Logger::LogLevel::LogLevelInfo, "relayed %zu bytes to %s", (size_t) 4096, "slave-1");
+}
+
+/**
+ * @brief the macros add time, function, file and line and colors
+ */
+BENCHMARK_F(LoggerFixture, BM_LoggerMacro)(benchmark::State &state) {
+  for (auto _ : state)
+    DINFO("relayed %zu bytes to %s", (size_t) 4096, "slave-1");
+}
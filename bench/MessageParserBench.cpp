@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include "message/MessageParser.h"
+
+static const std::string KEY = "1ZNDH6P00ABZJN";
+static const std::string IV = "dji-alpha";
+
+static Message::Ptr makeConnect() {
+  ConnectOptions options(ConnectionType::TypeMaster, "slave-1", true, 30, false);
+  options.setCapabilities(ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING);
+  return MessageFactory::create<ConnectMessage>(options);
+}
+
+static Message::Ptr makeResponse() {
+  nlohmann::json metaData;
+  metaData["version"] = 1;
+  metaData["capabilities"] = 7;
+  return MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, metaData);
+}
+
+static Message::Ptr makeSequenced(size_t size) {
+  auto putChar = MessageFactory::create<PutCharMessage>(std::string(size, 'x'));
+  std::string payload((const char *) putChar->getBuffer().getDataPtr(), putChar->getBuffer().getSize());
+  return MessageFactory::create<SequencedMessage>(11, 12, 13, 14, payload);
+}
+
+static Message::Ptr makeBatch() {
+  std::vector<std::string> batched;
+  for (int i = 0; i < 8; i++) {
+    auto sequenced = makeSequenced(64);
+    batched.emplace_back((const char *) sequenced->getBuffer().getDataPtr(), sequenced->getBuffer().getSize());
+  }
+  return MessageFactory::create<BatchMessage>(batched);
+}
+
+/**
+ * @brief parses the frame of msg as it is, without encryption
+ */
+static void BM_MessageParserParse(benchmark::State &state, const Message::Ptr &msg) {
+  MessageParser parser(KEY, IV);
+  auto &buffer = msg->getBuffer();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(parser.parse(buffer.getDataPtr(), buffer.getSize()));
+  state.SetBytesProcessed((int64_t) (state.iterations() * buffer.getSize()));
+}
+BENCHMARK_CAPTURE(BM_MessageParserParse, Connect, makeConnect());
+BENCHMARK_CAPTURE(BM_MessageParserParse, PutChar, MessageFactory::create<PutCharMessage>("l"));
+BENCHMARK_CAPTURE(BM_MessageParserParse, ResizeTerminal, MessageFactory::create<ResizeTerminalMessage>(80, 24));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Response, makeResponse());
+BENCHMARK_CAPTURE(BM_MessageParserParse, ExecuteCommand,
+                  MessageFactory::create<ExecuteCommandMessage>(7, "uname -a", 1500, std::vector<std::string>{"slave-1", "slave-2"}));
+BENCHMARK_CAPTURE(BM_MessageParserParse, CommandOutput, MessageFactory::create<CommandOutputMessage>(7, "slave-1", std::string(256, 'x')));
+BENCHMARK_CAPTURE(BM_MessageParserParse, CommandResult,
+                  MessageFactory::create<CommandResultMessage>(7, "slave-1", CommandStatus::StatusExited, 0, 42));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Sequenced, makeSequenced(64));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Resume, MessageFactory::create<ResumeMessage>(21, 22, 23, true));
+BENCHMARK_CAPTURE(BM_MessageParserParse, ChannelData, MessageFactory::create<ChannelDataMessage>(7, std::string(256, 'x')));
+BENCHMARK_CAPTURE(BM_MessageParserParse, OpenChannel,
+                  MessageFactory::create<OpenChannelMessage>(8, ConnectOptions(ConnectionType::TypeMaster, "slave-1")));
+BENCHMARK_CAPTURE(BM_MessageParserParse, CloseChannel, MessageFactory::create<CloseChannelMessage>(9));
+BENCHMARK_CAPTURE(BM_MessageParserParse, ChannelWindow, MessageFactory::create<ChannelWindowMessage>(10, 65536));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Compressed,
+                  MessageFactory::create<CompressedMessage>(CompressedMessage::FLAG_RESET, 3, 512, std::string(256, 'z')));
+BENCHMARK_CAPTURE(BM_MessageParserParse, CompressionRequest, MessageFactory::create<CompressionRequestMessage>(CompressionType::Deflate));
+BENCHMARK_CAPTURE(BM_MessageParserParse, DisplayMode, MessageFactory::create<DisplayModeMessage>(DisplayMode::ScreenSync, 30));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Batch, makeBatch());
+BENCHMARK_CAPTURE(BM_MessageParserParse, WindowUpdate, MessageFactory::create<WindowUpdateMessage>(4096, false));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Heartbeat, MessageFactory::create<HeartbeatMessage>(1000, false));
+BENCHMARK_CAPTURE(BM_MessageParserParse, Trace, MessageFactory::create<TraceMessage>(42, TraceMessage::Stamps{100, 200, 300}));
+BENCHMARK_CAPTURE(BM_MessageParserParse, MasterDetached, MessageFactory::create<MasterDetachedMessage>());
+
+/**
+ * @brief parses session frames of a size as they arrive from the server, in both wire formats
+ */
+static void BM_MessageParserParseEncrypted(benchmark::State &state, WireFormat format) {
+  MessageParser parser(KEY, IV);
+  auto encrypted = MessageFactory::create<EncryptedMessage>(makeSequenced((size_t) state.range(0)), KEY, IV, format);
+  auto &buffer = encrypted->getBuffer();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(parser.parse(buffer.getDataPtr(), buffer.getSize()));
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_MessageParserParseEncrypted, Legacy, WireFormat::Legacy)->RangeMultiplier(16)->Range(1, 16 << 10);
+BENCHMARK_CAPTURE(BM_MessageParserParseEncrypted, Compact, WireFormat::Compact)->RangeMultiplier(16)->Range(1, 16 << 10);
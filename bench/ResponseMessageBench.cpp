@@ -0,0 +1,27 @@
+#include <benchmark/benchmark.h>
+#include "message/MessageParser.h"
+
+/**
+ * @brief encodes a progress report, parses it and reads what a client reads of it
+ */
+static void BM_ResponseMessageProgress(benchmark::State &state, MetaDataEncoding encoding) {
+  MessageParser messageParser("1ZNDH6P00ABZJN", "dji-alpha");
+  nlohmann::json progress = {
+    {"request", 42}, {"completed", 0}, {"failed", 2}, {"total", 300},
+    {"hosts", {{"web-1", "exit 0"}, {"web-2", "timed out"}}},
+    {"sessions", {"dji-alpha", "dji-beta", "dji-gamma"}},
+    {"owner", "controller-7"}};
+  uint64_t round = 0;
+  for (auto _ : state) {
+    progress["completed"] = round++;
+    auto msg = MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, progress, encoding);
+    auto result = messageParser.parse(msg->getBuffer().getDataPtr(), msg->getBuffer().getSize());
+    auto response = result->cast<ResponseMessage>();
+    uint64_t completed = 0, total = 0;
+    response.getUnsigned("completed", completed);
+    response.getUnsigned("total", total);
+    benchmark::DoNotOptimize(completed + total);
+  }
+}
+BENCHMARK_CAPTURE(BM_ResponseMessageProgress, Text, MetaDataEncoding::Text);
+BENCHMARK_CAPTURE(BM_ResponseMessageProgress, Binary, MetaDataEncoding::Binary);
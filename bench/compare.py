@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""Compares two terminus_bench json results, such as those of two commits.
+
+usage: compare.py BASELINE.json CONTENDER.json [--threshold PERCENT]
+
+Prints the change of cpu time per benchmark and exits with 1 if one got
+slower by more than the threshold, 5 percent by default.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as file:
+        results = json.load(file)
+    # repetitions report aggregates as well, the mean stands for them
+    times = {}
+    for benchmark in results["benchmarks"]:
+        if benchmark.get("run_type") == "aggregate" and benchmark.get("aggregate_name") != "mean":
+            continue
+        name = benchmark.get("run_name", benchmark["name"])
+        times[name] = benchmark["cpu_time"], benchmark["time_unit"]
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compare two terminus_bench json results")
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=5.0, help="slowdown in percent counted as a regression")
+    args = parser.parse_args()
+
+    baseline, contender = load(args.baseline), load(args.contender)
+    regressions = 0
+    width = max((len(name) for name in baseline), default=0)
+    for name, (before, unit) in baseline.items():
+        if name not in contender:
+            print(f"{name:<{width}}  {before:12.1f} {unit}  gone")
+            continue
+        after, _ = contender[name]
+        change = (after - before) / before * 100 if before else 0.0
+        mark = ""
+        if change > args.threshold:
+            mark = "  slower"
+            regressions += 1
+        elif change < -args.threshold:
+            mark = "  faster"
+        print(f"{name:<{width}}  {before:12.1f} -> {after:12.1f} {unit}  {change:+7.1f}%{mark}")
+    for name in contender:
+        if name not in baseline:
+            print(f"{name:<{width}}  new")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
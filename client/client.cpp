@@ -1,16 +1,71 @@
 #include <iostream>
+#include <random>
 #include <cxxopts.hpp>
 #include <logger/Logger.h>
 #include <terminal/console.hpp>
 #include <terminal/terminal.hpp>
+#include <terminal/terminal_pool.hpp>
+#include <terminal/executor.hpp>
 #include <client/MessageClient.h>
+#include <client/OutputCoalescer.h>
+#include <client/RetransmitWindow.h>
+#include <client/EchoPredictor.h>
+#include <client/ChannelMux.h>
+#include <client/StreamCompressor.h>
+#include <client/ScreenSync.h>
+#include <client/FlowWindow.h>
+#include <client/LatencyTracer.h>
 #include <message/MessageParser.h>
+#include <message/FrameReader.h>
 
 class TerminusClientApplication {
+private:
+  using MessageMap = std::map<uint32_t, std::function<void(Message &)>>;
+private:
+  static constexpr int IDLE_WAIT_MS = 200;
+  /*! until the master reports its size */
+  static constexpr int TERMINAL_WIDTH = 80;
+  static constexpr int TERMINAL_HEIGHT = 24;
+  /*! pooled sessions which got no terminal in a row before the slave gives up */
+  static constexpr int MAX_POOL_FAILURES = 5;
+  static const int DEFAULT_EXEC_TIMEOUT_MS = 30000;
+  /*! ctrl+\ leaves the session running on the slave, a master with the same id attaches to it again */
+  static const char DETACH_KEY = 0x1c;
+  static constexpr int RECONNECT_TIMEOUT_MS = 60000;
+  /*! heartbeats missed before the connection counts as lost */
+  static const int HEARTBEAT_MISSED_LIMIT = 3;
 private:
   std::shared_ptr<Terminal> fShellTerminal;
+  std::shared_ptr<TerminalPool> fTerminalPool;
+  std::shared_ptr<CommandExecutor> fCommandExecutor;
   std::shared_ptr<Console> fClientConsole;
+  std::shared_ptr<EchoPredictor> fEchoPredictor;
+  std::shared_ptr<ChannelMux> fChannelMux;
+  std::mutex fPredictorMutex;
   std::shared_ptr<MessageClient> fMessageClient;
+  std::shared_ptr<RetransmitWindow> fRetransmitWindow;
+  /*! slave output compression, guarded by fSessionMutex as it has to follow the frame order */
+  std::shared_ptr<StreamCompressor> fCompressor;
+  std::shared_ptr<StreamDecompressor> fDecompressor;
+  bool fResyncRequested = false;
+  /*! slave screen model, fScreenSync is set while the master asked for screen updates instead of the raw output */
+  std::shared_ptr<Screen> fScreen;
+  std::shared_ptr<ScreenSync> fScreenSync;
+  /*! a master streaming output asked for the whole screen once */
+  bool fRepaintRequested = false;
+  std::mutex fScreenMutex;
+  /*! credit of the slave for output, credit handed back by the master for output it displayed */
+  std::shared_ptr<FlowWindow> fFlowWindow;
+  std::shared_ptr<FlowGrant> fFlowGrant;
+  /*! frame which announced the window, output the slave sent before it got that frame was not charged */
+  uint32_t fFlowStart = 0;
+  /*! keystrokes followed to their echo, always on a slave, on a master with --trace-latency */
+  std::shared_ptr<LatencyTracer> fTracer;
+  /*! guards fMessageClient replaced on reconnect and the retransmit window */
+  std::mutex fSessionMutex;
+  /*! keeps sequenced frames in order on the wire, taken before fSessionMutex which is not held while writing */
+  std::mutex fSequenceMutex;
+  int fReconnectBackoff = MessageClient::RECONNECT_MIN_BACKOFF_MS;
   std::shared_ptr<MessageParser> fMessageParser;
   cxxopts::Options fOptions;
   int fServerPort;
@@ -20,6 +75,24 @@ private:
   std::string fServerLogin;
   std::string fServerKey;
   std::string fClientId;
+  OutputCoalescer::Options fCoalescerOptions;
+  int fPoolSize = 0;
+  bool fAllowExec = false;
+  bool fPredictEcho = false;
+  bool fCompress = false;
+  bool fSyncScreen = false;
+  int fFrameRate = ScreenSync::DEFAULT_FRAME_RATE;
+  uint32_t fFlowWindowSize = FlowGrant::DEFAULT_WINDOW_SIZE;
+  int fKeepAlive = ConnectOptions::defaultKeepAliveInterval;
+  bool fTraceLatency = false;
+  std::string fMuxPath;
+  bool fDatagram = false;
+  uint32_t fCapabilities = ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING |
+                           ConnectOptions::CAPABILITY_BINARY_METADATA;
+  LossSimulator::Options fSimulator;
+  std::string fCommand;
+  std::vector<std::string> fTargets;
+  int fExecTimeout = DEFAULT_EXEC_TIMEOUT_MS;
   bool fReset = false;
 public:
 
@@ -28,11 +101,32 @@ public:
       ("v,verbose", "enable verbose output", cxxopts::value<bool>())
       ("p,port", "server port", cxxopts::value<int>())
       ("a,address", "server address", cxxopts::value<std::string>())
-      ("t,type", "client type (master/slave)", cxxopts::value<std::string>())
+      ("t,type", "client type (master/slave/exec)", cxxopts::value<std::string>())
       ("l,login", "server login", cxxopts::value<std::string>())
       ("k,key", "server key", cxxopts::value<std::string>())
       ("i,identifier", "specify client id", cxxopts::value<std::string>())
-      ("b,buffer-size", "specify buffer size", cxxopts::value<int>());
+      ("b,buffer-size", "specify buffer size", cxxopts::value<int>())
+      ("batch-size", "max output batch size in bytes (slave)", cxxopts::value<int>())
+      ("batch-delay", "max output batch delay in microseconds (slave)", cxxopts::value<int>())
+      ("pool-size", "keep this many shells spawned and serve sessions one after another (slave)", cxxopts::value<int>())
+      ("allow-exec", "run commands a controller fans out to this host (slave)", cxxopts::value<bool>())
+      ("predict", "show keystroke echo locally before the slave confirms it (master)", cxxopts::value<bool>())
+      ("compress", "ask the slave to compress its output (master)", cxxopts::value<bool>())
+      ("screen-sync", "receive screen updates at a bounded rate instead of every output byte (master)", cxxopts::value<bool>())
+      ("frame-rate", "screen updates per second with --screen-sync (master)", cxxopts::value<int>())
+      ("flow-window", "output in bytes the slave may send ahead of what is displayed, 0 turns flow control off (master)",
+       cxxopts::value<int>())
+      ("mux", "share one server connection between masters through this unix socket (master)", cxxopts::value<std::string>())
+      ("udp", "reach the server over udp instead of tcp", cxxopts::value<bool>())
+      ("keepalive", "seconds between heartbeats of the server, 0 turns them off", cxxopts::value<int>())
+      ("trace-latency", "time keystrokes on every hop to their echo and report it at exit (master)", cxxopts::value<bool>())
+      ("wire-format", "compact or legacy framing, compact is used if the server supports it", cxxopts::value<std::string>())
+      ("udp-loss", "simulated udp loss in percent", cxxopts::value<double>())
+      ("udp-delay", "simulated udp delay in milliseconds", cxxopts::value<int>())
+      ("udp-jitter", "simulated udp jitter in milliseconds", cxxopts::value<int>())
+      ("c,command", "command to run on every target (exec)", cxxopts::value<std::string>())
+      ("targets", "comma separated client ids of target slaves (exec)", cxxopts::value<std::string>())
+      ("timeout", "per host command timeout in milliseconds (exec)", cxxopts::value<int>());
   }
 
   int process(int argc, char **argv) {
@@ -42,21 +136,32 @@ public:
       DCRITICAL("%s", fOptions.help().c_str());
       return -1;
     }
+    if (fVerbose) Logger::init(Logger::LogLevel::LogLevelDebug);
 
-    fMessageClient = std::make_shared<MessageClient>();
-
-    fMessageClient->connect(fServerAddress, fServerPort);
+    fMessageParser = std::make_shared<MessageParser>(fServerLogin, fServerKey);
 
-    if (!sendConnect()) {
-      DERROR("failed to connect to server");
-      return -1;
-    }
+    if (fApplicationType == "slave" && fPoolSize > 0) return processPooledSessions();
 
-    fMessageParser = std::make_shared<MessageParser>(fServerLogin, fServerKey);
+    fMessageClient = std::make_shared<MessageClient>();
 
-    processSession();
+    if (!sendConnect(fMessageClient)) {
+      // the first master using a multiplexer socket starts the multiplexer, later ones join it
+      if (!fMuxPath.empty()) startMux();
+      fMessageClient = std::make_shared<MessageClient>();
+      if (fMuxPath.empty() || !sendConnect(fMessageClient)) {
+        DERROR("failed to connect to server");
+        return -1;
+      }
+    }
 
-    return 0;
+    auto ret = processSession();
+    if (fChannelMux) {
+      if (fChannelMux->channels() > 0)
+        std::cerr << "[waiting for " << fChannelMux->channels() << " sessions multiplexed over this connection]" << std::endl;
+      fChannelMux->wait();
+      fChannelMux.reset();
+    }
+    return ret;
   }
 
 private:
@@ -72,6 +177,51 @@ private:
       serverKey = result["key"].as<std::string>();
       applicationType = result["type"].as<std::string>();
       clientId = result["identifier"].as<std::string>();
+      if (result.count("batch-size"))
+        fCoalescerOptions.maxBatchSize = result["batch-size"].as<int>();
+      if (result.count("batch-delay"))
+        fCoalescerOptions.maxDelay = std::chrono::microseconds(result["batch-delay"].as<int>());
+      if (result.count("pool-size"))
+        fPoolSize = result["pool-size"].as<int>();
+      if (result.count("allow-exec"))
+        fAllowExec = result["allow-exec"].as<bool>();
+      if (result.count("predict"))
+        fPredictEcho = result["predict"].as<bool>();
+      if (result.count("compress"))
+        fCompress = result["compress"].as<bool>();
+      if (result.count("screen-sync"))
+        fSyncScreen = result["screen-sync"].as<bool>();
+      if (result.count("frame-rate"))
+        fFrameRate = result["frame-rate"].as<int>();
+      if (result.count("keepalive"))
+        fKeepAlive = std::max(0, std::min(result["keepalive"].as<int>(), (int) UINT16_MAX));
+      if (result.count("trace-latency"))
+        fTraceLatency = result["trace-latency"].as<bool>();
+      if (result.count("flow-window"))
+        fFlowWindowSize = (uint32_t) std::max(0, result["flow-window"].as<int>());
+      if (result.count("mux") && applicationType == "master")
+        fMuxPath = result["mux"].as<std::string>();
+      if (result.count("udp"))
+        fDatagram = result["udp"].as<bool>();
+      if (result.count("wire-format")) {
+        auto format = result["wire-format"].as<std::string>();
+        if (format != "compact" && format != "legacy") return false;
+        // batches need the compact format
+        if (format == "legacy") fCapabilities &= ~(ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING);
+      }
+      if (result.count("udp-loss"))
+        fSimulator.lossRate = result["udp-loss"].as<double>() / 100;
+      if (result.count("udp-delay"))
+        fSimulator.delay = std::chrono::milliseconds(result["udp-delay"].as<int>());
+      if (result.count("udp-jitter"))
+        fSimulator.jitter = std::chrono::milliseconds(result["udp-jitter"].as<int>());
+      if (result.count("command"))
+        fCommand = result["command"].as<std::string>();
+      if (result.count("targets"))
+        fTargets = splitList(result["targets"].as<std::string>());
+      if (result.count("timeout"))
+        fExecTimeout = result["timeout"].as<int>();
+      if (applicationType == "exec") return !fCommand.empty() && !fTargets.empty();
       if (applicationType != "master" && applicationType != "slave") return false;
     } catch (...) {
       return false;
@@ -79,118 +229,809 @@ private:
     return true;
   }
 
-  bool sendConnect() {
-    fMessageClient->connect(fServerAddress, fServerPort, false);
+  static std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+      if (!item.empty()) items.push_back(item);
+    return items;
+  }
 
-    ConnectOptions opts(fApplicationType == "master" ? ConnectionType::TypeMaster : ConnectionType::TypeSlave, fClientId);
+  bool sendConnect(const std::shared_ptr<MessageClient> &messageClient, bool resume = false) {
+    bool connected;
+    if (!fMuxPath.empty())
+      connected = messageClient->connectLocal(fMuxPath, false);
+    else if (fDatagram)
+      connected = messageClient->connectDatagram(fServerAddress, fServerPort, fServerLogin, fServerKey, fSimulator, false);
+    else
+      connected = messageClient->connect(fServerAddress, fServerPort, false);
+    if (!connected) return false;
+
+    auto connectionType = ConnectionType::TypeSlave;
+    if (fApplicationType == "master") connectionType = ConnectionType::TypeMaster;
+    if (fApplicationType == "exec") connectionType = ConnectionType::TypeController;
+    ConnectOptions opts(connectionType, fClientId);
+    opts.setResume(resume);
+    auto capabilities = fCapabilities;
+    // the multiplexer keeps its own connection alive
+    if (fKeepAlive > 0 && fMuxPath.empty()) {
+      opts.useKeepAlive((uint16_t) fKeepAlive);
+      capabilities |= ConnectOptions::CAPABILITY_HEARTBEAT;
+    }
+    // slaves always stamp traces, masters start them when asked to, the multiplexer does not pass them on
+    if (connectionType == ConnectionType::TypeSlave || (fTraceLatency && fMuxPath.empty()))
+      capabilities |= ConnectOptions::CAPABILITY_TRACE;
+    if (connectionType == ConnectionType::TypeSlave) capabilities |= ConnectOptions::CAPABILITY_DETACH_NOTICE;
+    opts.setCapabilities(capabilities);
 
     ConnectMessage::Ptr connectMessage = MessageFactory::create<ConnectMessage>(opts);
-    auto msg = MessageFactory::create<EncryptedMessage>(connectMessage, fServerLogin, fServerKey);
-    return fMessageClient->sendData((char *) msg->getBuffer().getDataPtr(), msg->getBuffer().getSize());
+    return sendMessage(connectMessage, messageClient);
+  }
+
+  void startMux() {
+    fChannelMux = std::make_shared<ChannelMux>(fMuxPath, fServerAddress, fServerPort, fServerLogin, fServerKey);
+    // fails as well if another master started one meanwhile
+    if (!fChannelMux->start()) fChannelMux.reset();
+  }
+
+  std::shared_ptr<MessageClient> getMessageClient() {
+    std::lock_guard<std::mutex> lock(fSessionMutex);
+    return fMessageClient;
+  }
+
+  /**
+   * @brief sleeps for a random part of the backoff, which doubles up to its limit until a peer frame arrives
+   */
+  void backoff(std::mt19937 &random) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(0, fReconnectBackoff)(random)));
+    fReconnectBackoff = std::min(fReconnectBackoff * 2, MessageClient::RECONNECT_MAX_BACKOFF_MS);
+  }
+
+  /**
+   * @brief reconnects with jittered exponential backoff and asks the peer to replay what was lost
+   */
+  bool reconnect() {
+    DWARN("connection to server lost, reconnecting");
+    std::mt19937 random(std::random_device{}());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RECONNECT_TIMEOUT_MS);
+    while (!fReset && std::chrono::steady_clock::now() < deadline) {
+      backoff(random);
+      auto messageClient = std::make_shared<MessageClient>();
+      if (!sendConnect(messageClient, true)) continue;
+      std::lock_guard<std::mutex> lock(fSessionMutex);
+      if (!sendMessages(fRetransmitWindow->startResume(), messageClient)) continue;
+      fMessageClient = messageClient;
+      DINFO("reconnected to server, replayed %zu frames", fRetransmitWindow->pending());
+      return true;
+    }
+    DERROR("failed to reconnect to server");
+    return false;
+  }
+
+  /**
+   * @brief receives until the session ends, reconnecting whenever the connection is lost
+   */
+  void receiveSession(const MessageMap &messageMap) {
+    while (!fReset) {
+      receiveMessages(messageMap);
+      if (fReset || !reconnect()) break;
+      // the slave was told the master detached if the server noticed the lost connection first
+      if (fFlowGrant) announceFlowWindow();
+    }
+    fReset = true;
+  }
+
+  void endSession() {
+    fReset = true;
+    auto messageClient = getMessageClient();
+    if (messageClient) messageClient->disconnect();
   }
 
-  void processSession() {
+  int processSession() {
     if (fApplicationType == "master") {
       processMasterSession();
-      return;
+      return 0;
     }
+    if (fApplicationType == "exec") return processExecSession();
     processSlaveSession();
+    return 0;
+  }
+
+  int processPooledSessions() {
+    fTerminalPool = std::make_shared<TerminalPool>(fPoolSize, TERMINAL_WIDTH, TERMINAL_HEIGHT, true);
+    fTerminalPool->start();
+    std::mt19937 random(std::random_device{}());
+    int failures = 0;
+    while (true) {
+      fReset = false;
+      fMessageClient = std::make_shared<MessageClient>();
+      if (!sendConnect(fMessageClient)) {
+        DERROR("failed to connect to server");
+        return -1;
+      }
+      if (processSlaveSession()) {
+        failures = 0;
+      } else if (++failures >= MAX_POOL_FAILURES) {
+        DERROR("no terminal for %d sessions in a row, giving up", failures);
+        return -1;
+      }
+      DINFO("session finished, %zu pooled terminals ready", fTerminalPool->available());
+      // a broken pool or a server dropping every session at once must not spin
+      backoff(random);
+    }
   }
 
-  void processSlaveSession() {
-    fShellTerminal = std::make_shared<Terminal>(80, 80, true);
-    fShellTerminal->open(false);
+  /**
+   * @return false if no terminal could be opened for the session
+   */
+  bool processSlaveSession() {
+    if (fTerminalPool) {
+      fShellTerminal = fTerminalPool->acquire();
+    } else {
+      fShellTerminal = std::make_shared<Terminal>(TERMINAL_WIDTH, TERMINAL_HEIGHT, true);
+      if (!fShellTerminal->open(false)) fShellTerminal.reset();
+    }
+    if (!fShellTerminal) {
+      DERROR("failed to open terminal");
+      fMessageClient.reset();
+      return false;
+    }
+    fRetransmitWindow = std::make_shared<RetransmitWindow>();
+    fFlowWindow = std::make_shared<FlowWindow>();
+    fScreen = std::make_shared<Screen>(TERMINAL_WIDTH, TERMINAL_HEIGHT);
+    fTracer = std::make_shared<LatencyTracer>();
     std::thread recvThread(&TerminusClientApplication::slaveReceive, this);
 
     std::thread sendTread(&TerminusClientApplication::slaveSend, this);
 
     sendTread.join();
+    endSession();
+    recvThread.join();
+    logBatchStats();
+    logSendStats();
+    logFlowStats();
+    logTraceStats();
+    fTracer.reset();
+    fFlowWindow.reset();
+    if (fCompressor) logCompressionStats();
+    fCompressor.reset();
+    if (fScreenSync) logScreenSyncStats();
+    fScreenSync.reset();
+    fScreen.reset();
     fMessageClient.reset();
     fShellTerminal.reset();
-    recvThread.join();
+    return true;
   }
 
   void slaveSend() {
+    OutputCoalescer coalescer(fCoalescerOptions);
+    bool hangUp = false;
+    while (!fReset && !hangUp) {
+      if (!coalescer.ready()) {
+        auto timeout = coalescer.getTimeout();
+        auto frameTimeout = getFrameTimeout();
+        if (timeout.count() < 0 || (frameTimeout.count() >= 0 && frameTimeout < timeout)) timeout = frameTimeout;
+        if (timeout.count() < 0) timeout = std::chrono::milliseconds(IDLE_WAIT_MS);
+        // without credit the output stays in the terminal, so the shell blocks and interrupts take effect at once
+        if (fFlowWindow->waitForCredit(timeout) && fShellTerminal->waitForData(timeout)) {
+          auto buffer = fShellTerminal->receive();
+          if (buffer.getSize() > 0) fTracer->read();
+          if (buffer.getSize() == 0)
+            hangUp = true;
+          else if (!updateScreen(buffer))
+            coalescer.append(buffer.getDataPtr(), buffer.getSize());
+        }
+      }
+      if (takeRepaint()) {
+        // the screen model has the output waiting here already
+        while (!coalescer.empty())
+          coalescer.take();
+        sendRepaint();
+      }
+      // frames that cannot be sent stay in the retransmit window until the connection is back
+      while (hangUp ? !coalescer.empty() : coalescer.ready())
+        sendOutput(coalescer.take());
+      sendScreenFrame(hangUp);
+      // traces follow the output read with them
+      if (coalescer.empty()) sendEchoedTraces();
+    }
+    auto &stats = coalescer.getStats();
+    DINFO("output batches: %lu, bytes: %lu, avg batch: %.1f, max batch: %zu, immediate: %lu, size: %lu, deadline: %lu",
+          stats.batches, stats.bytes, stats.averageBatchSize(), stats.maxBatch,
+          stats.immediateFlushes, stats.sizeFlushes, stats.deadlineFlushes);
+    fReset = true;
+  }
+
+  /**
+   * @return true if the output only goes to the screen model, because the master receives screen updates
+   */
+  bool updateScreen(const Buffer &output) {
+    std::lock_guard<std::mutex> lock(fScreenMutex);
+    fScreen->write((const char *) output.getDataPtr(), output.getSize());
+    auto replies = fScreen->takeReplies();
+    if (!fScreenSync) return false;
+    // status queries never reach the terminal of the master, so the model answers them
+    if (!replies.empty()) fShellTerminal->write(replies);
+    fScreenSync->touch();
+    return true;
+  }
+
+  std::chrono::microseconds getFrameTimeout() {
+    std::lock_guard<std::mutex> lock(fScreenMutex);
+    return fScreenSync ? fScreenSync->getTimeout() : std::chrono::microseconds(-1);
+  }
+
+  void sendScreenFrame(bool force) {
+    std::string frame;
+    {
+      std::lock_guard<std::mutex> lock(fScreenMutex);
+      if (!fScreenSync || !(force ? fScreenSync->getTimeout().count() >= 0 : fScreenSync->due())) return;
+      frame = fScreenSync->frame(*fScreen);
+    }
+    sendScreen(frame);
+  }
+
+  bool takeRepaint() {
+    std::lock_guard<std::mutex> lock(fScreenMutex);
+    auto repaint = fRepaintRequested;
+    fRepaintRequested = false;
+    return repaint;
+  }
+
+  /**
+   * @brief draws the whole screen model on the terminal of a master which streams output
+   */
+  void sendRepaint() {
+    std::string frame;
+    {
+      std::lock_guard<std::mutex> lock(fScreenMutex);
+      frame = ScreenSync().frame(*fScreen);
+    }
+    DINFO("repainting the screen of the master, %zu bytes", frame.size());
+    sendScreen(frame);
+  }
+
+  void sendScreen(const std::string &frame) {
+    // a full repaint of a large screen may not fit into one frame
+    for (size_t offset = 0; offset < frame.size(); offset += OutputCoalescer::MAX_BATCH_SIZE)
+      sendOutput(frame.substr(offset, OutputCoalescer::MAX_BATCH_SIZE));
+  }
+
+  bool sendOutput(const std::string &chars) {
+    fFlowWindow->consume(chars.size());
+    return sendChars(chars);
+  }
+
+  void logFlowStats() const {
+    auto stats = fFlowWindow->getStats();
+    DINFO("flow control %s, waits for credit: %lu, stalled: %ld ms", fFlowWindow->enabled() ? "on" : "off",
+          stats.stalls, (long) (stats.stalled.count() / 1000));
+  }
+
+  /**
+   * @param repaint the first screen update is a full one anyway, a master streaming output gets a repaint instead
+   */
+  void setDisplayMode(const DisplayModeMessage &msg, bool repaint = false) {
+    std::lock_guard<std::mutex> lock(fScreenMutex);
+    if (fScreenSync) logScreenSyncStats();
+    fScreenSync.reset();
+    if (msg.getMode() == DisplayMode::ScreenSync) fScreenSync = std::make_shared<ScreenSync>((int) msg.getFrameRate());
+    else fRepaintRequested = repaint;
+  }
+
+  void sendEchoedTraces() {
+    auto traces = fTracer->takeEchoed();
+    if (traces.empty()) return;
+    auto messageClient = getMessageClient();
+    for (auto &trace : traces)
+      sendEnvelope(trace, messageClient);
+  }
+
+  /**
+   * @brief master, follows the keystroke just sent if the server passes traces on
+   */
+  void startTrace() {
+    if (!fTracer) return;
+    auto messageClient = getMessageClient();
+    if (!messageClient || !messageClient->hasCapability(ConnectOptions::CAPABILITY_TRACE)) return;
+    auto trace = fTracer->start();
+    // not left to a batch, the server only stamps traces it sees
+    if (trace) sendEnvelope(trace, messageClient);
+  }
+
+  void logTraceStats() const {
+    auto stats = fTracer->getStats();
+    if (fApplicationType == "master") DINFO("keystroke traces: %lu, lost: %lu", stats.started, stats.expired);
+    for (int hop = 0; hop < LatencyTracer::HOP_COUNT; hop++) {
+      auto &delays = stats.hops[hop];
+      if (delays.count() == 0) continue;
+      DINFO("keystroke %s: %lu traces, p50: %lu us, p90: %lu us, p99: %lu us, max: %lu us",
+            LatencyTracer::getHopName((LatencyTracer::Hop) hop), delays.count(), delays.percentile(0.5),
+            delays.percentile(0.9), delays.percentile(0.99), delays.max());
+    }
+  }
+
+  void logScreenSyncStats() const {
+    auto &stats = fScreenSync->getStats();
+    DINFO("screen frames: %lu, full: %lu, scrolled lines: %lu, bytes: %lu",
+          stats.frames, stats.fullFrames, stats.scrolledLines, stats.bytes);
+  }
+
+  bool sendChars(const std::string &chars) {
+    return sendSequenced(MessageFactory::create<PutCharMessage>(chars));
+  }
+
+  /**
+   * @param seq set to the sequence number of the frame if not null
+   */
+  bool sendSequenced(const Message::Ptr &msg, uint32_t *seq = nullptr) {
+    std::lock_guard<std::mutex> order(fSequenceMutex);
+    SequencedMessage::Ptr frame;
+    std::shared_ptr<MessageClient> messageClient;
+    {
+      std::lock_guard<std::mutex> lock(fSessionMutex);
+      frame = fRetransmitWindow->wrap(fCompressor ? fCompressor->compress(msg) : msg);
+      messageClient = fMessageClient;
+    }
+    if (seq) *seq = frame->getSeq();
+    // input keeps being received while output waits for the socket
+    return sendMessage(frame, messageClient);
+  }
+
+  /**
+   * @brief unwraps session frames and answers resume requests, other messages are passed through
+   * @return message to dispatch, nullptr if there is nothing to dispatch
+   */
+  Message::Ptr handleSessionMessage(const Message::Ptr &msg) {
+    if (!fRetransmitWindow) return msg;
+    // a replay must not interleave with frames being sent
+    std::unique_lock<std::mutex> order(fSequenceMutex, std::defer_lock);
+    if (msg->getId() == ResumeMessage::id) order.lock();
+    std::lock_guard<std::mutex> lock(fSessionMutex);
+    switch (msg->getId()) {
+      case SequencedMessage::id: {
+        auto sequenced = msg->cast<SequencedMessage>();
+        fReconnectBackoff = MessageClient::RECONNECT_MIN_BACKOFF_MS;
+        auto peerSession = fRetransmitWindow->getPeerSession();
+        if (!fRetransmitWindow->accept(sequenced)) return nullptr;
+        // a new master has to ask for compression itself, it may not understand compressed frames
+        if (fRetransmitWindow->getPeerSession() != peerSession) {
+          if (fCompressor) logCompressionStats();
+          fCompressor.reset();
+          if (fScreen) setDisplayMode(DisplayModeMessage(DisplayMode::Stream, 0));
+          if (fFlowWindow) fFlowWindow->disable();
+        }
+        auto &payload = sequenced.getPayload();
+        return fMessageParser->parse((const uint8_t *) payload.data(), payload.size());
+      }
+      case ResumeMessage::id: {
+        auto resume = msg->cast<ResumeMessage>();
+        auto frames = fRetransmitWindow->resume(resume);
+        DINFO("peer resumed after frame %u, replaying %zu frames", resume.getLastReceived(), frames.size());
+        std::vector<Message::Ptr> replay;
+        if (!resume.isReply()) replay.push_back(fRetransmitWindow->makeResume(true));
+        replay.insert(replay.end(), frames.begin(), frames.end());
+        sendMessages(replay, fMessageClient);
+        return nullptr;
+      }
+      default:
+        return msg;
+    }
+  }
+
+  /**
+   * @brief the peer dropped frames this side never got, what they changed is requested again as far as it can be
+   * @note keystrokes of the master are gone for good, output of the slave is replaced by a repaint of its screen.
+   * Compressed output after the gap does not decompress and asks for a compressor reset by itself
+   */
+  void resyncLostFrames() {
+    uint32_t lost;
+    {
+      std::lock_guard<std::mutex> lock(fSessionMutex);
+      lost = fRetransmitWindow->takeLost();
+    }
+    if (lost == 0) return;
+    if (fApplicationType != "master") {
+      DERROR("lost %u frames of the master, their keystrokes were not written", lost);
+      // credit granted in them is gone as well, waiting for it would stall the shell for good
+      if (fFlowWindow) fFlowWindow->disable();
+      return;
+    }
+    DERROR("lost %u frames of the slave, requesting a repaint", lost);
+    sendSequenced(MessageFactory::create<DisplayModeMessage>(fSyncScreen ? DisplayMode::ScreenSync : DisplayMode::Stream,
+                                                             (uint32_t) fFrameRate));
+    // credit for the lost output never comes back from displaying it
+    if (fFlowGrant) announceFlowWindow();
+  }
+
+  /**
+   * @brief announces the window to the slave, which forgets the credit it had before
+   */
+  void announceFlowWindow() {
+    fFlowGrant->reset();
+    sendSequenced(MessageFactory::create<WindowUpdateMessage>(fFlowWindowSize, true), &fFlowStart);
+  }
+
+  /**
+   * @return true if the output just received was charged to the announced window, scrollback replayed on attach
+   * and output the slave sent before it got the window were not
+   */
+  bool isFlowCharged() {
+    std::lock_guard<std::mutex> lock(fSessionMutex);
+    return fFlowStart != 0 && fRetransmitWindow->getPeerAck() >= fFlowStart;
+  }
+
+  bool sendMessage(const Message::Ptr &msg, const std::shared_ptr<MessageClient> &messageClient) const {
+    return sendMessages({msg}, messageClient);
+  }
+
+  /**
+   * @brief sends messages in order, frames for the peer ready at the same time share one envelope
+   * @note only if the server confirmed batching, it splits batches again for peers which do not support them
+   */
+  bool sendMessages(const std::vector<Message::Ptr> &messages, const std::shared_ptr<MessageClient> &messageClient) const {
+    if (!messageClient) return false;
+    auto send = [this, &messageClient](const Message::Ptr &msg) {
+      return sendEnvelope(msg, messageClient);
+    };
+    if (messageClient->hasCapability(ConnectOptions::CAPABILITY_BATCHING)) return messageClient->getBatcher().send(messages, send);
+    bool sent = true;
+    for (auto &msg : messages)
+      sent = send(msg) && sent;
+    return sent;
+  }
+
+  /**
+   * @brief acks frames once everything read so far is delivered, a busy socket must not hold up input
+   */
+  void sendAck(const std::shared_ptr<MessageClient> &messageClient) {
+    Message::Ptr ack;
+    {
+      std::lock_guard<std::mutex> lock(fSessionMutex);
+      if (!fRetransmitWindow || !fRetransmitWindow->ackDue()) return;
+      ack = fRetransmitWindow->makeAck();
+    }
+    // not left to a batch, which may be stuck behind output
+    sendEnvelope(ack, messageClient);
+  }
+
+  bool sendEnvelope(const Message::Ptr &msg, const std::shared_ptr<MessageClient> &messageClient) const {
+    EncryptedMessage::Ptr encrypted = MessageFactory::create<EncryptedMessage>(msg, fServerLogin, fServerKey,
+                                                                               messageClient->getWireFormat());
+    return messageClient->sendData((char *) encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+  }
+
+  void executeCommand(const ExecuteCommandMessage &msg) {
+    auto requestId = msg.getRequestId();
+    auto messageClient = fMessageClient;
+    if (!fAllowExec) {
+      DWARN("refusing request %u, commands are not allowed without --allow-exec", requestId);
+      sendMessage(MessageFactory::create<CommandResultMessage>(requestId, "", CommandStatus::StatusFailed), messageClient);
+      return;
+    }
+    if (!fCommandExecutor) fCommandExecutor = std::make_shared<CommandExecutor>();
+    DINFO("executing request %u: %s", requestId, msg.getCommand().c_str());
+    auto id = fCommandExecutor->submit(msg.getCommand(), [this, requestId, messageClient](uint32_t, const std::string &chunk) {
+      sendMessage(MessageFactory::create<CommandOutputMessage>(requestId, "", chunk), messageClient);
+    }, [this, requestId, messageClient](uint32_t, const CommandExecutor::Result &result) {
+      auto status = CommandStatus::StatusFailed;
+      if (result.timedOut) status = CommandStatus::StatusTimedOut;
+      else if (result.exited()) status = CommandStatus::StatusExited;
+      sendMessage(MessageFactory::create<CommandResultMessage>(requestId, "", status, result.exitCode(),
+                                                               (uint32_t) result.elapsed.count()), messageClient);
+    }, std::chrono::milliseconds(msg.getTimeoutMs()));
+    if (id == 0)
+      sendMessage(MessageFactory::create<CommandResultMessage>(requestId, "", CommandStatus::StatusFailed), messageClient);
+  }
+
+  void receiveMessages(const MessageMap &messageMap) {
+    FrameReader frameReader;
+    Buffer frame;
+    auto messageClient = getMessageClient();
     while (!fReset) {
-      auto buffer = fShellTerminal->receive();
+      auto buffer = messageClient->receiveData();
       if (buffer.getSize() == 0) break;
-      PutCharMessage::Ptr putCharMessage = MessageFactory::create<PutCharMessage>(
-        std::string((char *) buffer.getDataPtr(), buffer.getSize()));
-      EncryptedMessage::Ptr encrypted = MessageFactory::create<EncryptedMessage>(putCharMessage, fServerLogin, fServerKey);
-      if (!fMessageClient->sendData((char *) encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize())) break;
+      frameReader.append(buffer.getDataPtr(), buffer.getSize());
+      while (frameReader.next(frame)) {
+        auto result = fMessageParser->parse(frame.getDataPtr(), frame.getSize());
+        if (!result) return;
+        if (result->getId() != BatchMessage::id) {
+          if (!dispatchMessage(result, messageMap, messageClient)) return;
+          continue;
+        }
+        auto batch = result->cast<BatchMessage>();
+        for (auto &data : batch.getMessages()) {
+          auto msg = fMessageParser->parse((const uint8_t *) data.data(), data.size());
+          if (!msg || !dispatchMessage(msg, messageMap, messageClient)) return;
+        }
+      }
+      sendAck(messageClient);
+      if (frameReader.failed()) break;
     }
-    fReset = true;
+  }
+
+  /**
+   * @return false if the message is not understood, the connection is dropped then
+   */
+  bool dispatchMessage(Message::Ptr msg, const MessageMap &messageMap, const std::shared_ptr<MessageClient> &messageClient) {
+    if (messageClient->acceptCapabilities(*msg)) {
+      if (messageClient->hasCapability(ConnectOptions::CAPABILITY_HEARTBEAT))
+        messageClient->setReceiveTimeout(std::chrono::seconds(fKeepAlive * HEARTBEAT_MISSED_LIMIT));
+      return true;
+    }
+    if (msg->getId() == HeartbeatMessage::id) {
+      sendEnvelope(MessageFactory::create<HeartbeatMessage>(msg->cast<HeartbeatMessage>().getTimestamp(), true), messageClient);
+      return true;
+    }
+    if (msg->getId() == MasterDetachedMessage::id) {
+      // no credit comes back until another master announces its window
+      DINFO("master detached, flow control is off");
+      if (fFlowWindow) fFlowWindow->disable();
+      return true;
+    }
+    if (msg->getId() == TraceMessage::id) {
+      // frames before it are handled, so the keystroke is written or its echo displayed
+      auto trace = msg->cast<TraceMessage>();
+      if (fTracer && fApplicationType == "master") fTracer->finish(trace);
+      else if (fTracer) fTracer->written(trace);
+      return true;
+    }
+    auto unwrapped = handleSessionMessage(msg);
+    auto fromPeer = unwrapped != msg;
+    if (fromPeer) resyncLostFrames();
+    msg = unwrapped;
+    if (msg) msg = expandMessage(msg);
+    if (!msg) return true;
+    // commands come from the server fanning out for a controller, never from the peer
+    if (fromPeer && msg->getId() == ExecuteCommandMessage::id) {
+      DWARN("ignoring a command from the peer");
+      return true;
+    }
+    auto item = messageMap.find(msg->getId());
+    // a newer peer may send messages this side does not know yet
+    if (item == messageMap.end() && fromPeer) {
+      DWARN("ignoring unknown message %08x from the peer", msg->getId());
+      return true;
+    }
+    if (item == messageMap.end()) return false;
+    item->second(*msg);
+    return true;
+  }
+
+  /**
+   * @return the message a compressed frame carries, nullptr if it cannot be decompressed
+   */
+  Message::Ptr expandMessage(const Message::Ptr &msg) {
+    if (msg->getId() != CompressedMessage::id) return msg;
+    if (!fDecompressor) return nullptr;
+    auto compressed = msg->cast<CompressedMessage>();
+    std::string payload;
+    if (!fDecompressor->decompress(compressed, payload)) {
+      // output up to the next reset is lost, the slave starts one when asked
+      if (fCompress && !fResyncRequested) {
+        DWARN("lost track of compressed output, requesting a reset");
+        fResyncRequested = true;
+        sendSequenced(MessageFactory::create<CompressionRequestMessage>(CompressionType::Deflate));
+      }
+      return nullptr;
+    }
+    if (compressed.isReset()) fResyncRequested = false;
+    return fMessageParser->parse((const uint8_t *) payload.data(), payload.size());
+  }
+
+  void logBatchStats() const {
+    if (!fMessageClient) return;
+    auto stats = fMessageClient->getBatcher().getStats();
+    DINFO("batched messages: %lu of %lu in %lu envelopes", stats.batchedMessages, stats.messages, stats.batches);
+  }
+
+  void logSendStats() const {
+    if (!fMessageClient) return;
+    auto stats = fMessageClient->getSendStats();
+    for (auto lane : {Lane::Interactive, Lane::Bulk}) {
+      auto &delays = stats.getDelays(lane);
+      DINFO("%s frames: %lu, queue delay p50: %lu us, p99: %lu us, max: %lu us",
+            lane == Lane::Interactive ? "interactive" : "bulk", delays.count(), delays.percentile(0.5),
+            delays.percentile(0.99), delays.max());
+    }
+  }
+
+  void logCompressionStats() const {
+    auto &stats = fCompressor->getStats();
+    DINFO("compressed frames: %lu of %lu, resets: %lu, bytes: %lu -> %lu, ratio: %.2f",
+          stats.compressedFrames, stats.frames, stats.resets, stats.bytesIn, stats.bytesOut, stats.ratio());
   }
 
   void slaveReceive() {
-    static const std::map<uint32_t, std::function<void(Message &)>> messageMap = {
+    static const MessageMap messageMap = {
       {ResizeTerminalMessage::id, [&](Message &msg) {
         auto resizeMsg = msg.cast<ResizeTerminalMessage>();
         fShellTerminal->setSize((int) resizeMsg.getWidth(), (int) resizeMsg.getHeight());
+        std::lock_guard<std::mutex> lock(fScreenMutex);
+        fScreen->resize((int) resizeMsg.getWidth(), (int) resizeMsg.getHeight());
+        if (fScreenSync) fScreenSync->invalidate();
       }},
       {PutCharMessage::id,        [&](Message &msg) {
         auto putCharMsg = msg.cast<PutCharMessage>();
         fShellTerminal->write(putCharMsg.getChars());
+        fTracer->keystroke();
+      }},
+      {ExecuteCommandMessage::id, [&](Message &msg) {
+        executeCommand(msg.cast<ExecuteCommandMessage>());
+      }},
+      {DisplayModeMessage::id,    [&](Message &msg) {
+        setDisplayMode(msg.cast<DisplayModeMessage>(), true);
+      }},
+      {WindowUpdateMessage::id,   [&](Message &msg) {
+        auto update = msg.cast<WindowUpdateMessage>();
+        if (update.isReset()) fFlowWindow->reset(update.getCredit());
+        else fFlowWindow->grant(update.getCredit());
+      }},
+      {CompressionRequestMessage::id, [&](Message &msg) {
+        auto type = msg.cast<CompressionRequestMessage>().getType();
+        std::lock_guard<std::mutex> lock(fSessionMutex);
+        if (type != CompressionType::Deflate) {
+          fCompressor.reset();
+          return;
+        }
+        if (fCompressor) fCompressor->reset();
+        else fCompressor = std::make_shared<StreamCompressor>();
       }},
     };
-    while (!fReset) {
-      auto buffer = fMessageClient->receiveData();
-      if (buffer.getSize() == 0) break;
-      auto result = fMessageParser->parse(buffer.getDataPtr(), buffer.getSize());
-      if (!result) break;
-      auto item = messageMap.find(result->getId());
-      if (item == messageMap.end()) break;
-      Message &msg = *result;
-      item->second(msg);
-    }
-    fReset = true;
+    receiveSession(messageMap);
   }
 
   void processMasterSession() {
     fClientConsole = std::make_shared<Console>();
-    fClientConsole->setup();
+    fRetransmitWindow = std::make_shared<RetransmitWindow>();
+    if (fPredictEcho) fEchoPredictor = std::make_shared<EchoPredictor>();
+    if (fTraceLatency) fTracer = std::make_shared<LatencyTracer>();
+    // compressed scrollback may arrive even when not asking for compression
+    fDecompressor = std::make_shared<StreamDecompressor>();
+    if (fCompress) {
+      fResyncRequested = true;
+      sendSequenced(MessageFactory::create<CompressionRequestMessage>(CompressionType::Deflate));
+    }
+    if (fSyncScreen)
+      sendSequenced(MessageFactory::create<DisplayModeMessage>(DisplayMode::ScreenSync, (uint32_t) fFrameRate));
+    if (fFlowWindowSize > 0) {
+      fFlowGrant = std::make_shared<FlowGrant>(fFlowWindowSize);
+      announceFlowWindow();
+    }
+    fClientConsole->setupWindowSizeHandler([this](int width, int height) {
+      if (width <= 0 || height <= 0) return;
+      if (fEchoPredictor) {
+        std::lock_guard<std::mutex> lock(fPredictorMutex);
+        fEchoPredictor->setWidth(width);
+      }
+      sendSequenced(MessageFactory::create<ResizeTerminalMessage>(width, height));
+    });
+    fClientConsole->setup(false);
 
     std::thread recvThread(&TerminusClientApplication::masterReceive, this);
 
     std::thread sendTread(&TerminusClientApplication::masterSend, this);
 
     sendTread.join();
+    endSession();
+    recvThread.join();
+    if (fEchoPredictor) {
+      auto &stats = fEchoPredictor->getStats();
+      DINFO("echo predictions: %lu, confirmed: %lu, rolled back: %lu", stats.predictions, stats.confirmed, stats.rollbacks);
+    }
+    logSendStats();
+    if (fTracer) logTraceStats();
+    fTracer.reset();
     fMessageClient.reset();
     fClientConsole.reset();
-    recvThread.join();
   }
 
   void masterReceive() {
-    const static std::map<uint32_t, std::function<void(Message &)>> messageMap = {
+    const static MessageMap messageMap = {
       {PutCharMessage::id, [&](Message &msg) {
         auto putCharMsg = msg.cast<PutCharMessage>();
-        fClientConsole->display(putCharMsg.getChars());
+        fClientConsole->display(predictOutput(putCharMsg.getChars()));
+        if (fTracer) fTracer->displayed();
+        // credit goes back once the output is on the screen, a slow terminal throttles the slave as well
+        auto credit = fFlowGrant && isFlowCharged() ? fFlowGrant->consume(putCharMsg.getChars().size()) : 0;
+        if (credit > 0) sendSequenced(MessageFactory::create<WindowUpdateMessage>(credit, false));
       }}
     };
-    while (!fReset) {
-      auto buffer = fMessageClient->receiveData();
-      if (buffer.getSize() == 0) break;
-      auto result = fMessageParser->parse(buffer.getDataPtr(), buffer.getSize());
-      if (!result) break;
-      auto item = messageMap.find(result->getId());
-      if (item == messageMap.end()) break;
-      Message &msg = *result;
-      item->second(msg);
-    }
-    fReset = true;
+    receiveSession(messageMap);
+  }
+
+  int processExecSession() {
+    std::map<std::string, std::string> pendingLines;
+    int failed = 0;
+    auto printLines = [&](const std::string &clientId, bool flush) {
+      auto &pending = pendingLines[clientId];
+      size_t pos;
+      while ((pos = pending.find('\n')) != std::string::npos) {
+        auto line = pending.substr(0, pos);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::cout << "[" << clientId << "] " << line << std::endl;
+        pending.erase(0, pos + 1);
+      }
+      if (flush && !pending.empty()) {
+        std::cout << "[" << clientId << "] " << pending << std::endl;
+        pending.clear();
+      }
+    };
+    const MessageMap messageMap = {
+      {CommandOutputMessage::id, [&](Message &msg) {
+        auto outputMsg = msg.cast<CommandOutputMessage>();
+        pendingLines[outputMsg.getClientId()] += outputMsg.getChars();
+        printLines(outputMsg.getClientId(), false);
+      }},
+      {CommandResultMessage::id, [&](Message &msg) {
+        auto resultMsg = msg.cast<CommandResultMessage>();
+        printLines(resultMsg.getClientId(), true);
+        std::string status;
+        switch (resultMsg.getStatus()) {
+          case CommandStatus::StatusExited:
+            status = "exit " + std::to_string(resultMsg.getExitCode());
+            break;
+          case CommandStatus::StatusTimedOut:
+            status = "timed out";
+            break;
+          case CommandStatus::StatusUnreachable:
+            status = "unreachable";
+            break;
+          default:
+            status = "failed";
+            break;
+        }
+        std::cout << "[" << resultMsg.getClientId() << "] " << status << " (" << resultMsg.getElapsedMs() << " ms)" << std::endl;
+      }},
+      {ResponseMessage::id, [&](Message &msg) {
+        auto progress = msg.cast<ResponseMessage>();
+        uint64_t completed = 0, total = 0, failedHosts = 0;
+        progress.getUnsigned("completed", completed);
+        progress.getUnsigned("total", total);
+        progress.getUnsigned("failed", failedHosts);
+        std::cerr << "-- " << completed << "/" << total << " hosts done, " << failedHosts << " failed" << std::endl;
+        failed = failedHosts;
+        if (completed == total) fReset = true;
+      }},
+    };
+
+    auto request = MessageFactory::create<ExecuteCommandMessage>(1, fCommand, fExecTimeout, fTargets);
+    if (!sendMessage(request, fMessageClient)) return -1;
+    receiveMessages(messageMap);
+    return failed ? 1 : 0;
   }
 
   void masterSend() {
     while (!fReset) {
       auto buffer = fClientConsole->read();
       if (buffer.getSize() == 0) break;
-      PutCharMessage::Ptr putCharMessage = MessageFactory::create<PutCharMessage>(
-        std::string((char *) buffer.getDataPtr(), buffer.getSize()));
-      EncryptedMessage::Ptr encrypted = MessageFactory::create<EncryptedMessage>(putCharMessage, fServerLogin, fServerKey);
-      if (!fMessageClient->sendData((char *) encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize())) break;
+      std::string chars((char *) buffer.getDataPtr(), buffer.getSize());
+      auto detach = chars.find(DETACH_KEY);
+      if (detach != std::string::npos) {
+        if (detach > 0) sendChars(chars.substr(0, detach));
+        fClientConsole->display("\r\n[detached from " + fClientId + "]\r\n");
+        break;
+      }
+      auto echo = predictInput(chars);
+      if (!echo.empty()) fClientConsole->display(echo);
+      sendChars(chars);
+      startTrace();
     }
     fReset = true;
   }
+
+  std::string predictInput(const std::string &keys) {
+    if (!fEchoPredictor) return {};
+    std::lock_guard<std::mutex> lock(fPredictorMutex);
+    return fEchoPredictor->input(keys);
+  }
+
+  std::string predictOutput(const std::string &output) {
+    if (!fEchoPredictor) return output;
+    std::lock_guard<std::mutex> lock(fPredictorMutex);
+    return fEchoPredictor->output(output);
+  }
 };
 
 int main(int argc, char **argv) {
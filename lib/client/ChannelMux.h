@@ -0,0 +1,347 @@
+#ifndef TERMINUS_CHANNELMUX_H
+#define TERMINUS_CHANNELMUX_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <condition_variable>
+
+#include <client/MessageClient.h>
+#include <message/MessageParser.h>
+#include <message/FrameReader.h>
+
+/**
+ * @brief carries the sessions of local masters over a single server connection
+ * @note masters connect to a unix socket and speak the usual protocol, every local connection becomes a channel.
+ * Server data is queued per channel and credit goes back to the server once the data was written to the master,
+ * so a master which stops reading only stalls its own session.
+ */
+class ChannelMux {
+public:
+  /*! credit is returned in chunks of a quarter of the server side window */
+  static constexpr uint32_t WINDOW_UPDATE_SIZE = 64 * 1024;
+private:
+  static const int BUFFER_SIZE = 4096;
+
+  struct Channel {
+    int socket = -1;
+    bool opened = false;
+    bool closing = false;
+    FrameReader frameReader;
+    std::deque<std::string> queue;
+    size_t queueOffset = 0;
+    uint32_t written = 0;
+  };
+private:
+  std::string fPath;
+  std::string fServerAddress;
+  int fServerPort;
+  std::string fLogin;
+  std::string fKey;
+  MessageParser fMessageParser;
+  int fListenSocket = -1;
+  int fWakeupPipe[2] = {-1, -1};
+  std::shared_ptr<MessageClient> fUpstream;
+  FrameReader fUpstreamReader;
+  std::map<uint32_t, Channel> fChannels;
+  uint32_t fNextChannel = 1;
+  int fReconnectBackoff = MessageClient::RECONNECT_MIN_BACKOFF_MS;
+  bool fStop = false;
+  mutable std::mutex fMutex;
+  std::condition_variable fChannelsFlag;
+  std::thread fLoopThread;
+public:
+  ChannelMux(std::string path, std::string serverAddress, int serverPort, std::string login, std::string key) :
+    fPath(std::move(path)), fServerAddress(std::move(serverAddress)), fServerPort(serverPort),
+    fLogin(std::move(login)), fKey(std::move(key)), fMessageParser(fLogin, fKey) {
+  }
+
+  ~ChannelMux() {
+    stop();
+  }
+
+  /**
+   * @return false if the server is not reachable or the socket belongs to a running multiplexer
+   */
+  bool start() {
+    fUpstream = connectUpstream();
+    if (!fUpstream || !listenLocal()) return false;
+    if (pipe2(fWakeupPipe, O_NONBLOCK | O_CLOEXEC) != 0) return false;
+    fLoopThread = std::thread(&ChannelMux::loop, this);
+    DINFO("multiplexing sessions over %s", fPath.c_str());
+    return true;
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (fStop) return;
+      fStop = true;
+    }
+    if (fLoopThread.joinable()) {
+      char c = 0;
+      (void) ::write(fWakeupPipe[1], &c, 1);
+      fLoopThread.join();
+    }
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      for (auto &item : fChannels)
+        close(item.second.socket);
+      fChannels.clear();
+    }
+    fChannelsFlag.notify_all();
+    if (fListenSocket != -1) {
+      close(fListenSocket);
+      unlink(fPath.c_str());
+    }
+    if (fWakeupPipe[0] != -1) close(fWakeupPipe[0]);
+    if (fWakeupPipe[1] != -1) close(fWakeupPipe[1]);
+  }
+
+  size_t channels() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fChannels.size();
+  }
+
+  /**
+   * @brief blocks until every local master has gone
+   */
+  void wait() {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fChannelsFlag.wait(lock, [this] { return fStop || fChannels.empty(); });
+  }
+
+private:
+
+  std::shared_ptr<MessageClient> connectUpstream() {
+    auto upstream = std::make_shared<MessageClient>();
+    if (!upstream->connect(fServerAddress, fServerPort, false)) return nullptr;
+    ConnectOptions opts(ConnectionType::TypeMux, fPath);
+    opts.setCapabilities(ConnectOptions::CAPABILITY_COMPACT);
+    if (!sendUpstream(upstream, MessageFactory::create<ConnectMessage>(opts))) return nullptr;
+    fUpstreamReader = FrameReader();
+    return upstream;
+  }
+
+  bool listenLocal() {
+    sockaddr_un address = {};
+    if (fPath.size() >= sizeof(address.sun_path)) return false;
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, fPath.c_str(), sizeof(address.sun_path) - 1);
+    fListenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fListenSocket == -1) return false;
+    if (::bind(fListenSocket, (sockaddr *) &address, sizeof(address)) == -1 && errno == EADDRINUSE) {
+      // a socket nobody accepts on is left over from a multiplexer which did not exit cleanly
+      MessageClient probe;
+      if (probe.connectLocal(fPath, false)) {
+        close(fListenSocket);
+        fListenSocket = -1;
+        return false;
+      }
+      unlink(fPath.c_str());
+      if (::bind(fListenSocket, (sockaddr *) &address, sizeof(address)) == -1) {
+        close(fListenSocket);
+        fListenSocket = -1;
+        return false;
+      }
+    }
+    if (::listen(fListenSocket, SOMAXCONN) == -1) {
+      close(fListenSocket);
+      unlink(fPath.c_str());
+      fListenSocket = -1;
+      return false;
+    }
+    return true;
+  }
+
+  bool sendUpstream(const std::shared_ptr<MessageClient> &upstream, const Message::Ptr &msg) {
+    auto encrypted = MessageFactory::create<EncryptedMessage>(msg, fLogin, fKey, upstream->getWireFormat());
+    return upstream->sendData((const char *) encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+  }
+
+  bool sendUpstreamRaw(const Message::Ptr &msg) {
+    auto frame = CompactCodec::makeFrame(msg, fUpstream->getWireFormat());
+    return fUpstream->sendData(frame.data(), frame.size());
+  }
+
+  void loop() {
+    std::vector<pollfd> pfds;
+    std::vector<uint32_t> ids;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fStop) return;
+      }
+      pfds.clear();
+      ids.clear();
+      pfds.push_back({fWakeupPipe[0], POLLIN, 0});
+      pfds.push_back({fListenSocket, POLLIN, 0});
+      pfds.push_back({fUpstream ? fUpstream->getSocket() : -1, POLLIN, 0});
+      for (auto &item : fChannels) {
+        short events = POLLIN;
+        if (!item.second.queue.empty()) events |= POLLOUT;
+        pfds.push_back({item.second.socket, events, 0});
+        ids.push_back(item.first);
+      }
+
+      int ret = poll(pfds.data(), pfds.size(), fUpstream ? -1 : fReconnectBackoff);
+      if (ret < 0 && errno != EINTR) return;
+      if (pfds[0].revents) {
+        char buf[64];
+        while (::read(fWakeupPipe[0], buf, sizeof(buf)) > 0);
+      }
+      if (!fUpstream) {
+        reconnectUpstream();
+        continue;
+      }
+      if (pfds[1].revents & POLLIN) acceptChannel();
+      if (pfds[2].revents && !receiveUpstream()) {
+        DWARN("connection to server lost, dropping %zu channels", fChannels.size());
+        fUpstream.reset();
+        closeAllChannels();
+        continue;
+      }
+      for (size_t i = 3; i < pfds.size(); i++) {
+        auto item = fChannels.find(ids[i - 3]);
+        if (item == fChannels.end()) continue;
+        if (pfds[i].revents & POLLOUT) writeChannel(item->first, item->second);
+        if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) readChannel(item->first, item->second);
+      }
+      removeClosedChannels();
+    }
+  }
+
+  void reconnectUpstream() {
+    std::mt19937 random(std::random_device{}());
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(0, fReconnectBackoff)(random)));
+    fReconnectBackoff = std::min(fReconnectBackoff * 2, MessageClient::RECONNECT_MAX_BACKOFF_MS);
+    fUpstream = connectUpstream();
+    if (!fUpstream) return;
+    fReconnectBackoff = MessageClient::RECONNECT_MIN_BACKOFF_MS;
+    DINFO("reconnected to server");
+  }
+
+  void acceptChannel() {
+    int sock = accept4(fListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (sock == -1) return;
+    std::lock_guard<std::mutex> lock(fMutex);
+    while (fNextChannel == 0 || fChannels.find(fNextChannel) != fChannels.end())
+      fNextChannel++;
+    fChannels[fNextChannel++].socket = sock;
+  }
+
+  /**
+   * @brief the first frame of a master is its connect message, it opens the channel, later frames are forwarded as they are
+   */
+  void readChannel(uint32_t id, Channel &channel) {
+    uint8_t buffer[BUFFER_SIZE];
+    auto size = recv(channel.socket, buffer, sizeof(buffer), 0);
+    if (size < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (size <= 0) {
+      closeChannel(id, channel);
+      return;
+    }
+    channel.frameReader.append(buffer, size);
+    Buffer frame;
+    while (channel.frameReader.next(frame)) {
+      if (channel.opened) {
+        sendUpstreamRaw(MessageFactory::create<ChannelDataMessage>(
+          id, std::string((const char *) frame.getDataPtr(), frame.getSize())));
+        continue;
+      }
+      auto msg = fMessageParser.parse(frame.getDataPtr(), frame.getSize());
+      if (!msg || msg->getId() != ConnectMessage::id) {
+        DERROR("channel %u did not start with a connect message", id);
+        closeChannel(id, channel);
+        return;
+      }
+      auto &options = msg->cast<ConnectMessage>().getConnectOptions();
+      DINFO("opening channel %u for %s", id, options.getClientId().c_str());
+      sendUpstream(fUpstream, MessageFactory::create<OpenChannelMessage>(id, options));
+      channel.opened = true;
+    }
+    if (channel.frameReader.failed()) closeChannel(id, channel);
+  }
+
+  void writeChannel(uint32_t id, Channel &channel) {
+    while (!channel.queue.empty()) {
+      auto &data = channel.queue.front();
+      auto sent = send(channel.socket, data.data() + channel.queueOffset, data.size() - channel.queueOffset, MSG_NOSIGNAL);
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent < 0 && errno == EAGAIN) break;
+      if (sent <= 0) {
+        closeChannel(id, channel);
+        return;
+      }
+      channel.queueOffset += sent;
+      channel.written += sent;
+      if (channel.queueOffset == data.size()) {
+        channel.queue.pop_front();
+        channel.queueOffset = 0;
+      }
+    }
+    if (channel.written >= WINDOW_UPDATE_SIZE) {
+      sendUpstream(fUpstream, MessageFactory::create<ChannelWindowMessage>(id, channel.written));
+      channel.written = 0;
+    }
+  }
+
+  bool receiveUpstream() {
+    auto data = fUpstream->receiveData();
+    if (data.getSize() == 0) return false;
+    fUpstreamReader.append(data.getDataPtr(), data.getSize());
+    Buffer frame;
+    while (fUpstreamReader.next(frame)) {
+      auto msg = fMessageParser.parse(frame.getDataPtr(), frame.getSize());
+      if (!msg || fUpstream->acceptCapabilities(*msg)) continue;
+      if (msg->getId() == ChannelDataMessage::id) {
+        auto channelData = msg->cast<ChannelDataMessage>();
+        auto item = fChannels.find(channelData.getChannel());
+        if (item != fChannels.end() && !item->second.closing) item->second.queue.push_back(channelData.getPayload());
+      } else if (msg->getId() == CloseChannelMessage::id) {
+        auto item = fChannels.find(msg->cast<CloseChannelMessage>().getChannel());
+        if (item != fChannels.end()) item->second.closing = true;
+      }
+    }
+    return !fUpstreamReader.failed();
+  }
+
+  void closeChannel(uint32_t id, Channel &channel) {
+    if (channel.closing) return;
+    channel.closing = true;
+    if (channel.opened && fUpstream) sendUpstream(fUpstream, MessageFactory::create<CloseChannelMessage>(id));
+  }
+
+  void closeAllChannels() {
+    for (auto &item : fChannels)
+      item.second.closing = true;
+    removeClosedChannels();
+  }
+
+  void removeClosedChannels() {
+    bool removed = false;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      for (auto it = fChannels.begin(); it != fChannels.end();) {
+        if (!it->second.closing) {
+          ++it;
+          continue;
+        }
+        close(it->second.socket);
+        it = fChannels.erase(it);
+        removed = true;
+      }
+    }
+    if (removed) fChannelsFlag.notify_all();
+  }
+};
+
+
+#endif //TERMINUS_CHANNELMUX_H
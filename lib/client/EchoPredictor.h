@@ -0,0 +1,301 @@
+#ifndef TERMINUS_ECHOPREDICTOR_H
+#define TERMINUS_ECHOPREDICTOR_H
+
+#include <deque>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief speculative local echo for a master on a slow link
+ * @note keystrokes are matched against a model of the cursor line, their expected echo is shown at once and
+ * swallowed when the real echo arrives. Any other output rolls unconfirmed predictions back by redrawing the line.
+ * After keys which cannot be predicted (enter, control keys) predictions stay hidden until one is confirmed,
+ * so input of prompts without echo is never shown.
+ */
+class EchoPredictor {
+public:
+  struct Stats {
+    uint64_t predictions = 0;
+    uint64_t confirmed = 0;
+    uint64_t rollbacks = 0;
+  };
+
+private:
+  static constexpr char ESC = 0x1b;
+  /*! column limit while the width of the terminal is not known, escape parameters are clamped to it as well */
+  static constexpr size_t MAX_COLUMN = 0xFFFF;
+
+  struct Prediction {
+    std::string expected;
+    size_t matched = 0;
+    bool shown = false;
+  };
+
+  /*! cursor line as the server drew it, invalid after output which cannot be followed */
+  struct Line {
+    std::string text;
+    size_t column = 0;
+    bool valid = true;
+  };
+
+private:
+  Line fConfirmed;
+  Line fPredicted;
+  std::deque<Prediction> fPending;
+  std::string fEscape;
+  std::string fInputEscape;
+  size_t fWidth = 0;
+  bool fActive = false;
+  Stats fStats;
+
+public:
+  void setWidth(size_t width) {
+    fWidth = width;
+  }
+
+  bool isActive() const {
+    return fActive;
+  }
+
+  size_t pending() const {
+    return fPending.size();
+  }
+
+  const Stats &getStats() const {
+    return fStats;
+  }
+
+  /**
+   * @return bytes to show locally for keys typed by the user
+   */
+  std::string input(const std::string &keys) {
+    std::string display;
+    for (char key : keys) {
+      if (!fInputEscape.empty() || key == ESC) {
+        fInputEscape += key;
+        if (!isEscapeComplete(fInputEscape)) continue;
+        auto sequence = fInputEscape;
+        fInputEscape.clear();
+        if (sequence == "\x1b[D" || sequence == "\x1bOD") {
+          if (!predictCursorLeft(display)) stopPredicting();
+        } else if (sequence == "\x1b[C" || sequence == "\x1bOC") {
+          if (!predictCursorRight(display)) stopPredicting();
+        } else {
+          stopPredicting();
+        }
+        continue;
+      }
+      if (!isPrintable(key) || !predictChar(key, display))
+        stopPredicting();
+    }
+    return display;
+  }
+
+  /**
+   * @return bytes to show for output received from the slave
+   */
+  std::string output(const std::string &data) {
+    std::string display;
+    size_t pos = 0;
+    while (!fPending.empty() && pos < data.size()) {
+      auto &prediction = fPending.front();
+      auto remaining = prediction.expected.size() - prediction.matched;
+      size_t n = 0;
+      while (n < remaining && pos + n < data.size() && data[pos + n] == prediction.expected[prediction.matched + n])
+        n++;
+      if (n < remaining && pos + n < data.size()) {
+        rollback(display);
+        break;
+      }
+      auto chunk = data.substr(pos, n);
+      if (!prediction.shown) display += chunk;
+      feed(fConfirmed, chunk);
+      prediction.matched += n;
+      pos += n;
+      if (prediction.matched < prediction.expected.size()) break;
+      if (!prediction.shown) fActive = true;
+      fStats.confirmed++;
+      fPending.pop_front();
+    }
+    auto rest = data.substr(pos);
+    display += rest;
+    feed(fConfirmed, rest);
+    if (fPending.empty()) fPredicted = fConfirmed;
+    return display;
+  }
+
+private:
+
+  static bool isPrintable(char c) {
+    return c >= 0x20 && c < 0x7f;
+  }
+
+  static bool isEscapeComplete(const std::string &sequence) {
+    if (sequence.size() < 2) return false;
+    if (sequence[1] == '[') return sequence.size() > 2 && sequence.back() >= 0x40 && sequence.back() <= 0x7e;
+    if (sequence[1] == 'O') return sequence.size() > 2;
+    return true;
+  }
+
+  bool canPredict() const {
+    return fPredicted.valid && fConfirmed.valid && (fWidth == 0 || fPredicted.text.size() + 1 < fWidth);
+  }
+
+  void predict(const std::string &expected, std::string &display) {
+    Prediction prediction;
+    prediction.expected = expected;
+    prediction.shown = fActive;
+    if (prediction.shown) display += expected;
+    feed(fPredicted, expected);
+    fPending.push_back(prediction);
+    fStats.predictions++;
+  }
+
+  bool predictChar(char key, std::string &display) {
+    if (!canPredict()) return false;
+    auto tail = fPredicted.text.substr(std::min(fPredicted.column, fPredicted.text.size()));
+    // inserting in the middle of the line redraws the rest of it, the way readline does
+    predict(key + tail + std::string(tail.size(), '\b'), display);
+    return true;
+  }
+
+  bool predictCursorLeft(std::string &display) {
+    if (!canPredict() || fPredicted.column == 0) return false;
+    predict("\b", display);
+    return true;
+  }
+
+  bool predictCursorRight(std::string &display) {
+    if (!canPredict() || fPredicted.column >= fPredicted.text.size()) return false;
+    predict(std::string(1, fPredicted.text[fPredicted.column]), display);
+    return true;
+  }
+
+  /**
+   * @brief keys after this point are predicted without being shown until one of them is confirmed
+   */
+  void stopPredicting() {
+    fActive = false;
+    fPredicted.valid = false;
+  }
+
+  void rollback(std::string &display) {
+    bool shown = false;
+    for (auto &prediction : fPending)
+      shown |= prediction.shown;
+    fPending.clear();
+    fActive = false;
+    fPredicted = fConfirmed;
+    if (!shown) return;
+    fStats.rollbacks++;
+    if (!fConfirmed.valid) return;
+    display += "\r" + fConfirmed.text + "\x1b[K\r";
+    if (fConfirmed.column > 0) display += "\x1b[" + std::to_string(fConfirmed.column) + "C";
+  }
+
+  void feed(Line &line, const std::string &data) {
+    for (char c : data) {
+      if (!fEscape.empty() || c == ESC) {
+        if (&line != &fConfirmed) {
+          line.valid = false;
+          continue;
+        }
+        fEscape += c;
+        if (!isSequenceComplete(fEscape)) continue;
+        applyEscape(line, fEscape);
+        fEscape.clear();
+        continue;
+      }
+      switch (c) {
+        case '\r':
+          line.column = 0;
+          break;
+        case '\n':
+          line.text = std::string(line.column, ' ');
+          line.valid = true;
+          break;
+        case '\b':
+          if (line.column > 0) line.column--;
+          break;
+        case '\a':
+          break;
+        default:
+          // past the right margin the terminal wraps, which is not followed
+          if (!isPrintable(c) || line.column >= getMaxColumn()) {
+            line.valid = false;
+            break;
+          }
+          if (line.column >= line.text.size()) line.text.resize(line.column + 1, ' ');
+          line.text[line.column++] = c;
+          break;
+      }
+    }
+  }
+
+  static bool isSequenceComplete(const std::string &sequence) {
+    if (sequence.size() < 2) return false;
+    switch (sequence[1]) {
+      case '[':
+        return sequence.size() > 2 && sequence.back() >= 0x40 && sequence.back() <= 0x7e;
+      case ']':
+        // title and other operating system commands end with BEL or ST
+        return sequence.back() == '\a' || (sequence.size() > 3 && sequence[sequence.size() - 2] == ESC && sequence.back() == '\\');
+      default:
+        return true;
+    }
+  }
+
+  size_t getMaxColumn() const {
+    return fWidth > 0 ? std::min(fWidth, MAX_COLUMN) : MAX_COLUMN;
+  }
+
+  static size_t parseCount(const std::string &params) {
+    size_t count = 0;
+    for (char digit : params)
+      count = std::min<size_t>(count * 10 + (digit - '0'), MAX_COLUMN);
+    return count;
+  }
+
+  void applyEscape(Line &line, const std::string &sequence) const {
+    if (sequence[1] == ']') return;
+    if (sequence[1] != '[') {
+      line.valid = false;
+      return;
+    }
+    auto params = sequence.substr(2, sequence.size() - 3);
+    auto final = sequence.back();
+    // private modes such as bracketed paste and colors do not move anything
+    if (final == 'm' || (!params.empty() && params[0] == '?' && (final == 'h' || final == 'l'))) return;
+    if (params.find_first_not_of("0123456789") != std::string::npos) {
+      line.valid = false;
+      return;
+    }
+    size_t count = params.empty() ? 1 : parseCount(params);
+    switch (final) {
+      case 'K':
+        if (params.empty() || params == "0") {
+          if (line.column < line.text.size()) line.text.resize(line.column);
+        } else {
+          line.valid = false;
+        }
+        break;
+      case 'C':
+        line.column += count;
+        if (line.column > getMaxColumn()) {
+          line.column = getMaxColumn();
+          line.valid = false;
+        }
+        break;
+      case 'D':
+        line.column -= std::min(count, line.column);
+        break;
+      default:
+        line.valid = false;
+        break;
+    }
+  }
+};
+
+
+#endif //TERMINUS_ECHOPREDICTOR_H
@@ -0,0 +1,131 @@
+#ifndef TERMINUS_FLOWWINDOW_H
+#define TERMINUS_FLOWWINDOW_H
+
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+
+/**
+ * @brief credit the slave may still spend on output before it stops reading its terminal
+ * @note off until the master announces a window, so masters which know nothing about flow control never stall
+ * the slave. Output is let through as long as any credit is left, the overshoot is paid back by later grants
+ */
+class FlowWindow {
+public:
+  struct Stats {
+    uint64_t stalls = 0;
+    std::chrono::microseconds stalled{0};
+  };
+private:
+  bool fEnabled = false;
+  int64_t fCredit = 0;
+  Stats fStats;
+  mutable std::mutex fMutex;
+  std::condition_variable fCreditFlag;
+public:
+
+  Stats getStats() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+  }
+
+  bool enabled() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fEnabled;
+  }
+
+  int64_t available() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fCredit;
+  }
+
+  /**
+   * @brief a master announced its window, everything sent before is paid for
+   */
+  void reset(uint32_t window) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fEnabled = true;
+      fCredit = window;
+    }
+    fCreditFlag.notify_all();
+  }
+
+  /**
+   * @brief the master changed, the next one may not know flow control
+   */
+  void disable() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fEnabled = false;
+    }
+    fCreditFlag.notify_all();
+  }
+
+  void grant(uint32_t credit) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fCredit += credit;
+    }
+    fCreditFlag.notify_all();
+  }
+
+  void consume(size_t size) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fCredit -= (int64_t) size;
+  }
+
+  /**
+   * @return false if there is still no credit after timeout
+   */
+  bool waitForCredit(std::chrono::microseconds timeout) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    if (!fEnabled || fCredit > 0) return true;
+    auto start = std::chrono::steady_clock::now();
+    auto ready = fCreditFlag.wait_for(lock, timeout, [this] { return !fEnabled || fCredit > 0; });
+    fStats.stalls++;
+    fStats.stalled += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return ready;
+  }
+};
+
+/**
+ * @brief hands credit back for output the master displayed, in steps of a quarter window so updates stay rare
+ * @note not thread safe
+ */
+class FlowGrant {
+public:
+  static constexpr uint32_t DEFAULT_WINDOW_SIZE = 128 * 1024;
+private:
+  uint32_t fWindow;
+  uint32_t fConsumed = 0;
+public:
+  explicit FlowGrant(uint32_t window = DEFAULT_WINDOW_SIZE) : fWindow(window) {
+  }
+
+  uint32_t getWindow() const {
+    return fWindow;
+  }
+
+  /**
+   * @brief the window was announced again, output displayed so far was paid for by it
+   */
+  void reset() {
+    fConsumed = 0;
+  }
+
+  /**
+   * @return credit to grant now, 0 while it is not worth an update
+   */
+  uint32_t consume(size_t size) {
+    fConsumed += (uint32_t) size;
+    if (fConsumed < std::max<uint32_t>(fWindow / 4, 1)) return 0;
+    auto credit = fConsumed;
+    fConsumed = 0;
+    return credit;
+  }
+};
+
+
+#endif //TERMINUS_FLOWWINDOW_H
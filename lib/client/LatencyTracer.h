@@ -0,0 +1,195 @@
+#ifndef TERMINUS_LATENCYTRACER_H
+#define TERMINUS_LATENCYTRACER_H
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <message/MessageFactory.h>
+#include <message/TraceMessage.h>
+#include <transport/DelayHistogram.h>
+
+/**
+ * @brief follows keystrokes to their echo, the master starts traces and takes them back, the slave stamps the write
+ * to its terminal and the read of the echo
+ * @note one trace is in flight at a time and the first output after a traced keystroke counts as its echo. A trace
+ * travels behind its keystroke and the echo behind the trace, so both ends note when keystroke and echo passed
+ * and the trace picks that up. Hops are taken from stamps of one host, the network is what is left of the round trip
+ */
+class LatencyTracer {
+public:
+  enum class Hop {
+    ServerUp = 0,
+    SlaveEcho = 1,
+    ServerDown = 2,
+    Network = 3,
+    Total = 4,
+  };
+  static const int HOP_COUNT = 5;
+  /*! a keystroke without echo, such as one of a password, holds up tracing no longer than this */
+  static const uint32_t TRACE_TIMEOUT_US = 2000000;
+
+  struct Stats {
+    DelayHistogram hops[HOP_COUNT];
+    uint64_t started = 0;
+    uint64_t expired = 0;
+
+    const DelayHistogram &getHop(Hop hop) const {
+      return hops[(int) hop];
+    }
+  };
+private:
+  uint32_t fNextTraceId = 1;
+  /*! trace of the master in flight, 0 if none */
+  uint32_t fInFlight = 0;
+  uint32_t fStarted = 0;
+  /*! when the first output after the keystroke was read or displayed, 0 if none was yet */
+  uint32_t fKeystroke = 0;
+  uint32_t fEcho = 0;
+  /*! traces of the slave waiting for the echo and those with the echo read */
+  std::vector<TraceMessage::Ptr> fWritten;
+  std::vector<Message::Ptr> fEchoed;
+  Stats fStats;
+  mutable std::mutex fMutex;
+public:
+
+  static const char *getHopName(Hop hop) {
+    switch (hop) {
+      case Hop::ServerUp:
+        return "server up";
+      case Hop::SlaveEcho:
+        return "slave echo";
+      case Hop::ServerDown:
+        return "server down";
+      case Hop::Network:
+        return "network";
+      case Hop::Total:
+        break;
+    }
+    return "total";
+  }
+
+  Stats getStats() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+  }
+
+  /**
+   * @brief master, called for a keystroke just sent
+   * @return trace to send after it, nullptr while another one is in flight
+   */
+  TraceMessage::Ptr start(uint32_t now = TraceMessage::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fInFlight != 0 && now - fStarted < TRACE_TIMEOUT_US) return nullptr;
+    if (fInFlight != 0) fStats.expired++;
+    fInFlight = fNextTraceId++;
+    if (fNextTraceId == 0) fNextTraceId = 1;
+    fStarted = now;
+    fEcho = 0;
+    fStats.started++;
+    TraceMessage::Stamps stamps = {};
+    stamps[(int) TraceStamp::MasterSend] = now;
+    return MessageFactory::create<TraceMessage>(fInFlight, stamps);
+  }
+
+  /**
+   * @brief master, called for output once it is displayed
+   */
+  void displayed(uint32_t now = TraceMessage::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fInFlight != 0 && fEcho == 0) fEcho = now;
+  }
+
+  /**
+   * @brief master, called for a trace which came back once the output before it is displayed
+   * @return false if it is not the trace in flight
+   */
+  bool finish(const TraceMessage &trace, uint32_t now = TraceMessage::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fInFlight == 0 || trace.getTraceId() != fInFlight) return false;
+    fInFlight = 0;
+    auto total = (fEcho != 0 ? fEcho : now) - trace.getStamp(TraceStamp::MasterSend);
+    uint32_t hosts = 0;
+    hosts += recordSpan(Hop::ServerUp, trace, TraceStamp::ServerReceive, TraceStamp::ServerForward);
+    hosts += recordSpan(Hop::SlaveEcho, trace, TraceStamp::SlaveWrite, TraceStamp::SlaveRead);
+    hosts += recordSpan(Hop::ServerDown, trace, TraceStamp::ServerReturn, TraceStamp::ServerDeliver);
+    record(Hop::Network, total > hosts ? total - hosts : 0);
+    record(Hop::Total, total);
+    return true;
+  }
+
+  /**
+   * @brief slave, called for keystrokes written to the terminal
+   */
+  void keystroke(uint32_t now = TraceMessage::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fKeystroke = now;
+    fEcho = 0;
+  }
+
+  /**
+   * @brief slave, called for a trace, the keystroke before it was written already
+   */
+  void written(const TraceMessage &trace, uint32_t now = TraceMessage::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    // a keystroke which was never echoed
+    fWritten.erase(std::remove_if(fWritten.begin(), fWritten.end(), [now](const TraceMessage::Ptr &written) {
+      return now - written->getStamp(TraceStamp::SlaveWrite) >= TRACE_TIMEOUT_US;
+    }), fWritten.end());
+    auto stamped = trace.stamp(TraceStamp::SlaveWrite, fKeystroke != 0 ? fKeystroke : now);
+    if (fEcho != 0) echoed(stamped, fEcho);
+    else fWritten.push_back(stamped);
+  }
+
+  /**
+   * @brief slave, called for output read from the terminal
+   */
+  void read(uint32_t now = TraceMessage::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fKeystroke != 0 && fEcho == 0) fEcho = now;
+    for (auto &written : fWritten)
+      echoed(written, now);
+    fWritten.clear();
+  }
+
+  /**
+   * @brief slave, the traces to send back once the output read with them is sent
+   */
+  std::vector<Message::Ptr> takeEchoed() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    std::vector<Message::Ptr> echoed;
+    echoed.swap(fEchoed);
+    return echoed;
+  }
+
+private:
+
+  /**
+   * @note expects fMutex to be held
+   */
+  void echoed(const TraceMessage::Ptr &trace, uint32_t now) {
+    record(Hop::SlaveEcho, now - trace->getStamp(TraceStamp::SlaveWrite));
+    fEchoed.push_back(trace->stamp(TraceStamp::SlaveRead, now));
+  }
+
+  /**
+   * @return time between two stamps of one host, zero if one of them is missing
+   * @note expects fMutex to be held
+   */
+  uint32_t recordSpan(Hop hop, const TraceMessage &trace, TraceStamp from, TraceStamp to) {
+    if (trace.getStamp(from) == 0 || trace.getStamp(to) == 0) return 0;
+    auto span = trace.getStamp(to) - trace.getStamp(from);
+    record(hop, span);
+    return span;
+  }
+
+  /**
+   * @note expects fMutex to be held
+   */
+  void record(Hop hop, uint32_t microseconds) {
+    fStats.hops[(int) hop].record(std::chrono::microseconds(microseconds));
+  }
+};
+
+#endif //TERMINUS_LATENCYTRACER_H
@@ -0,0 +1,116 @@
+#ifndef TERMINUS_MESSAGEBATCHER_H
+#define TERMINUS_MESSAGEBATCHER_H
+
+#include <mutex>
+#include <vector>
+#include <functional>
+
+#include <message/MessageFactory.h>
+#include <message/BatchMessage.h>
+#include <message/SequencedMessage.h>
+#include <message/ResumeMessage.h>
+
+/**
+ * @brief packs messages which are ready at the same time into batches sent under one encryption envelope
+ * @note whoever sends takes along what other threads handed in meanwhile, nobody waits for a batch to fill.
+ * Only frames between slave and master are batched, the server relays them as they are.
+ */
+class MessageBatcher {
+public:
+  using SendHandler = std::function<bool(const Message::Ptr &)>;
+  /*! leaves room for the envelope within the largest frame */
+  static constexpr size_t MAX_BATCH_SIZE = 48 * 1024;
+
+  struct Stats {
+    uint64_t messages = 0;
+    uint64_t batches = 0;
+    uint64_t batchedMessages = 0;
+  };
+private:
+  std::mutex fMutex;
+  std::vector<Message::Ptr> fPending;
+  bool fSending = false;
+  Stats fStats;
+public:
+
+  /**
+   * @return false if sending failed, a message left to another sending thread counts as sent
+   */
+  bool send(const Message::Ptr &msg, const SendHandler &handler) {
+    return send(std::vector<Message::Ptr>{msg}, handler);
+  }
+
+  bool send(const std::vector<Message::Ptr> &messages, const SendHandler &handler) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fPending.insert(fPending.end(), messages.begin(), messages.end());
+      fStats.messages += messages.size();
+      if (fSending) return true;
+      fSending = true;
+    }
+    bool sent = true;
+    while (true) {
+      std::vector<Message::Ptr> ready;
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fPending.empty()) {
+          fSending = false;
+          return sent;
+        }
+        ready.swap(fPending);
+      }
+      for (auto &msg : pack(ready))
+        sent = handler(msg) && sent;
+    }
+  }
+
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+  }
+
+  static bool batchable(const Message::Ptr &msg) {
+    return msg->getId() == SequencedMessage::id || msg->getId() == ResumeMessage::id;
+  }
+
+private:
+
+  /**
+   * @brief joins runs of batchable messages, everything keeps its order
+   */
+  std::vector<Message::Ptr> pack(const std::vector<Message::Ptr> &messages) {
+    std::vector<Message::Ptr> packed;
+    std::vector<Message::Ptr> run;
+    size_t runSize = 0;
+    auto close = [&]() {
+      if (run.size() == 1) packed.push_back(run.front());
+      if (run.size() > 1) {
+        std::vector<std::string> batch;
+        for (auto &msg : run)
+          batch.emplace_back((const char *) msg->getBuffer().getDataPtr(), msg->getBuffer().getSize());
+        packed.push_back(MessageFactory::create<BatchMessage>(batch));
+        std::lock_guard<std::mutex> lock(fMutex);
+        fStats.batches++;
+        fStats.batchedMessages += run.size();
+      }
+      run.clear();
+      runSize = 0;
+    };
+    for (auto &msg : messages) {
+      auto size = msg->getBuffer().getSize();
+      if (!batchable(msg)) {
+        close();
+        packed.push_back(msg);
+        continue;
+      }
+      if (runSize + size > MAX_BATCH_SIZE) close();
+      run.push_back(msg);
+      runSize += size;
+    }
+    close();
+    return packed;
+  }
+};
+
+
+#endif //TERMINUS_MESSAGEBATCHER_H
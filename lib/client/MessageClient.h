@@ -3,11 +3,25 @@
 
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <sys/un.h>
+#include <mutex>
+#include <atomic>
 #include <thread>
+#include <chrono>
 
 #include "message/Buffer.h"
+#include "message/ConnectMessage.h"
+#include "message/ResponseMessage.h"
+#include "logger/Logger.h"
+#include "transport/DatagramEndpoint.h"
+#include "transport/LaneLock.h"
+#include "client/MessageBatcher.h"
 
 class MessageClient {
+public:
+  /*! jittered exponential backoff of clients reconnecting to the server */
+  static constexpr int RECONNECT_MIN_BACKOFF_MS = 10;
+  static constexpr int RECONNECT_MAX_BACKOFF_MS = 2000;
 private:
   static const int BUFFER_SIZE = 4069;
 private:
@@ -16,6 +30,10 @@ private:
   std::thread fReceiveThread = {};
   bool fShutDown = false;
   int fBufferSize = -1;
+  mutable LaneLock fSendLock;
+  std::shared_ptr<DatagramEndpoint> fDatagram;
+  std::atomic<uint32_t> fCapabilities{0};
+  MessageBatcher fBatcher;
 public:
   explicit MessageClient(int bufferSize = BUFFER_SIZE) : fBufferSize(bufferSize) {
   }
@@ -24,9 +42,63 @@ public:
     if (fSocket == -1) return;
     DWARN("disconnecting from %s", inet_ntoa(fServerAddress.sin_addr));
     if (fReceiveThread.joinable()) fReceiveThread.detach();
+    shutdown(fSocket, SHUT_RDWR);
     close(fSocket);
   }
 
+  /**
+   * @brief ends the connection while the client may still be shared, blocked receivers return
+   */
+  void disconnect() const {
+    if (fSocket == -1) return;
+    shutdown(fSocket, SHUT_RDWR);
+  }
+
+  int getSocket() const {
+    return fSocket;
+  }
+
+  /**
+   * @brief format of frames sent on this connection, the legacy one until the server confirmed another
+   */
+  WireFormat getWireFormat() const {
+    return ConnectOptions::toWireFormat(fCapabilities);
+  }
+
+  /**
+   * @brief the capabilities both sides support, none until the server answered the connect message
+   */
+  uint32_t getCapabilities() const {
+    return fCapabilities;
+  }
+
+  bool hasCapability(uint32_t capability) const {
+    return (fCapabilities & capability) == capability;
+  }
+
+  MessageBatcher &getBatcher() {
+    return fBatcher;
+  }
+
+  LaneLock::Stats getSendStats() const {
+    return fSendLock.getStats();
+  }
+
+  /**
+   * @brief switches to the capabilities the server confirmed in reply to the connect message
+   * @return false if msg is not that reply
+   */
+  bool acceptCapabilities(Message &msg) {
+    if (msg.getId() != ResponseMessage::id) return false;
+    auto response = msg.cast<ResponseMessage>();
+    uint64_t version = 0, capabilities;
+    if (!response.getUnsigned("capabilities", capabilities)) return false;
+    response.getUnsigned("version", version);
+    fCapabilities = (uint32_t) capabilities;
+    DINFO("server speaks protocol version %lu, capabilities 0x%x", version, fCapabilities.load());
+    return true;
+  }
+
   bool connect(const std::string &address, int port, bool async = true) {
     fSocket = 0;
 
@@ -63,23 +135,82 @@ public:
     return true;
   }
 
-  bool sendData(const char *msg, size_t size) const {
-    size_t numBytesSent = send(fSocket, msg, size, 0);
-    if (numBytesSent < 0) { // send failed
-      perror("send failed");
-      DCRITICAL("send failed");
+  /**
+   * @brief connects to a local multiplexer instead of the server, see ChannelMux
+   */
+  bool connectLocal(const std::string &path, bool async = true) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    fSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fSocket == -1) {
+      DCRITICAL("failed to create socket");
       return false;
     }
-    if ((uint) numBytesSent < size) { // not all bytes were sent
-      DERROR("not all bytes were sent, requested size: %d, result: %d", size, numBytesSent);
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (::connect(fSocket, (struct sockaddr *) &address, sizeof(address)) == -1) {
+      DINFO("no multiplexer listening on %s", path.c_str());
+      close(fSocket);
+      fSocket = -1;
+      return false;
+    }
+    if (async) fReceiveThread = std::thread(&MessageClient::receiveTask, this);
+    return true;
+  }
+
+  /**
+   * @brief reaches the server over udp, frames are sent and received through a local socket just like over tcp
+   */
+  bool connectDatagram(const std::string &address, int port, const std::string &login, const std::string &key,
+                       const LossSimulator::Options &simulator = {}, bool async = true) {
+    fDatagram = std::make_shared<DatagramEndpoint>(login, key, simulator);
+    fSocket = fDatagram->connect(address, port);
+    if (fSocket == -1) {
+      DCRITICAL("failed to set up udp transport to %s:%d", address.c_str(), port);
+      fDatagram.reset();
       return false;
     }
+    if (async) fReceiveThread = std::thread(&MessageClient::receiveTask, this);
     return true;
   }
 
+  /**
+   * @brief writes a whole frame, small frames are written before bulk ones waiting for the socket
+   */
+  bool sendData(const char *msg, size_t size) const {
+    LaneLock::Guard lock(fSendLock, LaneLock::classify(size));
+    size_t totalSent = 0;
+    while (totalSent < size) {
+      auto numBytesSent = send(fSocket, msg + totalSent, size - totalSent, MSG_NOSIGNAL);
+      if (numBytesSent < 0 && errno == EINTR) continue;
+      if (numBytesSent <= 0) { // send failed
+        perror("send failed");
+        DCRITICAL("send failed");
+        return false;
+      }
+      totalSent += numBytesSent;
+    }
+    return true;
+  }
+
+  /**
+   * @brief receiving fails once nothing arrived for timeout, a server sending heartbeats is never silent that long
+   */
+  bool setReceiveTimeout(std::chrono::milliseconds timeout) const {
+    timeval value = {};
+    value.tv_sec = (time_t) (timeout.count() / 1000);
+    value.tv_usec = (suseconds_t) (timeout.count() % 1000 * 1000);
+    return setsockopt(fSocket, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value)) == 0;
+  }
+
   Buffer receiveData() const {
     auto buffer = new uint8_t[fBufferSize];
     auto size = recv(fSocket, buffer, fBufferSize, 0);
+    if (size <= 0) {
+      if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) DWARN("server went silent");
+      delete[] buffer;
+      return {};
+    }
     Buffer data(buffer, size);
     delete[] buffer;
     return data;
@@ -98,7 +229,7 @@ protected:
 private:
 
   void receiveTask() {
-    size_t size;
+    ssize_t size;
     auto buffer = new uint8_t[fBufferSize];
 
     while (!fShutDown) {
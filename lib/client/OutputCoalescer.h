@@ -0,0 +1,132 @@
+#ifndef TERMINUS_OUTPUTCOALESCER_H
+#define TERMINUS_OUTPUTCOALESCER_H
+
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+/**
+ * @brief batches pty output before it is framed and sent
+ * @note a small read after an idle period (interactive echo) is flushed at once,
+ * continuous output is accumulated until maxBatchSize bytes or maxDelay elapsed
+ */
+class OutputCoalescer {
+public:
+  using Clock = std::chrono::steady_clock;
+public:
+  static constexpr size_t DEFAULT_MAX_BATCH_SIZE = 32 * 1024;
+  static constexpr size_t MAX_BATCH_SIZE = 60 * 1024;
+  static constexpr int DEFAULT_MAX_DELAY_US = 2000;
+  static constexpr size_t DEFAULT_ECHO_SIZE = 64;
+  static constexpr int HISTOGRAM_BUCKETS = 17;
+
+  struct Options {
+    size_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE;
+    std::chrono::microseconds maxDelay = std::chrono::microseconds(DEFAULT_MAX_DELAY_US);
+    size_t echoSize = DEFAULT_ECHO_SIZE;
+  };
+
+  struct Stats {
+    uint64_t batches = 0;
+    uint64_t bytes = 0;
+    uint64_t immediateFlushes = 0;
+    uint64_t sizeFlushes = 0;
+    uint64_t deadlineFlushes = 0;
+    size_t maxBatch = 0;
+    /*! histogram[i] counts batches of [2^i, 2^(i+1)) bytes */
+    uint64_t histogram[HISTOGRAM_BUCKETS] = {};
+
+    double averageBatchSize() const {
+      return batches ? (double) bytes / (double) batches : 0.0;
+    }
+  };
+
+private:
+  Options fOptions;
+  Stats fStats;
+  std::string fPending;
+  Clock::time_point fBatchStart = {};
+  Clock::time_point fLastInput = {};
+  bool fImmediate = false;
+
+public:
+  OutputCoalescer() : OutputCoalescer(Options()) {
+  }
+
+  explicit OutputCoalescer(const Options &options) : fOptions(options) {
+    fOptions.maxBatchSize = std::max<size_t>(1, std::min(fOptions.maxBatchSize, MAX_BATCH_SIZE));
+  }
+
+  void append(const uint8_t *data, size_t len, Clock::time_point now = Clock::now()) {
+    if (len == 0) return;
+    if (fPending.empty()) {
+      fBatchStart = now;
+      fImmediate = len <= fOptions.echoSize && now - fLastInput >= fOptions.maxDelay;
+    }
+    fLastInput = now;
+    fPending.append((const char *) data, len);
+  }
+
+  bool empty() const {
+    return fPending.empty();
+  }
+
+  bool ready(Clock::time_point now = Clock::now()) const {
+    if (fPending.empty()) return false;
+    return fImmediate || fPending.size() >= fOptions.maxBatchSize || now - fBatchStart >= fOptions.maxDelay;
+  }
+
+  /**
+   * @return time the caller may wait for more output before a flush is due, negative if nothing is pending
+   */
+  std::chrono::microseconds getTimeout(Clock::time_point now = Clock::now()) const {
+    if (fPending.empty()) return std::chrono::microseconds(-1);
+    if (ready(now)) return std::chrono::microseconds(0);
+    return std::chrono::duration_cast<std::chrono::microseconds>(fBatchStart + fOptions.maxDelay - now);
+  }
+
+  /**
+   * @brief takes the next batch, at most maxBatchSize bytes, regardless of whether it is ready
+   */
+  std::string take(Clock::time_point now = Clock::now()) {
+    auto size = std::min(fPending.size(), fOptions.maxBatchSize);
+    if (size == 0) return {};
+    if (fImmediate)
+      fStats.immediateFlushes++;
+    else if (size >= fOptions.maxBatchSize)
+      fStats.sizeFlushes++;
+    else
+      fStats.deadlineFlushes++;
+    fStats.batches++;
+    fStats.bytes += size;
+    fStats.maxBatch = std::max(fStats.maxBatch, size);
+    fStats.histogram[getBucket(size)]++;
+
+    std::string batch = fPending.substr(0, size);
+    fPending.erase(0, size);
+    fImmediate = false;
+    fBatchStart = now;
+    return batch;
+  }
+
+  const Stats &getStats() const {
+    return fStats;
+  }
+
+  const Options &getOptions() const {
+    return fOptions;
+  }
+
+private:
+  static int getBucket(size_t size) {
+    int bucket = 0;
+    while (size > 1 && bucket < HISTOGRAM_BUCKETS - 1) {
+      size >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+};
+
+
+#endif //TERMINUS_OUTPUTCOALESCER_H
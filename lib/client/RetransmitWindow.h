@@ -0,0 +1,187 @@
+#ifndef TERMINUS_RETRANSMITWINDOW_H
+#define TERMINUS_RETRANSMITWINDOW_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <random>
+
+#include <message/MessageFactory.h>
+#include <message/SequencedMessage.h>
+#include <message/ResumeMessage.h>
+
+/**
+ * @brief numbers session frames sent to the peer and keeps them until the peer acknowledges them
+ * @note also tracks what was received from the peer, so duplicates replayed after a reconnect are dropped and
+ * frames that fell out of the window of the peer are noticed, not thread safe
+ */
+class RetransmitWindow {
+public:
+  static constexpr size_t DEFAULT_WINDOW_SIZE = 256 * 1024;
+  static constexpr uint32_t ACK_INTERVAL = 16;
+private:
+  struct Frame {
+    uint32_t seq;
+    std::string payload;
+  };
+private:
+  uint32_t fSession;
+  size_t fWindowSize;
+  uint32_t fNextSeq = 1;
+  std::deque<Frame> fUnacked;
+  size_t fUnackedBytes = 0;
+  uint32_t fPeerSession = 0;
+  uint32_t fLastReceived = 0;
+  uint32_t fReceivedSinceAck = 0;
+  uint32_t fLost = 0;
+  uint32_t fPeerAck = 0;
+  /*! asked the peer to resume and got no reply yet */
+  bool fResuming = false;
+public:
+  explicit RetransmitWindow(uint32_t session = createSession(), size_t windowSize = DEFAULT_WINDOW_SIZE) :
+    fSession(session), fWindowSize(windowSize) {
+  }
+
+  static uint32_t createSession() {
+    std::random_device random;
+    uint32_t session;
+    do {
+      session = random();
+    } while (session == 0);
+    return session;
+  }
+
+  uint32_t getSession() const {
+    return fSession;
+  }
+
+  uint32_t getPeerSession() const {
+    return fPeerSession;
+  }
+
+  uint32_t getLastReceived() const {
+    return fLastReceived;
+  }
+
+  /**
+   * @return the last frame of this session the peer had received when it sent the frame accepted last,
+   * 0 if it had none
+   */
+  uint32_t getPeerAck() const {
+    return fPeerAck;
+  }
+
+  size_t pending() const {
+    return fUnacked.size();
+  }
+
+  /**
+   * @return number of peer frames skipped since the last call, the peer dropped them before they were acknowledged
+   */
+  uint32_t takeLost() {
+    auto lost = fLost;
+    fLost = 0;
+    return lost;
+  }
+
+  /**
+   * @brief assigns the next sequence number to msg and keeps it for replay,
+   * the oldest frames are dropped when the window is full and the peer counts them as lost if it missed them
+   */
+  SequencedMessage::Ptr wrap(const Message::Ptr &msg) {
+    Frame frame{fNextSeq++, std::string((const char *) msg->getBuffer().getDataPtr(), msg->getBuffer().getSize())};
+    fUnackedBytes += frame.payload.size();
+    fUnacked.push_back(frame);
+    while (fUnackedBytes > fWindowSize && fUnacked.size() > 1) {
+      fUnackedBytes -= fUnacked.front().payload.size();
+      fUnacked.pop_front();
+    }
+    return makeMessage(frame);
+  }
+
+  SequencedMessage::Ptr makeAck() {
+    return makeMessage({0, {}});
+  }
+
+  /**
+   * @brief true once enough peer frames arrived without an outgoing frame carrying their ack
+   */
+  bool ackDue() const {
+    return fReceivedSinceAck >= ACK_INTERVAL;
+  }
+
+  /**
+   * @return false for pure acks and for frames that were already received
+   */
+  bool accept(const SequencedMessage &msg) {
+    acknowledge(msg.getPeerSession(), msg.getAck());
+    fPeerAck = msg.getPeerSession() == fSession ? msg.getAck() : 0;
+    if (msg.getSeq() == 0) return false;
+    // a new peer session may start anywhere, such as a slave running for a while before this master attached
+    if (msg.getSession() != fPeerSession) {
+      fPeerSession = msg.getSession();
+      fLastReceived = msg.getSeq() - 1;
+    }
+    if (msg.getSeq() <= fLastReceived) return false;
+    // output the peer sent before it saw the resume request, it is replayed after the reply
+    if (fResuming && msg.getSeq() != fLastReceived + 1) return false;
+    fLost += msg.getSeq() - fLastReceived - 1;
+    fLastReceived = msg.getSeq();
+    fReceivedSinceAck++;
+    return true;
+  }
+
+  ResumeMessage::Ptr makeResume(bool reply) const {
+    return MessageFactory::create<ResumeMessage>(fSession, fPeerSession, fLastReceived, reply);
+  }
+
+  /**
+   * @brief resumes on a new connection, frames not acknowledged go out right behind the request so they stay
+   * ahead of frames sent later
+   * @return the resume request and the frames to replay
+   */
+  std::vector<Message::Ptr> startResume() {
+    fResuming = true;
+    std::vector<Message::Ptr> frames{makeResume(false)};
+    for (auto &frame : fUnacked)
+      frames.push_back(makeMessage(frame));
+    return frames;
+  }
+
+  /**
+   * @return frames the peer missed, nothing if the peer never received this session or if msg replies to
+   * startResume, which replayed them already
+   */
+  std::vector<SequencedMessage::Ptr> resume(const ResumeMessage &msg) {
+    std::vector<SequencedMessage::Ptr> frames;
+    if (msg.isReply()) fResuming = false;
+    if (msg.getPeerSession() != fSession) {
+      fUnacked.clear();
+      fUnackedBytes = 0;
+      return frames;
+    }
+    acknowledge(fSession, msg.getLastReceived());
+    if (msg.isReply()) return frames;
+    for (auto &frame : fUnacked)
+      frames.push_back(makeMessage(frame));
+    return frames;
+  }
+
+private:
+
+  void acknowledge(uint32_t session, uint32_t ack) {
+    if (session != fSession) return;
+    while (!fUnacked.empty() && fUnacked.front().seq <= ack) {
+      fUnackedBytes -= fUnacked.front().payload.size();
+      fUnacked.pop_front();
+    }
+  }
+
+  SequencedMessage::Ptr makeMessage(const Frame &frame) {
+    fReceivedSinceAck = 0;
+    return MessageFactory::create<SequencedMessage>(fSession, frame.seq, fPeerSession, fLastReceived, frame.payload);
+  }
+};
+
+
+#endif //TERMINUS_RETRANSMITWINDOW_H
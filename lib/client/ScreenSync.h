@@ -0,0 +1,274 @@
+#ifndef TERMINUS_SCREENSYNC_H
+#define TERMINUS_SCREENSYNC_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <terminal/screen.hpp>
+
+/**
+ * @brief renders what changed on a Screen since the last frame as escape sequences for the terminal of a master
+ * @note frames are limited to frameRate per second, the first frame after an idle period goes out at once
+ * so keystroke echo is not delayed, not thread safe
+ */
+class ScreenSync {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr int DEFAULT_FRAME_RATE = 30;
+  static constexpr int MAX_FRAME_RATE = 1000;
+  /*! unchanged cells written over instead of moving the cursor past them */
+  static constexpr int MAX_GAP = 4;
+
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t fullFrames = 0;
+    uint64_t scrolledLines = 0;
+    uint64_t bytes = 0;
+  };
+private:
+  std::chrono::microseconds fInterval;
+  Clock::time_point fLastFrame;
+  bool fDirty = true;
+  bool fFull = true;
+  // what the terminal of the master shows
+  std::vector<Screen::Row> fShown;
+  int fShownWidth = 0;
+  bool fShownCursorVisible = true;
+  bool fShownKeypadMode = false;
+  std::vector<bool> fShownModes;
+  std::string fShownTitle;
+  // rendering state within a frame
+  int fPenX = -1;
+  int fPenY = -1;
+  bool fPenValid = false;
+  Screen::Attributes fPen;
+  Stats fStats;
+public:
+  explicit ScreenSync(int frameRate = DEFAULT_FRAME_RATE) :
+    fInterval(1000000 / std::max(1, std::min(frameRate, MAX_FRAME_RATE))) {
+  }
+
+  const Stats &getStats() const {
+    return fStats;
+  }
+
+  /**
+   * @brief the screen changed
+   */
+  void touch() {
+    fDirty = true;
+  }
+
+  /**
+   * @brief the next frame repaints everything, the terminal of the master is in an unknown state
+   */
+  void invalidate() {
+    fFull = true;
+    fDirty = true;
+  }
+
+  bool due(Clock::time_point now = Clock::now()) const {
+    return fDirty && now >= fLastFrame + fInterval;
+  }
+
+  /**
+   * @return time until the next frame is due, negative if nothing changed
+   */
+  std::chrono::microseconds getTimeout(Clock::time_point now = Clock::now()) const {
+    if (!fDirty) return std::chrono::microseconds(-1);
+    auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(fLastFrame + fInterval - now);
+    return std::max(remaining, std::chrono::microseconds(0));
+  }
+
+  std::string frame(const Screen &screen, Clock::time_point now = Clock::now()) {
+    std::string out;
+    fPenValid = false;
+    fPenX = fPenY = -1;
+    auto full = fFull || fShownWidth != screen.width() || (int) fShown.size() != screen.height();
+    if (full) {
+      out += "\x1b[0m\x1b[H\x1b[2J";
+      fShown.assign(screen.height(), Screen::Row(screen.width()));
+      fShownWidth = screen.width();
+      fPenValid = true;
+      fPen = Screen::Attributes();
+      fStats.fullFrames++;
+    } else {
+      scroll(screen, out);
+    }
+
+    std::string cells;
+    for (int y = 0; y < screen.height(); y++)
+      renderRow(screen.row(y), y, cells);
+    if (!cells.empty() && screen.cursorVisible() && fShownCursorVisible && !full) out += "\x1b[?25l" + cells + "\x1b[?25h";
+    else out += cells;
+
+    if (full || screen.cursorVisible() != fShownCursorVisible)
+      out += screen.cursorVisible() ? "\x1b[?25h" : "\x1b[?25l";
+    if (fPenX != screen.cursorX() || fPenY != screen.cursorY())
+      out += "\x1b[" + std::to_string(screen.cursorY() + 1) + ";" + std::to_string(screen.cursorX() + 1) + "H";
+    auto &modes = Screen::forwardedModes();
+    fShownModes.resize(modes.size());
+    for (size_t i = 0; i < modes.size(); i++) {
+      if (!full && screen.mode(modes[i]) == fShownModes[i]) continue;
+      out += "\x1b[?" + std::to_string(modes[i]) + (screen.mode(modes[i]) ? "h" : "l");
+      fShownModes[i] = screen.mode(modes[i]);
+    }
+    if (full || screen.keypadMode() != fShownKeypadMode) out += screen.keypadMode() ? "\x1b=" : "\x1b>";
+    if ((full && !screen.title().empty()) || screen.title() != fShownTitle) out += "\x1b]0;" + screen.title() + "\x07";
+
+    fShownCursorVisible = screen.cursorVisible();
+    fShownKeypadMode = screen.keypadMode();
+    fShownTitle = screen.title();
+    fFull = false;
+    fDirty = false;
+    fLastFrame = now;
+    fStats.frames++;
+    fStats.bytes += out.size();
+    return out;
+  }
+
+private:
+
+  static bool blankRow(const Screen::Row &row) {
+    for (auto &cell : row)
+      if (!cell.blank()) return false;
+    return true;
+  }
+
+  /**
+   * @brief scrolls the terminal of the master when the screen content moved up, the usual case for streaming output
+   * @note lines are scrolled with line feeds, so they reach the scrollback of the master terminal as well
+   */
+  void scroll(const Screen &screen, std::string &out) {
+    auto height = screen.height();
+    auto matches = [&](int shift) {
+      int count = 0;
+      for (int y = 0; y + shift < height; y++)
+        if (!blankRow(fShown[y + shift]) && screen.row(y) == fShown[y + shift]) count++;
+      return count;
+    };
+    int bestShift = 0;
+    int best = matches(0);
+    for (int shift = 1; shift < height; shift++) {
+      // fewer rows left to match than the best found so far
+      if (height - shift <= best) break;
+      auto count = matches(shift);
+      if (count > best) {
+        best = count;
+        bestShift = shift;
+      }
+    }
+    if (bestShift == 0) return;
+    out += "\x1b[0m\x1b[" + std::to_string(height) + ";1H" + std::string(bestShift, '\n');
+    fPen = Screen::Attributes();
+    fPenValid = true;
+    fPenX = 0;
+    fPenY = height - 1;
+    fShown.erase(fShown.begin(), fShown.begin() + bestShift);
+    fShown.insert(fShown.end(), bestShift, Screen::Row(screen.width()));
+    fStats.scrolledLines += bestShift;
+  }
+
+  void renderRow(const Screen::Row &row, int y, std::string &out) {
+    auto &shown = fShown[y];
+    int width = (int) row.size();
+    int x = 0;
+    while (x < width) {
+      if (row[x] == shown[x]) {
+        x++;
+        continue;
+      }
+      // starts at the left half of a wide character
+      if (row[x].glyph.empty() && x > 0) x--;
+      int end = x + 1;
+      int unchanged = 0;
+      while (end < width && unchanged <= MAX_GAP) {
+        if (row[end] == shown[end]) unchanged++;
+        else unchanged = 0;
+        end++;
+      }
+      end -= unchanged;
+      if (end < width && row[end].glyph.empty()) end++;
+
+      moveTo(x, y, out);
+      // blank rest of the line with one erase
+      bool blankTail = true;
+      for (int i = x; i < width && blankTail; i++)
+        blankTail = row[i].glyph == " " && row[i].attributes == row[x].attributes && row[i].attributes.flags == 0;
+      if (blankTail) {
+        setPen(row[x].attributes, out);
+        out += "\x1b[K";
+        for (int i = x; i < width; i++) shown[i] = row[i];
+        break;
+      }
+      for (int i = x; i < end; i++) {
+        if (row[i].glyph.empty()) continue;
+        setPen(row[i].attributes, out);
+        out += row[i].glyph;
+        fPenX += Screen::charWidth(decodeFirst(row[i].glyph));
+      }
+      // the cursor stays put after the last column, its position is unknown to us
+      if (fPenX >= width) fPenX = -1;
+      for (int i = x; i < end; i++) shown[i] = row[i];
+      x = end;
+    }
+  }
+
+  static uint32_t decodeFirst(const std::string &glyph) {
+    auto byte = (uint8_t) glyph[0];
+    if (byte < 0x80) return byte;
+    size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+    uint32_t codePoint = byte & (0x3F >> (length - 1));
+    for (size_t i = 1; i < length && i < glyph.size(); i++)
+      codePoint = (codePoint << 6) | ((uint8_t) glyph[i] & 0x3F);
+    return codePoint;
+  }
+
+  void moveTo(int x, int y, std::string &out) {
+    if (fPenX == x && fPenY == y) return;
+    if (fPenY == y && fPenX >= 0 && x == 0) out += "\r";
+    else out += "\x1b[" + std::to_string(y + 1) + ";" + std::to_string(x + 1) + "H";
+    fPenX = x;
+    fPenY = y;
+  }
+
+  void setPen(const Screen::Attributes &attributes, std::string &out) {
+    if (fPenValid && attributes == fPen) return;
+    out += "\x1b[0";
+    static const std::pair<uint16_t, const char *> FLAGS[] = {
+      {Screen::Bold,      ";1"},
+      {Screen::Dim,       ";2"},
+      {Screen::Italic,    ";3"},
+      {Screen::Underline, ";4"},
+      {Screen::Blink,     ";5"},
+      {Screen::Inverse,   ";7"},
+      {Screen::Hidden,    ";8"},
+      {Screen::Strike,    ";9"}
+    };
+    for (auto &flag : FLAGS)
+      if (attributes.flags & flag.first) out += flag.second;
+    appendColor(attributes.fg, 30, out);
+    appendColor(attributes.bg, 40, out);
+    out += "m";
+    fPen = attributes;
+    fPenValid = true;
+  }
+
+  static void appendColor(uint32_t color, int base, std::string &out) {
+    if (color == Screen::DEFAULT_COLOR) return;
+    if (color & Screen::RGB_COLOR) {
+      out += ";" + std::to_string(base + 8) + ";2;" + std::to_string((color >> 16) & 0xFF) + ";" +
+             std::to_string((color >> 8) & 0xFF) + ";" + std::to_string(color & 0xFF);
+    } else if (color < 8) {
+      out += ";" + std::to_string(base + color);
+    } else if (color < 16) {
+      out += ";" + std::to_string(base + 60 + color - 8);
+    } else {
+      out += ";" + std::to_string(base + 8) + ";5;" + std::to_string(color);
+    }
+  }
+};
+
+
+#endif //TERMINUS_SCREENSYNC_H
@@ -0,0 +1,211 @@
+#ifndef TERMINUS_STREAMCOMPRESSOR_H
+#define TERMINUS_STREAMCOMPRESSOR_H
+
+#include <string>
+#include <zlib.h>
+
+#include <message/MessageFactory.h>
+#include <message/CompressedMessage.h>
+
+namespace StreamCompression {
+  /*! escape sequences shells and editors send all the time, the most frequent ones last */
+  static const std::string DICTIONARY =
+    "\x1b[?25l\x1b[?25h\x1b[?1049h\x1b[?1049l\x1b[?1h\x1b=\x1b[?1l\x1b>\x1b[H\x1b[2J\x1b[3J\x1b[J\x1b[m\x1b(B"
+    "\x1b[1;1H\x1b[2;1H\x1b[24;1H\x1b[7m\x1b[27m\x1b[4m\x1b[22m\x1b[39m\x1b[49m\x1b[1m"
+    "\x1b[30m\x1b[31m\x1b[32m\x1b[33m\x1b[34m\x1b[35m\x1b[36m\x1b[37m\x1b[40m\x1b[41m\x1b[42m\x1b[44m"
+    "\x1b[01;31m\x1b[01;32m\x1b[01;33m\x1b[01;34m\x1b[01;35m\x1b[01;36m\x1b[40;31;01m\x1b[30;42m"
+    "\x1b[0m\x1b[00m\x1b[K\x1b[C\x1b[A\b\x1b[K\x07\x1b]0;\x07\x1b[?2004l\r\x1b[?2004h\x1b[0m\r\n\r\n";
+  /*! every sync flush ends with this marker, it is stripped before sending and added again on receipt */
+  static const std::string FLUSH_MARKER("\x00\x00\xff\xff", 4);
+  static const int WINDOW_BITS = -15;
+}
+
+/**
+ * @brief compresses outgoing session frames as one deflate stream, so a frame refers back to earlier ones
+ * @note small frames such as keystroke echo are passed on as they are, the stream is reset periodically
+ * so a master attaching later finds a frame to start from in the scrollback, not thread safe
+ */
+class StreamCompressor {
+public:
+  static constexpr size_t DEFAULT_MIN_SIZE = 64;
+  static constexpr size_t DEFAULT_RESET_INTERVAL = 256 * 1024;
+  static constexpr int DEFAULT_LEVEL = 3;
+
+  struct Options {
+    /*! frames below this size are not compressed */
+    size_t minSize = DEFAULT_MIN_SIZE;
+    /*! input bytes after which the stream starts over */
+    size_t resetInterval = DEFAULT_RESET_INTERVAL;
+    int level = DEFAULT_LEVEL;
+  };
+
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t compressedFrames = 0;
+    uint64_t resets = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+
+    double ratio() const {
+      return bytesOut ? (double) bytesIn / (double) bytesOut : 1.0;
+    }
+  };
+private:
+  Options fOptions;
+  z_stream fStream = {};
+  bool fValid = false;
+  bool fResetPending = true;
+  uint32_t fIndex = 0;
+  size_t fSinceReset = 0;
+  Stats fStats;
+public:
+  StreamCompressor() : StreamCompressor(Options()) {
+  }
+
+  explicit StreamCompressor(const Options &options) : fOptions(options) {
+    fValid = deflateInit2(&fStream, fOptions.level, Z_DEFLATED, StreamCompression::WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+  }
+
+  ~StreamCompressor() {
+    if (fValid) deflateEnd(&fStream);
+  }
+
+  StreamCompressor(const StreamCompressor &) = delete;
+  StreamCompressor &operator=(const StreamCompressor &) = delete;
+
+  const Stats &getStats() const {
+    return fStats;
+  }
+
+  /**
+   * @brief the next compressed frame starts a new stream
+   */
+  void reset() {
+    fResetPending = true;
+  }
+
+  /**
+   * @return msg itself if it is too small to be worth compressing, otherwise its compressed form
+   */
+  Message::Ptr compress(const Message::Ptr &msg) {
+    auto &buffer = msg->getBuffer();
+    fStats.frames++;
+    fStats.bytesIn += buffer.getSize();
+    if (!fValid || buffer.getSize() < fOptions.minSize) {
+      fStats.bytesOut += buffer.getSize();
+      return msg;
+    }
+    uint8_t flags = 0;
+    if (fResetPending || fSinceReset >= fOptions.resetInterval) {
+      deflateReset(&fStream);
+      deflateSetDictionary(&fStream, (const Bytef *) StreamCompression::DICTIONARY.data(),
+                           (uInt) StreamCompression::DICTIONARY.size());
+      flags |= CompressedMessage::FLAG_RESET;
+      fResetPending = false;
+      fIndex = 0;
+      fSinceReset = 0;
+      fStats.resets++;
+    }
+
+    std::string output;
+    uint8_t chunk[16 * 1024];
+    fStream.next_in = (Bytef *) buffer.getDataPtr();
+    fStream.avail_in = (uInt) buffer.getSize();
+    do {
+      fStream.next_out = chunk;
+      fStream.avail_out = sizeof(chunk);
+      if (deflate(&fStream, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+        // the stream is unusable, the receiver picks up again with the next reset
+        fResetPending = true;
+        fStats.bytesOut += buffer.getSize();
+        return msg;
+      }
+      output.append((const char *) chunk, sizeof(chunk) - fStream.avail_out);
+    } while (fStream.avail_out == 0);
+    if (output.size() >= StreamCompression::FLUSH_MARKER.size() &&
+        output.compare(output.size() - StreamCompression::FLUSH_MARKER.size(), std::string::npos, StreamCompression::FLUSH_MARKER) == 0)
+      output.resize(output.size() - StreamCompression::FLUSH_MARKER.size());
+
+    fSinceReset += buffer.getSize();
+    fStats.compressedFrames++;
+    auto compressed = MessageFactory::create<CompressedMessage>(flags, fIndex++, (uint32_t) buffer.getSize(), output);
+    fStats.bytesOut += compressed->getBuffer().getSize();
+    return compressed;
+  }
+};
+
+/**
+ * @brief restores frames compressed by StreamCompressor, frames are expected in the order they were sent
+ */
+class StreamDecompressor {
+public:
+  static constexpr size_t MAX_FRAME_SIZE = 1024 * 1024;
+private:
+  z_stream fStream = {};
+  bool fValid = false;
+  bool fSynced = false;
+  uint32_t fNextIndex = 0;
+public:
+  StreamDecompressor() {
+    fValid = inflateInit2(&fStream, StreamCompression::WINDOW_BITS) == Z_OK;
+  }
+
+  ~StreamDecompressor() {
+    if (fValid) inflateEnd(&fStream);
+  }
+
+  StreamDecompressor(const StreamDecompressor &) = delete;
+  StreamDecompressor &operator=(const StreamDecompressor &) = delete;
+
+  /**
+   * @brief false until a reset frame was seen and after a frame went missing
+   */
+  bool synced() const {
+    return fSynced;
+  }
+
+  /**
+   * @return false if the frame cannot be decompressed, frames up to the next reset cannot either
+   */
+  bool decompress(const CompressedMessage &msg, std::string &output) {
+    if (!fValid) return false;
+    if (msg.isReset()) {
+      inflateReset(&fStream);
+      inflateSetDictionary(&fStream, (const Bytef *) StreamCompression::DICTIONARY.data(),
+                           (uInt) StreamCompression::DICTIONARY.size());
+      fSynced = true;
+      fNextIndex = 0;
+    }
+    if (!fSynced || msg.getIndex() != fNextIndex || msg.getOriginalSize() > MAX_FRAME_SIZE) {
+      fSynced = false;
+      return false;
+    }
+    fNextIndex++;
+
+    auto input = msg.getData() + StreamCompression::FLUSH_MARKER;
+    output.resize(msg.getOriginalSize());
+    fStream.next_in = (Bytef *) input.data();
+    fStream.avail_in = (uInt) input.size();
+    fStream.next_out = (Bytef *) output.data();
+    fStream.avail_out = (uInt) output.size();
+    auto ret = inflate(&fStream, Z_SYNC_FLUSH);
+    uint8_t excess;
+    if (ret == Z_OK && fStream.avail_out == 0 && fStream.avail_in != 0) {
+      // the flush marker may be left over once the output is complete, it must not produce anything
+      fStream.next_out = &excess;
+      fStream.avail_out = 1;
+      ret = inflate(&fStream, Z_SYNC_FLUSH);
+      if (fStream.avail_out == 0) ret = Z_DATA_ERROR;
+      fStream.avail_out = 0;
+    }
+    // a frame inflating to anything but its original size means the stream is corrupt
+    if ((ret != Z_OK && ret != Z_BUF_ERROR) || fStream.avail_out != 0 || fStream.avail_in != 0) {
+      fSynced = false;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+#endif //TERMINUS_STREAMCOMPRESSOR_H
@@ -1,4 +1,5 @@
 #include "CryptoInterface.h"
+#include <metrics/Probes.h>
 #include <openssl/aes.h>
 #include <openssl/ssl.h>
 #include <openssl/evp.h>
@@ -23,7 +24,9 @@ std::string Crypto::AES256::encryptData(const std::string &input, const std::str
   auto iv = getAlignedString(userIv, 256);
   auto size = input.length() * 10;
   auto buffer = new char[size];
+  TERMINUS_PROBE1(encrypt__start, input.length());
   auto len = encrypt((uint8_t *) input.c_str(), input.length(), (uint8_t *) key.c_str(), (uint8_t *) iv.c_str(), (uint8_t *) buffer);
+  TERMINUS_PROBE2(encrypt__done, input.length(), len);
   if (len < 0) {
     delete[] buffer;
     return {};
@@ -39,7 +42,9 @@ std::string Crypto::AES256::decryptData(const std::string &input, const std::str
   auto iv = getAlignedString(userIv, 256);
   auto size = input.length() * 10;
   auto buffer = new char[size];
+  TERMINUS_PROBE1(decrypt__start, input.length());
   auto len = decrypt((uint8_t *) input.c_str(), input.length(), (uint8_t *) key.c_str(), (uint8_t *) iv.c_str(), (uint8_t *) buffer);
+  TERMINUS_PROBE2(decrypt__done, input.length(), len);
   if (len < 0) {
     delete[] buffer;
     return {};
@@ -9,6 +9,17 @@ namespace Crypto {
   namespace MD5 {
     std::string encryptData(const std::string &input);
   }
+  namespace HMAC {
+    /**
+     * @return hex encoded HMAC-SHA256 of input
+     */
+    std::string signData(const std::string &input, const std::string &key);
+
+    /**
+     * @return true if both signatures are equal, takes the same time wherever they differ
+     */
+    bool compareSignatures(const std::string &left, const std::string &right);
+  }
   /**
    * @brief encrypt and decrypt data using AES256 algorithm
    * @note iv is optional
@@ -0,0 +1,23 @@
+#include "CryptoInterface.h"
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+#include <iomanip>
+#include <sstream>
+
+std::string Crypto::HMAC::signData(const std::string &input, const std::string &key) {
+  unsigned char result[EVP_MAX_MD_SIZE];
+  unsigned int len = 0;
+  ::HMAC(EVP_sha256(), key.data(), (int) key.size(), (unsigned char *) input.data(), input.size(), result, &len);
+
+  std::ostringstream sout;
+  sout << std::hex << std::setfill('0');
+  for (unsigned int i = 0; i < len; i++) {
+    sout << std::setw(2) << (int) result[i];
+  }
+  return sout.str();
+}
+
+bool Crypto::HMAC::compareSignatures(const std::string &left, const std::string &right) {
+  return left.size() == right.size() && CRYPTO_memcmp(left.data(), right.data(), left.size()) == 0;
+}
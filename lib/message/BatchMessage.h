@@ -0,0 +1,54 @@
+#ifndef TERMINUS_BATCHMESSAGE_H
+#define TERMINUS_BATCHMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief several serialized messages sent under one encryption envelope
+ * @note messages are handled in the order they were added, as if they had arrived one by one
+ */
+class BatchMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<BatchMessage>;
+public:
+  static constexpr uint32_t id = 0x6C3A91D4;
+public:
+  explicit BatchMessage(const std::vector<std::string> &messages) : Message(), fMessages(messages) {
+    fBuffer.append(id);
+    fBuffer.append((uint32_t) messages.size());
+    for (auto &message : messages) {
+      fBuffer.append((uint32_t) message.size());
+      fBuffer.append(message);
+    }
+  }
+
+  explicit BatchMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 8)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    auto count = msg.getBuffer().get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+      auto size = msg.getBuffer().get<uint32_t>();
+      auto charVector = msg.getBuffer().get<char>(size);
+      fMessages.emplace_back(charVector.begin(), charVector.end());
+    }
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  const std::vector<std::string> &getMessages() const {
+    return fMessages;
+  }
+
+private:
+  std::vector<std::string> fMessages;
+};
+
+#endif //TERMINUS_BATCHMESSAGE_H
@@ -46,7 +46,7 @@ public:
   }
 
   template<typename T>
-  std::vector<T> get(uint16_t size) const {
+  std::vector<T> get(uint32_t size) const {
     // check if data is empty
     if (fData.empty())
       return {};
@@ -56,7 +56,7 @@ public:
     std::vector<T> ret = {};
     auto it = fDataIterator;
     fDataIterator += size;
-    for (int i = 0; i < size; i++) {
+    for (uint32_t i = 0; i < size; i++) {
       ret.emplace_back(*it++);
     }
     return ret;
@@ -120,6 +120,13 @@ public:
     fDataIterator = fData.begin();
   }
 
+  /**
+   * @return number of bytes not read yet
+   */
+  size_t getRemaining() const {
+    return fData.end() - fDataIterator;
+  }
+
 private:
 
   template<typename ReturnType, typename InputType>
@@ -0,0 +1,55 @@
+#ifndef TERMINUS_CHANNELDATAMESSAGE_H
+#define TERMINUS_CHANNELDATAMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+
+/**
+ * @brief carries one frame of a session multiplexed over a shared connection
+ * @note the payload is an already encrypted frame, so the envelope itself is sent as is
+ */
+class ChannelDataMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<ChannelDataMessage>;
+public:
+  static constexpr uint32_t id = 0x52894083;
+public:
+  ChannelDataMessage(uint32_t channel, const std::string &payload) :
+    Message(), fChannel(channel), fPayload(payload) {
+    fBuffer.append(id);
+    fBuffer.append(channel);
+    fBuffer.append((uint32_t) payload.size());
+    fBuffer.append(payload);
+  }
+
+  explicit ChannelDataMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 12)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fChannel = msg.getBuffer().get<uint32_t>();
+    auto size = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(size);
+    fPayload = std::string(charVector.begin(), charVector.end());
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getChannel() const {
+    return fChannel;
+  }
+
+  const std::string &getPayload() const {
+    return fPayload;
+  }
+
+private:
+  uint32_t fChannel = 0;
+  std::string fPayload;
+};
+
+#endif //TERMINUS_CHANNELDATAMESSAGE_H
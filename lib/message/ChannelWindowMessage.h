@@ -0,0 +1,49 @@
+#ifndef TERMINUS_CHANNELWINDOWMESSAGE_H
+#define TERMINUS_CHANNELWINDOWMESSAGE_H
+
+#include "Message.h"
+
+/**
+ * @brief grants the server credit to send more bytes on a channel
+ * @note sent by the multiplexing side once it passed the data on, a channel without credit only stalls its own session
+ */
+class ChannelWindowMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<ChannelWindowMessage>;
+public:
+  static constexpr uint32_t id = 0x18228133;
+public:
+  ChannelWindowMessage(uint32_t channel, uint32_t credit) : Message(), fChannel(channel), fCredit(credit) {
+    fBuffer.append(id);
+    fBuffer.append(channel);
+    fBuffer.append(credit);
+  }
+
+  explicit ChannelWindowMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 12)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fChannel = msg.getBuffer().get<uint32_t>();
+    fCredit = msg.getBuffer().get<uint32_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getChannel() const {
+    return fChannel;
+  }
+
+  uint32_t getCredit() const {
+    return fCredit;
+  }
+
+private:
+  uint32_t fChannel = 0;
+  uint32_t fCredit = 0;
+};
+
+#endif //TERMINUS_CHANNELWINDOWMESSAGE_H
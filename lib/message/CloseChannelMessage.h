@@ -0,0 +1,41 @@
+#ifndef TERMINUS_CLOSECHANNELMESSAGE_H
+#define TERMINUS_CLOSECHANNELMESSAGE_H
+
+#include "Message.h"
+
+/**
+ * @brief ends a session of a multiplexed connection, the same as closing a connection of its own
+ */
+class CloseChannelMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<CloseChannelMessage>;
+public:
+  static constexpr uint32_t id = 0xEAA05335;
+public:
+  explicit CloseChannelMessage(uint32_t channel) : Message(), fChannel(channel) {
+    fBuffer.append(id);
+    fBuffer.append(channel);
+  }
+
+  explicit CloseChannelMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 8)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fChannel = msg.getBuffer().get<uint32_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getChannel() const {
+    return fChannel;
+  }
+
+private:
+  uint32_t fChannel = 0;
+};
+
+#endif //TERMINUS_CLOSECHANNELMESSAGE_H
@@ -0,0 +1,65 @@
+#ifndef TERMINUS_COMMANDOUTPUTMESSAGE_H
+#define TERMINUS_COMMANDOUTPUTMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+
+/**
+ * @brief chunk of output of a command started by ExecuteCommandMessage
+ * @note client id is filled in by the server before the chunk is passed to the controller
+ */
+class CommandOutputMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<CommandOutputMessage>;
+public:
+  static constexpr uint32_t id = 0x9A52E6C4;
+public:
+  CommandOutputMessage(uint32_t requestId, const std::string &clientId, const std::string &chars) :
+    Message(), fRequestId(requestId), fClientId(clientId), fChars(chars) {
+    fBuffer.append(id);
+    fBuffer.append(requestId);
+    fBuffer.append((uint32_t) clientId.size());
+    fBuffer.append(clientId);
+    fBuffer.append((uint32_t) chars.size());
+    fBuffer.append(chars);
+  }
+
+  explicit CommandOutputMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 16)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fRequestId = msg.getBuffer().get<uint32_t>();
+    auto size = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(size);
+    fClientId = std::string(charVector.begin(), charVector.end());
+    size = msg.getBuffer().get<uint32_t>();
+    charVector = msg.getBuffer().get<char>(size);
+    fChars = std::string(charVector.begin(), charVector.end());
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getRequestId() const {
+    return fRequestId;
+  }
+
+  const std::string &getClientId() const {
+    return fClientId;
+  }
+
+  const std::string &getChars() const {
+    return fChars;
+  }
+
+private:
+  uint32_t fRequestId = 0;
+  std::string fClientId;
+  std::string fChars;
+};
+
+#endif //TERMINUS_COMMANDOUTPUTMESSAGE_H
@@ -0,0 +1,83 @@
+#ifndef TERMINUS_COMMANDRESULTMESSAGE_H
+#define TERMINUS_COMMANDRESULTMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+
+enum class CommandStatus : uint32_t {
+  StatusExited = 0x1D6B30E2,
+  StatusTimedOut = 0x6C84F1A9,
+  StatusUnreachable = 0xE2074B5D,
+  StatusFailed = 0x58A3C61F
+};
+
+/**
+ * @brief final state of a command started by ExecuteCommandMessage on one host
+ */
+class CommandResultMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<CommandResultMessage>;
+public:
+  static constexpr uint32_t id = 0x47E0BB13;
+public:
+  CommandResultMessage(uint32_t requestId, const std::string &clientId, CommandStatus status,
+                       int32_t exitCode = -1, uint32_t elapsedMs = 0) :
+    Message(), fRequestId(requestId), fClientId(clientId), fStatus(status), fExitCode(exitCode), fElapsedMs(elapsedMs) {
+    fBuffer.append(id);
+    fBuffer.append(requestId);
+    fBuffer.append((uint32_t) clientId.size());
+    fBuffer.append(clientId);
+    fBuffer.append((uint32_t) status);
+    fBuffer.append((uint32_t) exitCode);
+    fBuffer.append(elapsedMs);
+  }
+
+  explicit CommandResultMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 24)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fRequestId = msg.getBuffer().get<uint32_t>();
+    auto size = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(size);
+    fClientId = std::string(charVector.begin(), charVector.end());
+    fStatus = static_cast<CommandStatus>(msg.getBuffer().get<uint32_t>());
+    fExitCode = (int32_t) msg.getBuffer().get<uint32_t>();
+    fElapsedMs = msg.getBuffer().get<uint32_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getRequestId() const {
+    return fRequestId;
+  }
+
+  const std::string &getClientId() const {
+    return fClientId;
+  }
+
+  CommandStatus getStatus() const {
+    return fStatus;
+  }
+
+  int32_t getExitCode() const {
+    return fExitCode;
+  }
+
+  uint32_t getElapsedMs() const {
+    return fElapsedMs;
+  }
+
+private:
+  uint32_t fRequestId = 0;
+  std::string fClientId;
+  CommandStatus fStatus = CommandStatus::StatusFailed;
+  int32_t fExitCode = -1;
+  uint32_t fElapsedMs = 0;
+};
+
+#endif //TERMINUS_COMMANDRESULTMESSAGE_H
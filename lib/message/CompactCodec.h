@@ -0,0 +1,402 @@
+#ifndef TERMINUS_COMPACTCODEC_H
+#define TERMINUS_COMPACTCODEC_H
+
+#include <string>
+#include <vector>
+
+#include "Message.h"
+#include "PutCharMessage.h"
+#include "ResizeTerminalMessage.h"
+#include "ResponseMessage.h"
+#include "ConnectMessage.h"
+#include "ExecuteCommandMessage.h"
+#include "CommandOutputMessage.h"
+#include "CommandResultMessage.h"
+#include "SequencedMessage.h"
+#include "ResumeMessage.h"
+#include "ChannelDataMessage.h"
+#include "OpenChannelMessage.h"
+#include "CloseChannelMessage.h"
+#include "ChannelWindowMessage.h"
+#include "CompressedMessage.h"
+#include "CompressionRequestMessage.h"
+#include "DisplayModeMessage.h"
+#include "BatchMessage.h"
+#include "WindowUpdateMessage.h"
+#include "HeartbeatMessage.h"
+#include "TraceMessage.h"
+#include "MasterDetachedMessage.h"
+
+/**
+ * @brief translates messages between their usual layout and the compact wire format
+ * @note a compact message starts with a one byte type instead of the 32-bit id, counters and lengths are varints
+ * and the last string or nested message of a message runs to its end without a length. A compact frame puts a
+ * varint length after the type, only encrypted frames and channel data are sent as frames and neither type is
+ * the first byte of a message id, so both formats can be told apart by the first byte of a frame.
+ */
+class CompactCodec {
+public:
+  static constexpr uint8_t TYPE_ENCRYPTED = 0xF1;
+  static constexpr uint8_t TYPE_CHANNEL_DATA = 0xF2;
+  static constexpr size_t MAX_VARINT_SIZE = 5;
+  /*! a batch holds session frames, which nest a message, which may be compressed */
+  static constexpr int MAX_DEPTH = 3;
+private:
+  enum class Field : uint8_t {
+    Byte,
+    /*! random values such as session ids, a varint would be longer */
+    Fixed,
+    Varint,
+    Varint16,
+    String,
+    String16,
+    Strings,
+    /*! string running to the end of the message */
+    Tail,
+    /*! serialized message running to the end of the message */
+    Nested,
+    /*! count of serialized messages, each with its length */
+    Messages
+  };
+
+  struct Schema {
+    uint8_t type;
+    uint32_t id;
+    std::vector<Field> fields;
+  };
+
+  class Reader {
+  private:
+    const uint8_t *fData;
+    size_t fSize;
+    size_t fOffset = 0;
+  public:
+    Reader(const uint8_t *data, size_t size) : fData(data), fSize(size) {
+    }
+
+    bool atEnd() const {
+      return fOffset == fSize;
+    }
+
+    size_t remaining() const {
+      return fSize - fOffset;
+    }
+
+    const uint8_t *current() const {
+      return fData + fOffset;
+    }
+
+    bool skip(size_t size) {
+      if (size > remaining()) return false;
+      fOffset += size;
+      return true;
+    }
+
+    template<typename T>
+    bool readLe(T &value) {
+      if (sizeof(T) > remaining()) return false;
+      value = 0;
+      for (size_t i = 0; i < sizeof(T); i++)
+        value |= (T) fData[fOffset++] << (i * 8);
+      return true;
+    }
+
+    bool readVarint(uint32_t &value) {
+      value = 0;
+      for (size_t i = 0; i < MAX_VARINT_SIZE; i++) {
+        if (atEnd()) return false;
+        auto byte = fData[fOffset++];
+        // the fifth byte holds the top four bits only
+        if (i == MAX_VARINT_SIZE - 1 && byte > 0x0F) return false;
+        value |= (uint32_t) (byte & 0x7F) << (i * 7);
+        if (!(byte & 0x80)) return true;
+      }
+      return false;
+    }
+  };
+public:
+
+  static bool isFrameType(uint8_t type) {
+    return type == TYPE_ENCRYPTED || type == TYPE_CHANNEL_DATA;
+  }
+
+  static void appendVarint(uint32_t value, std::string &out) {
+    while (value >= 0x80) {
+      out += (char) (value | 0x80);
+      value >>= 7;
+    }
+    out += (char) value;
+  }
+
+  /**
+   * @return size of the compact frame starting at data, 0 if the header is incomplete, -1 if it is malformed
+   */
+  static long getFrameSize(const uint8_t *data, size_t len) {
+    Reader reader(data, len);
+    uint8_t type;
+    uint32_t size;
+    if (!reader.readLe(type)) return 0;
+    if (!isFrameType(type)) return -1;
+    if (!reader.readVarint(size)) return len > MAX_VARINT_SIZE ? -1 : 0;
+    return (long) (len - reader.remaining()) + (long) size;
+  }
+
+  /**
+   * @brief splits a complete compact frame into its type and body
+   */
+  static bool getFrameBody(const uint8_t *data, size_t len, uint8_t &type, const uint8_t *&body, size_t &size) {
+    Reader reader(data, len);
+    uint32_t bodySize;
+    if (!reader.readLe(type) || !reader.readVarint(bodySize) || bodySize != reader.remaining()) return false;
+    body = reader.current();
+    size = bodySize;
+    return true;
+  }
+
+  static std::string makeFrame(uint8_t type, const std::string &body) {
+    std::string frame(1, (char) type);
+    appendVarint((uint32_t) body.size(), frame);
+    return frame + body;
+  }
+
+  /**
+   * @return msg as it is sent unencrypted in the given format, see EncryptedMessage for everything else
+   */
+  static std::string makeFrame(const Message::Ptr &msg, WireFormat format) {
+    auto &buffer = msg->getBuffer();
+    std::string encoded;
+    if (format == WireFormat::Compact && encode(buffer.getDataPtr(), buffer.getSize(), encoded) &&
+        isFrameType((uint8_t) encoded[0]))
+      return makeFrame((uint8_t) encoded[0], encoded.substr(1));
+    return {(const char *) buffer.getDataPtr(), buffer.getSize()};
+  }
+
+  /**
+   * @brief translates a serialized message into its compact form
+   * @return false if the message has no compact form, it is then sent as it is
+   */
+  static bool encode(const uint8_t *data, size_t len, std::string &out, int depth = 0) {
+    Reader reader(data, len);
+    uint32_t id;
+    if (depth > MAX_DEPTH || !reader.readLe(id)) return false;
+    auto schema = findById(id);
+    if (!schema) return false;
+    out += (char) schema->type;
+    for (auto field : schema->fields) {
+      // trailing fields added to a message later may be missing
+      if (reader.atEnd()) break;
+      uint8_t byte;
+      uint16_t word;
+      uint32_t value;
+      switch (field) {
+        case Field::Byte:
+          if (!reader.readLe(byte)) return false;
+          out += (char) byte;
+          break;
+        case Field::Fixed:
+          if (!reader.readLe(value)) return false;
+          appendLe(value, out);
+          break;
+        case Field::Varint:
+          if (!reader.readLe(value)) return false;
+          appendVarint(value, out);
+          break;
+        case Field::Varint16:
+          if (!reader.readLe(word)) return false;
+          appendVarint(word, out);
+          break;
+        case Field::String:
+          if (!encodeString<uint32_t>(reader, out)) return false;
+          break;
+        case Field::String16:
+          if (!encodeString<uint16_t>(reader, out)) return false;
+          break;
+        case Field::Strings:
+          if (!reader.readLe(value)) return false;
+          appendVarint(value, out);
+          for (uint32_t i = 0; i < value; i++)
+            if (!encodeString<uint32_t>(reader, out)) return false;
+          break;
+        case Field::Tail:
+          if (!reader.readLe(value) || value != reader.remaining()) return false;
+          out.append((const char *) reader.current(), value);
+          reader.skip(value);
+          break;
+        case Field::Nested:
+          if (!reader.readLe(value) || value != reader.remaining()) return false;
+          if (value > 0 && !encode(reader.current(), value, out, depth + 1)) return false;
+          reader.skip(value);
+          break;
+        case Field::Messages:
+          if (!reader.readLe(value)) return false;
+          appendVarint(value, out);
+          for (uint32_t i = 0; i < value; i++) {
+            uint32_t size;
+            std::string nested;
+            if (!reader.readLe(size) || size > reader.remaining() || !encode(reader.current(), size, nested, depth + 1)) return false;
+            appendVarint((uint32_t) nested.size(), out);
+            out += nested;
+            reader.skip(size);
+          }
+          break;
+      }
+    }
+    return reader.atEnd();
+  }
+
+  /**
+   * @brief translates a compact message back into the layout MessageParser expects
+   */
+  static bool decode(const uint8_t *data, size_t len, std::string &out, int depth = 0) {
+    if (len == 0) return false;
+    return decode(data[0], data + 1, len - 1, out, depth);
+  }
+
+  static bool decode(uint8_t type, const uint8_t *data, size_t len, std::string &out, int depth = 0) {
+    Reader reader(data, len);
+    auto schema = findByType(type);
+    if (depth > MAX_DEPTH || !schema) return false;
+    appendLe(schema->id, out);
+    for (auto field : schema->fields) {
+      if (reader.atEnd() && field != Field::Tail && field != Field::Nested) break;
+      uint8_t byte;
+      uint32_t value;
+      switch (field) {
+        case Field::Byte:
+          if (!reader.readLe(byte)) return false;
+          out += (char) byte;
+          break;
+        case Field::Fixed:
+          if (!reader.readLe(value)) return false;
+          appendLe(value, out);
+          break;
+        case Field::Varint:
+          if (!reader.readVarint(value)) return false;
+          appendLe(value, out);
+          break;
+        case Field::Varint16:
+          if (!reader.readVarint(value) || value > 0xFFFF) return false;
+          appendLe((uint16_t) value, out);
+          break;
+        case Field::String:
+          if (!decodeString<uint32_t>(reader, out)) return false;
+          break;
+        case Field::String16:
+          if (!decodeString<uint16_t>(reader, out)) return false;
+          break;
+        case Field::Strings:
+          if (!reader.readVarint(value)) return false;
+          appendLe(value, out);
+          for (uint32_t i = 0; i < value; i++)
+            if (!decodeString<uint32_t>(reader, out)) return false;
+          break;
+        case Field::Tail:
+          appendLe((uint32_t) reader.remaining(), out);
+          out.append((const char *) reader.current(), reader.remaining());
+          reader.skip(reader.remaining());
+          break;
+        case Field::Nested: {
+          std::string nested;
+          if (!reader.atEnd() && !decode(reader.current(), reader.remaining(), nested, depth + 1)) return false;
+          appendLe((uint32_t) nested.size(), out);
+          out += nested;
+          reader.skip(reader.remaining());
+          break;
+        }
+        case Field::Messages:
+          if (!reader.readVarint(value)) return false;
+          appendLe(value, out);
+          for (uint32_t i = 0; i < value; i++) {
+            uint32_t size;
+            std::string nested;
+            if (!reader.readVarint(size) || size > reader.remaining() || !decode(reader.current(), size, nested, depth + 1)) return false;
+            appendLe((uint32_t) nested.size(), out);
+            out += nested;
+            reader.skip(size);
+          }
+          break;
+      }
+    }
+    return reader.atEnd();
+  }
+
+  /**
+   * @return id of every message with a compact form
+   */
+  static std::vector<uint32_t> getIds() {
+    std::vector<uint32_t> ids;
+    for (auto &schema : getSchemas())
+      ids.push_back(schema.id);
+    return ids;
+  }
+
+private:
+
+  static const std::vector<Schema> &getSchemas() {
+    // types are part of the wire format, new messages get new ones, TYPE_ENCRYPTED only appears as a frame
+    static const std::vector<Schema> SCHEMAS = {
+      {TYPE_CHANNEL_DATA, ChannelDataMessage::id,           {Field::Varint, Field::Tail}},
+      {0x01,              PutCharMessage::id,               {Field::Tail}},
+      {0x02,              ResizeTerminalMessage::id,        {Field::Varint, Field::Varint}},
+      {0x03,              ResponseMessage::id,              {Field::Fixed, Field::String16}},
+      {0x04,              ConnectMessage::id,               {Field::Fixed, Field::String, Field::Byte, Field::Varint16, Field::Byte, Field::Varint16, Field::Varint}},
+      {0x05,              ExecuteCommandMessage::id,        {Field::Varint, Field::Varint, Field::String, Field::Strings}},
+      {0x06,              CommandOutputMessage::id,         {Field::Varint, Field::String, Field::Tail}},
+      {0x07,              CommandResultMessage::id,         {Field::Varint, Field::String, Field::Fixed, Field::Varint, Field::Varint}},
+      {0x08,              SequencedMessage::id,             {Field::Fixed, Field::Varint, Field::Fixed, Field::Varint, Field::Nested}},
+      {0x09,              ResumeMessage::id,                {Field::Fixed, Field::Fixed, Field::Varint, Field::Byte}},
+      {0x0A,              OpenChannelMessage::id,           {Field::Varint, Field::Fixed, Field::String, Field::Byte, Field::Varint16, Field::Varint}},
+      {0x0B,              CloseChannelMessage::id,          {Field::Varint}},
+      {0x0C,              ChannelWindowMessage::id,         {Field::Varint, Field::Varint}},
+      {0x0D,              CompressedMessage::id,            {Field::Byte, Field::Varint, Field::Varint, Field::Tail}},
+      {0x0E,              CompressionRequestMessage::id,    {Field::Varint}},
+      {0x0F,              DisplayModeMessage::id,           {Field::Varint, Field::Varint}},
+      {0x10,              BatchMessage::id,                 {Field::Messages}},
+      {0x11,              WindowUpdateMessage::id,          {Field::Varint, Field::Byte}},
+      {0x12,              HeartbeatMessage::id,             {Field::Fixed, Field::Byte}},
+      {0x13,              TraceMessage::id,                 {Field::Fixed, Field::Fixed, Field::Fixed, Field::Fixed, Field::Fixed,
+                                                             Field::Fixed, Field::Fixed, Field::Fixed}},
+      {0x14,              MasterDetachedMessage::id,        {}},
+    };
+    return SCHEMAS;
+  }
+
+  static const Schema *findById(uint32_t id) {
+    for (auto &schema : getSchemas())
+      if (schema.id == id) return &schema;
+    return nullptr;
+  }
+
+  static const Schema *findByType(uint8_t type) {
+    for (auto &schema : getSchemas())
+      if (schema.type == type) return &schema;
+    return nullptr;
+  }
+
+  template<typename T>
+  static void appendLe(T value, std::string &out) {
+    for (size_t i = 0; i < sizeof(T); i++)
+      out += (char) (value >> (i * 8));
+  }
+
+  template<typename T>
+  static bool encodeString(Reader &reader, std::string &out) {
+    T size;
+    if (!reader.readLe(size) || size > reader.remaining()) return false;
+    appendVarint(size, out);
+    out.append((const char *) reader.current(), size);
+    return reader.skip(size);
+  }
+
+  template<typename T>
+  static bool decodeString(Reader &reader, std::string &out) {
+    uint32_t size;
+    if (!reader.readVarint(size) || size > reader.remaining() || size > (uint32_t) (T) ~0) return false;
+    appendLe((T) size, out);
+    out.append((const char *) reader.current(), size);
+    return reader.skip(size);
+  }
+};
+
+
+#endif //TERMINUS_COMPACTCODEC_H
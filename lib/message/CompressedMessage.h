@@ -0,0 +1,75 @@
+#ifndef TERMINUS_COMPRESSEDMESSAGE_H
+#define TERMINUS_COMPRESSEDMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+
+/**
+ * @brief a serialized message compressed as part of a stream, see StreamCompressor
+ * @note index counts frames since the stream was reset, a receiver missing one of them has to wait for the next reset
+ */
+class CompressedMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<CompressedMessage>;
+public:
+  static constexpr uint32_t id = 0xFD198CC8;
+  /*! the stream starts over with this frame, earlier frames are not needed to decompress it */
+  const static uint8_t FLAG_RESET = 0x01;
+public:
+  CompressedMessage(uint8_t flags, uint32_t index, uint32_t originalSize, const std::string &data) :
+    Message(), fFlags(flags), fIndex(index), fOriginalSize(originalSize), fData(data) {
+    fBuffer.append(id);
+    fBuffer.append(flags);
+    fBuffer.append(index);
+    fBuffer.append(originalSize);
+    fBuffer.append((uint32_t) data.size());
+    fBuffer.append(data);
+  }
+
+  explicit CompressedMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 17)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fFlags = msg.getBuffer().get<uint8_t>();
+    fIndex = msg.getBuffer().get<uint32_t>();
+    fOriginalSize = msg.getBuffer().get<uint32_t>();
+    auto size = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(size);
+    fData = std::string(charVector.begin(), charVector.end());
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  bool isReset() const {
+    return fFlags & FLAG_RESET;
+  }
+
+  uint8_t getFlags() const {
+    return fFlags;
+  }
+
+  uint32_t getIndex() const {
+    return fIndex;
+  }
+
+  uint32_t getOriginalSize() const {
+    return fOriginalSize;
+  }
+
+  const std::string &getData() const {
+    return fData;
+  }
+
+private:
+  uint8_t fFlags = 0;
+  uint32_t fIndex = 0;
+  uint32_t fOriginalSize = 0;
+  std::string fData;
+};
+
+#endif //TERMINUS_COMPRESSEDMESSAGE_H
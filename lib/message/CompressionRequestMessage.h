@@ -0,0 +1,47 @@
+#ifndef TERMINUS_COMPRESSIONREQUESTMESSAGE_H
+#define TERMINUS_COMPRESSIONREQUESTMESSAGE_H
+
+#include "Message.h"
+
+enum class CompressionType : uint32_t {
+  None = 0,
+  Deflate = 1
+};
+
+/**
+ * @brief sent by a master to have the slave compress its output, the slave starts a fresh stream on every request
+ * @note a master that lost track of the stream sends it again to get a reset frame
+ */
+class CompressionRequestMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<CompressionRequestMessage>;
+public:
+  static constexpr uint32_t id = 0x21DA3AA5;
+public:
+  explicit CompressionRequestMessage(CompressionType type) : Message(), fType(type) {
+    fBuffer.append(id);
+    fBuffer.append((uint32_t) type);
+  }
+
+  explicit CompressionRequestMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 8)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fType = static_cast<CompressionType>(msg.getBuffer().get<uint32_t>());
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  CompressionType getType() const {
+    return fType;
+  }
+
+private:
+  CompressionType fType = CompressionType::None;
+};
+
+#endif //TERMINUS_COMPRESSIONREQUESTMESSAGE_H
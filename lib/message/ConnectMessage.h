@@ -7,16 +7,40 @@
 
 enum class ConnectionType : uint32_t {
   TypeSlave = 0xBA186B22,
-  TypeMaster = 0x8DAE13DF
+  TypeMaster = 0x8DAE13DF,
+  TypeController = 0x2C5F7A90,
+  /*! carries the sessions of many masters as channels, see OpenChannelMessage */
+  TypeMux = 0x7AEB6049
+};
+
+/*! how frames are laid out on a connection, the value is the version of the format, see CompactCodec */
+enum class WireFormat : uint8_t {
+  Legacy = 0,
+  Compact = 1
 };
 
 class ConnectOptions {
 public:
   const static uint16_t defaultKeepAliveInterval = 5;
+  /*! version of the handshake, clients older than capabilities send none and count as version 0 */
+  const static uint16_t PROTOCOL_VERSION = 1;
+  /*! frames in the compact format, see CompactCodec */
+  const static uint32_t CAPABILITY_COMPACT = 1u << 0;
+  /*! peer frames batched under one envelope, see BatchMessage, only together with the compact format */
+  const static uint32_t CAPABILITY_BATCHING = 1u << 1;
+  /*! response metadata in MessagePack instead of json text, see ResponseMessage */
+  const static uint32_t CAPABILITY_BINARY_METADATA = 1u << 2;
+  /*! the server sends heartbeats every keep alive interval, see HeartbeatMessage */
+  const static uint32_t CAPABILITY_HEARTBEAT = 1u << 3;
+  /*! keystrokes may be followed by the server and the slave, see TraceMessage */
+  const static uint32_t CAPABILITY_TRACE = 1u << 4;
+  /*! a slave is told when the master of its session detaches, see MasterDetachedMessage */
+  const static uint32_t CAPABILITY_DETACH_NOTICE = 1u << 5;
 public:
   explicit ConnectOptions(ConnectionType connectionType, std::string clientId, bool useKeepAlive = false,
-                          uint16_t keepAliveInterval = defaultKeepAliveInterval) :
-    fConnectionType(connectionType), fUseKeepAlive(useKeepAlive), fKeepAliveInterval(keepAliveInterval), fClientId(std::move(clientId)) {
+                          uint16_t keepAliveInterval = defaultKeepAliveInterval, bool resume = false) :
+    fConnectionType(connectionType), fUseKeepAlive(useKeepAlive), fKeepAliveInterval(keepAliveInterval), fClientId(std::move(clientId)),
+    fResume(resume) {
   }
 
   ConnectionType &getConnectionType() const {
@@ -44,18 +68,63 @@ public:
     fKeepAliveInterval = keepAliveInterval;
   }
 
+  /**
+   * @brief a resuming client replaces a connection of the same id the server still holds
+   */
+  bool isResume() const {
+    return fResume;
+  }
+
+  void setResume(bool resume) {
+    fResume = resume;
+  }
+
+  uint16_t getProtocolVersion() const {
+    return fProtocolVersion;
+  }
+
+  void setProtocolVersion(uint16_t version) {
+    fProtocolVersion = version;
+  }
+
+  /**
+   * @brief the optional features the client would like to use, the server answers with those it supports as well
+   */
+  uint32_t getCapabilities() const {
+    return fCapabilities;
+  }
+
+  void setCapabilities(uint32_t capabilities) {
+    fCapabilities = capabilities;
+  }
+
+  bool hasCapability(uint32_t capability) const {
+    return (fCapabilities & capability) == capability;
+  }
+
+  WireFormat getWireFormat() const {
+    return toWireFormat(fCapabilities);
+  }
+
+  static WireFormat toWireFormat(uint32_t capabilities) {
+    return capabilities & CAPABILITY_COMPACT ? WireFormat::Compact : WireFormat::Legacy;
+  }
+
 private:
   mutable bool fUseKeepAlive;
   mutable uint16_t fKeepAliveInterval;
   mutable ConnectionType fConnectionType;
   std::string fClientId;
+  bool fResume = false;
+  uint16_t fProtocolVersion = PROTOCOL_VERSION;
+  uint32_t fCapabilities = 0;
 };
 
 class ConnectMessage : public Message {
 public:
   using Ptr = std::shared_ptr<ConnectMessage>;
 public:
-  const static uint32_t id = 0x6E4DC60B;
+  static constexpr uint32_t id = 0x6E4DC60B;
 public:
   explicit ConnectMessage(const ConnectOptions &connectOptions) :
     Message(), fConnectOptions(std::make_shared<ConnectOptions>(connectOptions)) {
@@ -65,6 +134,9 @@ public:
     fBuffer.append(fConnectOptions->getClientId());
     fBuffer.append((uint8_t) fConnectOptions->keepAliveUsed());
     fBuffer.append((uint16_t) fConnectOptions->keepAliveInterval());
+    fBuffer.append((uint8_t) fConnectOptions->isResume());
+    fBuffer.append((uint16_t) fConnectOptions->getProtocolVersion());
+    fBuffer.append((uint32_t) fConnectOptions->getCapabilities());
   }
 
   explicit ConnectMessage(const Message &msg) {
@@ -79,8 +151,14 @@ public:
     fConnectOptions = std::make_shared<ConnectOptions>(
       static_cast<ConnectionType>(connectionType),
       std::string(charVector.begin(), charVector.end()));
-    if (msg.getBuffer().get<uint8_t>())
-      fConnectOptions->useKeepAlive(msg.getBuffer().get<uint16_t>());
+    bool keepAliveUsed = msg.getBuffer().get<uint8_t>();
+    auto keepAliveInterval = msg.getBuffer().get<uint16_t>();
+    if (keepAliveUsed)
+      fConnectOptions->useKeepAlive(keepAliveInterval);
+    fConnectOptions->setResume(msg.getBuffer().get<uint8_t>());
+    // missing with clients older than capabilities, read as zero
+    fConnectOptions->setProtocolVersion(msg.getBuffer().get<uint16_t>());
+    fConnectOptions->setCapabilities(msg.getBuffer().get<uint32_t>());
   }
 
   uint32_t getId() const override {
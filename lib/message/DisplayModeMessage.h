@@ -0,0 +1,55 @@
+#ifndef TERMINUS_DISPLAYMODEMESSAGE_H
+#define TERMINUS_DISPLAYMODEMESSAGE_H
+
+#include "Message.h"
+
+enum class DisplayMode : uint32_t {
+  /*! pty output is relayed byte for byte */
+  Stream = 0,
+  /*! the slave sends what changed on its screen, at most frameRate times per second */
+  ScreenSync = 1
+};
+
+/**
+ * @brief sent by a master to choose how the slave passes on its output, every request repaints the whole screen
+ */
+class DisplayModeMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<DisplayModeMessage>;
+public:
+  static constexpr uint32_t id = 0xB721029F;
+public:
+  DisplayModeMessage(DisplayMode mode, uint32_t frameRate) : Message(), fMode(mode), fFrameRate(frameRate) {
+    fBuffer.append(id);
+    fBuffer.append((uint32_t) mode);
+    fBuffer.append(frameRate);
+  }
+
+  explicit DisplayModeMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 12)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fMode = static_cast<DisplayMode>(msg.getBuffer().get<uint32_t>());
+    fFrameRate = msg.getBuffer().get<uint32_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  DisplayMode getMode() const {
+    return fMode;
+  }
+
+  uint32_t getFrameRate() const {
+    return fFrameRate;
+  }
+
+private:
+  DisplayMode fMode = DisplayMode::Stream;
+  uint32_t fFrameRate = 0;
+};
+
+#endif //TERMINUS_DISPLAYMODEMESSAGE_H
@@ -2,14 +2,21 @@
 #define TERMINUS_ENCRYPTEDMESSAGE_H
 
 #include "Message.h"
+#include "CompactCodec.h"
 #include "crypto/CryptoInterface.h"
 #include "logger/Logger.h"
 
 class EncryptedMessage : public Message {
 public:
-  const static uint32_t id = 0xC7A469E3;
+  static constexpr uint32_t id = 0xC7A469E3;
 public:
-  explicit EncryptedMessage(const Message::Ptr &msg, const std::string &key, const std::string &iv) : Message() {
+  explicit EncryptedMessage(const Message::Ptr &msg, const std::string &key, const std::string &iv,
+                            WireFormat format = WireFormat::Legacy) : Message() {
+    std::string compact;
+    if (format == WireFormat::Compact && CompactCodec::encode(msg->getBuffer().getDataPtr(), msg->getBuffer().getSize(), compact)) {
+      fBuffer.append(CompactCodec::makeFrame(CompactCodec::TYPE_ENCRYPTED, Crypto::AES256::encryptData(compact, key, iv)));
+      return;
+    }
     fBuffer.append(id);
     std::string data((char *) msg->getBuffer().getDataPtr(), msg->getBuffer().getSize());
     auto encryptedData = Crypto::AES256::encryptData(data, key, iv);
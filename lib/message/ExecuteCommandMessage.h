@@ -0,0 +1,83 @@
+#ifndef TERMINUS_EXECUTECOMMANDMESSAGE_H
+#define TERMINUS_EXECUTECOMMANDMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief asks to run a command non interactively
+ * @note sent by a controller to the server with the list of target client ids,
+ * the server forwards it to every target slave with an empty target list
+ */
+class ExecuteCommandMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<ExecuteCommandMessage>;
+public:
+  static constexpr uint32_t id = 0x3F1C9D27;
+public:
+  ExecuteCommandMessage(uint32_t requestId, const std::string &command, uint32_t timeoutMs,
+                        const std::vector<std::string> &targets = {}) :
+    Message(), fRequestId(requestId), fTimeoutMs(timeoutMs), fCommand(command), fTargets(targets) {
+    fBuffer.append(id);
+    fBuffer.append(requestId);
+    fBuffer.append(timeoutMs);
+    fBuffer.append((uint32_t) command.size());
+    fBuffer.append(command);
+    fBuffer.append((uint32_t) targets.size());
+    for (auto &target : targets) {
+      fBuffer.append((uint32_t) target.size());
+      fBuffer.append(target);
+    }
+  }
+
+  explicit ExecuteCommandMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 20)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fRequestId = msg.getBuffer().get<uint32_t>();
+    fTimeoutMs = msg.getBuffer().get<uint32_t>();
+    auto size = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(size);
+    fCommand = std::string(charVector.begin(), charVector.end());
+    auto numTargets = msg.getBuffer().get<uint32_t>();
+    if (numTargets > msg.getBuffer().getRemaining() / sizeof(uint32_t))
+      return;
+    for (uint32_t i = 0; i < numTargets; i++) {
+      size = msg.getBuffer().get<uint32_t>();
+      charVector = msg.getBuffer().get<char>(size);
+      fTargets.emplace_back(charVector.begin(), charVector.end());
+    }
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getRequestId() const {
+    return fRequestId;
+  }
+
+  uint32_t getTimeoutMs() const {
+    return fTimeoutMs;
+  }
+
+  const std::string &getCommand() const {
+    return fCommand;
+  }
+
+  const std::vector<std::string> &getTargets() const {
+    return fTargets;
+  }
+
+private:
+  uint32_t fRequestId = 0;
+  uint32_t fTimeoutMs = 0;
+  std::string fCommand;
+  std::vector<std::string> fTargets;
+};
+
+#endif //TERMINUS_EXECUTECOMMANDMESSAGE_H
@@ -0,0 +1,109 @@
+#ifndef TERMINUS_FRAMEREADER_H
+#define TERMINUS_FRAMEREADER_H
+
+#include "PutCharMessage.h"
+#include "ResizeTerminalMessage.h"
+#include "ConnectMessage.h"
+#include "EncryptedMessage.h"
+#include "ChannelDataMessage.h"
+#include "CompactCodec.h"
+
+/**
+ * @brief splits a tcp byte stream into complete message frames
+ * @note one recv() may carry a part of a frame or several frames at once
+ */
+class FrameReader {
+public:
+  /*! a channel envelope around the largest encrypted frame */
+  static const size_t MAX_FRAME_SIZE = 0x10000 + 32;
+private:
+  std::vector<uint8_t> fData;
+  size_t fOffset = 0;
+  bool fFailed = false;
+public:
+  void append(const uint8_t *data, size_t len) {
+    if (fOffset > 0 && fOffset == fData.size()) {
+      fData.clear();
+      fOffset = 0;
+    }
+    fData.insert(fData.end(), data, data + len);
+  }
+
+  bool next(Buffer &frame) {
+    if (fFailed) return false;
+    auto available = fData.size() - fOffset;
+    auto frameSize = getFrameSize(fData.data() + fOffset, available);
+    if (frameSize < 0) {
+      fFailed = true;
+      return false;
+    }
+    if (frameSize == 0 || (size_t) frameSize > available) return false;
+    frame = Buffer(fData.data() + fOffset, frameSize);
+    fOffset += frameSize;
+    if (fOffset > BUFFER_COMPACT_SIZE) {
+      fData.erase(fData.begin(), fData.begin() + (long) fOffset);
+      fOffset = 0;
+    }
+    return true;
+  }
+
+  bool failed() const {
+    return fFailed;
+  }
+
+  size_t pending() const {
+    return fData.size() - fOffset;
+  }
+
+  /**
+   * @return size of the frame starting at data, 0 if the header is incomplete, -1 if the frame is malformed
+   */
+  static long getFrameSize(const uint8_t *data, size_t len) {
+    if (len > 0 && CompactCodec::isFrameType(data[0])) {
+      auto size = CompactCodec::getFrameSize(data, len);
+      return size > (long) MAX_FRAME_SIZE ? -1 : size;
+    }
+    if (len < sizeof(uint32_t)) return 0;
+    long size;
+    switch (readLe<uint32_t>(data)) {
+      case EncryptedMessage::id:
+        if (len < 6) return 0;
+        size = 6 + (long) readLe<uint16_t>(data + 4);
+        break;
+      case PutCharMessage::id:
+        if (len < 8) return 0;
+        size = 8 + (long) readLe<uint32_t>(data + 4);
+        break;
+      case ResizeTerminalMessage::id:
+        size = 12;
+        break;
+      case ChannelDataMessage::id:
+        if (len < 12) return 0;
+        size = 12 + (long) readLe<uint32_t>(data + 8);
+        break;
+      case ConnectMessage::id:
+        if (len < 12) return 0;
+        size = 12 + (long) readLe<uint32_t>(data + 8) + 4;
+        break;
+      default:
+        return -1;
+    }
+    if (size > (long) MAX_FRAME_SIZE) return -1;
+    return size;
+  }
+
+private:
+  static const size_t BUFFER_COMPACT_SIZE = 0x10000;
+
+  template<typename T>
+  static T readLe(const uint8_t *data) {
+    T ret = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      ret |= (T) data[i] << (i * 8);
+    }
+    return ret;
+  }
+};
+
+
+#endif //TERMINUS_FRAMEREADER_H
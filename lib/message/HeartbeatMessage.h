@@ -0,0 +1,50 @@
+#ifndef TERMINUS_HEARTBEATMESSAGE_H
+#define TERMINUS_HEARTBEATMESSAGE_H
+
+#include "Message.h"
+
+/**
+ * @brief sent by the server to clients which asked for heartbeats, they echo it at once
+ * @note the timestamp is only read by the server which sent it, microseconds of its clock wrapping around every
+ * 71 minutes, which is plenty for a round trip
+ */
+class HeartbeatMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<HeartbeatMessage>;
+public:
+  static constexpr uint32_t id = 0x6B1F93C4;
+public:
+  HeartbeatMessage(uint32_t timestamp, bool reply) : Message(), fTimestamp(timestamp), fReply(reply) {
+    fBuffer.append(id);
+    fBuffer.append(timestamp);
+    fBuffer.append((uint8_t) reply);
+  }
+
+  explicit HeartbeatMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 9)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fTimestamp = msg.getBuffer().get<uint32_t>();
+    fReply = msg.getBuffer().get<uint8_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getTimestamp() const {
+    return fTimestamp;
+  }
+
+  bool isReply() const {
+    return fReply;
+  }
+
+private:
+  uint32_t fTimestamp = 0;
+  bool fReply = false;
+};
+
+#endif //TERMINUS_HEARTBEATMESSAGE_H
@@ -0,0 +1,25 @@
+#ifndef TERMINUS_MASTERDETACHEDMESSAGE_H
+#define TERMINUS_MASTERDETACHEDMESSAGE_H
+
+#include "Message.h"
+
+/**
+ * @brief sent by the server to a slave which asked for it once the master of its session detached,
+ * nobody hands credit back until the next master announces its window
+ */
+class MasterDetachedMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<MasterDetachedMessage>;
+public:
+  static constexpr uint32_t id = 0x3D8E05A7;
+public:
+  MasterDetachedMessage() : Message() {
+    fBuffer.append(id);
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+};
+
+#endif //TERMINUS_MASTERDETACHEDMESSAGE_H
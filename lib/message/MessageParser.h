@@ -8,7 +8,26 @@
 #include "ResponseMessage.h"
 #include "ConnectMessage.h"
 #include "EncryptedMessage.h"
+#include "ExecuteCommandMessage.h"
+#include "CommandOutputMessage.h"
+#include "CommandResultMessage.h"
+#include "SequencedMessage.h"
+#include "ResumeMessage.h"
+#include "ChannelDataMessage.h"
+#include "OpenChannelMessage.h"
+#include "CloseChannelMessage.h"
+#include "ChannelWindowMessage.h"
+#include "CompressedMessage.h"
+#include "CompressionRequestMessage.h"
+#include "DisplayModeMessage.h"
+#include "BatchMessage.h"
+#include "WindowUpdateMessage.h"
+#include "HeartbeatMessage.h"
+#include "TraceMessage.h"
+#include "MasterDetachedMessage.h"
+#include "CompactCodec.h"
 #include "MessageFactory.h"
+#include <metrics/Probes.h>
 
 class MessageParser {
 public:
@@ -36,6 +55,16 @@ public:
   }
 
   std::shared_ptr<Message> parse(const uint8_t *data, size_t len) const {
+    TERMINUS_PROBE1(parse__start, len);
+    auto msg = parseFrame(data, len);
+    TERMINUS_PROBE2(parse__done, len, msg ? msg->getId() : 0);
+    return msg;
+  }
+
+private:
+
+  std::shared_ptr<Message> parseFrame(const uint8_t *data, size_t len) const {
+    if (len > 0 && CompactCodec::isFrameType(data[0])) return parseCompact(data, len);
     Buffer buffer(data, len);
     auto id = buffer.get<uint32_t>();
     switch (id) {
@@ -44,10 +73,15 @@ public:
         auto clientIdLen = buffer.get<uint32_t>();
         auto charVector = buffer.get<char>(clientIdLen);
         bool keepAliveUsed = buffer.get<uint8_t>();
-        uint16_t keepAliveInterval = buffer.get<uint8_t>();
+        auto keepAliveInterval = buffer.get<uint16_t>();
+        bool resume = buffer.get<uint8_t>();
+        auto protocolVersion = buffer.get<uint16_t>();
+        auto capabilities = buffer.get<uint32_t>();
         auto connectOpts = ConnectOptions(static_cast<ConnectionType>(connectionType),
                                           std::string(charVector.begin(), charVector.end()),
-                                          keepAliveUsed, keepAliveInterval);
+                                          keepAliveUsed, keepAliveInterval, resume);
+        connectOpts.setProtocolVersion(protocolVersion);
+        connectOpts.setCapabilities(capabilities);
         return MessageFactory::create<ConnectMessage>(connectOpts);
       }
       case PutCharMessage::id: {
@@ -64,21 +98,156 @@ public:
       case ResponseMessage::id: {
         auto code = buffer.get<uint32_t>();
         auto size = buffer.get<uint16_t>();
-        auto charVector = buffer.get<char>(size);
-        std::string chars(charVector.begin(), charVector.end());
-        nlohmann::json metaData = nlohmann::json::parse(chars);
-        return MessageFactory::create<ResponseMessage>(static_cast<ResponseCode>(code), metaData);
+        // decoded when it is read, a response without metadata has none
+        auto metaData = buffer.get<uint8_t>(size);
+        return MessageFactory::create<ResponseMessage>(static_cast<ResponseCode>(code), metaData.data(), metaData.size());
+      }
+      case ExecuteCommandMessage::id: {
+        auto requestId = buffer.get<uint32_t>();
+        auto timeoutMs = buffer.get<uint32_t>();
+        auto command = getString(buffer);
+        auto numTargets = buffer.get<uint32_t>();
+        // every target takes at least its length
+        if (numTargets > buffer.getRemaining() / sizeof(uint32_t)) return nullptr;
+        std::vector<std::string> targets;
+        for (uint32_t i = 0; i < numTargets; i++)
+          targets.emplace_back(getString(buffer));
+        return MessageFactory::create<ExecuteCommandMessage>(requestId, command, timeoutMs, targets);
+      }
+      case CommandOutputMessage::id: {
+        auto requestId = buffer.get<uint32_t>();
+        auto clientId = getString(buffer);
+        auto chars = getString(buffer);
+        return MessageFactory::create<CommandOutputMessage>(requestId, clientId, chars);
+      }
+      case CommandResultMessage::id: {
+        auto requestId = buffer.get<uint32_t>();
+        auto clientId = getString(buffer);
+        auto status = static_cast<CommandStatus>(buffer.get<uint32_t>());
+        auto exitCode = (int32_t) buffer.get<uint32_t>();
+        auto elapsedMs = buffer.get<uint32_t>();
+        return MessageFactory::create<CommandResultMessage>(requestId, clientId, status, exitCode, elapsedMs);
+      }
+      case SequencedMessage::id: {
+        auto session = buffer.get<uint32_t>();
+        auto seq = buffer.get<uint32_t>();
+        auto peerSession = buffer.get<uint32_t>();
+        auto ack = buffer.get<uint32_t>();
+        auto payload = getString(buffer);
+        return MessageFactory::create<SequencedMessage>(session, seq, peerSession, ack, payload);
+      }
+      case ResumeMessage::id: {
+        auto session = buffer.get<uint32_t>();
+        auto peerSession = buffer.get<uint32_t>();
+        auto lastReceived = buffer.get<uint32_t>();
+        bool reply = buffer.get<uint8_t>();
+        return MessageFactory::create<ResumeMessage>(session, peerSession, lastReceived, reply);
+      }
+      case ChannelDataMessage::id: {
+        auto channel = buffer.get<uint32_t>();
+        auto payload = getString(buffer);
+        return MessageFactory::create<ChannelDataMessage>(channel, payload);
+      }
+      case OpenChannelMessage::id: {
+        auto channel = buffer.get<uint32_t>();
+        auto connectionType = buffer.get<uint32_t>();
+        auto clientId = getString(buffer);
+        bool resume = buffer.get<uint8_t>();
+        auto protocolVersion = buffer.get<uint16_t>();
+        auto capabilities = buffer.get<uint32_t>();
+        ConnectOptions connectOpts(static_cast<ConnectionType>(connectionType), clientId);
+        connectOpts.setResume(resume);
+        connectOpts.setProtocolVersion(protocolVersion);
+        connectOpts.setCapabilities(capabilities);
+        return MessageFactory::create<OpenChannelMessage>(channel, connectOpts);
+      }
+      case CloseChannelMessage::id: {
+        auto channel = buffer.get<uint32_t>();
+        return MessageFactory::create<CloseChannelMessage>(channel);
+      }
+      case ChannelWindowMessage::id: {
+        auto channel = buffer.get<uint32_t>();
+        auto credit = buffer.get<uint32_t>();
+        return MessageFactory::create<ChannelWindowMessage>(channel, credit);
+      }
+      case CompressedMessage::id: {
+        auto flags = buffer.get<uint8_t>();
+        auto index = buffer.get<uint32_t>();
+        auto originalSize = buffer.get<uint32_t>();
+        auto data = getString(buffer);
+        return MessageFactory::create<CompressedMessage>(flags, index, originalSize, data);
+      }
+      case CompressionRequestMessage::id: {
+        auto type = static_cast<CompressionType>(buffer.get<uint32_t>());
+        return MessageFactory::create<CompressionRequestMessage>(type);
+      }
+      case WindowUpdateMessage::id: {
+        auto credit = buffer.get<uint32_t>();
+        bool reset = buffer.get<uint8_t>();
+        return MessageFactory::create<WindowUpdateMessage>(credit, reset);
+      }
+      case HeartbeatMessage::id: {
+        auto timestamp = buffer.get<uint32_t>();
+        bool reply = buffer.get<uint8_t>();
+        return MessageFactory::create<HeartbeatMessage>(timestamp, reply);
+      }
+      case TraceMessage::id: {
+        auto traceId = buffer.get<uint32_t>();
+        TraceMessage::Stamps stamps;
+        for (auto &stamp : stamps)
+          stamp = buffer.get<uint32_t>();
+        return MessageFactory::create<TraceMessage>(traceId, stamps);
+      }
+      case MasterDetachedMessage::id:
+        return MessageFactory::create<MasterDetachedMessage>();
+      case DisplayModeMessage::id: {
+        auto mode = static_cast<DisplayMode>(buffer.get<uint32_t>());
+        auto frameRate = buffer.get<uint32_t>();
+        return MessageFactory::create<DisplayModeMessage>(mode, frameRate);
+      }
+      case BatchMessage::id: {
+        auto count = buffer.get<uint32_t>();
+        // every message takes at least its length
+        if (count > len / sizeof(uint32_t)) return nullptr;
+        std::vector<std::string> messages;
+        for (uint32_t i = 0; i < count; i++)
+          messages.emplace_back(getString(buffer));
+        return MessageFactory::create<BatchMessage>(messages);
       }
       case EncryptedMessage::id: {
         auto size = buffer.get<uint16_t>();
         auto charVector = buffer.get<char>(size);
-        std::string chars = Crypto::AES256::decryptData(charVector.data(), fKey, fIv);
-        return parse((const uint8_t *) (chars.data()), chars.size());
+        std::string chars = Crypto::AES256::decryptData(std::string(charVector.begin(), charVector.end()), fKey, fIv);
+        return parseFrame((const uint8_t *) (chars.data()), chars.size());
       }
       default:
         return nullptr;
     }
   }
+
+  /**
+   * @brief restores the usual layout of a compact frame and parses that
+   */
+  std::shared_ptr<Message> parseCompact(const uint8_t *data, size_t len) const {
+    uint8_t type;
+    const uint8_t *body;
+    size_t size;
+    if (!CompactCodec::getFrameBody(data, len, type, body, size)) return nullptr;
+    std::string message;
+    if (type == CompactCodec::TYPE_ENCRYPTED) {
+      auto chars = Crypto::AES256::decryptData(std::string((const char *) body, size), fKey, fIv);
+      if (!CompactCodec::decode((const uint8_t *) chars.data(), chars.size(), message)) return nullptr;
+    } else if (!CompactCodec::decode(type, body, size, message)) {
+      return nullptr;
+    }
+    return parseFrame((const uint8_t *) message.data(), message.size());
+  }
+
+  static std::string getString(const Buffer &buffer) {
+    auto size = buffer.get<uint32_t>();
+    auto charVector = buffer.get<char>(size);
+    return std::string(charVector.begin(), charVector.end());
+  }
 };
 
 
@@ -0,0 +1,149 @@
+#ifndef TERMINUS_MSGPACKREADER_H
+#define TERMINUS_MSGPACKREADER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief looks up fields of a MessagePack map in place, strings are not copied
+ * @note only the top level map is searched, nested values are skipped over
+ */
+class MsgPackReader {
+private:
+  static const int MAX_DEPTH = 16;
+  const uint8_t *fData;
+  size_t fSize;
+public:
+  MsgPackReader(const uint8_t *data, size_t size) : fData(data), fSize(size) {
+  }
+
+  /**
+   * @return false if the field is missing or not a string, data points into the encoded map
+   */
+  bool getString(const std::string &key, const char *&data, size_t &size) const {
+    size_t pos;
+    if (!find(key, pos)) return false;
+    size_t start;
+    if (!readString(pos, start, size)) return false;
+    data = (const char *) fData + start;
+    return true;
+  }
+
+  bool getUnsigned(const std::string &key, uint64_t &value) const {
+    size_t pos;
+    if (!find(key, pos)) return false;
+    auto type = fData[pos++];
+    if (type <= 0x7F) {
+      value = type;
+      return true;
+    }
+    if (type < 0xCC || type > 0xCF) return false;
+    return readBigEndian(pos, (size_t) 1 << (type - 0xCC), value);
+  }
+
+private:
+
+  /**
+   * @brief finds the value of key, pos is where it starts
+   */
+  bool find(const std::string &key, size_t &pos) const {
+    pos = 0;
+    if (fSize == 0) return false;
+    uint64_t count;
+    auto type = fData[pos++];
+    if (type >= 0x80 && type <= 0x8F) count = type & 0x0F;
+    else if (type == 0xDE) { if (!readBigEndian(pos, 2, count)) return false; }
+    else if (type == 0xDF) { if (!readBigEndian(pos, 4, count)) return false; }
+    else return false;
+    for (uint64_t i = 0; i < count; i++) {
+      size_t start, size;
+      if (!readString(pos, start, size)) {
+        // keys which are not strings are never looked up
+        if (!skip(pos, 0) || !skip(pos, 0)) return false;
+        continue;
+      }
+      if (size == key.size() && memcmp(fData + start, key.data(), size) == 0) return pos < fSize;
+      if (!skip(pos, 0)) return false;
+    }
+    return false;
+  }
+
+  bool readBigEndian(size_t &pos, size_t bytes, uint64_t &value) const {
+    if (pos + bytes > fSize) return false;
+    value = 0;
+    for (size_t i = 0; i < bytes; i++)
+      value = value << 8 | fData[pos++];
+    return true;
+  }
+
+  /**
+   * @brief reads a string at pos and moves past it, pos is left alone if there is none
+   */
+  bool readString(size_t &pos, size_t &start, size_t &size) const {
+    if (pos >= fSize) return false;
+    auto at = pos;
+    auto type = fData[at++];
+    uint64_t length;
+    if (type >= 0xA0 && type <= 0xBF) length = type & 0x1F;
+    else if (type >= 0xD9 && type <= 0xDB) { if (!readBigEndian(at, (size_t) 1 << (type - 0xD9), length)) return false; }
+    else return false;
+    if (length > fSize - at) return false;
+    start = at;
+    size = length;
+    pos = at + length;
+    return true;
+  }
+
+  /**
+   * @brief moves pos past the value starting there
+   */
+  bool skip(size_t &pos, int depth) const {
+    if (pos >= fSize || depth > MAX_DEPTH) return false;
+    auto type = fData[pos++];
+    uint64_t length = 0;
+    // fixint, nil, bool
+    if (type <= 0x7F || type >= 0xE0 || type == 0xC0 || type == 0xC2 || type == 0xC3) return true;
+    if (type >= 0x80 && type <= 0x8F) return skipItems(pos, (type & 0x0F) * 2, depth);
+    if (type >= 0x90 && type <= 0x9F) return skipItems(pos, type & 0x0F, depth);
+    if (type >= 0xA0 && type <= 0xBF) return skipBytes(pos, type & 0x1F);
+    switch (type) {
+      case 0xC4: case 0xC5: case 0xC6:
+        return readBigEndian(pos, (size_t) 1 << (type - 0xC4), length) && skipBytes(pos, length);
+      case 0xC7: case 0xC8: case 0xC9:
+        return readBigEndian(pos, (size_t) 1 << (type - 0xC7), length) && skipBytes(pos, length + 1);
+      case 0xCA:
+        return skipBytes(pos, 4);
+      case 0xCB:
+        return skipBytes(pos, 8);
+      case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+        return skipBytes(pos, (size_t) 1 << (type - 0xCC));
+      case 0xD0: case 0xD1: case 0xD2: case 0xD3:
+        return skipBytes(pos, (size_t) 1 << (type - 0xD0));
+      case 0xD4: case 0xD5: case 0xD6: case 0xD7: case 0xD8:
+        return skipBytes(pos, ((size_t) 1 << (type - 0xD4)) + 1);
+      case 0xD9: case 0xDA: case 0xDB:
+        return readBigEndian(pos, (size_t) 1 << (type - 0xD9), length) && skipBytes(pos, length);
+      case 0xDC: case 0xDD:
+        return readBigEndian(pos, type == 0xDC ? 2 : 4, length) && skipItems(pos, length, depth);
+      case 0xDE: case 0xDF:
+        return readBigEndian(pos, type == 0xDE ? 2 : 4, length) && skipItems(pos, length * 2, depth);
+      default:
+        return false;
+    }
+  }
+
+  bool skipItems(size_t &pos, uint64_t count, int depth) const {
+    for (uint64_t i = 0; i < count; i++)
+      if (!skip(pos, depth + 1)) return false;
+    return true;
+  }
+
+  bool skipBytes(size_t &pos, uint64_t count) const {
+    if (count > fSize - pos) return false;
+    pos += count;
+    return true;
+  }
+};
+
+#endif //TERMINUS_MSGPACKREADER_H
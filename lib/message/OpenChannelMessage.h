@@ -0,0 +1,64 @@
+#ifndef TERMINUS_OPENCHANNELMESSAGE_H
+#define TERMINUS_OPENCHANNELMESSAGE_H
+
+#include "Message.h"
+#include "ConnectMessage.h"
+
+/**
+ * @brief opens a session on a multiplexed connection, the channel takes the place of a connection of its own
+ * @note channel ids are chosen by the multiplexing side and must not be in use on the connection
+ */
+class OpenChannelMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<OpenChannelMessage>;
+public:
+  static constexpr uint32_t id = 0x47F5EA10;
+public:
+  OpenChannelMessage(uint32_t channel, const ConnectOptions &connectOptions) :
+    Message(), fChannel(channel), fConnectOptions(std::make_shared<ConnectOptions>(connectOptions)) {
+    fBuffer.append(id);
+    fBuffer.append(channel);
+    fBuffer.append((uint32_t) fConnectOptions->getConnectionType());
+    fBuffer.append((uint32_t) fConnectOptions->getClientId().length());
+    fBuffer.append(fConnectOptions->getClientId());
+    fBuffer.append((uint8_t) fConnectOptions->isResume());
+    fBuffer.append((uint16_t) fConnectOptions->getProtocolVersion());
+    fBuffer.append((uint32_t) fConnectOptions->getCapabilities());
+  }
+
+  explicit OpenChannelMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 17)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fChannel = msg.getBuffer().get<uint32_t>();
+    auto connectionType = msg.getBuffer().get<uint32_t>();
+    auto clientIdLen = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(clientIdLen);
+    fConnectOptions = std::make_shared<ConnectOptions>(
+      static_cast<ConnectionType>(connectionType),
+      std::string(charVector.begin(), charVector.end()));
+    fConnectOptions->setResume(msg.getBuffer().get<uint8_t>());
+    fConnectOptions->setProtocolVersion(msg.getBuffer().get<uint16_t>());
+    fConnectOptions->setCapabilities(msg.getBuffer().get<uint32_t>());
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getChannel() const {
+    return fChannel;
+  }
+
+  const ConnectOptions &getConnectOptions() const {
+    return *fConnectOptions;
+  }
+
+private:
+  uint32_t fChannel = 0;
+  std::shared_ptr<ConnectOptions> fConnectOptions;
+};
+
+#endif //TERMINUS_OPENCHANNELMESSAGE_H
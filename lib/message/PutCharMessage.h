@@ -7,7 +7,7 @@ class PutCharMessage : public Message {
 public:
   using Ptr = std::shared_ptr<PutCharMessage>;
 public:
-  const static uint32_t id = 0xB0E0A971;
+  static constexpr uint32_t id = 0xB0E0A971;
 public:
   explicit PutCharMessage(const std::string &chars) : Message(), fChars(chars) {
     fBuffer.append(id);
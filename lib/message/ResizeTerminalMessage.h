@@ -8,7 +8,7 @@ public:
   using Ptr = std::shared_ptr<ResizeTerminalMessage>;
   using ConstPtr = const std::shared_ptr<ResizeTerminalMessage>;
 public:
-  const static uint32_t id = 0xBA8A5A9;
+  static constexpr uint32_t id = 0xBA8A5A9;
 public:
   ResizeTerminalMessage(size_t width, size_t height) :
     fWidth(width), fHeight(height) {
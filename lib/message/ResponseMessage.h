@@ -6,42 +6,66 @@
 #include <utility>
 #include <nlohmann/json.hpp>
 
+#include "MsgPackReader.h"
+
 enum class ResponseCode : uint32_t {
   ResponseOk = 0x4DC280B5,
   ResponseErr = 0xBFDAC919,
 };
 
+/*! how metadata is encoded, readers tell them apart by the first byte */
+enum class MetaDataEncoding : uint8_t {
+  /*! json text, all clients read it */
+  Text,
+  /*! MessagePack, for clients with CAPABILITY_BINARY_METADATA */
+  Binary
+};
+
 class ResponseMessage : public Message {
 public:
   using Ptr = std::shared_ptr<ResponseMessage>;
 public:
-  const static uint32_t id = 0x5B7CF880;
+  static constexpr uint32_t id = 0x5B7CF880;
+  static const size_t HEADER_SIZE = 10;
 public:
-  explicit ResponseMessage(ResponseCode code, const nlohmann::json &metaData = {}) : fCode(code),
-                                                                                     fMetaData(metaData) {
+  explicit ResponseMessage(ResponseCode code, const nlohmann::json &metaData = {},
+                           MetaDataEncoding encoding = MetaDataEncoding::Binary) :
+    fCode(code), fMetaData(metaData), fDecoded(true) {
     fBuffer.append(id);
     fBuffer.append((uint32_t) code);
     if (!metaData.is_structured())
       return;
-    auto size = (uint16_t) metaData.dump().size();
-    fBuffer.append(size);
-    std::string chars = metaData.dump();
-    fBuffer.append(chars);
+    if (encoding == MetaDataEncoding::Text) {
+      auto chars = metaData.dump();
+      fBuffer.append((uint16_t) chars.size());
+      fBuffer.append(chars);
+      return;
+    }
+    auto bytes = nlohmann::json::to_msgpack(metaData);
+    fBuffer.append((uint16_t) bytes.size());
+    fBuffer.append(bytes.data(), bytes.size());
+  }
+
+  /**
+   * @brief takes the metadata as it came in, it is decoded on first use
+   */
+  ResponseMessage(ResponseCode code, const uint8_t *metaData, size_t size) : fCode(code) {
+    fBuffer.append(id);
+    fBuffer.append((uint32_t) code);
+    if (size == 0)
+      return;
+    fBuffer.append((uint16_t) size);
+    fBuffer.append(metaData, size);
   }
 
-  explicit ResponseMessage(const Message &msg) : fCode(ResponseCode::ResponseErr), fMetaData({}) {
+  explicit ResponseMessage(const Message &msg) : fCode(ResponseCode::ResponseErr) {
     if (msg.getBuffer().getSize() < 8)
       return;
     auto inputId = msg.getBuffer().get<uint32_t>();
     if (inputId != id)
       return;
-    auto code = msg.getBuffer().get<uint32_t>();
-    fCode = static_cast<ResponseCode>(code);
-    if (msg.getBuffer().getSize() > 4) {
-      auto size = msg.getBuffer().get<uint16_t>();
-      auto dataVector = msg.getBuffer().get<char>(size);
-      fMetaData = nlohmann::json::parse(std::string(dataVector.begin(), dataVector.end()));
-    }
+    fCode = static_cast<ResponseCode>(msg.getBuffer().get<uint32_t>());
+    fBuffer = Buffer(msg.getBuffer().getDataPtr(), msg.getBuffer().getSize());
   }
 
   uint32_t getId() const override {
@@ -52,13 +76,69 @@ public:
     return fCode;
   }
 
+  /**
+   * @return null if there is no metadata or it cannot be decoded
+   */
   const nlohmann::json &getMetaData() const {
+    if (fDecoded) return fMetaData;
+    fDecoded = true;
+    auto data = getMetaDataPtr();
+    auto size = getMetaDataSize();
+    if (size == 0) return fMetaData;
+    if (getEncoding() == MetaDataEncoding::Text)
+      fMetaData = nlohmann::json::parse(data, data + size, nullptr, false);
+    else
+      fMetaData = nlohmann::json::from_msgpack(data, data + size, true, false);
+    if (fMetaData.is_discarded()) fMetaData = nullptr;
     return fMetaData;
   }
 
+  MetaDataEncoding getEncoding() const {
+    auto size = getMetaDataSize();
+    auto first = size > 0 ? getMetaDataPtr()[0] : 0;
+    return first == '{' || first == '[' ? MetaDataEncoding::Text : MetaDataEncoding::Binary;
+  }
+
+  /**
+   * @brief reads a string field without decoding the metadata, data points into the message for binary metadata
+   */
+  bool getString(const std::string &key, const char *&data, size_t &size) const {
+    if (getEncoding() == MetaDataEncoding::Binary && !fDecoded)
+      return MsgPackReader(getMetaDataPtr(), getMetaDataSize()).getString(key, data, size);
+    auto &metaData = getMetaData();
+    if (!metaData.is_object() || !metaData.contains(key) || !metaData[key].is_string()) return false;
+    auto &value = metaData[key].get_ref<const std::string &>();
+    data = value.data();
+    size = value.size();
+    return true;
+  }
+
+  bool getUnsigned(const std::string &key, uint64_t &value) const {
+    if (getEncoding() == MetaDataEncoding::Binary && !fDecoded)
+      return MsgPackReader(getMetaDataPtr(), getMetaDataSize()).getUnsigned(key, value);
+    auto &metaData = getMetaData();
+    if (!metaData.is_object() || !metaData.contains(key) || !metaData[key].is_number_unsigned()) return false;
+    value = metaData[key].get<uint64_t>();
+    return true;
+  }
+
+private:
+
+  const uint8_t *getMetaDataPtr() const {
+    return fBuffer.getDataPtr() + HEADER_SIZE;
+  }
+
+  size_t getMetaDataSize() const {
+    if (fBuffer.getSize() < HEADER_SIZE) return 0;
+    auto data = fBuffer.getDataPtr();
+    size_t size = data[8] | data[9] << 8;
+    return std::min(size, fBuffer.getSize() - HEADER_SIZE);
+  }
+
 private:
   ResponseCode fCode;
-  nlohmann::json fMetaData;
+  mutable nlohmann::json fMetaData;
+  mutable bool fDecoded = false;
 };
 
 
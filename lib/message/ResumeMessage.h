@@ -0,0 +1,64 @@
+#ifndef TERMINUS_RESUMEMESSAGE_H
+#define TERMINUS_RESUMEMESSAGE_H
+
+#include "Message.h"
+
+/**
+ * @brief sent by a peer after it (re)connected, asks the other peer to replay frames after lastReceived
+ * @note lastReceived only refers to peer session peerSession, the receiver answers with a reply resume of its own
+ */
+class ResumeMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<ResumeMessage>;
+public:
+  static constexpr uint32_t id = 0x1D675516;
+public:
+  ResumeMessage(uint32_t session, uint32_t peerSession, uint32_t lastReceived, bool reply = false) :
+    Message(), fSession(session), fPeerSession(peerSession), fLastReceived(lastReceived), fReply(reply) {
+    fBuffer.append(id);
+    fBuffer.append(session);
+    fBuffer.append(peerSession);
+    fBuffer.append(lastReceived);
+    fBuffer.append((uint8_t) reply);
+  }
+
+  explicit ResumeMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 17)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fSession = msg.getBuffer().get<uint32_t>();
+    fPeerSession = msg.getBuffer().get<uint32_t>();
+    fLastReceived = msg.getBuffer().get<uint32_t>();
+    fReply = msg.getBuffer().get<uint8_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getSession() const {
+    return fSession;
+  }
+
+  uint32_t getPeerSession() const {
+    return fPeerSession;
+  }
+
+  uint32_t getLastReceived() const {
+    return fLastReceived;
+  }
+
+  bool isReply() const {
+    return fReply;
+  }
+
+private:
+  uint32_t fSession = 0;
+  uint32_t fPeerSession = 0;
+  uint32_t fLastReceived = 0;
+  bool fReply = false;
+};
+
+#endif //TERMINUS_RESUMEMESSAGE_H
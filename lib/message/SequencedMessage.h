@@ -0,0 +1,77 @@
+#ifndef TERMINUS_SEQUENCEDMESSAGE_H
+#define TERMINUS_SEQUENCEDMESSAGE_H
+
+#include "Message.h"
+
+#include <string>
+
+/**
+ * @brief session data numbered per direction so it can be replayed after a reconnect
+ * @note payload is a serialized message, seq 0 carries no payload and only acknowledges
+ * peer frames up to ack, which is only valid for peer session peerSession
+ */
+class SequencedMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<SequencedMessage>;
+public:
+  static constexpr uint32_t id = 0x837B2BEE;
+public:
+  SequencedMessage(uint32_t session, uint32_t seq, uint32_t peerSession, uint32_t ack, const std::string &payload = {}) :
+    Message(), fSession(session), fSeq(seq), fPeerSession(peerSession), fAck(ack), fPayload(payload) {
+    fBuffer.append(id);
+    fBuffer.append(session);
+    fBuffer.append(seq);
+    fBuffer.append(peerSession);
+    fBuffer.append(ack);
+    fBuffer.append((uint32_t) payload.size());
+    fBuffer.append(payload);
+  }
+
+  explicit SequencedMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 24)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fSession = msg.getBuffer().get<uint32_t>();
+    fSeq = msg.getBuffer().get<uint32_t>();
+    fPeerSession = msg.getBuffer().get<uint32_t>();
+    fAck = msg.getBuffer().get<uint32_t>();
+    auto size = msg.getBuffer().get<uint32_t>();
+    auto charVector = msg.getBuffer().get<char>(size);
+    fPayload = std::string(charVector.begin(), charVector.end());
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getSession() const {
+    return fSession;
+  }
+
+  uint32_t getSeq() const {
+    return fSeq;
+  }
+
+  uint32_t getPeerSession() const {
+    return fPeerSession;
+  }
+
+  uint32_t getAck() const {
+    return fAck;
+  }
+
+  const std::string &getPayload() const {
+    return fPayload;
+  }
+
+private:
+  uint32_t fSession = 0;
+  uint32_t fSeq = 0;
+  uint32_t fPeerSession = 0;
+  uint32_t fAck = 0;
+  std::string fPayload;
+};
+
+#endif //TERMINUS_SEQUENCEDMESSAGE_H
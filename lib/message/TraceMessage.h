@@ -0,0 +1,92 @@
+#ifndef TERMINUS_TRACEMESSAGE_H
+#define TERMINUS_TRACEMESSAGE_H
+
+#include <array>
+#include <chrono>
+
+#include "Message.h"
+#include "MessageFactory.h"
+
+/*! hops a traced keystroke passes, in the order it passes them */
+enum class TraceStamp : uint8_t {
+  MasterSend = 0,
+  ServerReceive = 1,
+  ServerForward = 2,
+  SlaveWrite = 3,
+  SlaveRead = 4,
+  ServerReturn = 5,
+  ServerDeliver = 6,
+};
+
+/**
+ * @brief follows a keystroke from the master to the slave and its echo back, every hop stamps the time it passed
+ * @note stamps are microseconds of the monotonic clock of whoever set them, wrapping around every 71 minutes. Only
+ * stamps of one host are compared with each other, zero means not stamped. Sent outside the session stream, so the
+ * server stamps it on the way
+ */
+class TraceMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<TraceMessage>;
+  static const int STAMP_COUNT = 7;
+  using Stamps = std::array<uint32_t, STAMP_COUNT>;
+public:
+  static constexpr uint32_t id = 0x3E8D5A17;
+public:
+  TraceMessage(uint32_t traceId, const Stamps &stamps) : Message(), fTraceId(traceId), fStamps(stamps) {
+    fBuffer.append(id);
+    fBuffer.append(traceId);
+    for (auto stamp : stamps)
+      fBuffer.append(stamp);
+  }
+
+  explicit TraceMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 8)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fTraceId = msg.getBuffer().get<uint32_t>();
+    // stamps missing from the buffer read as zero
+    for (auto &stamp : fStamps)
+      stamp = msg.getBuffer().get<uint32_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  /**
+   * @return the time hops stamp
+   */
+  static uint32_t now() {
+    return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  uint32_t getTraceId() const {
+    return fTraceId;
+  }
+
+  const Stamps &getStamps() const {
+    return fStamps;
+  }
+
+  uint32_t getStamp(TraceStamp stamp) const {
+    return fStamps[(int) stamp];
+  }
+
+  /**
+   * @return a copy with stamp set to time
+   */
+  Ptr stamp(TraceStamp stamp, uint32_t time) const {
+    auto stamps = fStamps;
+    stamps[(int) stamp] = time;
+    return MessageFactory::create<TraceMessage>(fTraceId, stamps);
+  }
+
+private:
+  uint32_t fTraceId = 0;
+  Stamps fStamps = {};
+};
+
+#endif //TERMINUS_TRACEMESSAGE_H
@@ -0,0 +1,49 @@
+#ifndef TERMINUS_WINDOWUPDATEMESSAGE_H
+#define TERMINUS_WINDOWUPDATEMESSAGE_H
+
+#include "Message.h"
+
+/**
+ * @brief grants the slave credit to send more output, sent by the master for output it displayed
+ * @note the first update of a master resets the credit to its window, a slave never told about a window sends freely
+ */
+class WindowUpdateMessage : public Message {
+public:
+  using Ptr = std::shared_ptr<WindowUpdateMessage>;
+public:
+  static constexpr uint32_t id = 0x3D8E52A6;
+public:
+  WindowUpdateMessage(uint32_t credit, bool reset) : Message(), fCredit(credit), fReset(reset) {
+    fBuffer.append(id);
+    fBuffer.append(credit);
+    fBuffer.append((uint8_t) reset);
+  }
+
+  explicit WindowUpdateMessage(const Message &msg) {
+    if (msg.getBuffer().getSize() < 9)
+      return;
+    auto inputId = msg.getBuffer().get<uint32_t>();
+    if (id != inputId)
+      return;
+    fCredit = msg.getBuffer().get<uint32_t>();
+    fReset = msg.getBuffer().get<uint8_t>();
+  }
+
+  uint32_t getId() const override {
+    return id;
+  }
+
+  uint32_t getCredit() const {
+    return fCredit;
+  }
+
+  bool isReset() const {
+    return fReset;
+  }
+
+private:
+  uint32_t fCredit = 0;
+  bool fReset = false;
+};
+
+#endif //TERMINUS_WINDOWUPDATEMESSAGE_H
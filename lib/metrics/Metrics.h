@@ -0,0 +1,260 @@
+#ifndef TERMINUS_METRICS_H
+#define TERMINUS_METRICS_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief slot of the calling thread, threads get their own slot until there are more of them than SHARDS
+ */
+struct MetricShard {
+  static const size_t SHARDS = 16;
+
+  static size_t index() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+  }
+};
+
+/**
+ * @brief monotonic count, every thread adds to its own cache line and reads sum them up
+ */
+class Counter {
+private:
+  struct alignas(64) Cell {
+    std::atomic<uint64_t> value{0};
+  };
+  Cell fCells[MetricShard::SHARDS];
+public:
+  using Ptr = std::shared_ptr<Counter>;
+
+  void add(uint64_t value = 1) {
+    fCells[MetricShard::index()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const {
+    uint64_t sum = 0;
+    for (auto &cell : fCells)
+      sum += cell.value.load(std::memory_order_relaxed);
+    return sum;
+  }
+};
+
+/**
+ * @brief value going up and down, such as open sessions
+ */
+class Gauge {
+private:
+  std::atomic<int64_t> fValue{0};
+public:
+  using Ptr = std::shared_ptr<Gauge>;
+
+  void set(int64_t value) {
+    fValue.store(value, std::memory_order_relaxed);
+  }
+
+  void add(int64_t value = 1) {
+    fValue.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void sub(int64_t value = 1) {
+    fValue.fetch_sub(value, std::memory_order_relaxed);
+  }
+
+  int64_t value() const {
+    return fValue.load(std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief log linear histogram of integer values, every power of two is split into SUB_BUCKETS buckets
+ * @note recording is wait free on a per thread shard, so values are within 12.5% of what was recorded.
+ * Values are in whatever unit the caller picked, microseconds for latencies
+ */
+class Histogram {
+public:
+  using Ptr = std::shared_ptr<Histogram>;
+  static const int SUB_BITS = 3;
+  static const int SUB_BUCKETS = 1 << SUB_BITS;
+  /*! values from 2^MAX_POWER on all land in the last bucket, 12 days in microseconds */
+  static const int MAX_POWER = 40;
+  static const int BUCKET_COUNT = (MAX_POWER - SUB_BITS + 1) * SUB_BUCKETS;
+
+  /**
+   * @brief merged copy of all shards, not thread safe
+   */
+  struct Snapshot {
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(BUCKET_COUNT, 0);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+
+    /**
+     * @return number of values below bound, exact if bound is a power of two
+     */
+    uint64_t countBelow(uint64_t bound) const {
+      uint64_t below = 0;
+      for (int i = 0; i < BUCKET_COUNT && getUpperBound(i) <= bound; i++)
+        below += buckets[i];
+      return below;
+    }
+
+    /**
+     * @param share 0 to 1, 0.99 for the 99th percentile
+     * @return upper bound of the bucket the percentile lies in
+     */
+    uint64_t percentile(double share) const {
+      uint64_t seen = 0;
+      for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen > 0 && (double) seen >= share * (double) count) return getUpperBound(i);
+      }
+      return 0;
+    }
+  };
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+
+    Shard() {
+      for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    }
+  };
+  std::unique_ptr<Shard[]> fShards{new Shard[MetricShard::SHARDS]};
+public:
+
+  static int getBucket(uint64_t value) {
+    if (value < SUB_BUCKETS) return (int) value;
+    int power = 63 - __builtin_clzll(value);
+    if (power >= MAX_POWER) return BUCKET_COUNT - 1;
+    auto sub = (int) (value >> (power - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (power - SUB_BITS + 1) * SUB_BUCKETS + sub;
+  }
+
+  /**
+   * @return values in bucket are below this bound
+   */
+  static uint64_t getUpperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) return (uint64_t) bucket + 1;
+    auto power = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    auto sub = (uint64_t) (bucket % SUB_BUCKETS);
+    return ((uint64_t) SUB_BUCKETS + sub + 1) << (power - SUB_BITS);
+  }
+
+  void record(uint64_t value) {
+    auto &shard = fShards[MetricShard::index()];
+    shard.buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void record(std::chrono::microseconds value) {
+    record(value.count() > 0 ? (uint64_t) value.count() : 0);
+  }
+
+  Snapshot snapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < MetricShard::SHARDS; i++) {
+      auto &shard = fShards[i];
+      for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+        snapshot.buckets[bucket] += shard.buckets[bucket].load(std::memory_order_relaxed);
+      snapshot.count += shard.count.load(std::memory_order_relaxed);
+      snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+};
+
+/**
+ * @brief named metrics of a process, metrics are created once and then updated without the registry
+ * @note a name with different labels is one family, labels are given as text such as lane="bulk"
+ */
+class MetricRegistry {
+public:
+  using Ptr = std::shared_ptr<MetricRegistry>;
+  using Callback = std::function<double()>;
+
+  enum class Type {
+    Counter,
+    Gauge,
+    Histogram,
+  };
+
+  struct Metric {
+    std::string labels;
+    Counter::Ptr counter;
+    Gauge::Ptr gauge;
+    Histogram::Ptr histogram;
+    /*! read when exported, for values the owner tracks anyway */
+    Callback callback;
+    /*! exported histogram values are multiplied by it, 1e-6 turns microseconds into seconds */
+    double scale = 1;
+  };
+
+  struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    std::vector<Metric> metrics;
+  };
+private:
+  std::vector<Family> fFamilies;
+  mutable std::mutex fMutex;
+public:
+
+  Counter::Ptr counter(const std::string &name, const std::string &help, const std::string &labels = "") {
+    Metric metric;
+    metric.counter = std::make_shared<Counter>();
+    return add(name, help, Type::Counter, labels, metric).counter;
+  }
+
+  Gauge::Ptr gauge(const std::string &name, const std::string &help, const std::string &labels = "") {
+    Metric metric;
+    metric.gauge = std::make_shared<Gauge>();
+    return add(name, help, Type::Gauge, labels, metric).gauge;
+  }
+
+  void gauge(const std::string &name, const std::string &help, const std::string &labels, Callback callback) {
+    Metric metric;
+    metric.callback = std::move(callback);
+    add(name, help, Type::Gauge, labels, metric);
+  }
+
+  Histogram::Ptr histogram(const std::string &name, const std::string &help, const std::string &labels = "",
+                           double scale = 1e-6) {
+    Metric metric;
+    metric.histogram = std::make_shared<Histogram>();
+    metric.scale = scale;
+    return add(name, help, Type::Histogram, labels, metric).histogram;
+  }
+
+  std::vector<Family> getFamilies() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fFamilies;
+  }
+
+private:
+
+  Metric add(const std::string &name, const std::string &help, Type type, const std::string &labels, Metric &metric) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    metric.labels = labels;
+    for (auto &family : fFamilies) {
+      if (family.name != name) continue;
+      family.metrics.push_back(metric);
+      return metric;
+    }
+    fFamilies.push_back({name, help, type, {metric}});
+    return metric;
+  }
+};
+
+#endif //TERMINUS_METRICS_H
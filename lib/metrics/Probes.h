@@ -0,0 +1,27 @@
+#ifndef TERMINUS_PROBES_H
+#define TERMINUS_PROBES_H
+
+/**
+ * @brief USDT probes of the terminus provider, listed in tools/trace/README.md
+ * @note with sys/sdt.h a probe is a single nop plus a note in the binary which tracers patch when they attach,
+ * without it or with TERMINUS_NO_PROBES they compile to nothing. Durations are taken by the tracer from pairs of
+ * __start and __done probes, so nothing is timed while nobody traces
+ */
+#if !defined(TERMINUS_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TERMINUS_HAS_PROBES 1
+#endif
+#endif
+
+#ifdef TERMINUS_HAS_PROBES
+#define TERMINUS_PROBE1(name, a1) DTRACE_PROBE1(terminus, name, a1)
+#define TERMINUS_PROBE2(name, a1, a2) DTRACE_PROBE2(terminus, name, a1, a2)
+#define TERMINUS_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(terminus, name, a1, a2, a3)
+#else
+#define TERMINUS_PROBE1(name, a1) do {} while (0)
+#define TERMINUS_PROBE2(name, a1, a2) do {} while (0)
+#define TERMINUS_PROBE3(name, a1, a2, a3) do {} while (0)
+#endif
+
+#endif //TERMINUS_PROBES_H
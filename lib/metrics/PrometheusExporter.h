@@ -0,0 +1,172 @@
+#ifndef TERMINUS_PROMETHEUSEXPORTER_H
+#define TERMINUS_PROMETHEUSEXPORTER_H
+
+#include <mutex>
+#include <thread>
+#include <string>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+#include <metrics/Metrics.h>
+
+/**
+ * @brief serves the metrics of a registry in the prometheus text format on a unix socket
+ * @note every connection gets one scrape and is closed. A request starting with GET is answered over http so a
+ * scraper can go through a socket proxy, anything else such as an empty line gets the bare text
+ */
+class PrometheusExporter {
+public:
+  static const int REQUEST_SIZE = 1024;
+  /*! histogram buckets exported, powers of two of the recorded unit from 2^FIRST_POWER to 2^LAST_POWER */
+  static const int FIRST_POWER = 3;
+  static const int LAST_POWER = 25;
+private:
+  MetricRegistry::Ptr fRegistry;
+  std::string fPath;
+  int fListenSocket = -1;
+  std::thread fThread;
+  std::mutex fMutex;
+public:
+  explicit PrometheusExporter(MetricRegistry::Ptr registry) : fRegistry(std::move(registry)) {
+  }
+
+  ~PrometheusExporter() {
+    stop();
+  }
+
+  /**
+   * @brief replaces a socket left at path and serves scrapes on a thread of its own
+   */
+  bool start(const std::string &path) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fListenSocket != -1) return false;
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    auto sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1) return false;
+    unlink(path.c_str());
+    if (::bind(sock, (sockaddr *) &address, sizeof(address)) == -1 || ::listen(sock, SOMAXCONN) == -1) {
+      close(sock);
+      return false;
+    }
+    fPath = path;
+    fListenSocket = sock;
+    fThread = std::thread(&PrometheusExporter::run, this, sock);
+    return true;
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (fListenSocket == -1) return;
+      // wakes the accept of the exporter thread
+      shutdown(fListenSocket, SHUT_RDWR);
+    }
+    if (fThread.joinable()) fThread.join();
+    std::lock_guard<std::mutex> lock(fMutex);
+    close(fListenSocket);
+    unlink(fPath.c_str());
+    fListenSocket = -1;
+  }
+
+  /**
+   * @return metrics of registry in the prometheus text exposition format
+   */
+  static std::string format(const MetricRegistry &registry) {
+    std::string text;
+    for (auto &family : registry.getFamilies()) {
+      text += "# HELP " + family.name + " " + family.help + "\n";
+      text += "# TYPE " + family.name + " " + getTypeName(family.type) + "\n";
+      for (auto &metric : family.metrics) {
+        if (family.type != MetricRegistry::Type::Histogram) {
+          text += family.name + wrapLabels(metric.labels) + " " + formatValue(getValue(metric)) + "\n";
+          continue;
+        }
+        auto snapshot = metric.histogram->snapshot();
+        auto separator = metric.labels.empty() ? "" : ",";
+        for (int power = FIRST_POWER; power <= LAST_POWER; power++) {
+          auto bound = (uint64_t) 1 << power;
+          text += family.name + "_bucket{" + metric.labels + separator + "le=\"" + formatValue((double) bound * metric.scale) +
+                  "\"} " + std::to_string(snapshot.countBelow(bound)) + "\n";
+        }
+        text += family.name + "_bucket{" + metric.labels + separator + "le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+        text += family.name + "_sum" + wrapLabels(metric.labels) + " " + formatValue((double) snapshot.sum * metric.scale) + "\n";
+        text += family.name + "_count" + wrapLabels(metric.labels) + " " + std::to_string(snapshot.count) + "\n";
+      }
+    }
+    return text;
+  }
+
+private:
+
+  static const char *getTypeName(MetricRegistry::Type type) {
+    switch (type) {
+      case MetricRegistry::Type::Counter:
+        return "counter";
+      case MetricRegistry::Type::Gauge:
+        return "gauge";
+      case MetricRegistry::Type::Histogram:
+        return "histogram";
+    }
+    return "untyped";
+  }
+
+  static double getValue(const MetricRegistry::Metric &metric) {
+    if (metric.counter) return (double) metric.counter->value();
+    if (metric.gauge) return (double) metric.gauge->value();
+    return metric.callback ? metric.callback() : 0;
+  }
+
+  static std::string wrapLabels(const std::string &labels) {
+    return labels.empty() ? labels : "{" + labels + "}";
+  }
+
+  static std::string formatValue(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+  }
+
+  void run(int listenSocket) {
+    while (true) {
+      auto sock = accept4(listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+      if (sock == -1) {
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        return;
+      }
+      serve(sock);
+      close(sock);
+    }
+  }
+
+  void serve(int sock) {
+    // a scraper which connects and sends nothing must not stall the others
+    timeval timeout = {1, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[REQUEST_SIZE];
+    auto size = recv(sock, request, sizeof(request), 0);
+    auto body = format(*fRegistry);
+    std::string reply;
+    if (size >= 4 && strncmp(request, "GET ", 4) == 0) {
+      reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+              std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    }
+    reply += body;
+    size_t sent = 0;
+    while (sent < reply.size()) {
+      auto result = send(sock, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+      if (result < 0 && errno == EINTR) continue;
+      if (result <= 0) return;
+      sent += result;
+    }
+  }
+};
+
+#endif //TERMINUS_PROMETHEUSEXPORTER_H
@@ -0,0 +1,69 @@
+#ifndef TERMINUS_CHANNELWINDOW_H
+#define TERMINUS_CHANNELWINDOW_H
+
+#include <mutex>
+#include <memory>
+#include <condition_variable>
+
+/**
+ * @brief credit the server may still send on one channel of a multiplexed connection
+ * @note a frame is let through as long as any credit is left, so frames larger than the window never stall,
+ * the overshoot is paid back by later grants
+ */
+class ChannelWindow {
+public:
+  using Ptr = std::shared_ptr<ChannelWindow>;
+  static constexpr int64_t DEFAULT_WINDOW_SIZE = 256 * 1024;
+private:
+  int64_t fCredit;
+  bool fClosed = false;
+  mutable std::mutex fMutex;
+  std::condition_variable fCreditFlag;
+public:
+  explicit ChannelWindow(int64_t credit = DEFAULT_WINDOW_SIZE) : fCredit(credit) {
+  }
+
+  int64_t available() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fCredit;
+  }
+
+  /**
+   * @brief blocks until there is credit and takes size bytes of it
+   * @return false once the channel is closed
+   */
+  bool acquire(size_t size) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fCreditFlag.wait(lock, [this] { return fClosed || fCredit > 0; });
+    if (fClosed) return false;
+    fCredit -= (int64_t) size;
+    return true;
+  }
+
+  /**
+   * @brief takes credit without waiting, used for data the receiver asked for such as scrollback
+   */
+  void consume(size_t size) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fCredit -= (int64_t) size;
+  }
+
+  void grant(uint32_t credit) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fCredit += credit;
+    }
+    fCreditFlag.notify_all();
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fClosed = true;
+    }
+    fCreditFlag.notify_all();
+  }
+};
+
+
+#endif //TERMINUS_CHANNELWINDOW_H
@@ -0,0 +1,42 @@
+#ifndef TERMINUS_COMMANDFILTER_H
+#define TERMINUS_COMMANDFILTER_H
+
+#include <message/MessageParser.h>
+
+/**
+ * @brief finds commands in frames of masters, slaves take commands only from the server fanning out for a controller
+ * @note batches and session frames are searched as well, frames nested deeper than any client sends count as commands
+ */
+class CommandFilter {
+public:
+  static constexpr int MAX_DEPTH = 4;
+public:
+
+  static bool carriesCommand(const MessageParser &parser, const Message::Ptr &msg, int depth = 0) {
+    if (depth > MAX_DEPTH) return true;
+    switch (msg->getId()) {
+      case ExecuteCommandMessage::id:
+      case CommandOutputMessage::id:
+      case CommandResultMessage::id:
+        return true;
+      case SequencedMessage::id: {
+        auto sequenced = msg->cast<SequencedMessage>();
+        auto &payload = sequenced.getPayload();
+        auto inner = parser.parse((const uint8_t *) payload.data(), payload.size());
+        return inner && carriesCommand(parser, inner, depth + 1);
+      }
+      case BatchMessage::id: {
+        auto batch = msg->cast<BatchMessage>();
+        for (auto &message : batch.getMessages()) {
+          auto inner = parser.parse((const uint8_t *) message.data(), message.size());
+          if (inner && carriesCommand(parser, inner, depth + 1)) return true;
+        }
+        return false;
+      }
+      default:
+        return false;
+    }
+  }
+};
+
+#endif //TERMINUS_COMMANDFILTER_H
@@ -0,0 +1,130 @@
+#ifndef TERMINUS_FANOUTREQUEST_H
+#define TERMINUS_FANOUTREQUEST_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include <message/MessageParser.h>
+
+/**
+ * @brief tracks one command fanned out by a controller to a set of slaves
+ * @note results are tagged with the client id of the slave and passed to the controller through the send handler
+ */
+class FanOutRequest {
+public:
+  using Ptr = std::shared_ptr<FanOutRequest>;
+  using Clock = std::chrono::steady_clock;
+  using SendHandler = std::function<bool(const Message::Ptr &)>;
+private:
+  uint32_t fRequestId;
+  std::map<std::string, bool> fHosts;
+  size_t fCompleted = 0;
+  size_t fFailed = 0;
+  bool fCancelled = false;
+  Clock::time_point fDeadline;
+  SendHandler fSendHandler;
+  mutable std::mutex fMutex;
+  /*! held while replies are sent, so none is sent once cancel returned */
+  std::mutex fSendMutex;
+  std::condition_variable fDoneFlag;
+public:
+  FanOutRequest(uint32_t requestId, const std::vector<std::string> &targets, std::chrono::milliseconds timeout,
+                SendHandler sendHandler) :
+    fRequestId(requestId), fDeadline(Clock::now() + timeout), fSendHandler(std::move(sendHandler)) {
+    for (auto &target : targets)
+      fHosts[target] = false;
+  }
+
+  uint32_t getRequestId() const {
+    return fRequestId;
+  }
+
+  std::vector<std::string> getTargets() const {
+    std::vector<std::string> targets;
+    for (auto &host : fHosts)
+      targets.push_back(host.first);
+    return targets;
+  }
+
+  bool isPending(const std::string &clientId) const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto host = fHosts.find(clientId);
+    return host != fHosts.end() && !host->second;
+  }
+
+  bool finished() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fCompleted == fHosts.size() || fCancelled;
+  }
+
+  /**
+   * @brief drops the controller, nothing is sent to it after this returns and wait stops waiting
+   */
+  void cancel() {
+    {
+      std::lock_guard<std::mutex> sendLock(fSendMutex);
+      std::lock_guard<std::mutex> lock(fMutex);
+      fCancelled = true;
+    }
+    fDoneFlag.notify_all();
+  }
+
+  void output(const std::string &clientId, const std::string &chars) {
+    if (!isPending(clientId)) return;
+    send(MessageFactory::create<CommandOutputMessage>(fRequestId, clientId, chars));
+  }
+
+  /**
+   * @return false if the host was not part of the request or has already completed
+   */
+  bool complete(const std::string &clientId, CommandStatus status, int32_t exitCode = -1, uint32_t elapsedMs = 0) {
+    size_t completed, failed;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      auto host = fHosts.find(clientId);
+      if (host == fHosts.end() || host->second) return false;
+      host->second = true;
+      completed = ++fCompleted;
+      if (status != CommandStatus::StatusExited || exitCode != 0) fFailed++;
+      failed = fFailed;
+    }
+    send(MessageFactory::create<CommandResultMessage>(fRequestId, clientId, status, exitCode, elapsedMs));
+    nlohmann::json progress;
+    progress["request"] = fRequestId;
+    progress["completed"] = completed;
+    progress["failed"] = failed;
+    progress["total"] = fHosts.size();
+    send(MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, progress));
+    fDoneFlag.notify_all();
+    return true;
+  }
+
+  /**
+   * @brief blocks until every host completed or the deadline passed, hosts still running are reported as timed out
+   */
+  void wait() {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fDoneFlag.wait_until(lock, fDeadline, [this] { return fCompleted == fHosts.size() || fCancelled; });
+    }
+    for (auto &target : getTargets()) {
+      complete(target, CommandStatus::StatusTimedOut);
+    }
+  }
+
+private:
+
+  void send(const Message::Ptr &msg) {
+    std::lock_guard<std::mutex> sendLock(fSendMutex);
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (fCancelled) return;
+    }
+    fSendHandler(msg);
+  }
+};
+
+#endif //TERMINUS_FANOUTREQUEST_H
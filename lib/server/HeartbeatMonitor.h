@@ -0,0 +1,246 @@
+#ifndef TERMINUS_HEARTBEATMONITOR_H
+#define TERMINUS_HEARTBEATMONITOR_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+
+#include <logger/Logger.h>
+#include <message/MessageFactory.h>
+#include <message/HeartbeatMessage.h>
+#include <transport/TimerWheel.h>
+#include <transport/DelayHistogram.h>
+
+/**
+ * @brief sends heartbeats and drops silent peers, every connection has one timer on a wheel driven by one thread
+ * @note peers answering heartbeats are dropped after missing too many of them, the others once they were silent
+ * for the idle timeout if one is set
+ */
+class HeartbeatMonitor {
+public:
+  using SendHandler = std::function<bool(int sock, const Message::Ptr &msg)>;
+  using EvictHandler = std::function<void(int sock)>;
+  static constexpr int DEFAULT_MAX_MISSED = 10;
+  static constexpr int TICK_MS = 100;
+
+  struct RoundTrip {
+    uint64_t samples = 0;
+    std::chrono::microseconds last{0};
+    std::chrono::microseconds smoothed{0};
+    std::chrono::microseconds min{0};
+  };
+
+  /**
+   * @brief what the monitor knows of one connection, heard() is called by the thread reading it
+   */
+  class Peer {
+    friend class HeartbeatMonitor;
+  private:
+    int fSocket;
+    std::string fName;
+    std::atomic<int64_t> fLastHeard;
+    /*! guarded by the mutex of the monitor */
+    std::chrono::milliseconds fInterval{0};
+    TimerWheel::TimerId fTimer = 0;
+    RoundTrip fRoundTrip;
+  public:
+    using Ptr = std::shared_ptr<Peer>;
+
+    Peer(int sock, std::string name) : fSocket(sock), fName(std::move(name)), fLastHeard(now()) {
+    }
+
+    void heard() {
+      fLastHeard.store(now(), std::memory_order_relaxed);
+    }
+  };
+private:
+  int fMaxMissed = DEFAULT_MAX_MISSED;
+  std::chrono::milliseconds fIdleTimeout{0};
+  SendHandler fSend;
+  EvictHandler fEvict;
+  TimerWheel fWheel{std::chrono::milliseconds(TICK_MS)};
+  DelayHistogram fRoundTrips;
+  bool fRunning = false;
+  std::thread fThread;
+  mutable std::mutex fMutex;
+  std::condition_variable fStopFlag;
+  /*! sockets owed a heartbeat, sent by the wheel thread once it released fMutex */
+  std::vector<int> fDue;
+  bool fSending = false;
+  std::condition_variable fSentFlag;
+public:
+  HeartbeatMonitor(SendHandler send, EvictHandler evict) : fSend(std::move(send)), fEvict(std::move(evict)) {
+  }
+
+  ~HeartbeatMonitor() {
+    stop();
+  }
+
+  /**
+   * @brief heartbeats a peer may miss before it is dropped
+   */
+  void setMaxMissed(int maxMissed) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fMaxMissed = std::max(1, maxMissed);
+  }
+
+  /**
+   * @brief silence after which peers without heartbeats are dropped, zero keeps them, applies to peers added later
+   */
+  void setIdleTimeout(std::chrono::milliseconds idleTimeout) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fIdleTimeout = idleTimeout;
+  }
+
+  void start() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fRunning) return;
+    fRunning = true;
+    fThread = std::thread(&HeartbeatMonitor::run, this);
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (!fRunning) return;
+      fRunning = false;
+    }
+    fStopFlag.notify_all();
+    if (fThread.joinable()) fThread.join();
+  }
+
+  size_t getTimerCount() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fWheel.size();
+  }
+
+  DelayHistogram getRoundTrips() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fRoundTrips;
+  }
+
+  RoundTrip getRoundTrip(const Peer::Ptr &peer) const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return peer->fRoundTrip;
+  }
+
+  Peer::Ptr add(int sock, const std::string &name) {
+    auto peer = std::make_shared<Peer>(sock, name);
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fIdleTimeout.count() > 0) schedule(peer, fIdleTimeout);
+    return peer;
+  }
+
+  /**
+   * @brief sends peer a heartbeat every interval from now on
+   */
+  void enableHeartbeat(const Peer::Ptr &peer, std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    peer->fInterval = interval;
+    schedule(peer, interval);
+  }
+
+  /**
+   * @brief takes the round trip of a heartbeat the peer echoed
+   * @return the round trip, zero if msg is no reply
+   */
+  std::chrono::microseconds onHeartbeat(const Peer::Ptr &peer, const HeartbeatMessage &msg) {
+    if (!msg.isReply()) return std::chrono::microseconds(0);
+    std::chrono::microseconds roundTrip((uint32_t) now() - msg.getTimestamp());
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto &stats = peer->fRoundTrip;
+    stats.last = roundTrip;
+    stats.smoothed = stats.samples == 0 ? roundTrip : (stats.smoothed * 7 + roundTrip) / 8;
+    stats.min = stats.samples == 0 ? roundTrip : std::min(stats.min, roundTrip);
+    stats.samples++;
+    fRoundTrips.record(roundTrip);
+    return roundTrip;
+  }
+
+  /**
+   * @brief forgets the peer before its socket is closed, so the socket is never dropped or sent to once it is reused
+   */
+  void remove(const Peer::Ptr &peer) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    if (peer->fTimer) fWheel.cancel(peer->fTimer);
+    peer->fTimer = 0;
+    fDue.erase(std::remove(fDue.begin(), fDue.end(), peer->fSocket), fDue.end());
+    fSentFlag.wait(lock, [this] { return !fSending; });
+    auto &stats = peer->fRoundTrip;
+    if (stats.samples > 0)
+      DINFO("client %s round trip last: %ld us, smoothed: %ld us, min: %ld us over %lu heartbeats", peer->fName.c_str(),
+            (long) stats.last.count(), (long) stats.smoothed.count(), (long) stats.min.count(), stats.samples);
+  }
+
+private:
+
+  static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * @note expects fMutex to be held
+   */
+  void schedule(const Peer::Ptr &peer, std::chrono::microseconds delay) {
+    if (peer->fTimer) fWheel.cancel(peer->fTimer);
+    peer->fTimer = fWheel.schedule(delay, [this, peer] { check(peer); });
+  }
+
+  /**
+   * @note runs on the wheel with fMutex held
+   */
+  void check(const Peer::Ptr &peer) {
+    peer->fTimer = 0;
+    std::chrono::microseconds silence(now() - peer->fLastHeard.load(std::memory_order_relaxed));
+    if (peer->fInterval.count() > 0) {
+      if (silence >= peer->fInterval * fMaxMissed) {
+        DWARN("client %s missed %d heartbeats, dropping it", peer->fName.c_str(), fMaxMissed);
+        fEvict(peer->fSocket);
+        return;
+      }
+      fDue.push_back(peer->fSocket);
+      schedule(peer, peer->fInterval);
+      return;
+    }
+    if (fIdleTimeout.count() == 0) return;
+    if (silence >= fIdleTimeout) {
+      DWARN("client %s idle for %ld s, dropping it", peer->fName.c_str(), (long) (silence.count() / 1000000));
+      fEvict(peer->fSocket);
+      return;
+    }
+    schedule(peer, fIdleTimeout - silence);
+  }
+
+  /**
+   * @brief sends the heartbeats that came due, without fMutex so the threads reading peers never wait for a socket
+   */
+  void sendDue(std::unique_lock<std::mutex> &lock) {
+    if (fDue.empty()) return;
+    std::vector<int> due;
+    due.swap(fDue);
+    fSending = true;
+    lock.unlock();
+    // skipped while the socket is busy, the peer is heard from anyway then
+    for (auto sock : due)
+      fSend(sock, MessageFactory::create<HeartbeatMessage>((uint32_t) now(), false));
+    lock.lock();
+    fSending = false;
+    fSentFlag.notify_all();
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(fMutex);
+    while (fRunning) {
+      fWheel.advance(TimerWheel::Clock::now());
+      sendDue(lock);
+      fStopFlag.wait_for(lock, fWheel.getTick());
+    }
+  }
+};
+
+#endif //TERMINUS_HEARTBEATMONITOR_H
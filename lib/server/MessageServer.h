@@ -15,6 +15,17 @@
 #include <message/Buffer.h>
 #include <logger/Logger.h>
 #include <message/MessageParser.h>
+#include <message/FrameReader.h>
+#include <server/FanOutRequest.h>
+#include <server/CommandFilter.h>
+#include <server/Scrollback.h>
+#include <server/ChannelWindow.h>
+#include <server/RateLimiter.h>
+#include <server/HeartbeatMonitor.h>
+#include <server/ServerMetrics.h>
+#include <metrics/Probes.h>
+#include <transport/DatagramEndpoint.h>
+#include <transport/LaneLock.h>
 
 class MessageServer {
 private:
@@ -22,11 +33,31 @@ private:
     int socket;
     std::thread t;
   };
+
+  /*! where a master is reached, channel 0 is a connection of its own */
+  struct Endpoint {
+    int socket = -1;
+    uint32_t channel = 0;
+    ChannelWindow::Ptr window;
+    /*! capabilities of the master, they decide how session frames reach it */
+    uint32_t capabilities = 0;
+  };
+
+  struct MuxChannel {
+    std::string clientId;
+    ChannelWindow::Ptr window;
+  };
 private:
-  static const int MAX_CONNECT_QUEUE = 5;
+  static const int MAX_CONNECT_QUEUE = SOMAXCONN;
   static const bool ENABLE_TCP_NODELAY = false;
   static const int BUF_SIZE = 4096;
   static const int KEEPALIVE_MAXCOUNT = 10;
+  static const int FANOUT_GRACE_MS = 1000;
+  /*! capabilities which decide how frames are encoded, scrollback is stored the way they want it */
+  static const uint32_t FRAME_CAPABILITIES = ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING |
+                                             ConnectOptions::CAPABILITY_BINARY_METADATA;
+  static const uint32_t CAPABILITIES = FRAME_CAPABILITIES | ConnectOptions::CAPABILITY_HEARTBEAT |
+                                       ConnectOptions::CAPABILITY_TRACE | ConnectOptions::CAPABILITY_DETACH_NOTICE;
 private:
   int fServerSocket = -1;
   int fBufferSize = -1;
@@ -35,12 +66,25 @@ private:
   bool isRunning = false;
   bool stopRunning = false;
   std::map<const std::string, ClientParams> fClientThreadPool;
-  std::map<std::string, int> fMasterSocketPool;
+  std::map<std::string, Endpoint> fMasterSocketPool;
   std::map<std::string, int> fSlaveSocketPool;
   bool fKeepAlive = false;
   int fKeepAliveInterval = -1;
+  int fKeepAliveMaxCount = KEEPALIVE_MAXCOUNT;
+  std::shared_ptr<HeartbeatMonitor> fHeartbeat;
   std::mutex fMutex;
+  std::map<int, std::shared_ptr<LaneLock>> fSendLocks;
+  /*! capabilities agreed on with connections which sent any */
+  std::map<int, uint32_t> fCapabilities;
+  std::mutex fSendLocksMutex;
+  std::map<uint32_t, FanOutRequest::Ptr> fFanOutRequests;
+  uint32_t fNextRequestId = 1;
+  std::mutex fFanOutMutex;
+  std::shared_ptr<ScrollbackStore> fScrollback = std::make_shared<ScrollbackStore>();
+  std::shared_ptr<RateLimiter> fRateLimiter = std::make_shared<RateLimiter>();
+  ServerMetrics fMetrics{std::make_shared<MetricRegistry>()};
   std::shared_ptr<MessageParser> fMessageParser = nullptr;
+  std::shared_ptr<DatagramEndpoint> fDatagram = nullptr;
   std::string fServerLogin;
   std::string fServerPassword;
 
@@ -50,23 +94,84 @@ public:
     fBufferSize(bufferSize), fTcpNoDelay(tcpNoDelay), fMaxConnectQueue(maxConnectQueue),
     fServerLogin(std::move(login)), fServerPassword(std::move(password)) {
     fMessageParser = std::make_shared<MessageParser>(fServerLogin, fServerPassword);
+    fHeartbeat = std::make_shared<HeartbeatMonitor>([this](int sock, const Message::Ptr &msg) {
+      return trySendMessage(sock, msg);
+    }, [this](int sock) {
+      // the thread reading the socket cleans up
+      fMetrics.evictions->add();
+      shutdown(sock, SHUT_RDWR);
+    });
+    for (auto lane : {Lane::Interactive, Lane::Bulk}) {
+      fMetrics.getRegistry()->gauge("terminus_send_waiting", "Frames waiting for their socket",
+                                    lane == Lane::Interactive ? "lane=\"interactive\"" : "lane=\"bulk\"",
+                                    [this, lane] { return (double) getWaiting(lane); });
+    }
   }
 
   ~MessageServer() {
     stop();
   }
 
+  /**
+   * @brief enables tcp keep alive, clients asking for heartbeats are dropped after missing maxDropPackets of them
+   */
   void enableKeepAlive(int keepAliveInterval, int maxDropPackets = KEEPALIVE_MAXCOUNT) {
     fKeepAliveInterval = keepAliveInterval;
+    fKeepAliveMaxCount = maxDropPackets;
     fKeepAlive = true;
+    fHeartbeat->setMaxMissed(maxDropPackets);
+  }
+
+  /**
+   * @brief drops clients without heartbeats which sent nothing for idleTimeout, zero keeps them
+   */
+  void setIdleTimeout(std::chrono::milliseconds idleTimeout) {
+    fHeartbeat->setIdleTimeout(idleTimeout);
+  }
+
+  /**
+   * @brief sets how much slave output is kept for masters attaching later, zero disables scrollback
+   */
+  void setScrollback(size_t sessionSize, size_t totalSize) {
+    fScrollback = std::make_shared<ScrollbackStore>(sessionSize, totalSize);
+  }
+
+  /**
+   * @brief limits how fast slave output is relayed, slaves over their limit are not read until they are back below
+   */
+  void setRateLimiter(std::shared_ptr<RateLimiter> rateLimiter) {
+    fRateLimiter = std::move(rateLimiter);
+  }
+
+  /**
+   * @brief metrics of the server, see PrometheusExporter
+   */
+  const MetricRegistry::Ptr &getMetrics() const {
+    return fMetrics.getRegistry();
   }
 
   void listen(const char *host, int &port, int socketFlags = 0) {
     DWARN("starting listening %s:%d", host, port);
+    fHeartbeat->start();
     return bindAndListen(host, port, socketFlags);
   }
 
+  /**
+   * @brief serves clients over udp next to tcp, each udp session is handled like a tcp connection
+   */
+  bool listenDatagram(const char *host, int port, const LossSimulator::Options &simulator = {}) {
+    DWARN("starting listening %s:%d/udp", host, port);
+    fHeartbeat->start();
+    fDatagram = std::make_shared<DatagramEndpoint>(fServerLogin, fServerPassword, simulator);
+    return fDatagram->listen(host, port, [this](const std::string &remote, int sock) {
+      std::lock_guard<std::mutex> lock(fMutex);
+      startClient(remote, sock);
+    });
+  }
+
   void stop() {
+    fHeartbeat->stop();
+    if (fDatagram) fDatagram->stop();
     if (!isRunning) return;
     std::lock_guard<std::mutex> lock(fMutex);
     stopRunning = true;
@@ -114,8 +219,11 @@ private:
 
       if (sock == -1) {
         DERROR("accept failed");
+        fMetrics.acceptErrors->add();
+        TERMINUS_PROBE1(accept__error, errno);
         continue;
       }
+      TERMINUS_PROBE1(accept, sock);
 
       sockaddr_in peer = {};
 
@@ -127,7 +235,7 @@ private:
 
       inet_ntop(AF_INET, &(peer.sin_addr), client, INET_ADDRSTRLEN);
 
-      if (fKeepAlive && !setKeepAlive(sock, fKeepAliveInterval, KEEPALIVE_MAXCOUNT)) {
+      if (fKeepAlive && !setKeepAlive(sock, fKeepAliveInterval, fKeepAliveMaxCount)) {
         DERROR("failed to setup keepalive for client %s", client);
         close(sock);
         continue;
@@ -143,102 +251,704 @@ private:
         continue;
       }
 
-      fClientThreadPool[remote].socket = sock;
-      fClientThreadPool[remote].t = std::thread([this, remote, sock]() {
-        clientHandler(remote.c_str(), sock);
-        close(sock);
-        fClientThreadPool.erase(remote);
-      });
-      fClientThreadPool[remote].t.detach();
+      startClient(remote, sock);
     }
   }
 
+  /**
+   * @note expects fMutex to be held
+   */
+  void startClient(const std::string &remote, int sock) {
+    fMetrics.accepted->add();
+    fMetrics.connections->add();
+    fClientThreadPool[remote].socket = sock;
+    fClientThreadPool[remote].t = std::thread([this, remote, sock]() {
+      clientHandler(remote.c_str(), sock);
+      // a connection accepted once the socket is closed may get the same descriptor
+      releaseSocket(sock, remote.c_str());
+      close(sock);
+      fMetrics.connections->sub();
+      std::lock_guard<std::mutex> lock(fMutex);
+      fClientThreadPool.erase(remote);
+    });
+    fClientThreadPool[remote].t.detach();
+  }
+
   void clientHandler(const char *client, int sock) {
     DINFO("new client connected: %s", client);
-    size_t size;
-    int redirectSocket = -1;
+    ssize_t size;
     std::string clientId;
     auto recvBuffer = new uint8_t[fBufferSize];
     std::shared_ptr<ConnectionType> connectionType = nullptr;
-    while (true) {
+    std::map<uint32_t, MuxChannel> channels;
+    std::shared_ptr<RateLimiter::Shaper> shaper;
+    auto maxPause = TokenBucket::Clock::duration::max();
+    std::vector<FanOutRequest::Ptr> fanOuts;
+    Gauge::Ptr sessions;
+    auto peer = fHeartbeat->add(sock, client);
+    FrameReader frameReader;
+    Buffer frame;
+    bool running = true;
+    while (running) {
+      // the output of a slave over its limit backs up in the slave instead of taking the uplink of other sessions
+      if (shaper && shaper->throttle(maxPause)) fMetrics.rateLimitPauses->add();
       size = recv(sock, recvBuffer, fBufferSize, 0);
       if (size <= 0) break;
+      auto received = TraceMessage::now();
+      peer->heard();
+      fMetrics.receivedBytes->add(size);
+      TERMINUS_PROBE2(recv, sock, size);
 
-      auto parseResult = fMessageParser->parse(recvBuffer, size);
-      if (!parseResult) {
-        DERROR("failed to parse incoming message");
-        break;
-      }
+      frameReader.append(recvBuffer, size);
+      while (running && frameReader.next(frame)) {
+        fMetrics.receivedFrames->add();
+        auto parseResult = fMessageParser->parse(frame.getDataPtr(), frame.getSize());
+        if (!parseResult) {
+          DERROR("failed to parse incoming message");
+          running = false;
+          break;
+        }
 
-      if (parseResult->getId() == ConnectMessage::id) {
-        clientId = parseResult->cast<ConnectMessage>().getConnectOptions().getClientId();
-        if (!connectMessageHandler(client, sock, parseResult, connectionType)) break;
-        continue;
-      }
+        if (parseResult->getId() == HeartbeatMessage::id) {
+          auto roundTrip = fHeartbeat->onHeartbeat(peer, parseResult->cast<HeartbeatMessage>());
+          if (roundTrip.count() > 0) fMetrics.roundTrips->record(roundTrip);
+          continue;
+        }
 
-      if (redirectSocket < 0 && connectionType != nullptr) {
-        redirectSocket = getRedirectSocket(clientId, *connectionType);
-      }
+        if (parseResult->getId() == TraceMessage::id) {
+          if (connectionType) forwardTrace(clientId, *connectionType, parseResult->cast<TraceMessage>(), received);
+          continue;
+        }
 
-      if (redirectSocket < 0) continue;
+        if (parseResult->getId() == ConnectMessage::id) {
+          auto connectMessage = parseResult->cast<ConnectMessage>();
+          auto &options = connectMessage.getConnectOptions();
+          clientId = options.getClientId();
+          if (!connectMessageHandler(client, sock, parseResult, connectionType)) {
+            running = false;
+            continue;
+          }
+          if (!sessions) {
+            sessions = fMetrics.getSessions(*connectionType);
+            sessions->add();
+          }
+          TERMINUS_PROBE3(connect, sock, clientId.c_str(), (uint32_t) *connectionType);
+          if (*connectionType == ConnectionType::TypeSlave) shaper = fRateLimiter->makeShaper(clientId);
+          if (getCapabilities(sock) & ConnectOptions::CAPABILITY_HEARTBEAT) {
+            std::chrono::seconds interval(std::max<int>(1, options.keepAliveInterval()));
+            fHeartbeat->enableHeartbeat(peer, interval);
+            // replies are read at least once per heartbeat, far from the misses which drop the slave
+            maxPause = interval;
+          }
+          continue;
+        }
 
-      send(redirectSocket, recvBuffer, size, 0);
+        if (connectionType == nullptr) continue;
 
+        if (*connectionType == ConnectionType::TypeMux) {
+          if (!channelHandler(client, sock, parseResult, channels)) running = false;
+          continue;
+        }
+
+        if (*connectionType == ConnectionType::TypeController) {
+          if (parseResult->getId() == ExecuteCommandMessage::id) {
+            fanOuts.erase(std::remove_if(fanOuts.begin(), fanOuts.end(), [](const FanOutRequest::Ptr &request) {
+              return request->finished();
+            }), fanOuts.end());
+            fanOuts.push_back(fanOutHandler(clientId, sock, parseResult->cast<ExecuteCommandMessage>()));
+          }
+          continue;
+        }
+
+        if (*connectionType == ConnectionType::TypeSlave) {
+          if (!fanOutReplyHandler(clientId, parseResult))
+            relaySlaveFrame(clientId, frame);
+          if (shaper) shaper->consume(frame.getSize());
+          continue;
+        }
+
+        if (CommandFilter::carriesCommand(*fMessageParser, parseResult)) {
+          DWARN("dropping a command master %s sent to %s", client, clientId.c_str());
+          continue;
+        }
+        relayToSlave(clientId, frame.getDataPtr(), frame.getSize());
+      }
+      if (frameReader.failed()) {
+        DERROR("malformed frame from client %s", client);
+        break;
+      }
     }
     delete[] recvBuffer;
+    // replies of requests still running must not reach a connection which gets the socket next
+    for (auto &request : fanOuts)
+      request->cancel();
+    fHeartbeat->remove(peer);
+    if (sessions) sessions->sub();
+    TERMINUS_PROBE2(disconnect, sock, clientId.c_str());
     DWARN("client %s disconnected", client);
+    if (shaper && shaper->getStats().pauses > 0)
+      DINFO("rate limits paused reading %s %lu times for %ld ms", clientId.c_str(), shaper->getStats().pauses,
+            (long) (shaper->getStats().paused.count() / 1000));
     if (connectionType == nullptr) return;
 
     DWARN("erasing id %s from session socket pool", clientId.c_str());
+    bool replaced = false;
     switch (*connectionType) {
-      case ConnectionType::TypeSlave:
-        fSlaveSocketPool.erase(clientId);
+      case ConnectionType::TypeSlave: {
+        std::lock_guard<std::mutex> lock(fMutex);
+        replaced = !erasePoolEntry(fSlaveSocketPool, clientId, sock);
+        if (!replaced) fScrollback->release(clientId);
         break;
+      }
       case ConnectionType::TypeMaster:
-        fMasterSocketPool.erase(clientId);
+        detachMaster(clientId, {sock, 0, nullptr});
+        break;
+      case ConnectionType::TypeMux:
+        for (auto &channel : channels)
+          detachMaster(channel.second.clientId, {sock, channel.first, channel.second.window});
+        break;
+      case ConnectionType::TypeController:
         break;
     }
+    if (*connectionType == ConnectionType::TypeSlave && !replaced) fanOutHostLost(clientId);
   }
 
-  int getRedirectSocket(const std::string &clientId, ConnectionType connectionType) {
-    std::map<std::string, int> *map;
-    switch (connectionType) {
-      case ConnectionType::TypeSlave: {
-        map = &fMasterSocketPool;
-        break;
+  /**
+   * @return false if the entry belongs to a newer connection which resumed the session
+   */
+  static bool erasePoolEntry(std::map<std::string, int> &pool, const std::string &clientId, int sock) {
+    auto item = pool.find(clientId);
+    if (item == pool.end() || item->second != sock) return false;
+    pool.erase(item);
+    return true;
+  }
+
+  static bool erasePoolEntry(std::map<std::string, Endpoint> &pool, const std::string &clientId, const Endpoint &endpoint) {
+    auto item = pool.find(clientId);
+    if (item == pool.end() || item->second.socket != endpoint.socket || item->second.channel != endpoint.channel) return false;
+    pool.erase(item);
+    return true;
+  }
+
+  void detachMaster(const std::string &clientId, const Endpoint &endpoint) {
+    if (endpoint.window) endpoint.window->close();
+    int slaveSocket = -1;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      auto slave = fSlaveSocketPool.find(clientId);
+      if (!erasePoolEntry(fMasterSocketPool, clientId, endpoint) || slave == fSlaveSocketPool.end()) return;
+      DINFO("master detached from %s, session is kept for reattach", clientId.c_str());
+      slaveSocket = slave->second;
+    }
+    // the slave would wait for credit of a master which is gone
+    if (getCapabilities(slaveSocket) & ConnectOptions::CAPABILITY_DETACH_NOTICE)
+      sendMessage(slaveSocket, MessageFactory::create<MasterDetachedMessage>());
+  }
+
+  /**
+   * @brief serves the channels of a multiplexed connection, each of them behaves like a master connection
+   * @return false if the connection has to be dropped
+   */
+  bool channelHandler(const std::string &client, int sock, const std::shared_ptr<Message> &parseResult,
+                      std::map<uint32_t, MuxChannel> &channels) {
+    switch (parseResult->getId()) {
+      case ChannelDataMessage::id: {
+        auto data = parseResult->cast<ChannelDataMessage>();
+        auto channel = channels.find(data.getChannel());
+        if (channel == channels.end()) return true;
+        auto &payload = data.getPayload();
+        auto inner = fMessageParser->parse((const uint8_t *) payload.data(), payload.size());
+        if (!inner || CommandFilter::carriesCommand(*fMessageParser, inner)) {
+          DWARN("dropping a frame client %s sent on channel %u", client.c_str(), data.getChannel());
+          return true;
+        }
+        relayToSlave(channel->second.clientId, (const uint8_t *) payload.data(), payload.size());
+        return true;
       }
-      case ConnectionType::TypeMaster: {
-        map = &fSlaveSocketPool;
-        break;
+      case ChannelWindowMessage::id: {
+        auto update = parseResult->cast<ChannelWindowMessage>();
+        auto channel = channels.find(update.getChannel());
+        if (channel != channels.end()) channel->second.window->grant(update.getCredit());
+        return true;
       }
+      case OpenChannelMessage::id: {
+        auto open = parseResult->cast<OpenChannelMessage>();
+        auto &options = open.getConnectOptions();
+        if (open.getChannel() == 0 || channels.find(open.getChannel()) != channels.end()) {
+          DERROR("client %s opened channel %u twice", client.c_str(), open.getChannel());
+          return false;
+        }
+        // heartbeats are exchanged with the multiplexer, not per channel, and it does not pass traces on
+        Endpoint endpoint{sock, open.getChannel(), std::make_shared<ChannelWindow>(),
+                          negotiate(options) & ~(ConnectOptions::CAPABILITY_HEARTBEAT | ConnectOptions::CAPABILITY_TRACE)};
+        if (options.getConnectionType() != ConnectionType::TypeMaster ||
+            !attachClient(client, endpoint, options.getClientId(), options.getConnectionType(), options.isResume())) {
+          DERROR("client %s failed to open channel %u for %s", client.c_str(), open.getChannel(), options.getClientId().c_str());
+          return sendMessage(sock, MessageFactory::create<CloseChannelMessage>(open.getChannel()));
+        }
+        channels[open.getChannel()] = {options.getClientId(), endpoint.window};
+        if (options.getProtocolVersion() > 0) {
+          auto reply = MessageFactory::create<EncryptedMessage>(makeHandshakeReply(endpoint.capabilities), fServerLogin, fServerPassword);
+          sendToMaster(endpoint, reply->getBuffer().getDataPtr(), reply->getBuffer().getSize());
+        }
+        return true;
+      }
+      case CloseChannelMessage::id: {
+        auto channel = channels.find(parseResult->cast<CloseChannelMessage>().getChannel());
+        if (channel == channels.end()) return true;
+        DINFO("client %s closed channel %u of %s", client.c_str(), channel->first, channel->second.clientId.c_str());
+        detachMaster(channel->second.clientId, {sock, channel->first, channel->second.window});
+        channels.erase(channel);
+        return true;
+      }
+      default:
+        return true;
+    }
+  }
+
+  /**
+   * @brief keeps the frame in the session scrollback and passes it to the master if one is attached
+   */
+  void relaySlaveFrame(const std::string &clientId, const Buffer &frame) {
+    auto start = ServerMetrics::Clock::now();
+    TERMINUS_PROBE2(relay__start, clientId.c_str(), frame.getSize());
+    // a multiplexed master out of credit holds back this slave only, taken before the scrollback is locked
+    // so the master can still be replaced meanwhile
+    auto window = getMasterEndpoint(clientId).window;
+    if (window) window->acquire(frame.getSize());
+    auto scrollback = fScrollback->find(clientId);
+    std::unique_lock<std::mutex> scrollbackLock;
+    if (scrollback) {
+      scrollbackLock = std::unique_lock<std::mutex>(scrollback->getMutex());
+      scrollback->append(frame.getDataPtr(), frame.getSize());
+    }
+    auto master = getMasterEndpoint(clientId);
+    auto sent = master.socket >= 0 && sendToMaster(master, frame.getDataPtr(), frame.getSize());
+    if (sent) fMetrics.relayed(ServerMetrics::Direction::ToMaster, frame.getSize(), start);
+    TERMINUS_PROBE3(relay__done, clientId.c_str(), frame.getSize(), master.socket);
+  }
+
+  void relayToSlave(const std::string &clientId, const uint8_t *data, size_t size) {
+    auto start = ServerMetrics::Clock::now();
+    TERMINUS_PROBE2(relay__start, clientId.c_str(), size);
+    // looked up per frame, the slave of a session may have reconnected since the last one
+    auto slaveSocket = getSlaveSocket(clientId);
+    if (slaveSocket >= 0 && relayFrame(slaveSocket, getCapabilities(slaveSocket), data, size))
+      fMetrics.relayed(ServerMetrics::Direction::ToSlave, size, start);
+    TERMINUS_PROBE3(relay__done, clientId.c_str(), size, slaveSocket);
+  }
+
+  /**
+   * @brief stamps a keystroke trace and passes it to the other end of the session if that one takes traces
+   * @param received when the frame carrying the trace was read, so the time the frames before it took counts
+   */
+  void forwardTrace(const std::string &clientId, ConnectionType connectionType, const TraceMessage &trace, uint32_t received) {
+    if (connectionType == ConnectionType::TypeMaster) {
+      auto slaveSocket = getSlaveSocket(clientId);
+      if (slaveSocket < 0 || !(getCapabilities(slaveSocket) & ConnectOptions::CAPABILITY_TRACE)) return;
+      sendMessage(slaveSocket, trace.stamp(TraceStamp::ServerReceive, received)
+        ->stamp(TraceStamp::ServerForward, TraceMessage::now()));
+      return;
+    }
+    if (connectionType != ConnectionType::TypeSlave) return;
+    auto master = getMasterEndpoint(clientId);
+    if (master.socket < 0 || !(master.capabilities & ConnectOptions::CAPABILITY_TRACE)) return;
+    auto stamped = trace.stamp(TraceStamp::ServerReturn, received)->stamp(TraceStamp::ServerDeliver, TraceMessage::now());
+    auto encrypted = MessageFactory::create<EncryptedMessage>(stamped, fServerLogin, fServerPassword,
+                                                              ConnectOptions::toWireFormat(master.capabilities));
+    sendToMaster(master, encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+  }
+
+  bool sendToMaster(const Endpoint &master, const uint8_t *data, size_t size) {
+    if (master.channel == 0) return relayFrame(master.socket, master.capabilities, data, size);
+    Buffer converted;
+    if (convertFrame(data, size, master.capabilities, converted)) {
+      data = converted.getDataPtr();
+      size = converted.getSize();
     }
-    auto item = map->find(clientId);
-    if (item == map->end()) return -1;
+    auto wrapped = CompactCodec::makeFrame(MessageFactory::create<ChannelDataMessage>(master.channel, std::string((const char *) data, size)),
+                                           getWireFormat(master.socket));
+    return sendFrame(master.socket, (const uint8_t *) wrapped.data(), wrapped.size());
+  }
+
+  /**
+   * @brief passes a session frame on as it came in unless the connection lacks a capability the frame needs
+   */
+  bool relayFrame(int sock, uint32_t capabilities, const uint8_t *data, size_t size) {
+    Buffer converted;
+    if (convertFrame(data, size, capabilities, converted)) return sendFrame(sock, converted.getDataPtr(), converted.getSize());
+    return sendFrame(sock, data, size);
+  }
+
+  /**
+   * @return false if the frame can be sent as it is, clients of the compact format read both formats
+   * @note batches become one frame per message for clients without batching
+   */
+  bool convertFrame(const uint8_t *data, size_t size, uint32_t capabilities, Buffer &converted) {
+    if (size == 0 || data[0] != CompactCodec::TYPE_ENCRYPTED) return false;
+    auto format = ConnectOptions::toWireFormat(capabilities);
+    if (format != WireFormat::Legacy && (capabilities & ConnectOptions::CAPABILITY_BATCHING)) return false;
+    auto msg = fMessageParser->parse(data, size);
+    if (!msg) return false;
+    if (msg->getId() != BatchMessage::id) {
+      if (format != WireFormat::Legacy) return false;
+      converted = MessageFactory::create<EncryptedMessage>(msg, fServerLogin, fServerPassword)->getBuffer();
+      return true;
+    }
+    std::string frames;
+    auto batch = msg->cast<BatchMessage>();
+    for (auto &message : batch.getMessages()) {
+      auto inner = fMessageParser->parse((const uint8_t *) message.data(), message.size());
+      if (!inner) continue;
+      auto encrypted = MessageFactory::create<EncryptedMessage>(inner, fServerLogin, fServerPassword, format);
+      frames.append((const char *) encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+    }
+    converted = Buffer((const uint8_t *) frames.data(), frames.size());
+    return true;
+  }
+
+  FanOutRequest::Ptr fanOutHandler(const std::string &controllerId, int controllerSock, const ExecuteCommandMessage &msg) {
+    std::vector<std::string> targets = msg.getTargets();
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    DINFO("controller %s fans out request %u to %zu hosts", controllerId.c_str(), msg.getRequestId(), targets.size());
+
+    auto timeout = std::chrono::milliseconds(msg.getTimeoutMs() + FANOUT_GRACE_MS);
+    auto request = std::make_shared<FanOutRequest>(msg.getRequestId(), targets, timeout, [this, controllerSock](const Message::Ptr &reply) {
+      return sendMessage(controllerSock, reply);
+    });
+    uint32_t requestId;
+    {
+      std::lock_guard<std::mutex> lock(fFanOutMutex);
+      requestId = fNextRequestId++;
+      fFanOutRequests[requestId] = request;
+    }
+
+    auto forward = MessageFactory::create<ExecuteCommandMessage>(requestId, msg.getCommand(), msg.getTimeoutMs());
+    for (auto &target : targets) {
+      int slaveSocket;
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto slave = fSlaveSocketPool.find(target);
+        slaveSocket = slave == fSlaveSocketPool.end() ? -1 : slave->second;
+      }
+      if (slaveSocket < 0 || !sendMessage(slaveSocket, forward))
+        request->complete(target, CommandStatus::StatusUnreachable);
+    }
+
+    std::thread([this, requestId, request]() {
+      request->wait();
+      std::lock_guard<std::mutex> lock(fFanOutMutex);
+      fFanOutRequests.erase(requestId);
+    }).detach();
+    return request;
+  }
+
+  bool fanOutReplyHandler(const std::string &clientId, const std::shared_ptr<Message> &parseResult) {
+    uint32_t requestId;
+    switch (parseResult->getId()) {
+      case CommandOutputMessage::id:
+        requestId = parseResult->cast<CommandOutputMessage>().getRequestId();
+        break;
+      case CommandResultMessage::id:
+        requestId = parseResult->cast<CommandResultMessage>().getRequestId();
+        break;
+      default:
+        return false;
+    }
+    FanOutRequest::Ptr request;
+    {
+      std::lock_guard<std::mutex> lock(fFanOutMutex);
+      auto item = fFanOutRequests.find(requestId);
+      if (item == fFanOutRequests.end()) return true;
+      request = item->second;
+    }
+    if (parseResult->getId() == CommandOutputMessage::id) {
+      request->output(clientId, parseResult->cast<CommandOutputMessage>().getChars());
+      return true;
+    }
+    auto result = parseResult->cast<CommandResultMessage>();
+    request->complete(clientId, result.getStatus(), result.getExitCode(), result.getElapsedMs());
+    return true;
+  }
+
+  void fanOutHostLost(const std::string &clientId) {
+    std::vector<FanOutRequest::Ptr> requests;
+    {
+      std::lock_guard<std::mutex> lock(fFanOutMutex);
+      for (auto &item : fFanOutRequests)
+        requests.push_back(item.second);
+    }
+    for (auto &request : requests)
+      request->complete(clientId, CommandStatus::StatusUnreachable);
+  }
+
+  std::shared_ptr<LaneLock> getSendLock(int sock) {
+    std::lock_guard<std::mutex> lock(fSendLocksMutex);
+    auto &sendLock = fSendLocks[sock];
+    if (!sendLock) sendLock = std::make_shared<LaneLock>();
+    return sendLock;
+  }
+
+  void releaseSocket(int sock, const char *client) {
+    std::shared_ptr<LaneLock> sendLock;
+    {
+      std::lock_guard<std::mutex> lock(fSendLocksMutex);
+      auto item = fSendLocks.find(sock);
+      if (item != fSendLocks.end()) sendLock = item->second;
+      fSendLocks.erase(sock);
+      fCapabilities.erase(sock);
+    }
+    if (sendLock) logSendStats(client, sendLock->getStats());
+  }
+
+  int getWaiting(Lane lane) {
+    std::lock_guard<std::mutex> lock(fSendLocksMutex);
+    int waiting = 0;
+    for (auto &item : fSendLocks)
+      waiting += item.second->getWaiting(lane);
+    return waiting;
+  }
+
+  static void logSendStats(const char *client, const LaneLock::Stats &stats) {
+    for (auto lane : {Lane::Interactive, Lane::Bulk}) {
+      auto &delays = stats.getDelays(lane);
+      if (delays.count() == 0) continue;
+      DINFO("client %s %s frames: %lu, queue delay p50: %lu us, p99: %lu us, max: %lu us", client,
+            lane == Lane::Interactive ? "interactive" : "bulk", delays.count(), delays.percentile(0.5),
+            delays.percentile(0.99), delays.max());
+    }
+  }
+
+  uint32_t getCapabilities(int sock) {
+    std::lock_guard<std::mutex> lock(fSendLocksMutex);
+    auto item = fCapabilities.find(sock);
+    return item == fCapabilities.end() ? 0 : item->second;
+  }
+
+  void setCapabilities(int sock, uint32_t capabilities) {
+    std::lock_guard<std::mutex> lock(fSendLocksMutex);
+    fCapabilities[sock] = capabilities;
+  }
+
+  WireFormat getWireFormat(int sock) {
+    return ConnectOptions::toWireFormat(getCapabilities(sock));
+  }
+
+  /**
+   * @return the capabilities asked for in a connect message which the server supports as well
+   */
+  static uint32_t negotiate(const ConnectOptions &options) {
+    auto capabilities = options.getCapabilities() & CAPABILITIES;
+    if (!(capabilities & ConnectOptions::CAPABILITY_COMPACT)) capabilities &= ~ConnectOptions::CAPABILITY_BATCHING;
+    return capabilities;
+  }
+
+  static Message::Ptr makeHandshakeReply(uint32_t capabilities) {
+    return adaptMessage(MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, nlohmann::json{
+      {"version",      (int) ConnectOptions::PROTOCOL_VERSION},
+      {"capabilities", capabilities}}), capabilities);
+  }
+
+  /**
+   * @return msg in a form a client with the given capabilities reads
+   */
+  static Message::Ptr adaptMessage(const Message::Ptr &msg, uint32_t capabilities) {
+    if (msg->getId() != ResponseMessage::id || (capabilities & ConnectOptions::CAPABILITY_BINARY_METADATA)) return msg;
+    auto response = msg->cast<ResponseMessage>();
+    if (response.getEncoding() == MetaDataEncoding::Text) return msg;
+    return MessageFactory::create<ResponseMessage>(response.getResponseCode(), response.getMetaData(), MetaDataEncoding::Text);
+  }
+
+  /**
+   * @brief writes a whole frame, frames sent to one socket from different threads are never interleaved
+   * @note small frames go first, so the echo of one channel does not wait behind the output of another
+   */
+  bool sendFrame(int sock, const uint8_t *data, size_t size) {
+    auto sendLock = getSendLock(sock);
+    auto lane = LaneLock::classify(size);
+    LaneLock::Guard lock(*sendLock, lane);
+    fMetrics.sendWait[(int) lane]->record(lock.getWait());
+    TERMINUS_PROBE3(send__wait, sock, (int) lane, lock.getWait().count());
+    return writeUnsent(sock, *sendLock) && writeFrame(sock, data, size);
+  }
+
+  /**
+   * @brief finishes a frame trySendMessage could only write in part
+   * @note expects the send lock of sock to be held
+   */
+  static bool writeUnsent(int sock, LaneLock &sendLock) {
+    auto &unsent = sendLock.getUnsent();
+    if (unsent.empty()) return true;
+    auto written = writeFrame(sock, (const uint8_t *) unsent.data(), unsent.size());
+    unsent.clear();
+    return written;
+  }
+
+  /**
+   * @note expects the send lock of sock to be held
+   */
+  static bool writeFrame(int sock, const uint8_t *data, size_t size) {
+    size_t totalSent = 0;
+    while (totalSent < size) {
+      auto numBytesSent = send(sock, data + totalSent, size - totalSent, MSG_NOSIGNAL);
+      if (numBytesSent < 0 && errno == EINTR) continue;
+      if (numBytesSent <= 0) return false;
+      totalSent += numBytesSent;
+    }
+    return true;
+  }
+
+  /**
+   * @brief sends msg unless the socket is busy, for the heartbeat thread which must never block on one client
+   */
+  bool trySendMessage(int sock, const Message::Ptr &msg) {
+    auto capabilities = getCapabilities(sock);
+    auto encrypted = MessageFactory::create<EncryptedMessage>(adaptMessage(msg, capabilities), fServerLogin, fServerPassword,
+                                                              ConnectOptions::toWireFormat(capabilities));
+    auto data = encrypted->getBuffer().getDataPtr();
+    auto size = encrypted->getBuffer().getSize();
+    auto sendLock = getSendLock(sock);
+    if (!sendLock->tryLock(Lane::Interactive)) return false;
+    auto &unsent = sendLock->getUnsent();
+    // what is left of the previous frame goes first, the socket is still busy while some of it is
+    if (!unsent.empty()) {
+      auto sent = trySend(sock, (const uint8_t *) unsent.data(), unsent.size());
+      if (sent > 0) unsent.erase(0, sent);
+    }
+    ssize_t sent = -1;
+    if (unsent.empty()) sent = trySend(sock, data, size);
+    // once a part is out the rest has to follow, or the stream would be corrupt, the next sender writes it
+    if (sent > 0 && (size_t) sent < size) unsent.assign((const char *) data + sent, size - sent);
+    sendLock->unlock();
+    return sent > 0;
+  }
+
+  /**
+   * @return bytes written without waiting for the socket, -1 if it is full or broken
+   */
+  static ssize_t trySend(int sock, const uint8_t *data, size_t size) {
+    ssize_t sent;
+    do {
+      sent = send(sock, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (sent < 0 && errno == EINTR);
+    return sent;
+  }
+
+  bool sendMessage(int sock, const Message::Ptr &msg) {
+    auto capabilities = getCapabilities(sock);
+    auto encrypted = MessageFactory::create<EncryptedMessage>(adaptMessage(msg, capabilities), fServerLogin, fServerPassword,
+                                                              ConnectOptions::toWireFormat(capabilities));
+    return sendFrame(sock, encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+  }
+
+  int getSlaveSocket(const std::string &clientId) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto item = fSlaveSocketPool.find(clientId);
+    if (item == fSlaveSocketPool.end()) return -1;
+    return item->second;
+  }
+
+  Endpoint getMasterEndpoint(const std::string &clientId) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto item = fMasterSocketPool.find(clientId);
+    if (item == fMasterSocketPool.end()) return {};
     return item->second;
   }
 
   bool connectMessageHandler(const std::string &client, int clientSock, const std::shared_ptr<Message> &parseResult, std::shared_ptr<ConnectionType> &connectionType) {
     auto connectMessage = parseResult->cast<ConnectMessage>();
-    auto clientId = connectMessage.getConnectOptions().getClientId();
-    switch (connectMessage.getConnectOptions().getConnectionType()) {
+    auto &options = connectMessage.getConnectOptions();
+    // the client reads both formats from now on, it switches itself once it got the reply
+    auto capabilities = negotiate(options);
+    if (capabilities != 0) setCapabilities(clientSock, capabilities);
+    if (options.getConnectionType() == ConnectionType::TypeMux) {
+      DINFO("client %s registered as multiplexer, id %s", client.c_str(), options.getClientId().c_str());
+    } else if (!attachClient(client, {clientSock, 0, nullptr, capabilities}, options.getClientId(), options.getConnectionType(), options.isResume())) {
+      return false;
+    }
+    connectionType = std::make_shared<ConnectionType>(options.getConnectionType());
+    // clients older than capabilities do not expect a reply
+    if (options.getProtocolVersion() > 0) return sendMessage(clientSock, makeHandshakeReply(capabilities));
+    return true;
+  }
+
+  /**
+   * @brief registers the client and replays the scrollback of the session to a master
+   */
+  bool attachClient(const std::string &client, const Endpoint &endpoint, const std::string &clientId, ConnectionType type, bool resume) {
+    // the scrollback lock keeps slave output from reaching the master before the replay
+    ScrollbackBuffer::Ptr scrollback;
+    std::unique_lock<std::mutex> scrollbackLock;
+    if (type == ConnectionType::TypeMaster)
+      scrollback = fScrollback->find(clientId);
+    if (scrollback)
+      scrollbackLock = std::unique_lock<std::mutex>(scrollback->getMutex());
+    if (!registerClient(client, endpoint, clientId, type, resume))
+      return false;
+    if (!scrollback || scrollback->size() == 0) return true;
+    DINFO("replaying %zu bytes of scrollback to master %s", scrollback->size(), clientId.c_str());
+    // frames are converted one by one for a master which lacks a capability they may need
+    if (endpoint.channel != 0 || (endpoint.capabilities & FRAME_CAPABILITIES) != FRAME_CAPABILITIES) {
+      bool sent = true;
+      scrollback->forEachFrame([&](const uint8_t *data, size_t size) {
+        if (endpoint.window) endpoint.window->consume(size);
+        sent = sent && sendToMaster(endpoint, data, size);
+      });
+      return sent;
+    }
+    auto sendLock = getSendLock(endpoint.socket);
+    LaneLock::Guard lock(*sendLock, Lane::Bulk);
+    return writeUnsent(endpoint.socket, *sendLock) && scrollback->replay(endpoint.socket);
+  }
+
+  bool registerClient(const std::string &client, const Endpoint &endpoint, const std::string &clientId, ConnectionType type, bool resume) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    // a resuming client replaces its previous connection, which may not have timed out yet
+    if (resume && type == ConnectionType::TypeSlave) {
+      auto item = fSlaveSocketPool.find(clientId);
+      if (item != fSlaveSocketPool.end()) {
+        DWARN("client %s resumes %s, dropping its previous connection", client.c_str(), clientId.c_str());
+        shutdown(item->second, SHUT_RDWR);
+        fSlaveSocketPool.erase(item);
+      }
+    }
+    if (resume && type == ConnectionType::TypeMaster) {
+      auto item = fMasterSocketPool.find(clientId);
+      if (item != fMasterSocketPool.end()) {
+        DWARN("client %s resumes %s, dropping its previous connection", client.c_str(), clientId.c_str());
+        // other channels share the connection, only the channel itself is dropped
+        if (item->second.channel == 0) shutdown(item->second.socket, SHUT_RDWR);
+        if (item->second.window) item->second.window->close();
+        fMasterSocketPool.erase(item);
+      }
+    }
+    switch (type) {
       case ConnectionType::TypeSlave:
         if (fSlaveSocketPool.find(clientId) != fSlaveSocketPool.end()) {
-          DERROR("client %s requested slave connection for %s, but there is slave already");
+          DERROR("client %s requested slave connection for %s, but there is slave already", client.c_str(), clientId.c_str());
           return false;
         }
         DINFO("client %s registered as slave, id %s", client.c_str(), clientId.c_str());
-        fSlaveSocketPool[clientId] = clientSock;
+        fSlaveSocketPool[clientId] = endpoint.socket;
+        fScrollback->acquire(clientId);
         break;
       case ConnectionType::TypeMaster:
         if (fMasterSocketPool.find(clientId) != fMasterSocketPool.end()) {
-          DERROR("client %s requested master connection for %s, but there is master already");
+          DERROR("client %s requested master connection for %s, but there is master already", client.c_str(), clientId.c_str());
           return false;
         }
-        DINFO("client %s registered as master, id %s", client.c_str(), clientId.c_str());
-        fMasterSocketPool[clientId] = clientSock;
+        DINFO("client %s registered as master, id %s%s", client.c_str(), clientId.c_str(),
+              fSlaveSocketPool.find(clientId) != fSlaveSocketPool.end() ? ", attaching to running session" : "");
+        fMasterSocketPool[clientId] = endpoint;
+        break;
+      case ConnectionType::TypeController:
+        DINFO("client %s registered as controller, id %s", client.c_str(), clientId.c_str());
         break;
+      default:
+        DERROR("client %s requested unknown connection type", client.c_str());
+        return false;
     }
-    connectionType = std::make_shared<ConnectionType>(connectMessage.getConnectOptions().getConnectionType());
     return true;
   }
 
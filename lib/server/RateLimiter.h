@@ -0,0 +1,204 @@
+#ifndef TERMINUS_RATELIMITER_H
+#define TERMINUS_RATELIMITER_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief bytes a session may relay, refilled at a fixed rate up to a burst
+ * @note a frame is let through as long as the bucket is not in debt, the overshoot is paid back before the next read
+ */
+class TokenBucket {
+public:
+  using Ptr = std::shared_ptr<TokenBucket>;
+  using Clock = std::chrono::steady_clock;
+private:
+  double fRate;
+  double fBurst;
+  double fTokens;
+  Clock::time_point fUpdated;
+  mutable std::mutex fMutex;
+public:
+  /**
+   * @param rate bytes per second
+   */
+  TokenBucket(uint64_t rate, uint64_t burst, Clock::time_point now = Clock::now()) :
+    fRate((double) std::max<uint64_t>(rate, 1)), fBurst((double) burst), fTokens((double) burst), fUpdated(now) {
+  }
+
+  void consume(size_t size, Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    refill(now);
+    fTokens -= (double) size;
+  }
+
+  /**
+   * @return true if the bucket refilled up to the burst, it is as good as a new one then
+   */
+  bool isFull(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    refill(now);
+    return fTokens >= fBurst;
+  }
+
+  /**
+   * @return how long until the debt is paid back, zero if there is none
+   */
+  Clock::duration getDelay(Clock::time_point now = Clock::now()) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    refill(now);
+    if (fTokens >= 0) return Clock::duration::zero();
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-fTokens / fRate)) +
+           Clock::duration(1);
+  }
+
+private:
+
+  void refill(Clock::time_point now) {
+    if (now <= fUpdated) return;
+    fTokens = std::min(fBurst, fTokens + fRate * std::chrono::duration<double>(now - fUpdated).count());
+    fUpdated = now;
+  }
+};
+
+/**
+ * @brief configured limits for relaying slave output, per session and shared by all sessions with an id prefix
+ */
+class RateLimiter {
+public:
+  static const uint64_t DEFAULT_BURST = 64 * 1024;
+
+  struct Stats {
+    uint64_t pauses = 0;
+    std::chrono::microseconds paused{0};
+  };
+
+  /**
+   * @brief the buckets one session draws from
+   * @note not thread safe, used by the thread reading the slave
+   */
+  class Shaper {
+  private:
+    std::vector<TokenBucket::Ptr> fBuckets;
+    Stats fStats;
+  public:
+    explicit Shaper(std::vector<TokenBucket::Ptr> buckets) : fBuckets(std::move(buckets)) {
+    }
+
+    const Stats &getStats() const {
+      return fStats;
+    }
+
+    void consume(size_t size) {
+      auto now = TokenBucket::Clock::now();
+      for (auto &bucket : fBuckets)
+        bucket->consume(size, now);
+    }
+
+    /**
+     * @brief pauses until no bucket is in debt, the socket is not read meanwhile so the slave is held back by tcp
+     * @param maxPause longest pause, heartbeat replies of the slave wait behind its output and it is dropped if
+     * they wait too long. The debt left is paid by the next pause
+     * @return true if it paused
+     */
+    bool throttle(TokenBucket::Clock::duration maxPause = TokenBucket::Clock::duration::max()) {
+      auto start = TokenBucket::Clock::now();
+      auto now = start;
+      auto delay = getDelay(start);
+      if (delay == TokenBucket::Clock::duration::zero()) return false;
+      // a shared bucket may have been drained again by another session meanwhile
+      for (; delay > TokenBucket::Clock::duration::zero() && now - start < maxPause; delay = getDelay(now)) {
+        std::this_thread::sleep_for(std::min(delay, maxPause - (now - start)));
+        now = TokenBucket::Clock::now();
+      }
+      fStats.pauses++;
+      fStats.paused += std::chrono::duration_cast<std::chrono::microseconds>(TokenBucket::Clock::now() - start);
+      return true;
+    }
+
+  private:
+
+    TokenBucket::Clock::duration getDelay(TokenBucket::Clock::time_point now) {
+      auto delay = TokenBucket::Clock::duration::zero();
+      for (auto &bucket : fBuckets)
+        delay = std::max(delay, bucket->getDelay(now));
+      return delay;
+    }
+  };
+private:
+  uint64_t fSessionRate = 0;
+  uint64_t fBurst = DEFAULT_BURST;
+  std::map<std::string, TokenBucket::Ptr> fPrefixBuckets;
+  /*! by client id, so a slave which reconnects keeps its debt */
+  std::map<std::string, TokenBucket::Ptr> fSessionBuckets;
+  std::mutex fMutex;
+public:
+
+  /**
+   * @param rate bytes per second each session may relay, 0 for no limit
+   */
+  void setSessionRate(uint64_t rate) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fSessionRate = rate;
+  }
+
+  /**
+   * @brief bytes relayed at once after a session was idle, applies to buckets created afterwards
+   */
+  void setBurst(uint64_t burst) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fBurst = burst;
+  }
+
+  /**
+   * @param rate bytes per second shared by all sessions whose id starts with prefix, the longest prefix applies
+   */
+  void addPrefixRate(const std::string &prefix, uint64_t rate) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPrefixBuckets[prefix] = std::make_shared<TokenBucket>(rate, fBurst);
+  }
+
+  /**
+   * @return nullptr if no limit applies to the session
+   */
+  std::shared_ptr<Shaper> makeShaper(const std::string &clientId) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    std::vector<TokenBucket::Ptr> buckets;
+    if (fSessionRate > 0) buckets.push_back(getSessionBucket(clientId));
+    TokenBucket::Ptr prefixBucket;
+    size_t prefixSize = 0;
+    for (auto &item : fPrefixBuckets) {
+      if (clientId.compare(0, item.first.size(), item.first) != 0 || (prefixBucket && item.first.size() < prefixSize)) continue;
+      prefixBucket = item.second;
+      prefixSize = item.first.size();
+    }
+    if (prefixBucket) buckets.push_back(prefixBucket);
+    if (buckets.empty()) return nullptr;
+    return std::make_shared<Shaper>(buckets);
+  }
+
+private:
+
+  /**
+   * @note expects fMutex to be held
+   */
+  TokenBucket::Ptr getSessionBucket(const std::string &clientId) {
+    auto now = TokenBucket::Clock::now();
+    // buckets of sessions gone for long enough to refill are forgotten
+    for (auto item = fSessionBuckets.begin(); item != fSessionBuckets.end();) {
+      if (item->second.use_count() == 1 && item->second->isFull(now)) item = fSessionBuckets.erase(item);
+      else ++item;
+    }
+    auto &bucket = fSessionBuckets[clientId];
+    if (!bucket) bucket = std::make_shared<TokenBucket>(fSessionRate, fBurst, now);
+    return bucket;
+  }
+};
+
+#endif //TERMINUS_RATELIMITER_H
@@ -0,0 +1,193 @@
+#ifndef TERMINUS_SCROLLBACK_H
+#define TERMINUS_SCROLLBACK_H
+
+#include <map>
+#include <deque>
+#include <string>
+#include <algorithm>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cerrno>
+#include <sys/uio.h>
+
+/**
+ * @brief fixed size ring holding the latest frames a slave sent
+ * @note only whole frames are kept, the oldest frames are dropped to make room for new ones
+ */
+class ScrollbackBuffer {
+public:
+  using Ptr = std::shared_ptr<ScrollbackBuffer>;
+private:
+  std::vector<uint8_t> fData;
+  std::deque<size_t> fFrames;
+  size_t fHead = 0;
+  size_t fSize = 0;
+  std::mutex fMutex;
+public:
+  explicit ScrollbackBuffer(size_t capacity) : fData(capacity) {
+  }
+
+  size_t capacity() const {
+    return fData.size();
+  }
+
+  size_t size() const {
+    return fSize;
+  }
+
+  size_t frames() const {
+    return fFrames.size();
+  }
+
+  /**
+   * @brief guards the buffer together with whatever the caller relays while holding it
+   */
+  std::mutex &getMutex() {
+    return fMutex;
+  }
+
+  /**
+   * @return false if the frame does not fit into the buffer at all
+   */
+  bool append(const uint8_t *data, size_t len) {
+    if (len == 0) return true;
+    if (len > fData.size()) {
+      clear();
+      return false;
+    }
+    while (fSize + len > fData.size()) {
+      fHead = (fHead + fFrames.front()) % fData.size();
+      fSize -= fFrames.front();
+      fFrames.pop_front();
+    }
+    auto tail = (fHead + fSize) % fData.size();
+    auto first = std::min(len, fData.size() - tail);
+    std::copy(data, data + first, fData.begin() + (long) tail);
+    std::copy(data + first, data + len, fData.begin());
+    fSize += len;
+    fFrames.push_back(len);
+    return true;
+  }
+
+  void clear() {
+    fFrames.clear();
+    fHead = 0;
+    fSize = 0;
+  }
+
+  /**
+   * @brief describes the buffered bytes in order, a wrapped ring takes two entries
+   * @return number of entries filled
+   */
+  int getIoVec(iovec iov[2]) {
+    if (fSize == 0) return 0;
+    auto first = std::min(fSize, fData.size() - fHead);
+    iov[0].iov_base = fData.data() + fHead;
+    iov[0].iov_len = first;
+    if (first == fSize) return 1;
+    iov[1].iov_base = fData.data();
+    iov[1].iov_len = fSize - first;
+    return 2;
+  }
+
+  /**
+   * @brief calls handler for every buffered frame in order, frames split by the end of the ring are joined
+   */
+  template<typename Handler>
+  void forEachFrame(Handler handler) const {
+    std::vector<uint8_t> joined;
+    auto offset = fHead;
+    for (auto len : fFrames) {
+      if (offset + len <= fData.size()) {
+        handler(fData.data() + offset, len);
+      } else {
+        joined.assign(fData.begin() + (long) offset, fData.end());
+        joined.insert(joined.end(), fData.begin(), fData.begin() + (long) (offset + len - fData.size()));
+        handler(joined.data(), len);
+      }
+      offset = (offset + len) % fData.size();
+    }
+  }
+
+  /**
+   * @brief writes all buffered frames to sock, a single writev unless the socket accepts less
+   */
+  bool replay(int sock) {
+    iovec iov[2]{};
+    int count = getIoVec(iov);
+    iovec *current = iov;
+    while (count > 0) {
+      auto written = writev(sock, current, count);
+      if (written < 0 && errno == EINTR) continue;
+      if (written <= 0) return false;
+      while (count > 0 && (size_t) written >= current->iov_len) {
+        written -= (ssize_t) current->iov_len;
+        current++;
+        count--;
+      }
+      if (count > 0) {
+        current->iov_base = (uint8_t *) current->iov_base + written;
+        current->iov_len -= written;
+      }
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief hands out per session scrollback buffers within a global memory limit
+ * @note a session created while the limit is exhausted gets a smaller or no buffer
+ */
+class ScrollbackStore {
+public:
+  static constexpr size_t DEFAULT_SESSION_SIZE = 64 * 1024;
+  static constexpr size_t DEFAULT_TOTAL_SIZE = 64 * 1024 * 1024;
+private:
+  size_t fSessionSize;
+  size_t fTotalSize;
+  size_t fReserved = 0;
+  std::map<std::string, ScrollbackBuffer::Ptr> fBuffers;
+  mutable std::mutex fMutex;
+public:
+  explicit ScrollbackStore(size_t sessionSize = DEFAULT_SESSION_SIZE, size_t totalSize = DEFAULT_TOTAL_SIZE) :
+    fSessionSize(sessionSize), fTotalSize(totalSize) {
+  }
+
+  /**
+   * @return buffer of the session, created on first use, nullptr if scrollback is disabled or memory is exhausted
+   */
+  ScrollbackBuffer::Ptr acquire(const std::string &sessionId) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto item = fBuffers.find(sessionId);
+    if (item != fBuffers.end()) return item->second;
+    auto capacity = std::min(fSessionSize, fTotalSize - fReserved);
+    if (capacity == 0) return nullptr;
+    fReserved += capacity;
+    auto buffer = std::make_shared<ScrollbackBuffer>(capacity);
+    fBuffers[sessionId] = buffer;
+    return buffer;
+  }
+
+  ScrollbackBuffer::Ptr find(const std::string &sessionId) const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto item = fBuffers.find(sessionId);
+    return item == fBuffers.end() ? nullptr : item->second;
+  }
+
+  void release(const std::string &sessionId) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto item = fBuffers.find(sessionId);
+    if (item == fBuffers.end()) return;
+    fReserved -= item->second->capacity();
+    fBuffers.erase(item);
+  }
+
+  size_t reserved() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fReserved;
+  }
+};
+
+
+#endif //TERMINUS_SCROLLBACK_H
@@ -0,0 +1,94 @@
+#ifndef TERMINUS_SERVERMETRICS_H
+#define TERMINUS_SERVERMETRICS_H
+
+#include <chrono>
+
+#include <metrics/Metrics.h>
+#include <message/ConnectMessage.h>
+#include <transport/LaneLock.h>
+
+/**
+ * @brief metrics the server updates while relaying, created once so the hot path never touches the registry
+ */
+class ServerMetrics {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Direction {
+    ToMaster = 0,
+    ToSlave = 1,
+  };
+private:
+  MetricRegistry::Ptr fRegistry;
+public:
+  Counter::Ptr accepted;
+  Counter::Ptr acceptErrors;
+  Gauge::Ptr connections;
+  Gauge::Ptr slaves;
+  Gauge::Ptr masters;
+  Gauge::Ptr controllers;
+  Gauge::Ptr muxes;
+  Counter::Ptr receivedBytes;
+  Counter::Ptr receivedFrames;
+  Counter::Ptr relayedBytes[2];
+  Counter::Ptr relayedFrames[2];
+  Histogram::Ptr relayLatency[2];
+  Histogram::Ptr sendWait[LaneLock::LANE_COUNT];
+  Histogram::Ptr roundTrips;
+  Counter::Ptr rateLimitPauses;
+  Counter::Ptr evictions;
+
+  explicit ServerMetrics(MetricRegistry::Ptr registry) : fRegistry(std::move(registry)) {
+    accepted = fRegistry->counter("terminus_connections_accepted_total", "Connections accepted over tcp and udp");
+    acceptErrors = fRegistry->counter("terminus_accept_errors_total", "Failed accept calls");
+    connections = fRegistry->gauge("terminus_connections", "Open client connections");
+    auto sessions = "terminus_sessions";
+    auto sessionsHelp = "Connections which connected, by type";
+    slaves = fRegistry->gauge(sessions, sessionsHelp, "type=\"slave\"");
+    masters = fRegistry->gauge(sessions, sessionsHelp, "type=\"master\"");
+    controllers = fRegistry->gauge(sessions, sessionsHelp, "type=\"controller\"");
+    muxes = fRegistry->gauge(sessions, sessionsHelp, "type=\"mux\"");
+    receivedBytes = fRegistry->counter("terminus_received_bytes_total", "Bytes read from clients");
+    receivedFrames = fRegistry->counter("terminus_received_frames_total", "Frames read from clients");
+    for (auto direction : {Direction::ToMaster, Direction::ToSlave}) {
+      auto labels = direction == Direction::ToMaster ? "direction=\"to_master\"" : "direction=\"to_slave\"";
+      relayedBytes[(int) direction] = fRegistry->counter("terminus_relayed_bytes_total", "Session bytes passed on", labels);
+      relayedFrames[(int) direction] = fRegistry->counter("terminus_relayed_frames_total", "Session frames passed on", labels);
+      relayLatency[(int) direction] = fRegistry->histogram("terminus_relay_seconds",
+                                                           "Time from reading a session frame until it was written", labels);
+    }
+    for (auto lane : {Lane::Interactive, Lane::Bulk}) {
+      sendWait[(int) lane] = fRegistry->histogram("terminus_send_wait_seconds", "Time frames waited for their socket",
+                                                  lane == Lane::Interactive ? "lane=\"interactive\"" : "lane=\"bulk\"");
+    }
+    roundTrips = fRegistry->histogram("terminus_heartbeat_rtt_seconds", "Round trips of heartbeats");
+    rateLimitPauses = fRegistry->counter("terminus_rate_limit_pauses_total", "Times a slave over its limit was not read");
+    evictions = fRegistry->counter("terminus_evictions_total", "Connections dropped for missing heartbeats or idling");
+  }
+
+  const MetricRegistry::Ptr &getRegistry() const {
+    return fRegistry;
+  }
+
+  const Gauge::Ptr &getSessions(ConnectionType type) const {
+    switch (type) {
+      case ConnectionType::TypeSlave:
+        return slaves;
+      case ConnectionType::TypeMaster:
+        return masters;
+      case ConnectionType::TypeController:
+        return controllers;
+      case ConnectionType::TypeMux:
+        break;
+    }
+    return muxes;
+  }
+
+  void relayed(Direction direction, size_t size, Clock::time_point start) {
+    relayedBytes[(int) direction]->add(size);
+    relayedFrames[(int) direction]->add();
+    relayLatency[(int) direction]->record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+  }
+};
+
+#endif //TERMINUS_SERVERMETRICS_H
@@ -60,6 +60,13 @@ public:
     fInputHandler = std::bind(handler, obj, std::placeholders::_1);
   }
 
+  /**
+   * @note the handler is also called once with the initial size, set it before setup()
+   */
+  void setupWindowSizeHandler(const WindowSizeHandler &windowSizeHandler) {
+    fWindowSizeHandler = windowSizeHandler;
+  }
+
   template<class Base>
   void setupInputHandler(void(Base::*handler)(int, int), const Base *obj) {
     fWindowSizeHandler = std::bind(handler, obj, std::placeholders::_1);
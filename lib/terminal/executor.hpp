@@ -0,0 +1,312 @@
+#ifndef TERMINUS_EXECUTOR_HPP
+#define TERMINUS_EXECUTOR_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <pty.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <csignal>
+#include <wait.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/**
+ * @brief runs shell commands concurrently on a single event loop thread
+ * @note output and exit handlers are called from the event loop thread
+ */
+class CommandExecutor {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Result {
+    /*! raw status as returned by waitpid */
+    int status = -1;
+    bool timedOut = false;
+    std::chrono::milliseconds elapsed = {};
+
+    bool exited() const {
+      return status != -1 && WIFEXITED(status);
+    }
+
+    int exitCode() const {
+      return exited() ? WEXITSTATUS(status) : -1;
+    }
+  };
+
+  using OutputHandler = std::function<void(uint32_t, const std::string &)>;
+  using ExitHandler = std::function<void(uint32_t, const Result &)>;
+private:
+  static constexpr int READ_BUFFER_SIZE = 4096;
+  static constexpr int REAP_INTERVAL_MS = 10;
+
+  struct Handlers {
+    OutputHandler onOutput;
+    ExitHandler onExit;
+  };
+
+  struct Command {
+    pid_t pid = -1;
+    int fd = -1;
+    int pidFd = -1;
+    bool reaped = false;
+    bool cancelled = false;
+    Result result;
+    Clock::time_point start;
+    Clock::time_point deadline = Clock::time_point::max();
+    std::shared_ptr<const Handlers> handlers;
+  };
+
+  struct Event {
+    uint32_t id;
+    std::shared_ptr<const Handlers> handlers;
+    std::string output;
+    bool finished;
+    Result result;
+  };
+private:
+  std::map<uint32_t, Command> fCommands;
+  mutable std::mutex fMutex;
+  std::thread fLoopThread;
+  int fWakeupPipe[2] = {-1, -1};
+  uint32_t fNextId = 1;
+  bool fStop = false;
+public:
+  CommandExecutor() {
+    if (pipe2(fWakeupPipe, O_NONBLOCK | O_CLOEXEC) == 0)
+      fLoopThread = std::thread(&CommandExecutor::loop, this);
+  }
+
+  ~CommandExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+    }
+    wakeup();
+    if (fLoopThread.joinable()) fLoopThread.join();
+    for (auto &item : fCommands) {
+      kill(-item.second.pid, SIGKILL);
+      closeCommand(item.second);
+      if (!item.second.reaped) waitpid(item.second.pid, nullptr, 0);
+    }
+    close(fWakeupPipe[0]);
+    close(fWakeupPipe[1]);
+  }
+
+  /**
+   * @brief starts cmd in its own pty
+   * @param timeout command is killed after this time, zero runs it until it exits
+   * @return command id, 0 if the command could not be started
+   */
+  uint32_t submit(const std::string &cmd, const OutputHandler &onOutput, const ExitHandler &onExit,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+    if (!fLoopThread.joinable()) return 0;
+    Command command;
+    command.pid = forkpty(&command.fd, nullptr, nullptr, nullptr);
+    if (command.pid < 0)
+      return 0;
+    if (command.pid == 0) {
+      execl("/bin/sh", "sh", "-c", cmd.c_str(), nullptr);
+      _exit(127);
+    }
+    fcntl(command.fd, F_SETFL, fcntl(command.fd, F_GETFL) | O_NONBLOCK);
+    fcntl(command.fd, F_SETFD, FD_CLOEXEC);
+    command.pidFd = openPidFd(command.pid);
+    command.start = Clock::now();
+    if (timeout.count() > 0) command.deadline = command.start + timeout;
+    command.handlers = std::make_shared<const Handlers>(Handlers{onOutput, onExit});
+
+    uint32_t id;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      id = fNextId++;
+      if (fNextId == 0) fNextId = 1;
+      fCommands[id] = command;
+    }
+    wakeup();
+    return id;
+  }
+
+  bool cancel(uint32_t id) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto item = fCommands.find(id);
+    if (item == fCommands.end()) return false;
+    item->second.cancelled = true;
+    if (!item->second.reaped) kill(-item->second.pid, SIGKILL);
+    wakeup();
+    return true;
+  }
+
+  size_t running() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fCommands.size();
+  }
+
+  /**
+   * @brief runs cmd and blocks until it finishes
+   * @param timeout as for submit, none by default
+   * @return raw wait status and collected output
+   */
+  static std::pair<int, std::string> execute(const std::string &cmd,
+                                             std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+    CommandExecutor executor;
+    std::string output;
+    std::promise<Result> done;
+    auto id = executor.submit(cmd,
+                              [&](uint32_t, const std::string &chunk) { output += chunk; },
+                              [&](uint32_t, const Result &result) { done.set_value(result); },
+                              timeout);
+    if (id == 0) return {};
+    auto result = done.get_future().get();
+    return std::make_pair(result.status, output);
+  }
+
+private:
+
+  static int openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int) syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void) pid;
+    return -1;
+#endif
+  }
+
+  void wakeup() const {
+    char c = 0;
+    (void) ::write(fWakeupPipe[1], &c, 1);
+  }
+
+  static void closeCommand(Command &command) {
+    if (command.fd != -1) close(command.fd);
+    if (command.pidFd != -1) close(command.pidFd);
+    command.fd = -1;
+    command.pidFd = -1;
+  }
+
+  static void readOutput(uint32_t id, Command &command, std::vector<Event> &events) {
+    char buf[READ_BUFFER_SIZE];
+    while (command.fd != -1) {
+      auto numBytes = ::read(command.fd, buf, sizeof(buf));
+      if (numBytes > 0) {
+        events.push_back({id, command.handlers, std::string(buf, numBytes), false, {}});
+        continue;
+      }
+      if (numBytes < 0 && errno == EINTR) continue;
+      if (numBytes < 0 && errno == EAGAIN) return;
+      // EIO once every process holding the pty has exited
+      close(command.fd);
+      command.fd = -1;
+    }
+  }
+
+  static void reap(Command &command) {
+    if (command.reaped) return;
+    int status;
+    if (waitpid(command.pid, &status, WNOHANG) != command.pid) return;
+    command.reaped = true;
+    command.result.status = status;
+  }
+
+  int collectPollFds(std::vector<pollfd> &pfds, std::vector<uint32_t> &ids) {
+    int timeout = -1;
+    pfds.clear();
+    ids.clear();
+    pfds.push_back({fWakeupPipe[0], POLLIN, 0});
+    ids.push_back(0);
+    auto now = Clock::now();
+    for (auto &item : fCommands) {
+      auto &command = item.second;
+      if (command.fd != -1) {
+        pfds.push_back({command.fd, POLLIN, 0});
+        ids.push_back(item.first);
+      }
+      if (command.pidFd != -1) {
+        pfds.push_back({command.pidFd, POLLIN, 0});
+        ids.push_back(item.first);
+      } else {
+        timeout = updateTimeout(timeout, REAP_INTERVAL_MS);
+      }
+      if (command.deadline != Clock::time_point::max() && !command.result.timedOut) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(command.deadline - now).count();
+        timeout = updateTimeout(timeout, (int) std::max<long>(0, left + 1));
+      }
+    }
+    return timeout;
+  }
+
+  void loop() {
+    std::vector<pollfd> pfds;
+    std::vector<uint32_t> ids;
+    std::vector<Event> events;
+    while (true) {
+      int timeout;
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fStop) return;
+        timeout = collectPollFds(pfds, ids);
+      }
+
+      int ret = poll(pfds.data(), pfds.size(), timeout);
+      if (ret < 0 && errno != EINTR) return;
+
+      if (pfds[0].revents) {
+        char buf[64];
+        while (::read(fWakeupPipe[0], buf, sizeof(buf)) > 0);
+      }
+
+      events.clear();
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto now = Clock::now();
+        for (size_t i = 1; i < pfds.size(); i++) {
+          if (!pfds[i].revents) continue;
+          auto item = fCommands.find(ids[i]);
+          if (item == fCommands.end()) continue;
+          readOutput(item->first, item->second, events);
+          reap(item->second);
+        }
+        for (auto it = fCommands.begin(); it != fCommands.end();) {
+          auto &command = it->second;
+          if (command.pidFd == -1) reap(command);
+          if (!command.reaped && !command.result.timedOut && now >= command.deadline) {
+            command.result.timedOut = true;
+            kill(-command.pid, SIGKILL);
+          }
+          if (!command.reaped) {
+            ++it;
+            continue;
+          }
+          // drain whatever the command printed before it exited
+          readOutput(it->first, command, events);
+          closeCommand(command);
+          command.result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - command.start);
+          events.push_back({it->first, command.handlers, {}, true, command.result});
+          it = fCommands.erase(it);
+        }
+      }
+      dispatch(events);
+    }
+  }
+
+  static void dispatch(const std::vector<Event> &events) {
+    for (auto &event : events) {
+      if (!event.finished && event.handlers->onOutput)
+        event.handlers->onOutput(event.id, event.output);
+      else if (event.finished && event.handlers->onExit)
+        event.handlers->onExit(event.id, event.result);
+    }
+  }
+
+  static int updateTimeout(int timeout, int candidate) {
+    return timeout < 0 ? candidate : std::min(timeout, candidate);
+  }
+};
+
+#endif //TERMINUS_EXECUTOR_HPP
@@ -0,0 +1,938 @@
+#ifndef TERMINUS_SCREEN_HPP
+#define TERMINUS_SCREEN_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * @brief what a terminal shows, built by interpreting the escape sequences of pty output
+ * @note covers what shells, pagers and full screen programs such as top or vim use, lines scrolled off the top
+ * are not kept, not thread safe
+ */
+class Screen {
+public:
+  static constexpr uint32_t DEFAULT_COLOR = 0xFFFFFFFF;
+  /*! marks 24 bit colors, palette colors are 0 to 255 */
+  static constexpr uint32_t RGB_COLOR = 0x1000000;
+  static constexpr int TAB_WIDTH = 8;
+  static constexpr size_t MAX_SEQUENCE_SIZE = 4096;
+
+  enum Flags : uint16_t {
+    Bold = 0x01,
+    Dim = 0x02,
+    Italic = 0x04,
+    Underline = 0x08,
+    Blink = 0x10,
+    Inverse = 0x20,
+    Hidden = 0x40,
+    Strike = 0x80
+  };
+
+  struct Attributes {
+    uint32_t fg = DEFAULT_COLOR;
+    uint32_t bg = DEFAULT_COLOR;
+    uint16_t flags = 0;
+
+    bool operator==(const Attributes &other) const {
+      return fg == other.fg && bg == other.bg && flags == other.flags;
+    }
+
+    bool operator!=(const Attributes &other) const {
+      return !(*this == other);
+    }
+  };
+
+  struct Cell {
+    /*! utf-8 character including combining marks, empty for the right half of a wide character */
+    std::string glyph = " ";
+    Attributes attributes;
+
+    bool operator==(const Cell &other) const {
+      return glyph == other.glyph && attributes == other.attributes;
+    }
+
+    bool operator!=(const Cell &other) const {
+      return !(*this == other);
+    }
+
+    bool blank() const {
+      return glyph == " " && attributes == Attributes();
+    }
+  };
+
+  using Row = std::vector<Cell>;
+
+  /**
+   * @brief private modes that change what the terminal sends rather than what it shows,
+   * the terminal of a master has to be switched along
+   */
+  static const std::vector<int> &forwardedModes() {
+    static const std::vector<int> modes = {1, 1000, 1002, 1003, 1005, 1006, 2004};
+    return modes;
+  }
+
+private:
+  enum class State {
+    Ground,
+    Escape,
+    Csi,
+    Osc,
+    OscEscape,
+    Charset,
+    Ignore,
+    String,
+    StringEscape,
+    Alignment
+  };
+
+  struct SavedCursor {
+    int x = 0;
+    int y = 0;
+    Attributes attributes;
+    bool lineDrawing[2] = {false, false};
+    bool originMode = false;
+  };
+
+private:
+  int fWidth;
+  int fHeight;
+  std::vector<Row> fPrimary;
+  std::vector<Row> fAlternate;
+  bool fAlternateActive = false;
+  int fX = 0;
+  int fY = 0;
+  bool fWrapPending = false;
+  Attributes fAttributes;
+  SavedCursor fSaved;
+  SavedCursor fSavedPrimary;
+  int fTop = 0;
+  int fBottom;
+  bool fAutoWrap = true;
+  bool fOriginMode = false;
+  bool fInsertMode = false;
+  bool fCursorVisible = true;
+  bool fKeypadMode = false;
+  bool fLineDrawing[2] = {false, false};
+  int fCharset = 0;
+  int fDesignating = 0;
+  std::map<int, bool> fModes;
+  std::string fTitle;
+  std::string fReplies;
+  std::string fLastGlyph;
+
+  State fState = State::Ground;
+  std::string fSequence;
+  char fPrivate = 0;
+  std::string fIntermediate;
+  std::string fUtf8;
+  size_t fUtf8Expected = 0;
+public:
+  Screen(int width, int height) : fWidth(std::max(width, 1)), fHeight(std::max(height, 1)), fBottom(fHeight - 1) {
+    fPrimary.assign(fHeight, Row(fWidth));
+    fAlternate.assign(fHeight, Row(fWidth));
+  }
+
+  int width() const {
+    return fWidth;
+  }
+
+  int height() const {
+    return fHeight;
+  }
+
+  const Row &row(int y) const {
+    return rows()[y];
+  }
+
+  int cursorX() const {
+    return fX;
+  }
+
+  int cursorY() const {
+    return fY;
+  }
+
+  bool cursorVisible() const {
+    return fCursorVisible;
+  }
+
+  bool keypadMode() const {
+    return fKeypadMode;
+  }
+
+  bool mode(int mode) const {
+    auto item = fModes.find(mode);
+    return item != fModes.end() && item->second;
+  }
+
+  const std::string &title() const {
+    return fTitle;
+  }
+
+  /**
+   * @return answers to status queries the program is waiting for, to be written back to the pty
+   */
+  std::string takeReplies() {
+    std::string replies;
+    replies.swap(fReplies);
+    return replies;
+  }
+
+  void write(const std::string &data) {
+    write(data.data(), data.size());
+  }
+
+  void write(const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++)
+      consume((uint8_t) data[i]);
+  }
+
+  /**
+   * @brief keeps the top left of the content, the primary screen scrolls up when the cursor line would be cut off
+   */
+  void resize(int width, int height) {
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (width == fWidth && height == fHeight) return;
+    auto &active = rows();
+    if (fY >= height) {
+      auto shift = fY - height + 1;
+      active.erase(active.begin(), active.begin() + shift);
+      fY -= shift;
+    }
+    for (auto *buffer : {&fPrimary, &fAlternate}) {
+      buffer->resize(height, Row(width));
+      for (auto &line : *buffer) {
+        line.resize(width);
+        // a wide character cut in half by the new edge
+        if (!line.empty() && line.back().glyph.size() > 0 && charWidth(decode(line.back().glyph)) == 2) line.back() = Cell();
+      }
+    }
+    fWidth = width;
+    fHeight = height;
+    fTop = 0;
+    fBottom = fHeight - 1;
+    fX = std::min(fX, fWidth - 1);
+    fY = std::min(fY, fHeight - 1);
+    fWrapPending = false;
+  }
+
+  /**
+   * @brief columns a character takes on the screen
+   */
+  static int charWidth(uint32_t codePoint) {
+    if ((codePoint >= 0x0300 && codePoint <= 0x036F) || (codePoint >= 0x1AB0 && codePoint <= 0x1AFF) ||
+        (codePoint >= 0x1DC0 && codePoint <= 0x1DFF) || (codePoint >= 0x200B && codePoint <= 0x200F) ||
+        (codePoint >= 0x20D0 && codePoint <= 0x20FF) || (codePoint >= 0xFE00 && codePoint <= 0xFE0F) ||
+        (codePoint >= 0xFE20 && codePoint <= 0xFE2F))
+      return 0;
+    if ((codePoint >= 0x1100 && codePoint <= 0x115F) || (codePoint >= 0x2E80 && codePoint <= 0x303E) ||
+        (codePoint >= 0x3041 && codePoint <= 0x33FF) || (codePoint >= 0x3400 && codePoint <= 0x4DBF) ||
+        (codePoint >= 0x4E00 && codePoint <= 0x9FFF) || (codePoint >= 0xA000 && codePoint <= 0xA4CF) ||
+        (codePoint >= 0xAC00 && codePoint <= 0xD7A3) || (codePoint >= 0xF900 && codePoint <= 0xFAFF) ||
+        (codePoint >= 0xFE30 && codePoint <= 0xFE4F) || (codePoint >= 0xFF00 && codePoint <= 0xFF60) ||
+        (codePoint >= 0xFFE0 && codePoint <= 0xFFE6) || (codePoint >= 0x1F300 && codePoint <= 0x1F64F) ||
+        (codePoint >= 0x1F900 && codePoint <= 0x1F9FF) || (codePoint >= 0x20000 && codePoint <= 0x3FFFD))
+      return 2;
+    return 1;
+  }
+
+private:
+
+  std::vector<Row> &rows() {
+    return fAlternateActive ? fAlternate : fPrimary;
+  }
+
+  const std::vector<Row> &rows() const {
+    return fAlternateActive ? fAlternate : fPrimary;
+  }
+
+  /*! erased cells take the current background like xterm does */
+  Cell blank() const {
+    Cell cell;
+    cell.attributes.bg = fAttributes.bg;
+    return cell;
+  }
+
+  static uint32_t decode(const std::string &glyph) {
+    return decode(glyph.data(), glyph.size());
+  }
+
+  static uint32_t decode(const char *glyph, size_t size) {
+    auto byte = (uint8_t) glyph[0];
+    if (byte < 0x80) return byte;
+    size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+    uint32_t codePoint = byte & (0x3F >> (length - 1));
+    for (size_t i = 1; i < length && i < size; i++)
+      codePoint = (codePoint << 6) | ((uint8_t) glyph[i] & 0x3F);
+    return codePoint;
+  }
+
+  void consume(uint8_t byte) {
+    if (fUtf8Expected > 0) {
+      if ((byte & 0xC0) == 0x80) {
+        fUtf8 += (char) byte;
+        if (fUtf8.size() == fUtf8Expected) {
+          fUtf8Expected = 0;
+          print(fUtf8);
+        }
+        return;
+      }
+      fUtf8Expected = 0;
+      print("\xEF\xBF\xBD");
+    }
+    switch (fState) {
+      case State::Ground:
+        if (byte < 0x20) control(byte);
+        else if (byte < 0x7F) printAscii((char) byte);
+        else if (byte >= 0xC2 && byte <= 0xF4) {
+          fUtf8 = std::string(1, (char) byte);
+          fUtf8Expected = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+        } else if (byte >= 0x80) print("\xEF\xBF\xBD");
+        break;
+      case State::Escape:
+        escape(byte);
+        break;
+      case State::Csi:
+        if (byte == 0x1B) {
+          fState = State::Escape;
+        } else if (byte < 0x20) {
+          control(byte);
+        } else if (byte >= 0x40 && byte <= 0x7E) {
+          fState = State::Ground;
+          csi((char) byte);
+        } else if (byte >= 0x3C && byte <= 0x3F && fSequence.empty() && !fPrivate) {
+          fPrivate = (char) byte;
+        } else if (byte >= 0x20 && byte <= 0x2F) {
+          fIntermediate += (char) byte;
+        } else if (fSequence.size() < MAX_SEQUENCE_SIZE) {
+          fSequence += (char) byte;
+        }
+        break;
+      case State::Osc:
+        if (byte == 0x07) osc();
+        else if (byte == 0x1B) fState = State::OscEscape;
+        else if (fSequence.size() < MAX_SEQUENCE_SIZE) fSequence += (char) byte;
+        break;
+      case State::OscEscape:
+        if (byte == '\\') osc();
+        else {
+          fState = State::Escape;
+          escape(byte);
+        }
+        break;
+      case State::Charset:
+        fLineDrawing[fDesignating] = byte == '0';
+        fState = State::Ground;
+        break;
+      case State::Ignore:
+        fState = State::Ground;
+        break;
+      case State::String:
+        if (byte == 0x07) fState = State::Ground;
+        else if (byte == 0x1B) fState = State::StringEscape;
+        break;
+      case State::StringEscape:
+        fState = byte == '\\' ? State::Ground : State::String;
+        break;
+      case State::Alignment:
+        fState = State::Ground;
+        if (byte == '8') {
+          for (auto &line : rows())
+            for (auto &cell : line)
+              cell = {"E", {}};
+          fX = fY = 0;
+          fWrapPending = false;
+        }
+        break;
+    }
+  }
+
+  void printAscii(char byte) {
+    static const char *const LINE_DRAWING[] = {
+      "◆", "▒", "␉", "␌", "␍", "␊", "°", "±", "␤", "␋", "┘",
+      "┐", "┌", "└", "┼", "⎺", "⎻", "─", "⎼", "⎽", "├", "┤",
+      "┴", "┬", "│", "≤", "≥", "π", "≠", "£", "·"
+    };
+    if (fLineDrawing[fCharset] && byte >= 0x60 && byte <= 0x7E) {
+      auto glyph = LINE_DRAWING[byte - 0x60];
+      print(glyph, strlen(glyph), 1);
+    } else {
+      print(&byte, 1, 1);
+    }
+  }
+
+  void control(uint8_t byte) {
+    switch (byte) {
+      case 0x08:
+        if (fX > 0) fX--;
+        fWrapPending = false;
+        break;
+      case 0x09:
+        fX = std::min(fWidth - 1, (fX / TAB_WIDTH + 1) * TAB_WIDTH);
+        fWrapPending = false;
+        break;
+      case 0x0A:
+      case 0x0B:
+      case 0x0C:
+        lineFeed();
+        break;
+      case 0x0D:
+        fX = 0;
+        fWrapPending = false;
+        break;
+      case 0x0E:
+        fCharset = 1;
+        break;
+      case 0x0F:
+        fCharset = 0;
+        break;
+      case 0x1B:
+        fState = State::Escape;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void escape(uint8_t byte) {
+    fState = State::Ground;
+    switch (byte) {
+      case '[':
+        fState = State::Csi;
+        fSequence.clear();
+        fIntermediate.clear();
+        fPrivate = 0;
+        break;
+      case ']':
+        fState = State::Osc;
+        fSequence.clear();
+        break;
+      case 'P':
+      case 'X':
+      case '^':
+      case '_':
+        fState = State::String;
+        break;
+      case '(':
+      case ')':
+        fDesignating = byte == '(' ? 0 : 1;
+        fState = State::Charset;
+        break;
+      case '*':
+      case '+':
+      case ' ':
+      case '%':
+        fState = State::Ignore;
+        break;
+      case '#':
+        fState = State::Alignment;
+        break;
+      case '7':
+        saveCursor(fSaved);
+        break;
+      case '8':
+        restoreCursor(fSaved);
+        break;
+      case 'D':
+        lineFeed();
+        break;
+      case 'E':
+        fX = 0;
+        lineFeed();
+        break;
+      case 'M':
+        reverseIndex();
+        break;
+      case 'c':
+        reset();
+        break;
+      case '=':
+        fKeypadMode = true;
+        break;
+      case '>':
+        fKeypadMode = false;
+        break;
+      case 0x1B:
+        fState = State::Escape;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void osc() {
+    fState = State::Ground;
+    auto separator = fSequence.find(';');
+    if (separator == std::string::npos) return;
+    auto command = fSequence.substr(0, separator);
+    if (command == "0" || command == "2") fTitle = fSequence.substr(separator + 1);
+  }
+
+  std::vector<int> params() const {
+    std::vector<int> values;
+    std::string value;
+    for (size_t i = 0; i <= fSequence.size(); i++) {
+      if (i == fSequence.size() || fSequence[i] == ';' || fSequence[i] == ':') {
+        values.push_back(value.empty() ? -1 : std::min(std::atoi(value.c_str()), 0xFFFF));
+        value.clear();
+      } else if (fSequence[i] >= '0' && fSequence[i] <= '9') {
+        value += fSequence[i];
+      }
+    }
+    return values;
+  }
+
+  static int param(const std::vector<int> &values, size_t index, int defaultValue) {
+    if (index >= values.size() || values[index] < 0) return defaultValue;
+    return values[index];
+  }
+
+  /*! movement counts of zero mean one */
+  static int count(const std::vector<int> &values, size_t index = 0) {
+    return std::max(1, param(values, index, 1));
+  }
+
+  void csi(char final) {
+    auto values = params();
+    if (fPrivate == '?') {
+      if (final == 'h' || final == 'l')
+        for (auto value : values) privateMode(value, final == 'h');
+      return;
+    }
+    if (fPrivate == '>') {
+      if (final == 'c') fReplies += "\x1b[>1;10;0c";
+      return;
+    }
+    if (fPrivate || !fIntermediate.empty()) return;
+    switch (final) {
+      case '@':
+        insertCells(count(values));
+        break;
+      case 'A':
+        moveTo(fX, std::max(fY - count(values), fY >= fTop ? fTop : 0));
+        break;
+      case 'B':
+      case 'e':
+        moveTo(fX, std::min(fY + count(values), fY <= fBottom ? fBottom : fHeight - 1));
+        break;
+      case 'C':
+      case 'a':
+        moveTo(fX + count(values), fY);
+        break;
+      case 'D':
+        moveTo(fX - count(values), fY);
+        break;
+      case 'E':
+        moveTo(0, std::min(fY + count(values), fBottom));
+        break;
+      case 'F':
+        moveTo(0, std::max(fY - count(values), fTop));
+        break;
+      case 'G':
+      case '`':
+        moveTo(count(values) - 1, fY);
+        break;
+      case 'H':
+      case 'f':
+        moveTo(count(values, 1) - 1, count(values, 0) - 1 + (fOriginMode ? fTop : 0));
+        break;
+      case 'd':
+        moveTo(fX, count(values) - 1 + (fOriginMode ? fTop : 0));
+        break;
+      case 'I':
+        for (int i = count(values); i > 0; i--) control(0x09);
+        break;
+      case 'Z':
+        for (int i = count(values); i > 0; i--) fX = std::max(0, (fX - 1) / TAB_WIDTH * TAB_WIDTH);
+        fWrapPending = false;
+        break;
+      case 'J':
+        eraseDisplay(param(values, 0, 0));
+        break;
+      case 'K':
+        eraseLine(param(values, 0, 0));
+        break;
+      case 'L':
+        if (fY >= fTop && fY <= fBottom) scrollDown(count(values), fY);
+        fX = 0;
+        break;
+      case 'M':
+        if (fY >= fTop && fY <= fBottom) scrollUp(count(values), fY);
+        fX = 0;
+        break;
+      case 'P':
+        deleteCells(count(values));
+        break;
+      case 'X': {
+        auto &line = rows()[fY];
+        auto end = std::min(fWidth, fX + count(values));
+        splitAt(line, fX);
+        splitAt(line, end);
+        for (int i = fX; i < end; i++) line[i] = blank();
+        fWrapPending = false;
+        break;
+      }
+      case 'S':
+        scrollUp(count(values), fTop);
+        break;
+      case 'T':
+        scrollDown(count(values), fTop);
+        break;
+      case 'b':
+        for (int i = std::min(count(values), fWidth * fHeight); i > 0 && !fLastGlyph.empty(); i--) print(fLastGlyph);
+        break;
+      case 'm':
+        selectGraphicRendition(values);
+        break;
+      case 'n':
+        if (param(values, 0, 0) == 5) fReplies += "\x1b[0n";
+        if (param(values, 0, 0) == 6)
+          fReplies += "\x1b[" + std::to_string(fY + 1 - (fOriginMode ? fTop : 0)) + ";" + std::to_string(fX + 1) + "R";
+        break;
+      case 'c':
+        if (param(values, 0, 0) == 0) fReplies += "\x1b[?1;2c";
+        break;
+      case 'r': {
+        auto top = count(values, 0) - 1;
+        auto bottom = param(values, 1, fHeight);
+        if (bottom <= 0 || bottom > fHeight) bottom = fHeight;
+        if (top < bottom - 1) {
+          fTop = top;
+          fBottom = bottom - 1;
+          moveTo(0, fOriginMode ? fTop : 0);
+        }
+        break;
+      }
+      case 's':
+        saveCursor(fSaved);
+        break;
+      case 'u':
+        restoreCursor(fSaved);
+        break;
+      case 'h':
+      case 'l':
+        for (auto value : values)
+          if (value == 4) fInsertMode = final == 'h';
+        break;
+      default:
+        break;
+    }
+  }
+
+  void privateMode(int mode, bool set) {
+    switch (mode) {
+      case 6:
+        fOriginMode = set;
+        moveTo(0, set ? fTop : 0);
+        break;
+      case 7:
+        fAutoWrap = set;
+        break;
+      case 25:
+        fCursorVisible = set;
+        break;
+      case 47:
+      case 1047:
+        if (set) switchScreen(true, mode == 1047);
+        else switchScreen(false, mode == 1047);
+        break;
+      case 1048:
+        if (set) saveCursor(fSaved);
+        else restoreCursor(fSaved);
+        break;
+      case 1049:
+        if (set) {
+          saveCursor(fSavedPrimary);
+          switchScreen(true, true);
+        } else {
+          switchScreen(false, true);
+          restoreCursor(fSavedPrimary);
+        }
+        break;
+      default:
+        if (std::find(forwardedModes().begin(), forwardedModes().end(), mode) != forwardedModes().end())
+          fModes[mode] = set;
+        break;
+    }
+  }
+
+  void switchScreen(bool alternate, bool clear) {
+    if (alternate == fAlternateActive) return;
+    if (alternate && clear)
+      for (auto &line : fAlternate) std::fill(line.begin(), line.end(), blank());
+    if (!alternate && clear)
+      for (auto &line : fAlternate) std::fill(line.begin(), line.end(), Cell());
+    fAlternateActive = alternate;
+    fWrapPending = false;
+  }
+
+  void selectGraphicRendition(const std::vector<int> &values) {
+    for (size_t i = 0; i < values.size(); i++) {
+      auto value = std::max(values[i], 0);
+      switch (value) {
+        case 0:
+          fAttributes = Attributes();
+          break;
+        case 1:
+          fAttributes.flags |= Bold;
+          break;
+        case 2:
+          fAttributes.flags |= Dim;
+          break;
+        case 3:
+          fAttributes.flags |= Italic;
+          break;
+        case 4:
+        case 21:
+          fAttributes.flags |= Underline;
+          break;
+        case 5:
+        case 6:
+          fAttributes.flags |= Blink;
+          break;
+        case 7:
+          fAttributes.flags |= Inverse;
+          break;
+        case 8:
+          fAttributes.flags |= Hidden;
+          break;
+        case 9:
+          fAttributes.flags |= Strike;
+          break;
+        case 22:
+          fAttributes.flags &= ~(Bold | Dim);
+          break;
+        case 23:
+          fAttributes.flags &= ~Italic;
+          break;
+        case 24:
+          fAttributes.flags &= ~Underline;
+          break;
+        case 25:
+          fAttributes.flags &= ~Blink;
+          break;
+        case 27:
+          fAttributes.flags &= ~Inverse;
+          break;
+        case 28:
+          fAttributes.flags &= ~Hidden;
+          break;
+        case 29:
+          fAttributes.flags &= ~Strike;
+          break;
+        case 38:
+        case 48: {
+          uint32_t color = DEFAULT_COLOR;
+          if (param(values, i + 1, 0) == 5) {
+            color = std::min(param(values, i + 2, 0), 255);
+            i += 2;
+          } else if (param(values, i + 1, 0) == 2) {
+            color = RGB_COLOR | (std::min(param(values, i + 2, 0), 255) << 16) |
+                    (std::min(param(values, i + 3, 0), 255) << 8) | std::min(param(values, i + 4, 0), 255);
+            i += 4;
+          } else {
+            i = values.size();
+          }
+          (value == 38 ? fAttributes.fg : fAttributes.bg) = color;
+          break;
+        }
+        case 39:
+          fAttributes.fg = DEFAULT_COLOR;
+          break;
+        case 49:
+          fAttributes.bg = DEFAULT_COLOR;
+          break;
+        default:
+          if (value >= 30 && value <= 37) fAttributes.fg = value - 30;
+          else if (value >= 40 && value <= 47) fAttributes.bg = value - 40;
+          else if (value >= 90 && value <= 97) fAttributes.fg = value - 90 + 8;
+          else if (value >= 100 && value <= 107) fAttributes.bg = value - 100 + 8;
+          break;
+      }
+    }
+  }
+
+  void print(const std::string &glyph) {
+    print(glyph.data(), glyph.size(), charWidth(decode(glyph)));
+  }
+
+  void print(const char *glyph, size_t size, int width) {
+    auto &active = rows();
+    if (width == 0) {
+      // combining marks join the character before the cursor
+      auto x = fWrapPending ? fX : fX - 1;
+      if (x < 0) return;
+      if (active[fY][x].glyph.empty() && x > 0) x--;
+      if (active[fY][x].glyph.size() < 32) active[fY][x].glyph.append(glyph, size);
+      return;
+    }
+    if (width > fWidth) return;
+    if (fWrapPending && fAutoWrap) {
+      fX = 0;
+      lineFeed();
+    }
+    fWrapPending = false;
+    if (fX + width > fWidth) {
+      if (!fAutoWrap) fX = fWidth - width;
+      else {
+        fX = 0;
+        lineFeed();
+      }
+    }
+    auto &line = active[fY];
+    if (fInsertMode) {
+      splitAt(line, fX);
+      line.insert(line.begin() + fX, width, blank());
+      line.resize(fWidth);
+      cleanEdge(line);
+    }
+    clearCell(line, fX);
+    if (width == 2) clearCell(line, fX + 1);
+    line[fX].glyph.assign(glyph, size);
+    line[fX].attributes = fAttributes;
+    if (width == 2) {
+      line[fX + 1].glyph.clear();
+      line[fX + 1].attributes = fAttributes;
+    }
+    fLastGlyph.assign(glyph, size);
+    fX += width;
+    if (fX >= fWidth) {
+      fX = fWidth - 1;
+      fWrapPending = fAutoWrap;
+    }
+  }
+
+  /**
+   * @brief blanks the other half of a wide character about to be overwritten at x
+   */
+  void clearCell(Row &line, int x) {
+    if (x >= fWidth) return;
+    if (line[x].glyph.empty() && x > 0) line[x - 1] = blank();
+    if (!line[x].glyph.empty() && x + 1 < fWidth && line[x + 1].glyph.empty()) line[x + 1] = blank();
+  }
+
+  /**
+   * @brief keeps a wide character from being split between x - 1 and x, when cells are shifted or erased from x on
+   */
+  void splitAt(Row &line, int x) {
+    if (x <= 0 || x >= fWidth || !line[x].glyph.empty()) return;
+    line[x - 1] = blank();
+    line[x] = blank();
+  }
+
+  void cleanEdge(Row &line) {
+    if (charWidth(decode(line.back().glyph.empty() ? " " : line.back().glyph)) == 2) line.back() = blank();
+    if (line.front().glyph.empty()) line.front() = blank();
+  }
+
+  void moveTo(int x, int y) {
+    fX = std::max(0, std::min(x, fWidth - 1));
+    fY = std::max(0, std::min(y, fHeight - 1));
+    fWrapPending = false;
+  }
+
+  void lineFeed() {
+    fWrapPending = false;
+    if (fY == fBottom) scrollUp(1, fTop);
+    else if (fY < fHeight - 1) fY++;
+  }
+
+  void reverseIndex() {
+    fWrapPending = false;
+    if (fY == fTop) scrollDown(1, fTop);
+    else if (fY > 0) fY--;
+  }
+
+  /**
+   * @brief moves lines top to the bottom of the scroll region up by count, blank lines come in at the bottom
+   */
+  void scrollUp(int count, int top) {
+    auto &active = rows();
+    count = std::min(count, fBottom - top + 1);
+    // rows are recycled, scrolling happens for every line of streaming output
+    std::rotate(active.begin() + top, active.begin() + top + count, active.begin() + fBottom + 1);
+    for (int y = fBottom - count + 1; y <= fBottom; y++) std::fill(active[y].begin(), active[y].end(), blank());
+  }
+
+  void scrollDown(int count, int top) {
+    auto &active = rows();
+    count = std::min(count, fBottom - top + 1);
+    std::rotate(active.begin() + top, active.begin() + fBottom + 1 - count, active.begin() + fBottom + 1);
+    for (int y = top; y < top + count; y++) std::fill(active[y].begin(), active[y].end(), blank());
+  }
+
+  void insertCells(int count) {
+    auto &line = rows()[fY];
+    count = std::min(count, fWidth - fX);
+    splitAt(line, fX);
+    line.insert(line.begin() + fX, count, blank());
+    line.resize(fWidth);
+    cleanEdge(line);
+    fWrapPending = false;
+  }
+
+  void deleteCells(int count) {
+    auto &line = rows()[fY];
+    count = std::min(count, fWidth - fX);
+    splitAt(line, fX);
+    splitAt(line, fX + count);
+    line.erase(line.begin() + fX, line.begin() + fX + count);
+    line.insert(line.end(), count, blank());
+    fWrapPending = false;
+  }
+
+  void eraseLine(int mode) {
+    auto &line = rows()[fY];
+    int from = mode == 0 ? fX : 0;
+    int to = mode == 1 ? fX + 1 : fWidth;
+    splitAt(line, from);
+    splitAt(line, to);
+    for (int x = from; x < to; x++) line[x] = blank();
+    fWrapPending = false;
+  }
+
+  void eraseDisplay(int mode) {
+    auto &active = rows();
+    if (mode == 0 || mode == 1) {
+      eraseLine(mode);
+      int from = mode == 0 ? fY + 1 : 0;
+      int to = mode == 0 ? fHeight : fY;
+      for (int y = from; y < to; y++) std::fill(active[y].begin(), active[y].end(), blank());
+    } else if (mode == 2 || mode == 3) {
+      for (auto &line : active) std::fill(line.begin(), line.end(), blank());
+    }
+    fWrapPending = false;
+  }
+
+  void saveCursor(SavedCursor &saved) const {
+    saved.x = fX;
+    saved.y = fY;
+    saved.attributes = fAttributes;
+    saved.lineDrawing[0] = fLineDrawing[0];
+    saved.lineDrawing[1] = fLineDrawing[1];
+    saved.originMode = fOriginMode;
+  }
+
+  void restoreCursor(const SavedCursor &saved) {
+    fAttributes = saved.attributes;
+    fLineDrawing[0] = saved.lineDrawing[0];
+    fLineDrawing[1] = saved.lineDrawing[1];
+    fOriginMode = saved.originMode;
+    moveTo(saved.x, saved.y);
+  }
+
+  void reset() {
+    auto width = fWidth, height = fHeight;
+    auto replies = fReplies;
+    *this = Screen(width, height);
+    fReplies = replies;
+  }
+};
+
+
+#endif //TERMINUS_SCREEN_HPP
@@ -2,17 +2,24 @@
 #define TERMINUS_TERMINAL_HPP
 
 #include <thread>
+#include <chrono>
 #include <pty.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <condition_variable>
 #include <csignal>
 #include <wait.h>
+#include <functional>
+
+#include <message/Buffer.h>
+#include <terminal/executor.hpp>
 
 class Terminal {
 public:
   using ReadHandler = std::function<void(const std::string &)>;
 private:
   int fChildPid = -1;
+  mutable bool fExited = false;
   int fTerminalFd = -1;
   int fHeight;
   int fWidth;
@@ -28,6 +35,8 @@ public:
     fReadHandler = nullptr;
     fReset = true;
     close(fTerminalFd);
+    if (fChildPid <= 0 || fExited)
+      return;
     kill(fChildPid, SIGKILL);
     int status;
     waitpid(fChildPid, &status, 0);
@@ -46,6 +55,8 @@ public:
     }
     if (fcntl(fTerminalFd, F_SETFL, fcntl(fTerminalFd, F_GETFL) | O_NONBLOCK) < 0)
       return false;
+    if (fcntl(fTerminalFd, F_SETFD, FD_CLOEXEC) < 0)
+      return false;
     if (async) std::thread(&Terminal::readThread, this).detach();
     return true;
   }
@@ -58,9 +69,29 @@ public:
       return {};
     }
     Buffer buffer(recvBuf, recvSize);
+    delete[] recvBuf;
     return buffer;
   }
 
+  /**
+   * @brief waits until the pty has output to read or is hung up
+   * @param timeout negative value waits infinitely
+   * @return false if timeout expired
+   */
+  bool waitForData(std::chrono::microseconds timeout) const {
+    if (fTerminalFd == -1)
+      return false;
+    pollfd pfd = {fTerminalFd, POLLIN, 0};
+    timespec ts = {};
+    ts.tv_sec = (time_t) (timeout.count() / 1000000);
+    ts.tv_nsec = (long) (timeout.count() % 1000000) * 1000;
+    int ret;
+    do {
+      ret = ppoll(&pfd, 1, timeout.count() < 0 ? nullptr : &ts, nullptr);
+    } while (ret < 0 && errno == EINTR);
+    return ret != 0;
+  }
+
   void subscribeDataFlow(const ReadHandler &readHandler) {
     fReadHandler = readHandler;
   }
@@ -72,32 +103,20 @@ public:
   }
 
   static std::pair<int, std::string> execute(const std::string &cmd) {
-    int fd = -1;
-    int childPid = forkpty(&fd, nullptr, nullptr, nullptr);
-    if (childPid < 0)
-      return {};
-    if (childPid == 0) {
-      exit(system(cmd.c_str()));
-    }
-    char buf[1024] = {0};
-    size_t numBytes;
-    std::string output;
-    while ((numBytes = read(fd, buf, 1024))) {
-      if (numBytes == -1) {
-        if (errno == EAGAIN) {
-          sleep(1);
-          continue;
-        }
-        break;
-      }
-      output += std::string(buf, numBytes);
-      memset(buf, 0, 1024);
-    }
+    return CommandExecutor::execute(cmd);
+  }
 
+  /**
+   * @return true if the shell process has not exited yet
+   */
+  bool isAlive() const {
+    if (fChildPid <= 0 || fExited)
+      return false;
     int status;
-    waitpid(childPid, &status, 0);
-    close(fd);
-    return std::make_pair(status, output);
+    if (waitpid(fChildPid, &status, WNOHANG) == 0)
+      return true;
+    fExited = true;
+    return false;
   }
 
   bool setSize(int width, int height) const {
@@ -119,12 +138,11 @@ private:
   [[noreturn]] void tty() const {
     static char termstr[] = "TERM=xterm";
     putenv(termstr);
-    while (true) {
-      if (fAuthorize)
-        execl("/bin/login", "login", nullptr);
-      else
-        execl("/bin/bash", "", nullptr);
-    }
+    if (fAuthorize)
+      execl("/bin/login", "login", nullptr);
+    else
+      execl("/bin/bash", "", nullptr);
+    _exit(EXIT_FAILURE);
   }
 
   void readThread() {
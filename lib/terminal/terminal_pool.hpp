@@ -0,0 +1,130 @@
+#ifndef TERMINUS_TERMINAL_POOL_HPP
+#define TERMINUS_TERMINAL_POOL_HPP
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <condition_variable>
+
+#include <logger/Logger.h>
+#include <message/Buffer.h>
+#include <terminal/terminal.hpp>
+
+/**
+ * @brief keeps a number of spawned shells/logins ready to be attached to new sessions
+ * @note idle terminals are health checked, so shells killed by a login timeout are replaced
+ */
+class TerminalPool {
+public:
+  using TerminalPtr = std::shared_ptr<Terminal>;
+private:
+  static constexpr int HEALTH_CHECK_INTERVAL_MS = 1000;
+private:
+  size_t fSize;
+  int fWidth;
+  int fHeight;
+  bool fAuthorize;
+  bool fStop = false;
+  std::deque<TerminalPtr> fReady;
+  mutable std::mutex fMutex;
+  std::condition_variable fRefillFlag;
+  std::condition_variable fReadyFlag;
+  std::thread fRefillThread;
+public:
+  TerminalPool(size_t size, int width, int height, bool withAuthentication) :
+    fSize(size), fWidth(width), fHeight(height), fAuthorize(withAuthentication) {
+  }
+
+  ~TerminalPool() {
+    stop();
+  }
+
+  void start() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fRefillThread.joinable()) return;
+    fStop = false;
+    fRefillThread = std::thread(&TerminalPool::refillThread, this);
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+    }
+    fRefillFlag.notify_all();
+    fReadyFlag.notify_all();
+    if (fRefillThread.joinable()) fRefillThread.join();
+    std::lock_guard<std::mutex> lock(fMutex);
+    fReady.clear();
+  }
+
+  /**
+   * @brief takes a ready terminal, spawns one in place if the pool is drained
+   */
+  TerminalPtr acquire() {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (!fReady.empty()) {
+        auto terminal = fReady.front();
+        fReady.pop_front();
+        fRefillFlag.notify_one();
+        if (terminal->isAlive()) return terminal;
+      }
+    }
+    DWARN("terminal pool is drained, spawning terminal in place");
+    return spawn();
+  }
+
+  size_t available() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fReady.size();
+  }
+
+  /**
+   * @brief blocks until the pool holds its configured amount of terminals
+   */
+  bool waitReady(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    return fReadyFlag.wait_for(lock, timeout, [this] { return fStop || fReady.size() >= fSize; }) && !fStop;
+  }
+
+private:
+
+  TerminalPtr spawn() const {
+    auto terminal = std::make_shared<Terminal>(fWidth, fHeight, fAuthorize);
+    if (!terminal->open(false)) {
+      DERROR("failed to spawn pooled terminal");
+      return nullptr;
+    }
+    return terminal;
+  }
+
+  void refillThread() {
+    std::unique_lock<std::mutex> lock(fMutex);
+    while (!fStop) {
+      for (auto it = fReady.begin(); it != fReady.end();) {
+        if ((*it)->isAlive()) {
+          ++it;
+          continue;
+        }
+        DWARN("pooled terminal exited, replacing it");
+        it = fReady.erase(it);
+      }
+      if (fReady.size() >= fSize) {
+        fReadyFlag.notify_all();
+        fRefillFlag.wait_for(lock, std::chrono::milliseconds(HEALTH_CHECK_INTERVAL_MS));
+        continue;
+      }
+      lock.unlock();
+      auto terminal = spawn();
+      lock.lock();
+      if (!terminal) {
+        fRefillFlag.wait_for(lock, std::chrono::milliseconds(HEALTH_CHECK_INTERVAL_MS));
+        continue;
+      }
+      fReady.push_back(terminal);
+    }
+  }
+};
+
+#endif //TERMINUS_TERMINAL_POOL_HPP
@@ -0,0 +1,412 @@
+#ifndef TERMINUS_DATAGRAMENDPOINT_H
+#define TERMINUS_DATAGRAMENDPOINT_H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <condition_variable>
+
+#include <logger/Logger.h>
+#include <crypto/CryptoInterface.h>
+#include <transport/ReliableStream.h>
+#include <transport/LossSimulator.h>
+
+/**
+ * @brief carries byte streams over udp, each stream shows up as a local stream socket
+ * @note the rest of the code keeps reading and writing frames to a socket and does not know which transport is used.
+ * Datagrams are signed with the server credentials. A session is bound to its connection id rather than to an
+ * address, so it follows a client whose address changes. Datagrams are numbered and only one newer than any before
+ * moves the session, a replayed datagram cannot take it over.
+ */
+class DatagramEndpoint {
+public:
+  using Clock = std::chrono::steady_clock;
+  using SessionHandler = std::function<void(const std::string &, int)>;
+  static constexpr uint32_t id = 0x378D7CC2;
+private:
+  static constexpr size_t HEADER_SIZE = 12;
+  static constexpr size_t TAG_SIZE = 16;
+  static constexpr size_t MAX_DATAGRAM_SIZE = HEADER_SIZE + ReliableStream::HEADER_SIZE + ReliableStream::MAX_PAYLOAD + TAG_SIZE;
+  static constexpr size_t DELIVER_LIMIT = 256 * 1024;
+  static constexpr size_t READ_CHUNK = 16 * 1024;
+  static constexpr int KEEPALIVE_MS = 1000;
+  static constexpr int IDLE_TIMEOUT_MS = 30000;
+  static constexpr int CLOSED_LINGER_MS = 60000;
+  static constexpr int MAX_POLL_MS = 1000;
+  static constexpr int LINGER_MS = 1000;
+
+  struct Session {
+    uint32_t connection = 0;
+    int socket = -1;
+    sockaddr_storage peer = {};
+    /*! number of the next datagram sent and of the newest one received */
+    uint32_t nextDatagram = 1;
+    uint32_t newestDatagram = 0;
+    ReliableStream stream;
+    std::string deliver;
+    bool localClosed = false;
+    bool peerClosed = false;
+    Clock::time_point lastReceived;
+    Clock::time_point lastSent;
+  };
+private:
+  std::string fKey;
+  int fSocket = -1;
+  int fWakeupPipe[2] = {-1, -1};
+  bool fServer = false;
+  std::map<uint32_t, std::unique_ptr<Session>> fSessions;
+  std::map<uint32_t, Clock::time_point> fClosedSessions;
+  SessionHandler fSessionHandler;
+  LossSimulator fSimulator;
+  std::thread fLoopThread;
+  std::mutex fMutex;
+  std::condition_variable fDoneFlag;
+  bool fStop = false;
+  bool fDone = false;
+public:
+  DatagramEndpoint(const std::string &login, const std::string &key, const LossSimulator::Options &simulator = {}) :
+    fKey(login + key), fSimulator(simulator) {
+  }
+
+  ~DatagramEndpoint() {
+    stop();
+  }
+
+  /**
+   * @brief accepts sessions of any client, handler gets a socket per session and owns it
+   */
+  bool listen(const std::string &host, int port, const SessionHandler &handler) {
+    auto address = resolve(host, port);
+    if (address.ss_family == AF_UNSPEC) return false;
+    fSocket = socket(address.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fSocket == -1) return false;
+    int yes = 1;
+    setsockopt(fSocket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (::bind(fSocket, (sockaddr *) &address, addressLength(address)) == -1) {
+      DCRITICAL("failed to bind udp socket to %s:%d", host.c_str(), port);
+      return false;
+    }
+    fServer = true;
+    fSessionHandler = handler;
+    return startLoop();
+  }
+
+  /**
+   * @return socket to exchange the session stream with the server, -1 on failure
+   */
+  int connect(const std::string &address, int port) {
+    auto server = resolve(address, port);
+    if (server.ss_family == AF_UNSPEC) return -1;
+    fSocket = socket(server.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fSocket == -1) return -1;
+    uint32_t connection;
+    std::random_device random;
+    do {
+      connection = random();
+    } while (connection == 0);
+    int sock = createSession(connection, server);
+    if (sock == -1 || !startLoop()) return -1;
+    return sock;
+  }
+
+  /**
+   * @brief a client waits a moment for its closed session to say goodbye to the server
+   */
+  void stop() {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      if (fStop) return;
+      if (!fServer) fDoneFlag.wait_for(lock, std::chrono::milliseconds(LINGER_MS), [this] { return fDone; });
+      fStop = true;
+    }
+    if (fLoopThread.joinable()) {
+      char c = 0;
+      (void) ::write(fWakeupPipe[1], &c, 1);
+      fLoopThread.join();
+    }
+    for (auto &item : fSessions)
+      close(item.second->socket);
+    fSessions.clear();
+    if (fSocket != -1) close(fSocket);
+    if (fWakeupPipe[0] != -1) close(fWakeupPipe[0]);
+    if (fWakeupPipe[1] != -1) close(fWakeupPipe[1]);
+  }
+
+private:
+
+  static sockaddr_storage resolve(const std::string &host, int port) {
+    sockaddr_storage address = {};
+    addrinfo hints = {};
+    addrinfo *result = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) || !result) {
+      DCRITICAL("failed to resolve %s", host.c_str());
+      return address;
+    }
+    memcpy(&address, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    return address;
+  }
+
+  static socklen_t addressLength(const sockaddr_storage &address) {
+    return address.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+  }
+
+  static std::string toString(const sockaddr_storage &address) {
+    char host[INET6_ADDRSTRLEN] = {};
+    int port;
+    if (address.ss_family == AF_INET6) {
+      auto in6 = (const sockaddr_in6 *) &address;
+      inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+      port = ntohs(in6->sin6_port);
+    } else {
+      auto in = (const sockaddr_in *) &address;
+      inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+      port = ntohs(in->sin_port);
+    }
+    return std::string(host) + ":" + std::to_string(port);
+  }
+
+  static uint32_t readLe(const std::string &data, size_t offset) {
+    uint32_t ret = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); i++)
+      ret |= (uint32_t) (uint8_t) data[offset + i] << (i * 8);
+    return ret;
+  }
+
+  static void appendLe(std::string &data, uint32_t value) {
+    for (size_t i = 0; i < sizeof(uint32_t); i++)
+      data += (char) ((value >> (i * 8)) & 0xff);
+  }
+
+  static bool sameAddress(const sockaddr_storage &a, const sockaddr_storage &b) {
+    return a.ss_family == b.ss_family && memcmp(&a, &b, addressLength(a)) == 0;
+  }
+
+  bool startLoop() {
+    if (pipe2(fWakeupPipe, O_NONBLOCK | O_CLOEXEC) != 0) return false;
+    fLoopThread = std::thread(&DatagramEndpoint::loop, this);
+    return true;
+  }
+
+  /**
+   * @return the other end of the session socket pair
+   */
+  int createSession(uint32_t connection, const sockaddr_storage &peer) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1) return -1;
+    fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+    auto session = std::unique_ptr<Session>(new Session());
+    session->connection = connection;
+    session->socket = pair[0];
+    session->peer = peer;
+    session->lastReceived = session->lastSent = Clock::now();
+    fSessions[connection] = std::move(session);
+    return pair[1];
+  }
+
+  std::string sign(const std::string &packet) const {
+    return Crypto::HMAC::signData(packet, fKey).substr(0, TAG_SIZE);
+  }
+
+  void sendSegment(Session &session, const std::string &segment, Clock::time_point now) {
+    std::string packet;
+    packet.reserve(HEADER_SIZE + segment.size() + TAG_SIZE);
+    appendLe(packet, id);
+    appendLe(packet, session.connection);
+    appendLe(packet, session.nextDatagram++);
+    packet += segment;
+    packet += sign(packet);
+    session.lastSent = now;
+    fSimulator.submit(packet, session.peer, now, [this](const std::string &data, const sockaddr_storage &peer) {
+      sendDatagram(data, peer);
+    });
+  }
+
+  void sendDatagram(const std::string &data, const sockaddr_storage &peer) const {
+    sendto(fSocket, data.data(), data.size(), 0, (const sockaddr *) &peer, addressLength(peer));
+  }
+
+  void receiveDatagrams(Clock::time_point now) {
+    char buffer[MAX_DATAGRAM_SIZE + 1];
+    while (true) {
+      sockaddr_storage from = {};
+      socklen_t fromLen = sizeof(from);
+      auto size = recvfrom(fSocket, buffer, sizeof(buffer), 0, (sockaddr *) &from, &fromLen);
+      if (size < 0 && errno == EINTR) continue;
+      if (size < 0) return;
+      handleDatagram(std::string(buffer, size), from, now);
+    }
+  }
+
+  void handleDatagram(const std::string &packet, const sockaddr_storage &from, Clock::time_point now) {
+    if (packet.size() < HEADER_SIZE + ReliableStream::HEADER_SIZE + TAG_SIZE) return;
+    if (readLe(packet, 0) != id) return;
+    auto body = packet.substr(0, packet.size() - TAG_SIZE);
+    if (!Crypto::HMAC::compareSignatures(packet.substr(body.size()), sign(body))) {
+      DWARN("dropping udp datagram with a bad signature from %s", toString(from).c_str());
+      return;
+    }
+    auto connection = readLe(packet, 4);
+    auto item = fSessions.find(connection);
+    if (item == fSessions.end()) {
+      if (!fServer || fClosedSessions.count(connection)) return;
+      int sock = createSession(connection, from);
+      if (sock == -1) return;
+      item = fSessions.find(connection);
+      DINFO("new udp session %08x from %s", connection, toString(from).c_str());
+      fSessionHandler("udp:" + toString(from) + "/" + std::to_string(connection), sock);
+    }
+    auto &session = *item->second;
+    auto number = readLe(packet, 8);
+    // serial number arithmetic, the count wraps
+    bool newest = (int32_t) (number - session.newestDatagram) > 0;
+    if (newest) session.newestDatagram = number;
+    // a replayed datagram is signed as well, only a new one shows where the client is now
+    if (fServer && newest && !sameAddress(session.peer, from)) {
+      DINFO("udp session %08x moved from %s to %s", connection, toString(session.peer).c_str(), toString(from).c_str());
+      session.peer = from;
+    }
+    session.lastReceived = now;
+    session.deliver += session.stream.receive(body.substr(HEADER_SIZE), now, session.deliver.size() < DELIVER_LIMIT);
+    writeLocal(session);
+  }
+
+  void readLocal(Session &session) {
+    if (session.localClosed || session.stream.writable() == 0) return;
+    char buffer[READ_CHUNK];
+    auto size = recv(session.socket, buffer, std::min(sizeof(buffer), session.stream.writable()), 0);
+    if (size < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (size <= 0) {
+      session.localClosed = true;
+      session.stream.finish();
+      return;
+    }
+    session.stream.write(buffer, size);
+  }
+
+  void writeLocal(Session &session) {
+    while (!session.deliver.empty()) {
+      auto sent = send(session.socket, session.deliver.data(), session.deliver.size(), MSG_NOSIGNAL);
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent < 0 && errno == EAGAIN) return;
+      if (sent <= 0) {
+        session.deliver.clear();
+        session.localClosed = true;
+        session.stream.finish();
+        return;
+      }
+      session.deliver.erase(0, sent);
+    }
+    if (session.stream.peerFinished() && !session.peerClosed) {
+      session.peerClosed = true;
+      shutdown(session.socket, SHUT_WR);
+    }
+  }
+
+  /**
+   * @return false once the session is over
+   */
+  bool updateSession(Session &session, Clock::time_point now) {
+    for (auto &segment : session.stream.poll(now))
+      sendSegment(session, segment, now);
+    if (now - session.lastSent >= std::chrono::milliseconds(KEEPALIVE_MS))
+      sendSegment(session, session.stream.makeAck(), now);
+    if (session.localClosed && session.stream.closed()) return false;
+    if (now - session.lastReceived >= std::chrono::milliseconds(IDLE_TIMEOUT_MS)) {
+      DWARN("udp session %08x timed out", session.connection);
+      return false;
+    }
+    return true;
+  }
+
+  void closeSession(Session &session, Clock::time_point now) {
+    auto &stats = session.stream.getStats();
+    DINFO("udp session %08x closed, rtt %ld us, segments %lu, retransmits %lu, timeouts %lu, received %lu, duplicates %lu",
+          session.connection, (long) session.stream.rtt().count(), stats.segments, stats.retransmits, stats.timeouts,
+          stats.received, stats.duplicates);
+    close(session.socket);
+    fClosedSessions[session.connection] = now + std::chrono::milliseconds(CLOSED_LINGER_MS);
+  }
+
+  int getTimeout(Clock::time_point now) const {
+    auto deadline = std::min(now + std::chrono::milliseconds(MAX_POLL_MS), fSimulator.nextDue());
+    for (auto &item : fSessions) {
+      auto &session = *item.second;
+      deadline = std::min(deadline, session.stream.nextDeadline(now));
+      deadline = std::min(deadline, session.lastSent + std::chrono::milliseconds(KEEPALIVE_MS));
+    }
+    if (deadline <= now) return 0;
+    // rounded up, waking up early only spins
+    return (int) std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now + std::chrono::microseconds(999)).count();
+  }
+
+  void loop() {
+    std::vector<pollfd> pfds;
+    std::vector<uint32_t> ids;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fStop) break;
+      }
+      pfds.clear();
+      ids.clear();
+      pfds.push_back({fWakeupPipe[0], POLLIN, 0});
+      pfds.push_back({fSocket, POLLIN, 0});
+      for (auto &item : fSessions) {
+        auto &session = *item.second;
+        short events = 0;
+        if (!session.localClosed && session.stream.writable() > 0) events |= POLLIN;
+        if (!session.deliver.empty()) events |= POLLOUT;
+        // a hung up socket would wake poll up all the time while the session still finishes
+        pfds.push_back({events ? session.socket : -1, events, 0});
+        ids.push_back(item.first);
+      }
+
+      int ret = poll(pfds.data(), pfds.size(), getTimeout(Clock::now()));
+      if (ret < 0 && errno != EINTR) break;
+      if (pfds[0].revents) {
+        char buf[64];
+        while (::read(fWakeupPipe[0], buf, sizeof(buf)) > 0);
+      }
+      auto now = Clock::now();
+      if (pfds[1].revents) receiveDatagrams(now);
+      for (size_t i = 2; i < pfds.size(); i++) {
+        auto item = fSessions.find(ids[i - 2]);
+        if (item == fSessions.end() || !pfds[i].revents) continue;
+        if (pfds[i].revents & POLLOUT) writeLocal(*item->second);
+        if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) readLocal(*item->second);
+      }
+      for (auto it = fSessions.begin(); it != fSessions.end();) {
+        if (updateSession(*it->second, now)) {
+          ++it;
+          continue;
+        }
+        closeSession(*it->second, now);
+        it = fSessions.erase(it);
+      }
+      fSimulator.flush(now, [this](const std::string &data, const sockaddr_storage &peer) {
+        sendDatagram(data, peer);
+      });
+      for (auto it = fClosedSessions.begin(); it != fClosedSessions.end();)
+        it = it->second <= now ? fClosedSessions.erase(it) : std::next(it);
+      if (!fServer && fSessions.empty()) break;
+    }
+    std::lock_guard<std::mutex> lock(fMutex);
+    fDone = true;
+    fDoneFlag.notify_all();
+  }
+};
+
+
+#endif //TERMINUS_DATAGRAMENDPOINT_H
@@ -0,0 +1,77 @@
+#ifndef TERMINUS_DELAYHISTOGRAM_H
+#define TERMINUS_DELAYHISTOGRAM_H
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @brief counts delays in power of two buckets of microseconds, percentiles are the upper bound of their bucket
+ * @note not thread safe
+ */
+class DelayHistogram {
+public:
+  static const int BUCKET_COUNT = 32;
+private:
+  uint64_t fBuckets[BUCKET_COUNT] = {};
+  uint64_t fCount = 0;
+  uint64_t fTotal = 0;
+  uint64_t fMax = 0;
+public:
+
+  void record(std::chrono::microseconds delay) {
+    auto micros = delay.count() > 0 ? (uint64_t) delay.count() : 0;
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && micros >= ((uint64_t) 1 << bucket)) bucket++;
+    fBuckets[bucket]++;
+    fCount++;
+    fTotal += micros;
+    if (micros > fMax) fMax = micros;
+  }
+
+  void merge(const DelayHistogram &other) {
+    for (int i = 0; i < BUCKET_COUNT; i++)
+      fBuckets[i] += other.fBuckets[i];
+    fCount += other.fCount;
+    fTotal += other.fTotal;
+    if (other.fMax > fMax) fMax = other.fMax;
+  }
+
+  uint64_t count() const {
+    return fCount;
+  }
+
+  uint64_t getBucket(int bucket) const {
+    return fBuckets[bucket];
+  }
+
+  /**
+   * @brief delays in bucket are below this bound and at least half of it
+   */
+  static uint64_t getUpperBound(int bucket) {
+    return (uint64_t) 1 << bucket;
+  }
+
+  uint64_t max() const {
+    return fMax;
+  }
+
+  double mean() const {
+    return fCount ? (double) fTotal / (double) fCount : 0;
+  }
+
+  /**
+   * @param share 0 to 1, 0.99 for the 99th percentile
+   */
+  uint64_t percentile(double share) const {
+    if (fCount == 0) return 0;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+      seen += fBuckets[bucket];
+      if ((double) seen >= share * (double) fCount) return std::min(getUpperBound(bucket), fMax);
+    }
+    return fMax;
+  }
+};
+
+#endif //TERMINUS_DELAYHISTOGRAM_H
@@ -0,0 +1,125 @@
+#ifndef TERMINUS_LANELOCK_H
+#define TERMINUS_LANELOCK_H
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <condition_variable>
+
+#include "DelayHistogram.h"
+
+enum class Lane {
+  Interactive = 0,
+  Bulk = 1,
+};
+
+/**
+ * @brief guards writes to a socket, senders waiting in the interactive lane get it before those in the bulk lane
+ * @note a keystroke then waits for at most the one frame being written instead of every bulk frame queued up.
+ * Frames of one stream are sent by one thread at a time, so they are never reordered
+ */
+class LaneLock {
+public:
+  static const int LANE_COUNT = 2;
+  /*! keystrokes, interrupts among them, acks and window updates all fit, output rarely does */
+  static const size_t INTERACTIVE_FRAME_SIZE = 256;
+
+  struct Stats {
+    DelayHistogram delays[LANE_COUNT];
+
+    const DelayHistogram &getDelays(Lane lane) const {
+      return delays[(int) lane];
+    }
+  };
+
+  class Guard {
+  private:
+    LaneLock &fLock;
+    std::chrono::microseconds fWait;
+  public:
+    Guard(LaneLock &lock, Lane lane) : fLock(lock), fWait(lock.lock(lane)) {
+    }
+
+    ~Guard() {
+      fLock.unlock();
+    }
+
+    std::chrono::microseconds getWait() const {
+      return fWait;
+    }
+
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+  };
+private:
+  mutable std::mutex fMutex;
+  std::condition_variable fReleased;
+  bool fLocked = false;
+  int fWaiting[LANE_COUNT] = {};
+  Stats fStats;
+  std::string fUnsent;
+public:
+
+  static Lane classify(size_t frameSize) {
+    return frameSize <= INTERACTIVE_FRAME_SIZE ? Lane::Interactive : Lane::Bulk;
+  }
+
+  int getWaiting(Lane lane) const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fWaiting[(int) lane];
+  }
+
+  Stats getStats() const {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats;
+  }
+
+  /**
+   * @return how long the caller waited
+   */
+  std::chrono::microseconds lock(Lane lane) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(fMutex);
+    auto &waiting = fWaiting[(int) lane];
+    waiting++;
+    fReleased.wait(lock, [this, lane] {
+      return !fLocked && (lane == Lane::Interactive || fWaiting[(int) Lane::Interactive] == 0);
+    });
+    waiting--;
+    fLocked = true;
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    fStats.delays[(int) lane].record(wait);
+    return wait;
+  }
+
+  /**
+   * @return false if the socket is being written or other senders wait for it
+   */
+  bool tryLock(Lane lane) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fLocked || fWaiting[(int) Lane::Interactive] > 0 || (lane == Lane::Bulk && fWaiting[(int) Lane::Bulk] > 0))
+      return false;
+    fLocked = true;
+    fStats.delays[(int) lane].record(std::chrono::microseconds(0));
+    return true;
+  }
+
+  /**
+   * @brief the end of a frame a sender which must not block left unwritten, the next holder writes it before
+   * anything else so the stream stays intact
+   * @note expects the lock to be held
+   */
+  std::string &getUnsent() {
+    return fUnsent;
+  }
+
+  void unlock() {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fLocked = false;
+    }
+    fReleased.notify_all();
+  }
+};
+
+#endif //TERMINUS_LANELOCK_H
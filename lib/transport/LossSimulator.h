@@ -0,0 +1,97 @@
+#ifndef TERMINUS_LOSSSIMULATOR_H
+#define TERMINUS_LOSSSIMULATOR_H
+
+#include <map>
+#include <chrono>
+#include <random>
+#include <string>
+#include <functional>
+#include <netinet/in.h>
+
+/**
+ * @brief drops and delays outgoing datagrams to reproduce a lossy link on loopback
+ * @note jitter reorders datagrams the way a real path does, the generator is seeded so runs can be repeated
+ */
+class LossSimulator {
+public:
+  using Clock = std::chrono::steady_clock;
+  using SendHandler = std::function<void(const std::string &, const sockaddr_storage &)>;
+
+  struct Options {
+    /*! share of datagrams dropped, 0 to 1 */
+    double lossRate = 0;
+    std::chrono::milliseconds delay{0};
+    std::chrono::milliseconds jitter{0};
+    uint32_t seed = 1;
+
+    bool enabled() const {
+      return lossRate > 0 || delay.count() > 0 || jitter.count() > 0;
+    }
+  };
+
+  struct Stats {
+    uint64_t submitted = 0;
+    uint64_t dropped = 0;
+  };
+private:
+  struct Datagram {
+    std::string data;
+    sockaddr_storage peer;
+  };
+private:
+  Options fOptions;
+  std::mt19937 fRandom;
+  std::multimap<Clock::time_point, Datagram> fQueue;
+  Stats fStats;
+public:
+  LossSimulator() : LossSimulator(Options()) {
+  }
+
+  explicit LossSimulator(const Options &options) : fOptions(options), fRandom(options.seed) {
+  }
+
+  bool enabled() const {
+    return fOptions.enabled();
+  }
+
+  const Stats &getStats() const {
+    return fStats;
+  }
+
+  /**
+   * @brief sends data at once if the simulator is disabled, otherwise drops or schedules it
+   */
+  void submit(const std::string &data, const sockaddr_storage &peer, Clock::time_point now, const SendHandler &send) {
+    fStats.submitted++;
+    if (!enabled()) {
+      send(data, peer);
+      return;
+    }
+    if (std::uniform_real_distribution<double>(0, 1)(fRandom) < fOptions.lossRate) {
+      fStats.dropped++;
+      return;
+    }
+    auto delay = std::chrono::microseconds(fOptions.delay);
+    if (fOptions.jitter.count() > 0)
+      delay += std::chrono::microseconds(std::uniform_int_distribution<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::microseconds>(fOptions.jitter).count())(fRandom));
+    fQueue.insert({now + delay, {data, peer}});
+  }
+
+  /**
+   * @brief sends every datagram whose delay has passed
+   */
+  void flush(Clock::time_point now, const SendHandler &send) {
+    while (!fQueue.empty() && fQueue.begin()->first <= now) {
+      send(fQueue.begin()->second.data, fQueue.begin()->second.peer);
+      fQueue.erase(fQueue.begin());
+    }
+  }
+
+  Clock::time_point nextDue() const {
+    return fQueue.empty() ? Clock::time_point::max() : fQueue.begin()->first;
+  }
+};
+
+
+#endif //TERMINUS_LOSSSIMULATOR_H
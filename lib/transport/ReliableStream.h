@@ -0,0 +1,349 @@
+#ifndef TERMINUS_RELIABLESTREAM_H
+#define TERMINUS_RELIABLESTREAM_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @brief reliable in-order byte stream over datagrams, tuned for small interactive writes
+ * @note every segment acknowledges the peer cumulatively and selectively. A segment counts as lost once three
+ * segments sent after it were acknowledged, or when the retransmission timeout fires, which stays short and
+ * backs off far less than tcp does. New data is paced over the round trip time. Not thread safe.
+ */
+class ReliableStream {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    uint64_t segments = 0;
+    uint64_t retransmits = 0;
+    uint64_t timeouts = 0;
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+  };
+
+  static constexpr size_t MAX_PAYLOAD = 1200;
+  static constexpr size_t HEADER_SIZE = 13;
+  static constexpr uint32_t MAX_WINDOW = 256;
+private:
+  static constexpr uint8_t FLAG_FIN = 0x01;
+  static constexpr uint32_t INITIAL_WINDOW = 32;
+  static constexpr uint32_t MIN_WINDOW = 4;
+  static constexpr uint32_t REORDER_THRESHOLD = 3;
+  static constexpr uint32_t SACK_BITS = 32;
+  static constexpr double PACING_BURST = 4;
+  static constexpr std::chrono::microseconds INITIAL_RTT = std::chrono::milliseconds(100);
+  static constexpr std::chrono::microseconds MIN_RTO = std::chrono::milliseconds(30);
+  static constexpr std::chrono::microseconds MAX_RTO = std::chrono::milliseconds(1000);
+
+  struct Segment {
+    std::string payload;
+    bool fin = false;
+    bool sacked = false;
+    bool lost = false;
+    unsigned transmissions = 0;
+    uint64_t transmitIndex = 0;
+    Clock::time_point sentAt;
+  };
+private:
+  // sender
+  std::map<uint32_t, Segment> fInFlight;
+  std::string fPending;
+  size_t fInFlightBytes = 0;
+  uint32_t fNextSeq = 1;
+  uint64_t fNextTransmitIndex = 1;
+  uint64_t fHighestAckedIndex = 0;
+  uint32_t fRecoverySeq = 0;
+  double fWindow = INITIAL_WINDOW;
+  bool fFinishing = false;
+  bool fFinQueued = false;
+  std::chrono::microseconds fSrtt = INITIAL_RTT;
+  std::chrono::microseconds fRttVar = INITIAL_RTT / 2;
+  std::chrono::microseconds fRto = INITIAL_RTT * 3;
+  bool fHaveRtt = false;
+  Clock::time_point fRtoDeadline = Clock::time_point::max();
+  double fPacingTokens = PACING_BURST;
+  Clock::time_point fPacingUpdate;
+  // receiver
+  uint32_t fReceived = 0;
+  std::map<uint32_t, std::pair<std::string, bool>> fOutOfOrder;
+  bool fAckPending = false;
+  bool fPeerFinished = false;
+  Stats fStats;
+public:
+
+  /**
+   * @return how many more bytes may be queued, zero while the window is full
+   */
+  size_t writable() const {
+    auto limit = (size_t) MAX_WINDOW * MAX_PAYLOAD;
+    auto used = fPending.size() + fInFlightBytes;
+    return fFinishing || used >= limit ? 0 : limit - used;
+  }
+
+  void write(const char *data, size_t len) {
+    if (!fFinishing) fPending.append(data, len);
+  }
+
+  /**
+   * @brief the peer learns that nothing follows once everything written so far was delivered
+   */
+  void finish() {
+    fFinishing = true;
+  }
+
+  /**
+   * @brief true once the peer finished its side and everything it sent was delivered
+   */
+  bool peerFinished() const {
+    return fPeerFinished;
+  }
+
+  /**
+   * @brief true once both sides finished and nothing is waiting for an acknowledgement
+   */
+  bool closed() const {
+    return fPeerFinished && fFinQueued && fInFlight.empty();
+  }
+
+  size_t inFlight() const {
+    return fInFlight.size();
+  }
+
+  uint32_t window() const {
+    return (uint32_t) fWindow;
+  }
+
+  std::chrono::microseconds rtt() const {
+    return fSrtt;
+  }
+
+  std::chrono::microseconds rto() const {
+    return fRto;
+  }
+
+  const Stats &getStats() const {
+    return fStats;
+  }
+
+  /**
+   * @brief processes a segment of the peer
+   * @param acceptData false drops the payload while the caller cannot take more, only the acknowledgements are used
+   * @return newly delivered bytes in order
+   */
+  std::string receive(const std::string &segment, Clock::time_point now, bool acceptData = true) {
+    std::string delivered;
+    if (segment.size() < HEADER_SIZE) return delivered;
+    auto seq = readLe(segment, 0);
+    auto ack = readLe(segment, 4);
+    auto sack = readLe(segment, 8);
+    auto flags = (uint8_t) segment[12];
+    acknowledge(ack, sack, now);
+    if (seq == 0 || !acceptData) return delivered;
+
+    fStats.received++;
+    fAckPending = true;
+    if (seq <= fReceived || seq > fReceived + MAX_WINDOW || fOutOfOrder.count(seq)) {
+      fStats.duplicates++;
+      return delivered;
+    }
+    fOutOfOrder[seq] = {segment.substr(HEADER_SIZE), (flags & FLAG_FIN) != 0};
+    for (auto item = fOutOfOrder.begin(); item != fOutOfOrder.end() && item->first == fReceived + 1;) {
+      delivered += item->second.first;
+      if (item->second.second) fPeerFinished = true;
+      fReceived++;
+      item = fOutOfOrder.erase(item);
+    }
+    return delivered;
+  }
+
+  /**
+   * @return segments to send now, lost segments first, then new data as far as window and pacing allow
+   */
+  std::vector<std::string> poll(Clock::time_point now) {
+    std::vector<std::string> segments;
+    if (!fInFlight.empty() && now >= fRtoDeadline) onTimeout(now);
+
+    for (auto &item : fInFlight) {
+      if (!item.second.lost) continue;
+      item.second.lost = false;
+      fStats.retransmits++;
+      segments.push_back(transmit(item.first, item.second, now));
+    }
+
+    refillPacing(now);
+    while (fInFlight.size() < (size_t) fWindow && fPacingTokens >= 1) {
+      if (fPending.empty() && !(fFinishing && !fFinQueued)) break;
+      Segment segment;
+      auto size = std::min(fPending.size(), MAX_PAYLOAD);
+      segment.payload = fPending.substr(0, size);
+      fPending.erase(0, size);
+      if (fPending.empty() && fFinishing) {
+        segment.fin = true;
+        fFinQueued = true;
+      }
+      auto seq = fNextSeq++;
+      fInFlightBytes += segment.payload.size();
+      auto &stored = fInFlight[seq] = segment;
+      segments.push_back(transmit(seq, stored, now));
+      fPacingTokens -= 1;
+    }
+
+    if (segments.empty() && fAckPending) segments.push_back(encode(0, {}, false));
+    fAckPending = false;
+    if (!fInFlight.empty() && fRtoDeadline == Clock::time_point::max()) fRtoDeadline = now + fRto;
+    return segments;
+  }
+
+  /**
+   * @return segment acknowledging what was received so far, used to keep an idle path alive
+   */
+  std::string makeAck() {
+    fAckPending = false;
+    return encode(0, {}, false);
+  }
+
+  /**
+   * @return when poll has something to send next, time_point::max() if it waits for the peer or for more data
+   */
+  Clock::time_point nextDeadline(Clock::time_point now) const {
+    if (fAckPending) return now;
+    auto deadline = fInFlight.empty() ? Clock::time_point::max() : fRtoDeadline;
+    for (auto &item : fInFlight)
+      if (item.second.lost) return now;
+    bool hasData = !fPending.empty() || (fFinishing && !fFinQueued);
+    if (hasData && fInFlight.size() < (size_t) fWindow) {
+      if (fPacingTokens >= 1) return now;
+      auto wait = std::chrono::duration_cast<Clock::duration>(pacingInterval() * (1 - fPacingTokens));
+      deadline = std::min(deadline, fPacingUpdate + wait);
+    }
+    return deadline;
+  }
+
+private:
+
+  static uint32_t readLe(const std::string &data, size_t offset) {
+    uint32_t ret = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); i++)
+      ret |= (uint32_t) (uint8_t) data[offset + i] << (i * 8);
+    return ret;
+  }
+
+  static void appendLe(std::string &data, uint32_t value) {
+    for (size_t i = 0; i < sizeof(uint32_t); i++)
+      data += (char) ((value >> (i * 8)) & 0xff);
+  }
+
+  std::string encode(uint32_t seq, const std::string &payload, bool fin) const {
+    uint32_t sack = 0;
+    for (auto &item : fOutOfOrder) {
+      auto bit = item.first - fReceived - 2;
+      if (bit < SACK_BITS) sack |= 1u << bit;
+    }
+    std::string segment;
+    segment.reserve(HEADER_SIZE + payload.size());
+    appendLe(segment, seq);
+    appendLe(segment, fReceived);
+    appendLe(segment, sack);
+    segment += (char) (fin ? FLAG_FIN : 0);
+    segment += payload;
+    return segment;
+  }
+
+  std::string transmit(uint32_t seq, Segment &segment, Clock::time_point now) {
+    segment.transmissions++;
+    segment.transmitIndex = fNextTransmitIndex++;
+    segment.sentAt = now;
+    fStats.segments++;
+    return encode(seq, segment.payload, segment.fin);
+  }
+
+  std::chrono::microseconds pacingInterval() const {
+    return std::max(std::chrono::microseconds(1), fSrtt / (int64_t) std::max(1.0, fWindow));
+  }
+
+  void refillPacing(Clock::time_point now) {
+    if (fPacingUpdate == Clock::time_point()) fPacingUpdate = now;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - fPacingUpdate);
+    fPacingTokens = std::min(PACING_BURST, fPacingTokens + (double) elapsed.count() / (double) pacingInterval().count());
+    fPacingUpdate = now;
+  }
+
+  void acknowledge(uint32_t ack, uint32_t sack, Clock::time_point now) {
+    bool progress = false;
+    for (auto item = fInFlight.begin(); item != fInFlight.end();) {
+      auto seq = item->first;
+      auto &segment = item->second;
+      bool acked = seq <= ack;
+      auto bit = seq - ack - 2;
+      bool sacked = !acked && seq > ack + 1 && bit < SACK_BITS && (sack & (1u << bit));
+      if (!acked && !(sacked && !segment.sacked)) {
+        ++item;
+        continue;
+      }
+      if (!segment.sacked) {
+        // samples of retransmitted segments are ambiguous and skipped
+        if (segment.transmissions == 1) updateRtt(now - segment.sentAt);
+        fHighestAckedIndex = std::max(fHighestAckedIndex, segment.transmitIndex);
+        fWindow = std::min((double) MAX_WINDOW, fWindow + 1 / fWindow);
+        progress = true;
+      }
+      if (acked) {
+        fInFlightBytes -= segment.payload.size();
+        item = fInFlight.erase(item);
+      } else {
+        segment.sacked = true;
+        segment.lost = false;
+        ++item;
+      }
+    }
+    if (!progress) return;
+    fRtoDeadline = fInFlight.empty() ? Clock::time_point::max() : now + fRto;
+    for (auto &item : fInFlight) {
+      auto &segment = item.second;
+      if (segment.sacked || segment.lost || segment.transmitIndex + REORDER_THRESHOLD > fHighestAckedIndex) continue;
+      segment.lost = true;
+      onLoss(item.first);
+    }
+  }
+
+  void onLoss(uint32_t seq) {
+    // one reduction per window of data
+    if (seq <= fRecoverySeq) return;
+    fRecoverySeq = fNextSeq - 1;
+    fWindow = std::max((double) MIN_WINDOW, fWindow / 2);
+  }
+
+  void onTimeout(Clock::time_point now) {
+    fStats.timeouts++;
+    for (auto &item : fInFlight) {
+      if (item.second.sacked) continue;
+      item.second.lost = true;
+      onLoss(item.first);
+      break;
+    }
+    fRto = std::min(MAX_RTO, fRto * 3 / 2);
+    fRtoDeadline = now + fRto;
+  }
+
+  void updateRtt(Clock::duration sample) {
+    auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(sample);
+    if (!fHaveRtt) {
+      fSrtt = rtt;
+      fRttVar = rtt / 2;
+      fHaveRtt = true;
+    } else {
+      auto delta = rtt > fSrtt ? rtt - fSrtt : fSrtt - rtt;
+      fRttVar = (fRttVar * 3 + delta) / 4;
+      fSrtt = (fSrtt * 7 + rtt) / 8;
+    }
+    fRto = std::min(MAX_RTO, std::max(MIN_RTO, fSrtt + std::max(std::chrono::microseconds(std::chrono::milliseconds(10)), fRttVar * 4)));
+  }
+};
+
+
+#endif //TERMINUS_RELIABLESTREAM_H
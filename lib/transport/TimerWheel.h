@@ -0,0 +1,132 @@
+#ifndef TERMINUS_TIMERWHEEL_H
+#define TERMINUS_TIMERWHEEL_H
+
+#include <list>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+/**
+ * @brief hierarchical timing wheel, scheduling and cancelling take constant time however many timers run
+ * @note not thread safe. Timers far ahead sit in coarse slots and move down a level as their time comes closer,
+ * so each timer is touched at most once per level before it fires
+ */
+class TimerWheel {
+public:
+  using Clock = std::chrono::steady_clock;
+  using TimerId = uint64_t;
+  using Callback = std::function<void()>;
+
+  static constexpr int LEVELS = 4;
+  static constexpr int SLOT_BITS = 6;
+  static constexpr int SLOTS = 1 << SLOT_BITS;
+  /*! later timers fire at this many ticks, about 46 hours with a tick of 10 ms */
+  static constexpr uint64_t MAX_TICKS = ((uint64_t) 1 << (SLOT_BITS * LEVELS)) - 1;
+private:
+  struct Timer {
+    uint64_t expiry;
+    int level;
+    int slot;
+    std::list<TimerId>::iterator position;
+    Callback callback;
+  };
+private:
+  Clock::duration fTick;
+  Clock::time_point fStart;
+  uint64_t fNow = 0;
+  TimerId fNextId = 1;
+  std::list<TimerId> fSlots[LEVELS][SLOTS];
+  std::unordered_map<TimerId, Timer> fTimers;
+public:
+  explicit TimerWheel(Clock::duration tick, Clock::time_point start = Clock::now()) :
+    fTick(tick > Clock::duration::zero() ? tick : Clock::duration(1)), fStart(start) {
+  }
+
+  Clock::duration getTick() const {
+    return fTick;
+  }
+
+  size_t size() const {
+    return fTimers.size();
+  }
+
+  /**
+   * @brief calls callback once delay passed, rounded up to whole ticks
+   */
+  TimerId schedule(Clock::duration delay, Callback callback) {
+    auto ticks = (uint64_t) std::max<Clock::rep>(1, (delay.count() + fTick.count() - 1) / fTick.count());
+    auto id = fNextId++;
+    auto &timer = fTimers[id];
+    timer.expiry = fNow + std::min(ticks, MAX_TICKS);
+    timer.callback = std::move(callback);
+    place(id, timer);
+    return id;
+  }
+
+  /**
+   * @return false if the timer already fired or was cancelled
+   */
+  bool cancel(TimerId id) {
+    auto item = fTimers.find(id);
+    if (item == fTimers.end()) return false;
+    fSlots[item->second.level][item->second.slot].erase(item->second.position);
+    fTimers.erase(item);
+    return true;
+  }
+
+  /**
+   * @brief fires the timers due until now, their callbacks may schedule and cancel timers
+   * @return number of timers fired
+   */
+  size_t advance(Clock::time_point now) {
+    if (now < fStart) return 0;
+    auto target = (uint64_t) ((now - fStart) / fTick);
+    size_t fired = 0;
+    while (fNow < target)
+      fired += tick();
+    return fired;
+  }
+
+private:
+
+  size_t tick() {
+    fNow++;
+    // coarse slots first, their timers may land in the finer slots processed next
+    for (int level = LEVELS - 1; level > 0; level--) {
+      if (fNow & (((uint64_t) 1 << (SLOT_BITS * level)) - 1)) continue;
+      auto &slot = fSlots[level][(fNow >> (SLOT_BITS * level)) & (SLOTS - 1)];
+      while (!slot.empty()) {
+        auto id = slot.front();
+        slot.pop_front();
+        place(id, fTimers[id]);
+      }
+    }
+    size_t fired = 0;
+    auto &slot = fSlots[0][fNow & (SLOTS - 1)];
+    while (!slot.empty()) {
+      auto id = slot.front();
+      slot.pop_front();
+      auto item = fTimers.find(id);
+      auto callback = std::move(item->second.callback);
+      fTimers.erase(item);
+      callback();
+      fired++;
+    }
+    return fired;
+  }
+
+  void place(TimerId id, Timer &timer) {
+    auto delta = timer.expiry > fNow ? timer.expiry - fNow : 0;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= ((uint64_t) 1 << (SLOT_BITS * (level + 1)))) level++;
+    // a cascaded timer due now goes to the slot fired next in this tick
+    timer.level = level;
+    timer.slot = (int) (((delta == 0 ? fNow : timer.expiry) >> (SLOT_BITS * level)) & (SLOTS - 1));
+    auto &slot = fSlots[level][timer.slot];
+    timer.position = slot.insert(slot.end(), id);
+  }
+};
+
+#endif //TERMINUS_TIMERWHEEL_H
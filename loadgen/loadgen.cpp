@@ -0,0 +1,623 @@
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <cxxopts.hpp>
+#include <logger/Logger.h>
+#include <client/MessageClient.h>
+#include <client/RetransmitWindow.h>
+#include <client/OutputCoalescer.h>
+#include <message/MessageParser.h>
+#include <message/FrameReader.h>
+#include <metrics/Metrics.h>
+
+/**
+ * @brief opens pairs of synthetic masters and slaves on a server and replays traffic between them
+ * @note both ends run in this process, so frames are timed on one clock from being sent to being received.
+ * Sessions are spread over workers, each with a thread receiving through epoll and one sending. Receiving threads
+ * never send, a receiver blocked on a full socket could otherwise hold up the reads the server waits for
+ */
+class TerminusLoadApplication {
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Shape {
+    /*! keystrokes at a human pace, each echoed by the slave */
+    Typing = 0,
+    /*! typing, plus bursts of output as from commands */
+    Bursty = 1,
+    /*! output as fast as the server takes it, or at --flood-rate */
+    Flood = 2,
+  };
+
+  /*! what a frame carries, latencies are kept apart for each */
+  enum class Traffic {
+    Keystroke = 0,
+    Echo = 1,
+    Output = 2,
+  };
+  static constexpr int TRAFFIC_COUNT = 3;
+
+  static constexpr int DEFAULT_SESSIONS = 100;
+  static constexpr int DEFAULT_DURATION_S = 30;
+  static constexpr int DEFAULT_KEY_RATE = 5;
+  static constexpr int DEFAULT_BURST_SIZE = 16 * 1024;
+  static constexpr int DEFAULT_BURST_INTERVAL_MS = 1000;
+  static constexpr int DEFAULT_CHUNK_SIZE = 4096;
+  static constexpr int MAX_EVENTS = 64;
+  /*! longest a sending thread sleeps, new sessions start within it */
+  static constexpr int IDLE_WAIT_MS = 1;
+  static constexpr int EPOLL_WAIT_MS = 100;
+
+  struct Session;
+
+  /*! one end of a session */
+  struct Peer {
+    Session *session = nullptr;
+    bool master = false;
+    std::shared_ptr<MessageClient> client;
+    /*! only used by the receiving thread */
+    FrameReader reader;
+    /*! the rest is guarded by the session mutex */
+    RetransmitWindow window;
+    /*! frames this end sent which the other end has not received yet, in order */
+    std::deque<std::pair<Clock::time_point, Traffic>> inFlight;
+    bool ready = false;
+  };
+
+  struct Session {
+    std::string id;
+    Shape shape = Shape::Typing;
+    Peer master, slave;
+    std::mutex mutex;
+    /*! keystrokes the slave still has to echo */
+    std::string echo;
+    Clock::time_point connectStart, nextKey, nextBurst, floodStart;
+    uint64_t flooded = 0;
+    std::mt19937 random;
+    std::atomic<bool> running{false};
+    std::atomic<bool> failed{false};
+  };
+
+  struct Worker {
+    int epoll = -1;
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Session>> sessions;
+    std::thread receiver;
+    std::thread sender;
+  };
+
+  /*! totals of a direction, to the slave are keystrokes, to the master everything else */
+  struct Totals {
+    Counter bytes;
+    Counter frames;
+  };
+private:
+  cxxopts::Options fOptions;
+  std::string fServerAddress;
+  int fServerPort = -1;
+  std::string fServerLogin;
+  std::string fServerKey;
+  bool fVerbose = false;
+  std::string fPrefix = "loadgen";
+  int fSessions = DEFAULT_SESSIONS;
+  std::vector<Shape> fShapes = {Shape::Typing};
+  int fDuration = DEFAULT_DURATION_S;
+  double fConnectRate = 0;
+  int fWorkerCount = (int) std::max(1u, std::thread::hardware_concurrency());
+  double fKeyRate = DEFAULT_KEY_RATE;
+  size_t fBurstSize = DEFAULT_BURST_SIZE;
+  int fBurstInterval = DEFAULT_BURST_INTERVAL_MS;
+  double fFloodRate = 0;
+  size_t fChunkSize = DEFAULT_CHUNK_SIZE;
+  uint32_t fCapabilities = ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING |
+                           ConnectOptions::CAPABILITY_BINARY_METADATA;
+  std::shared_ptr<MessageParser> fMessageParser;
+  std::vector<std::unique_ptr<Worker>> fWorkers;
+  std::string fOutput;
+  /*! fSending ends the sending threads, fStopping tells connections closed by this side from failed ones */
+  std::atomic<bool> fSending{true};
+  std::atomic<bool> fStopping{false};
+  std::atomic<bool> fReceiving{true};
+  /*! latencies count once all sessions are up, so they are not mixed with the ramp */
+  std::atomic<bool> fMeasuring{false};
+  Gauge fRunning;
+  Counter fFailed;
+  Histogram fConnectTimes;
+  Histogram fLatencies[TRAFFIC_COUNT];
+  Totals fToSlave, fToMaster;
+public:
+
+  TerminusLoadApplication() : fOptions("Terminus load generator") {
+    fOptions.add_options()
+      ("v,verbose", "enable verbose output", cxxopts::value<bool>())
+      ("p,port", "server port", cxxopts::value<int>())
+      ("a,address", "server address", cxxopts::value<std::string>())
+      ("l,login", "server login", cxxopts::value<std::string>())
+      ("k,key", "server key", cxxopts::value<std::string>())
+      ("i,identifier", "prefix of session ids, sessions are <prefix>-<number>", cxxopts::value<std::string>())
+      ("s,sessions", "master and slave pairs to open", cxxopts::value<int>())
+      ("shape", "traffic of the sessions, typing, bursty or flood, a comma separated list is dealt out in turn",
+       cxxopts::value<std::string>())
+      ("d,duration", "seconds to run once all sessions are up", cxxopts::value<int>())
+      ("connect-rate", "sessions opened per second, 0 opens them as fast as possible", cxxopts::value<double>())
+      ("workers", "threads receiving and threads sending, one of each per worker", cxxopts::value<int>())
+      ("key-rate", "keystrokes per second of a typing session", cxxopts::value<double>())
+      ("burst-size", "output in bytes of one burst (bursty)", cxxopts::value<int>())
+      ("burst-interval", "milliseconds between bursts (bursty)", cxxopts::value<int>())
+      ("flood-rate", "output in KB/s of a session, 0 sends as fast as the server takes it (flood)",
+       cxxopts::value<double>())
+      ("chunk-size", "bytes of output per frame", cxxopts::value<int>())
+      ("wire-format", "compact or legacy framing, compact is used if the server supports it", cxxopts::value<std::string>());
+  }
+
+  int process(int argc, char **argv) {
+    if (!parseOptions(argc, argv)) {
+      DCRITICAL("%s", fOptions.help().c_str());
+      return -1;
+    }
+    if (fVerbose) Logger::init(Logger::LogLevel::LogLevelDebug);
+    raiseFileLimit();
+
+    fMessageParser = std::make_shared<MessageParser>(fServerLogin, fServerKey);
+    fOutput = makeOutput(OutputCoalescer::MAX_BATCH_SIZE);
+    for (int i = 0; i < fWorkerCount; i++) {
+      auto worker = std::unique_ptr<Worker>(new Worker());
+      worker->epoll = epoll_create1(EPOLL_CLOEXEC);
+      if (worker->epoll == -1) {
+        DCRITICAL("failed to create epoll instance");
+        return -1;
+      }
+      fWorkers.push_back(std::move(worker));
+    }
+    for (auto &worker : fWorkers) {
+      worker->receiver = std::thread(&TerminusLoadApplication::receiveTask, this, std::ref(*worker));
+      worker->sender = std::thread(&TerminusLoadApplication::sendTask, this, std::ref(*worker));
+    }
+
+    auto rampStart = Clock::now();
+    auto opened = openSessions();
+    // sessions still waiting for the server are given a moment
+    auto settle = Clock::now() + std::chrono::seconds(5);
+    while (fRunning.value() + (int64_t) fFailed.value() < fSessions && Clock::now() < settle)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto ramp = std::chrono::duration<double>(Clock::now() - rampStart).count();
+    printf("connected %ld of %d sessions in %.2f s, %.1f sessions/s, %lu failed\n", (long) fRunning.value(), fSessions,
+           ramp, ramp > 0 ? (double) fRunning.value() / ramp : 0, fFailed.value());
+
+    fMeasuring = true;
+    auto start = Clock::now();
+    auto toSlave = snapshot(fToSlave), toMaster = snapshot(fToMaster);
+    auto last = start;
+    auto lastToSlave = toSlave, lastToMaster = toMaster;
+    for (int second = 1; second <= fDuration; second++) {
+      std::this_thread::sleep_until(start + std::chrono::seconds(second));
+      auto now = Clock::now();
+      auto elapsed = std::chrono::duration<double>(now - last).count();
+      auto currentToSlave = snapshot(fToSlave), currentToMaster = snapshot(fToMaster);
+      printf("[%3d s] sessions: %ld, failed: %lu, to slave: %s, to master: %s\n", second, (long) fRunning.value(),
+             fFailed.value(), formatRate(currentToSlave, lastToSlave, elapsed).c_str(),
+             formatRate(currentToMaster, lastToMaster, elapsed).c_str());
+      fflush(stdout);
+      last = now;
+      lastToSlave = currentToSlave;
+      lastToMaster = currentToMaster;
+    }
+    fMeasuring = false;
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    auto endToSlave = snapshot(fToSlave), endToMaster = snapshot(fToMaster);
+
+    stop();
+
+    printf("\nsessions: %d opened, %lu failed\n", opened, fFailed.value());
+    printSnapshot("connect", fConnectTimes.snapshot());
+    printf("throughput over %.1f s\n", elapsed);
+    printf("  to slave: %s\n", formatRate(endToSlave, toSlave, elapsed).c_str());
+    printf("  to master: %s\n", formatRate(endToMaster, toMaster, elapsed).c_str());
+    printf("relay latency\n");
+    for (auto traffic : {Traffic::Keystroke, Traffic::Echo, Traffic::Output})
+      printSnapshot(getTrafficName(traffic), fLatencies[(int) traffic].snapshot());
+    return fFailed.value() > 0 ? 1 : 0;
+  }
+
+private:
+
+  bool parseOptions(int argc, char **argv) {
+    try {
+      auto result = fOptions.parse(argc, argv);
+      fServerPort = result["port"].as<int>();
+      fServerAddress = result["address"].as<std::string>();
+      fVerbose = result["verbose"].as<bool>();
+      fServerLogin = result["login"].as<std::string>();
+      fServerKey = result["key"].as<std::string>();
+      if (result.count("identifier"))
+        fPrefix = result["identifier"].as<std::string>();
+      if (result.count("sessions"))
+        fSessions = result["sessions"].as<int>();
+      if (result.count("shape") && !parseShapes(result["shape"].as<std::string>()))
+        return false;
+      if (result.count("duration"))
+        fDuration = result["duration"].as<int>();
+      if (result.count("connect-rate"))
+        fConnectRate = result["connect-rate"].as<double>();
+      if (result.count("workers"))
+        fWorkerCount = std::max(1, result["workers"].as<int>());
+      if (result.count("key-rate"))
+        fKeyRate = result["key-rate"].as<double>();
+      if (result.count("burst-size"))
+        fBurstSize = (size_t) std::max(1, result["burst-size"].as<int>());
+      if (result.count("burst-interval"))
+        fBurstInterval = std::max(1, result["burst-interval"].as<int>());
+      if (result.count("flood-rate"))
+        fFloodRate = result["flood-rate"].as<double>() * 1024;
+      if (result.count("chunk-size"))
+        fChunkSize = (size_t) std::max(1, result["chunk-size"].as<int>());
+      // output is sent in frames like those of a slave
+      fChunkSize = std::min(fChunkSize, OutputCoalescer::MAX_BATCH_SIZE);
+      if (result.count("wire-format")) {
+        auto format = result["wire-format"].as<std::string>();
+        if (format != "compact" && format != "legacy") return false;
+        // batches need the compact format
+        if (format == "legacy") fCapabilities &= ~(ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING);
+      }
+      if (fSessions <= 0 || fDuration < 0 || fKeyRate <= 0) return false;
+    } catch (...) {
+      return false;
+    }
+    return true;
+  }
+
+  bool parseShapes(const std::string &list) {
+    fShapes.clear();
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+      if (name == "typing") fShapes.push_back(Shape::Typing);
+      else if (name == "bursty") fShapes.push_back(Shape::Bursty);
+      else if (name == "flood") fShapes.push_back(Shape::Flood);
+      else return false;
+    }
+    return !fShapes.empty();
+  }
+
+  static const char *getTrafficName(Traffic traffic) {
+    switch (traffic) {
+      case Traffic::Keystroke:
+        return "keystroke";
+      case Traffic::Echo:
+        return "echo";
+      case Traffic::Output:
+        break;
+    }
+    return "output";
+  }
+
+  /**
+   * @brief every session takes two sockets, thousands of them do not fit into the usual soft limit
+   */
+  static void raiseFileLimit() {
+    rlimit limit = {};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == limit.rlim_max) return;
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0) DWARN("failed to raise the limit of open files");
+  }
+
+  /**
+   * @brief lines of text like those of a listing, output frames are cut from it
+   */
+  static std::string makeOutput(size_t size) {
+    std::string output;
+    for (int line = 0; output.size() < size; line++)
+      output += "loadgen output line " + std::to_string(line) + " of synthetic slave output\r\n";
+    output.resize(size);
+    return output;
+  }
+
+  /**
+   * @return number of sessions whose connections were opened
+   */
+  int openSessions() {
+    auto start = Clock::now();
+    int opened = 0;
+    for (int i = 0; i < fSessions; i++) {
+      if (fConnectRate > 0)
+        std::this_thread::sleep_until(start + std::chrono::microseconds((int64_t) (i * 1000000.0 / fConnectRate)));
+      auto session = std::make_shared<Session>();
+      session->id = fPrefix + "-" + std::to_string(i);
+      session->shape = fShapes[i % fShapes.size()];
+      session->random.seed((uint32_t) i);
+      session->connectStart = Clock::now();
+      for (auto peer : {&session->slave, &session->master}) {
+        peer->session = session.get();
+        peer->master = peer == &session->master;
+        peer->client = std::make_shared<MessageClient>();
+      }
+      auto &worker = *fWorkers[i % fWorkers.size()];
+      {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.sessions.push_back(session);
+      }
+      // the slave connects first like it would in practice, neither end sends before both are registered
+      if (!connectPeer(worker, session->slave) || !connectPeer(worker, session->master)) {
+        fail(*session);
+        continue;
+      }
+      opened++;
+    }
+    return opened;
+  }
+
+  bool connectPeer(Worker &worker, Peer &peer) {
+    if (!peer.client->connect(fServerAddress, fServerPort, false)) return false;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = &peer;
+    if (epoll_ctl(worker.epoll, EPOLL_CTL_ADD, peer.client->getSocket(), &event) == -1) return false;
+    ConnectOptions opts(peer.master ? ConnectionType::TypeMaster : ConnectionType::TypeSlave, peer.session->id);
+    opts.setCapabilities(fCapabilities);
+    return sendEnvelope(MessageFactory::create<ConnectMessage>(opts), *peer.client);
+  }
+
+  /**
+   * @brief closes both ends, the server notices at once and frees the session
+   */
+  void fail(Session &session) {
+    if (session.failed.exchange(true)) return;
+    if (!fStopping) {
+      fFailed.add();
+      DWARN("session %s failed", session.id.c_str());
+    }
+    {
+      // taken after failed is set, so a session cannot start running meanwhile
+      std::lock_guard<std::mutex> lock(session.mutex);
+      if (session.running.exchange(false)) fRunning.sub();
+    }
+    for (auto peer : {&session.master, &session.slave})
+      peer->client->disconnect();
+  }
+
+  void stop() {
+    fSending = false;
+    for (auto &worker : fWorkers)
+      worker->sender.join();
+    fStopping = true;
+    for (auto &worker : fWorkers)
+      for (auto &session : worker->sessions)
+        fail(*session);
+    fReceiving = false;
+    for (auto &worker : fWorkers) {
+      worker->receiver.join();
+      close(worker->epoll);
+    }
+  }
+
+  void receiveTask(Worker &worker) {
+    epoll_event events[MAX_EVENTS];
+    while (fReceiving) {
+      auto count = epoll_wait(worker.epoll, events, MAX_EVENTS, EPOLL_WAIT_MS);
+      for (int i = 0; i < count; i++) {
+        auto &peer = *(Peer *) events[i].data.ptr;
+        if (!receive(peer)) {
+          epoll_ctl(worker.epoll, EPOLL_CTL_DEL, peer.client->getSocket(), nullptr);
+          fail(*peer.session);
+        }
+      }
+    }
+  }
+
+  /**
+   * @return false once the connection is closed or sent something unexpected
+   */
+  bool receive(Peer &peer) {
+    auto buffer = peer.client->receiveData();
+    if (buffer.getSize() == 0) return false;
+    peer.reader.append(buffer.getDataPtr(), buffer.getSize());
+    Buffer frame;
+    while (peer.reader.next(frame)) {
+      auto msg = fMessageParser->parse(frame.getDataPtr(), frame.getSize());
+      if (!msg) return false;
+      if (msg->getId() != BatchMessage::id) {
+        if (!dispatchMessage(peer, msg)) return false;
+        continue;
+      }
+      auto batch = msg->cast<BatchMessage>();
+      for (auto &data : batch.getMessages()) {
+        auto batched = fMessageParser->parse((const uint8_t *) data.data(), data.size());
+        if (!batched || !dispatchMessage(peer, batched)) return false;
+      }
+    }
+    return !peer.reader.failed();
+  }
+
+  bool dispatchMessage(Peer &peer, const Message::Ptr &msg) {
+    auto &session = *peer.session;
+    if (peer.client->acceptCapabilities(*msg)) {
+      connected(peer);
+      return true;
+    }
+    // heartbeats and the like, no session frame
+    if (msg->getId() != SequencedMessage::id) return true;
+    auto sequenced = msg->cast<SequencedMessage>();
+    if (sequenced.getSeq() == 0) {
+      // a pure ack
+      std::lock_guard<std::mutex> lock(session.mutex);
+      peer.window.accept(sequenced);
+      return true;
+    }
+    auto &payload = sequenced.getPayload();
+    // the frame is decoded like the peer would, outside of the session lock
+    auto inner = fMessageParser->parse((const uint8_t *) payload.data(), payload.size());
+    if (!inner) return false;
+    auto received = Clock::now();
+    std::lock_guard<std::mutex> lock(session.mutex);
+    if (!peer.window.accept(sequenced)) return true;
+    auto &sender = peer.master ? session.slave : session.master;
+    // the server relays in order and drops nothing while both ends are connected
+    if (sender.inFlight.empty()) return false;
+    auto sent = sender.inFlight.front();
+    sender.inFlight.pop_front();
+    auto &totals = peer.master ? fToMaster : fToSlave;
+    totals.bytes.add(payload.size());
+    totals.frames.add();
+    if (fMeasuring)
+      fLatencies[(int) sent.second].record(std::chrono::duration_cast<std::chrono::microseconds>(received - sent.first));
+    if (sent.second == Traffic::Keystroke && inner->getId() == PutCharMessage::id)
+      session.echo += inner->cast<PutCharMessage>().getChars();
+    return true;
+  }
+
+  void connected(Peer &peer) {
+    auto &session = *peer.session;
+    std::lock_guard<std::mutex> lock(session.mutex);
+    peer.ready = true;
+    if (!session.master.ready || !session.slave.ready || session.failed) return;
+    auto now = Clock::now();
+    fConnectTimes.record(std::chrono::duration_cast<std::chrono::microseconds>(now - session.connectStart));
+    // spread out so the sessions do not type in lockstep
+    session.nextKey = now + randomDelay(session, getKeyInterval());
+    session.nextBurst = now + randomDelay(session, std::chrono::milliseconds(fBurstInterval));
+    session.floodStart = now;
+    fRunning.add();
+    session.running = true;
+  }
+
+  std::chrono::microseconds getKeyInterval() const {
+    return std::chrono::microseconds((int64_t) (1000000 / fKeyRate));
+  }
+
+  static std::chrono::microseconds randomDelay(Session &session, std::chrono::microseconds max) {
+    return std::chrono::microseconds(std::uniform_int_distribution<int64_t>(0, std::max<int64_t>(0, max.count()))(session.random));
+  }
+
+  void sendTask(Worker &worker) {
+    std::vector<std::shared_ptr<Session>> sessions;
+    while (fSending) {
+      {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (sessions.size() != worker.sessions.size()) sessions = worker.sessions;
+      }
+      auto now = Clock::now();
+      auto wake = now + std::chrono::milliseconds(IDLE_WAIT_MS);
+      bool busy = false;
+      for (auto &session : sessions) {
+        if (!session->running) continue;
+        busy = pump(*session, now, wake) || busy;
+      }
+      if (!busy) std::this_thread::sleep_until(wake);
+    }
+  }
+
+  /**
+   * @brief sends what is due for a session
+   * @param wake lowered to when the session has something to send next
+   * @return true if the session has more to send right away
+   */
+  bool pump(Session &session, Clock::time_point now, Clock::time_point &wake) {
+    std::vector<Message::Ptr> toSlave, toMaster;
+    bool busy = false;
+    {
+      std::lock_guard<std::mutex> lock(session.mutex);
+      if (session.shape != Shape::Flood) {
+        // a late thread catches up with one keystroke per pass, typing is not bursty
+        if (now >= session.nextKey) {
+          auto key = std::string(1, (char) ('a' + session.random() % 26));
+          toSlave.push_back(wrap(session.master, MessageFactory::create<PutCharMessage>(key), Traffic::Keystroke, now));
+          auto interval = getKeyInterval();
+          session.nextKey += std::chrono::microseconds(interval.count() / 2) + randomDelay(session, interval);
+        }
+        wake = std::min(wake, session.nextKey);
+      }
+      if (!session.echo.empty()) {
+        toMaster.push_back(wrap(session.slave, MessageFactory::create<PutCharMessage>(session.echo), Traffic::Echo, now));
+        session.echo.clear();
+      }
+      if (session.shape == Shape::Bursty) {
+        if (now >= session.nextBurst) {
+          for (size_t sent = 0; sent < fBurstSize; sent += fChunkSize)
+            toMaster.push_back(wrapOutput(session, std::min(fChunkSize, fBurstSize - sent), now));
+          session.nextBurst += std::chrono::milliseconds(fBurstInterval);
+        }
+        wake = std::min(wake, session.nextBurst);
+      }
+      if (session.shape == Shape::Flood) {
+        auto allowed = std::chrono::duration<double>(now - session.floodStart).count() * fFloodRate;
+        if (fFloodRate <= 0 || (double) (session.flooded + fChunkSize) <= allowed) {
+          toMaster.push_back(wrapOutput(session, fChunkSize, now));
+          session.flooded += fChunkSize;
+          busy = true;
+        } else {
+          auto due = (double) (session.flooded + fChunkSize) / fFloodRate;
+          wake = std::min(wake, session.floodStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(due)));
+        }
+      }
+      // acks of a side which has nothing else to send
+      if (toSlave.empty() && session.master.window.ackDue()) toSlave.push_back(session.master.window.makeAck());
+      if (toMaster.empty() && session.slave.window.ackDue()) toMaster.push_back(session.slave.window.makeAck());
+    }
+    if (!sendMessages(toSlave, *session.master.client) || !sendMessages(toMaster, *session.slave.client)) {
+      fail(session);
+      return false;
+    }
+    return busy;
+  }
+
+  /**
+   * @note expects the session mutex to be held
+   */
+  Message::Ptr wrapOutput(Session &session, size_t size, Clock::time_point now) {
+    auto offset = session.random() % (fOutput.size() - size + 1);
+    return wrap(session.slave, MessageFactory::create<PutCharMessage>(fOutput.substr(offset, size)), Traffic::Output, now);
+  }
+
+  /**
+   * @brief numbers a frame of peer like a client does and notes when it was sent
+   * @note expects the session mutex to be held
+   */
+  static Message::Ptr wrap(Peer &peer, const Message::Ptr &msg, Traffic traffic, Clock::time_point now) {
+    peer.inFlight.emplace_back(now, traffic);
+    return peer.window.wrap(msg);
+  }
+
+  /**
+   * @brief frames ready at the same time share one envelope, as from a client
+   */
+  bool sendMessages(const std::vector<Message::Ptr> &messages, MessageClient &client) const {
+    if (messages.empty()) return true;
+    auto send = [this, &client](const Message::Ptr &msg) {
+      return sendEnvelope(msg, client);
+    };
+    if (client.hasCapability(ConnectOptions::CAPABILITY_BATCHING)) return client.getBatcher().send(messages, send);
+    for (auto &msg : messages)
+      if (!send(msg)) return false;
+    return true;
+  }
+
+  bool sendEnvelope(const Message::Ptr &msg, const MessageClient &client) const {
+    auto encrypted = MessageFactory::create<EncryptedMessage>(msg, fServerLogin, fServerKey, client.getWireFormat());
+    return client.sendData((char *) encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+  }
+
+  static std::pair<uint64_t, uint64_t> snapshot(const Totals &totals) {
+    return {totals.bytes.value(), totals.frames.value()};
+  }
+
+  static std::string formatRate(const std::pair<uint64_t, uint64_t> &current, const std::pair<uint64_t, uint64_t> &last,
+                                double seconds) {
+    char text[64];
+    if (seconds <= 0) seconds = 1;
+    snprintf(text, sizeof(text), "%.2f MB/s, %.0f frames/s", (double) (current.first - last.first) / seconds / 1000000,
+             (double) (current.second - last.second) / seconds);
+    return text;
+  }
+
+  static void printSnapshot(const char *name, const Histogram::Snapshot &snapshot) {
+    printf("  %s: %lu, p50: %lu us, p99: %lu us, p999: %lu us\n", name, snapshot.count, snapshot.percentile(0.5),
+           snapshot.percentile(0.99), snapshot.percentile(0.999));
+  }
+};
+
+int main(int argc, char **argv) {
+  TerminusLoadApplication loadApplication;
+  return loadApplication.process(argc, argv);
+}
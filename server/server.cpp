@@ -1,6 +1,8 @@
 #include <iostream>
+#include <sstream>
 #include <cxxopts.hpp>
 #include <server/MessageServer.h>
+#include <metrics/PrometheusExporter.h>
 
 class TerminusServerApplication {
 private:
@@ -10,7 +12,16 @@ private:
   std::string fServerAddress;
   int fServerPort = -1;
   bool fVerbose = false;
+  size_t fScrollbackSize = ScrollbackStore::DEFAULT_SESSION_SIZE;
+  size_t fScrollbackLimit = ScrollbackStore::DEFAULT_TOTAL_SIZE;
+  bool fDatagram = false;
+  int fKeepAliveMisses = HeartbeatMonitor::DEFAULT_MAX_MISSED;
+  int fIdleTimeout = 0;
+  std::shared_ptr<RateLimiter> fRateLimiter = std::make_shared<RateLimiter>();
+  LossSimulator::Options fSimulator;
+  std::string fMetricsSocket;
   std::shared_ptr<MessageServer> fMessageServer = nullptr;
+  std::shared_ptr<PrometheusExporter> fMetricsExporter = nullptr;
 public:
   TerminusServerApplication() :
     fOptions("Terminus server") {
@@ -22,7 +33,19 @@ public:
       ("k,key", "specify server key", cxxopts::value<std::string>())
       ("m,max-connections", "specify maximum amount of established connections", cxxopts::value<int>())
       ("b,buffer-size", "specify buffer size", cxxopts::value<int>())
-      ("t,tcp-no-delay", "enable tcp no delay", cxxopts::value<bool>());
+      ("t,tcp-no-delay", "enable tcp no delay", cxxopts::value<bool>())
+      ("scrollback-size", "slave output in KB kept per session for attaching masters", cxxopts::value<int>())
+      ("scrollback-limit", "scrollback memory limit in KB for all sessions", cxxopts::value<int>())
+      ("keepalive-misses", "heartbeats a client may miss before it is dropped", cxxopts::value<int>())
+      ("idle-timeout", "seconds after which silent clients without heartbeats are dropped, 0 keeps them", cxxopts::value<int>())
+      ("session-rate", "slave output in KB/s relayed per session, 0 for no limit", cxxopts::value<int>())
+      ("prefix-rate", "slave output in KB/s shared by sessions with an id prefix, as prefix=rate,...", cxxopts::value<std::string>())
+      ("rate-burst", "output in KB a rate limited session relays at once after being idle", cxxopts::value<int>())
+      ("metrics-socket", "unix socket serving metrics in the prometheus text format", cxxopts::value<std::string>())
+      ("udp", "serve clients over udp on the same port as well", cxxopts::value<bool>())
+      ("udp-loss", "simulated udp loss in percent", cxxopts::value<double>())
+      ("udp-delay", "simulated udp delay in milliseconds", cxxopts::value<int>())
+      ("udp-jitter", "simulated udp jitter in milliseconds", cxxopts::value<int>());
   }
 
   int process(int argc, char **argv) {
@@ -35,8 +58,23 @@ public:
 
     fMessageServer = std::make_shared<MessageServer>(fServerLogin, fServerKey);
 
-    fMessageServer->enableKeepAlive(10);
+    fMessageServer->enableKeepAlive(10, fKeepAliveMisses);
+    fMessageServer->setIdleTimeout(std::chrono::seconds(fIdleTimeout));
+    fMessageServer->setScrollback(fScrollbackSize, fScrollbackLimit);
+    fMessageServer->setRateLimiter(fRateLimiter);
 
+    if (!fMetricsSocket.empty()) {
+      fMetricsExporter = std::make_shared<PrometheusExporter>(fMessageServer->getMetrics());
+      if (!fMetricsExporter->start(fMetricsSocket)) {
+        DCRITICAL("failed to serve metrics on %s", fMetricsSocket.c_str());
+        return -1;
+      }
+    }
+
+    if (fDatagram && !fMessageServer->listenDatagram(fServerAddress.c_str(), fServerPort, fSimulator)) {
+      DCRITICAL("failed to listen on udp port %d", fServerPort);
+      return -1;
+    }
     fMessageServer->listen(fServerAddress.c_str(), fServerPort);
     return 0;
   }
@@ -51,11 +89,48 @@ private:
       verbose = result["verbose"].as<bool>();
       serverLogin = result["login"].as<std::string>();
       serverKey = result["key"].as<std::string>();
+      if (result.count("scrollback-size"))
+        fScrollbackSize = (size_t) std::max(0, result["scrollback-size"].as<int>()) * 1024;
+      if (result.count("scrollback-limit"))
+        fScrollbackLimit = (size_t) std::max(0, result["scrollback-limit"].as<int>()) * 1024;
+      if (result.count("keepalive-misses"))
+        fKeepAliveMisses = std::max(1, result["keepalive-misses"].as<int>());
+      if (result.count("idle-timeout"))
+        fIdleTimeout = std::max(0, result["idle-timeout"].as<int>());
+      if (result.count("rate-burst"))
+        fRateLimiter->setBurst((uint64_t) std::max(1, result["rate-burst"].as<int>()) * 1024);
+      if (result.count("session-rate"))
+        fRateLimiter->setSessionRate((uint64_t) std::max(0, result["session-rate"].as<int>()) * 1024);
+      if (result.count("prefix-rate") && !parsePrefixRates(result["prefix-rate"].as<std::string>()))
+        return false;
+      if (result.count("metrics-socket"))
+        fMetricsSocket = result["metrics-socket"].as<std::string>();
+      if (result.count("udp"))
+        fDatagram = result["udp"].as<bool>();
+      if (result.count("udp-loss"))
+        fSimulator.lossRate = result["udp-loss"].as<double>() / 100;
+      if (result.count("udp-delay"))
+        fSimulator.delay = std::chrono::milliseconds(result["udp-delay"].as<int>());
+      if (result.count("udp-jitter"))
+        fSimulator.jitter = std::chrono::milliseconds(result["udp-jitter"].as<int>());
     } catch (...) {
       return false;
     }
     return true;
   }
+
+  bool parsePrefixRates(const std::string &list) {
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+      auto separator = item.rfind('=');
+      if (separator == std::string::npos) return false;
+      auto rate = std::stoi(item.substr(separator + 1));
+      if (rate <= 0) return false;
+      fRateLimiter->addPrefixRate(item.substr(0, separator), (uint64_t) rate * 1024);
+    }
+    return true;
+  }
 };
 
 int main(int argc, char **argv) {
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "client/EchoPredictor.h"
+
+static EchoPredictor activePredictor() {
+  EchoPredictor predictor;
+  predictor.setWidth(80);
+  predictor.output("$ ");
+  // the first keystroke of an epoch is only shown once its echo arrives
+  EXPECT_EQ(predictor.input("l"), "");
+  EXPECT_EQ(predictor.output("l"), "l");
+  EXPECT_TRUE(predictor.isActive());
+  return predictor;
+}
+
+TEST(EchoPredictorTest, ShowsAndConfirmsEcho) {
+  auto predictor = activePredictor();
+  ASSERT_EQ(predictor.input("s"), "s");
+  ASSERT_EQ(predictor.input(" -"), " -");
+  ASSERT_EQ(predictor.pending(), 3);
+  // echo arriving in pieces is swallowed
+  ASSERT_EQ(predictor.output("s "), "");
+  ASSERT_EQ(predictor.output("-"), "");
+  ASSERT_EQ(predictor.pending(), 0);
+  ASSERT_EQ(predictor.getStats().confirmed, 4);
+  ASSERT_EQ(predictor.getStats().rollbacks, 0);
+}
+
+TEST(EchoPredictorTest, PredictsCursorMovement) {
+  auto predictor = activePredictor();
+  predictor.input("s");
+  predictor.output("s");
+  ASSERT_EQ(predictor.input("\x1b[D\x1b[D"), "\b\b");
+  ASSERT_EQ(predictor.output("\b\b"), "");
+  // nothing to predict beyond the end of the line
+  ASSERT_EQ(predictor.input("\x1b[C\x1b[C\x1b[C"), "ls");
+
+  EchoPredictor editing = activePredictor();
+  editing.input("s");
+  editing.output("s");
+  editing.input("\x1b[D");
+  editing.output("\b");
+  // inserting redraws the rest of the line
+  ASSERT_EQ(editing.input("x"), "xs\b");
+  ASSERT_EQ(editing.input("\x1b[C"), "s");
+  ASSERT_EQ(editing.output("xs\bs"), "");
+  ASSERT_EQ(editing.pending(), 0);
+}
+
+TEST(EchoPredictorTest, RollsBackWrongPredictions) {
+  auto predictor = activePredictor();
+  ASSERT_EQ(predictor.input("sx"), "sx");
+  // the shell rings the bell instead of echoing x
+  ASSERT_EQ(predictor.output("s\a"), "\r$ ls\x1b[K\r\x1b[4C\a");
+  ASSERT_EQ(predictor.getStats().rollbacks, 1);
+  ASSERT_FALSE(predictor.isActive());
+  ASSERT_EQ(predictor.pending(), 0);
+}
+
+TEST(EchoPredictorTest, HidesInputWithoutEcho) {
+  auto predictor = activePredictor();
+  ASSERT_EQ(predictor.input("\r"), "");
+  ASSERT_EQ(predictor.output("\r\nPassword: "), "\r\nPassword: ");
+  ASSERT_EQ(predictor.input("secret"), "");
+  ASSERT_EQ(predictor.output("\r\n$ "), "\r\n$ ");
+  ASSERT_EQ(predictor.getStats().rollbacks, 0);
+  ASSERT_FALSE(predictor.isActive());
+}
+
+TEST(EchoPredictorTest, StopsOnUntrackedOutput) {
+  auto predictor = activePredictor();
+  predictor.output("\x1b[2J\x1b[H");
+  ASSERT_EQ(predictor.input("a"), "");
+  ASSERT_EQ(predictor.pending(), 0);
+  // a new line makes the cursor line known again
+  predictor.output("\r\n$ ");
+  ASSERT_EQ(predictor.input("a"), "");
+  ASSERT_EQ(predictor.pending(), 1);
+}
+
+TEST(EchoPredictorTest, SurvivesHugeCursorMoves) {
+  auto predictor = activePredictor();
+  // binary output may carry any parameters
+  predictor.output("\x1b[99999999999999999999999C");
+  predictor.output("\x1b[4000000000Cx");
+  ASSERT_EQ(predictor.input("a"), "");
+  ASSERT_EQ(predictor.pending(), 0);
+  predictor.output("\r\n$ ");
+  ASSERT_EQ(predictor.input("a"), "");
+  ASSERT_EQ(predictor.pending(), 1);
+
+  EchoPredictor unknownWidth;
+  unknownWidth.output("\x1b[4000000000Cx\n");
+  unknownWidth.output("\x1b[4000000000D");
+  ASSERT_EQ(unknownWidth.input("a"), "");
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+#include "client/FlowWindow.h"
+
+#include <thread>
+
+TEST(FlowWindowTest, OffUntilTheMasterAnnouncesAWindow) {
+  FlowWindow window;
+  window.consume(1024 * 1024);
+  ASSERT_FALSE(window.enabled());
+  ASSERT_TRUE(window.waitForCredit(std::chrono::microseconds(0)));
+
+  window.reset(100);
+  ASSERT_TRUE(window.enabled());
+  ASSERT_EQ(window.available(), 100);
+  // output is let through while any credit is left
+  window.consume(60);
+  ASSERT_TRUE(window.waitForCredit(std::chrono::microseconds(0)));
+  window.consume(60);
+  ASSERT_FALSE(window.waitForCredit(std::chrono::milliseconds(1)));
+  window.grant(10);
+  ASSERT_FALSE(window.waitForCredit(std::chrono::microseconds(0)));
+  window.grant(30);
+  ASSERT_TRUE(window.waitForCredit(std::chrono::microseconds(0)));
+  ASSERT_EQ(window.getStats().stalls, 2);
+
+  // the next master may not know flow control
+  window.consume(100);
+  window.disable();
+  ASSERT_TRUE(window.waitForCredit(std::chrono::microseconds(0)));
+}
+
+TEST(FlowWindowTest, GrantWakesTheSender) {
+  FlowWindow window;
+  window.reset(10);
+  window.consume(10);
+  std::thread granter([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    window.grant(10);
+  });
+  ASSERT_TRUE(window.waitForCredit(std::chrono::seconds(5)));
+  granter.join();
+  ASSERT_GE(window.getStats().stalled.count(), 10000);
+}
+
+TEST(FlowWindowTest, GrantsInQuarterWindowSteps) {
+  FlowGrant grant(1000);
+  ASSERT_EQ(grant.consume(100), 0);
+  ASSERT_EQ(grant.consume(100), 0);
+  ASSERT_EQ(grant.consume(100), 300);
+  ASSERT_EQ(grant.consume(249), 0);
+  ASSERT_EQ(grant.consume(1), 250);
+  ASSERT_EQ(grant.consume(5000), 5000);
+
+  // output displayed before the window was announced again is not handed back
+  ASSERT_EQ(grant.consume(200), 0);
+  grant.reset();
+  ASSERT_EQ(grant.consume(200), 0);
+  ASSERT_EQ(grant.consume(50), 250);
+}
@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+#include "client/LatencyTracer.h"
+
+TEST(LatencyTracerTest, SplitsTheRoundTripIntoHops) {
+  LatencyTracer master, slave;
+  auto trace = master.start(1000);
+  ASSERT_TRUE(trace != nullptr);
+  // one trace at a time, the next keystroke goes untraced
+  ASSERT_TRUE(master.start(1010) == nullptr);
+
+  // server and slave clocks have nothing to do with the one of the master
+  auto atSlave = trace->stamp(TraceStamp::ServerReceive, 50000)->stamp(TraceStamp::ServerForward, 50100);
+  slave.written(*atSlave, 7000);
+  slave.read(7300);
+  auto echoed = slave.takeEchoed();
+  ASSERT_EQ(echoed.size(), 1u);
+  ASSERT_TRUE(slave.takeEchoed().empty());
+  auto back = echoed[0]->cast<TraceMessage>().stamp(TraceStamp::ServerReturn, 50600)
+    ->stamp(TraceStamp::ServerDeliver, 50650);
+
+  ASSERT_TRUE(master.finish(*back, 3000));
+  ASSERT_FALSE(master.finish(*back, 3100));
+  auto stats = master.getStats();
+  ASSERT_EQ(stats.getHop(LatencyTracer::Hop::ServerUp).max(), 100u);
+  ASSERT_EQ(stats.getHop(LatencyTracer::Hop::SlaveEcho).max(), 300u);
+  ASSERT_EQ(stats.getHop(LatencyTracer::Hop::ServerDown).max(), 50u);
+  ASSERT_EQ(stats.getHop(LatencyTracer::Hop::Network).max(), 1550u);
+  ASSERT_EQ(stats.getHop(LatencyTracer::Hop::Total).max(), 2000u);
+  ASSERT_EQ(slave.getStats().getHop(LatencyTracer::Hop::SlaveEcho).count(), 1u);
+  ASSERT_TRUE(master.start(3200) != nullptr);
+}
+
+TEST(LatencyTracerTest, GivesUpOnKeystrokesWithoutEcho) {
+  LatencyTracer master, slave;
+  auto first = master.start(1000);
+  auto second = master.start(1000 + LatencyTracer::TRACE_TIMEOUT_US);
+  ASSERT_TRUE(second != nullptr);
+  ASSERT_FALSE(master.finish(*first, 2000));
+  ASSERT_EQ(master.getStats().expired, 1u);
+
+  slave.written(*first, 100);
+  slave.written(*second, 100 + LatencyTracer::TRACE_TIMEOUT_US);
+  slave.read(200 + LatencyTracer::TRACE_TIMEOUT_US);
+  auto echoed = slave.takeEchoed();
+  ASSERT_EQ(echoed.size(), 1u);
+  ASSERT_EQ(echoed[0]->cast<TraceMessage>().getTraceId(), second->getTraceId());
+}
+
+TEST(LatencyTracerTest, TakesTheEchoWhichOvertookItsTrace) {
+  LatencyTracer master, slave;
+  auto trace = master.start(1000);
+  slave.keystroke(5000);
+  slave.read(5200);
+  slave.read(5900);
+  slave.written(*trace, 6000);
+  auto echoed = slave.takeEchoed();
+  ASSERT_EQ(echoed.size(), 1u);
+  auto back = echoed[0]->cast<TraceMessage>();
+  ASSERT_EQ(back.getStamp(TraceStamp::SlaveWrite), 5000u);
+  ASSERT_EQ(back.getStamp(TraceStamp::SlaveRead), 5200u);
+
+  master.displayed(1800);
+  master.displayed(2500);
+  ASSERT_TRUE(master.finish(back, 2600));
+  ASSERT_EQ(master.getStats().getHop(LatencyTracer::Hop::Total).max(), 800u);
+}
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include "client/MessageBatcher.h"
+#include "message/MessageParser.h"
+
+#include <thread>
+#include <condition_variable>
+
+static Message::Ptr makeFrame(uint32_t seq, size_t size = 1) {
+  auto payload = MessageFactory::create<PutCharMessage>(std::string(size, 'x'));
+  return MessageFactory::create<SequencedMessage>(1, seq, 2, 0, std::string((const char *) payload->getBuffer().getDataPtr(),
+                                                                             payload->getBuffer().getSize()));
+}
+
+static std::vector<uint32_t> getSeqs(const Message::Ptr &msg) {
+  MessageParser parser("key", "iv");
+  std::vector<uint32_t> seqs;
+  if (msg->getId() == SequencedMessage::id) return {msg->cast<SequencedMessage>().getSeq()};
+  auto batch = msg->cast<BatchMessage>();
+  for (auto &data : batch.getMessages())
+    seqs.push_back(parser.parse((const uint8_t *) data.data(), data.size())->cast<SequencedMessage>().getSeq());
+  return seqs;
+}
+
+TEST(MessageBatcherTest, SingleMessageIsNotWrapped) {
+  MessageBatcher batcher;
+  std::vector<Message::Ptr> sent;
+  ASSERT_TRUE(batcher.send(makeFrame(1), [&](const Message::Ptr &msg) {
+    sent.push_back(msg);
+    return true;
+  }));
+  ASSERT_EQ(sent.size(), 1);
+  ASSERT_TRUE(sent[0]->getId() == SequencedMessage::id);
+  ASSERT_EQ(batcher.getStats().batches, 0);
+}
+
+TEST(MessageBatcherTest, MessagesHandedInWhileSendingShareAnEnvelope) {
+  MessageBatcher batcher;
+  std::mutex mutex;
+  std::condition_variable flag;
+  bool release = false;
+  std::vector<Message::Ptr> sent;
+  auto handler = [&](const Message::Ptr &msg) {
+    std::unique_lock<std::mutex> lock(mutex);
+    sent.push_back(msg);
+    if (sent.size() == 1) {
+      flag.notify_all();
+      flag.wait(lock, [&] { return release; });
+    }
+    return true;
+  };
+
+  std::thread sender([&] { batcher.send(makeFrame(1), handler); });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    flag.wait(lock, [&] { return !sent.empty(); });
+  }
+  // the first sender is busy, these are left to it
+  EXPECT_TRUE(batcher.send(makeFrame(2), handler));
+  EXPECT_TRUE(batcher.send({makeFrame(3), makeFrame(4)}, handler));
+  EXPECT_TRUE(batcher.send(MessageFactory::create<CommandOutputMessage>(1, "", "out"), handler));
+  EXPECT_TRUE(batcher.send(makeFrame(5), handler));
+  size_t sentBeforeRelease;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    sentBeforeRelease = sent.size();
+    release = true;
+  }
+  flag.notify_all();
+  sender.join();
+
+  ASSERT_EQ(sentBeforeRelease, 1);
+
+  ASSERT_EQ(sent.size(), 4);
+  ASSERT_EQ(getSeqs(sent[0]), std::vector<uint32_t>({1}));
+  ASSERT_TRUE(sent[1]->getId() == BatchMessage::id);
+  ASSERT_EQ(getSeqs(sent[1]), std::vector<uint32_t>({2, 3, 4}));
+  // not for the peer, sent on its own in order
+  ASSERT_TRUE(sent[2]->getId() == CommandOutputMessage::id);
+  ASSERT_EQ(getSeqs(sent[3]), std::vector<uint32_t>({5}));
+
+  auto stats = batcher.getStats();
+  ASSERT_EQ(stats.messages, 6);
+  ASSERT_EQ(stats.batches, 1);
+  ASSERT_EQ(stats.batchedMessages, 3);
+}
+
+TEST(MessageBatcherTest, BatchesStayBelowMaxSize) {
+  MessageBatcher batcher;
+  std::vector<Message::Ptr> messages;
+  for (uint32_t seq = 1; seq <= 5; seq++)
+    messages.push_back(makeFrame(seq, MessageBatcher::MAX_BATCH_SIZE / 3));
+  std::vector<Message::Ptr> sent;
+  ASSERT_TRUE(batcher.send(messages, [&](const Message::Ptr &msg) {
+    sent.push_back(msg);
+    return true;
+  }));
+  ASSERT_EQ(sent.size(), 3);
+  ASSERT_EQ(getSeqs(sent[0]), std::vector<uint32_t>({1, 2}));
+  ASSERT_EQ(getSeqs(sent[1]), std::vector<uint32_t>({3, 4}));
+  ASSERT_EQ(getSeqs(sent[2]), std::vector<uint32_t>({5}));
+  for (auto &msg : sent)
+    ASSERT_LE(msg->getBuffer().getSize(), MessageBatcher::MAX_BATCH_SIZE + 64);
+}
@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+#include "client/OutputCoalescer.h"
+
+using namespace std::chrono;
+
+TEST(OutputCoalescerTest, EchoFlushedImmediately) {
+  OutputCoalescer coalescer;
+  auto now = OutputCoalescer::Clock::now();
+  ASSERT_TRUE(coalescer.empty());
+  ASSERT_LT(coalescer.getTimeout(now).count(), 0);
+  coalescer.append((const uint8_t *) "a", 1, now);
+  ASSERT_TRUE(coalescer.ready(now));
+  ASSERT_EQ(coalescer.take(now), "a");
+  ASSERT_EQ(coalescer.getStats().immediateFlushes, 1);
+}
+
+TEST(OutputCoalescerTest, FloodIsBatched) {
+  OutputCoalescer::Options options;
+  options.maxBatchSize = 16;
+  options.maxDelay = microseconds(2000);
+  OutputCoalescer coalescer(options);
+  auto now = OutputCoalescer::Clock::now();
+  coalescer.append((const uint8_t *) "a", 1, now);
+  coalescer.take(now);
+
+  // output keeps arriving right after the previous flush
+  now += microseconds(100);
+  coalescer.append((const uint8_t *) "b", 1, now);
+  ASSERT_FALSE(coalescer.ready(now));
+  ASSERT_EQ(coalescer.getTimeout(now).count(), 2000);
+  now += microseconds(500);
+  coalescer.append((const uint8_t *) "c", 1, now);
+  ASSERT_FALSE(coalescer.ready(now));
+  now += microseconds(1500);
+  ASSERT_TRUE(coalescer.ready(now));
+  ASSERT_EQ(coalescer.take(now), "bc");
+  ASSERT_EQ(coalescer.getStats().deadlineFlushes, 1);
+
+  now += microseconds(10);
+  std::string flood(40, 'x');
+  coalescer.append((const uint8_t *) flood.data(), flood.size(), now);
+  ASSERT_TRUE(coalescer.ready(now));
+  ASSERT_EQ(coalescer.take(now).size(), 16);
+  ASSERT_EQ(coalescer.take(now).size(), 16);
+  ASSERT_FALSE(coalescer.ready(now));
+  ASSERT_EQ(coalescer.take(now).size(), 8);
+  ASSERT_TRUE(coalescer.empty());
+
+  auto &stats = coalescer.getStats();
+  ASSERT_EQ(stats.batches, 5);
+  ASSERT_EQ(stats.bytes, 43);
+  ASSERT_EQ(stats.sizeFlushes, 2);
+  ASSERT_EQ(stats.maxBatch, 16);
+  ASSERT_EQ(stats.histogram[4], 2);
+}
@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+#include "client/RetransmitWindow.h"
+#include "message/PutCharMessage.h"
+
+static SequencedMessage::Ptr sendChars(RetransmitWindow &window, const std::string &chars) {
+  return window.wrap(MessageFactory::create<PutCharMessage>(chars));
+}
+
+TEST(RetransmitWindowTest, DropsDuplicates) {
+  RetransmitWindow sender(1);
+  RetransmitWindow receiver(2);
+  auto first = sendChars(sender, "a");
+  auto second = sendChars(sender, "b");
+  ASSERT_EQ(first->getSeq(), 1);
+  ASSERT_EQ(second->getSeq(), 2);
+  ASSERT_TRUE(receiver.accept(*first));
+  ASSERT_TRUE(receiver.accept(*second));
+  ASSERT_FALSE(receiver.accept(*first));
+  ASSERT_FALSE(receiver.accept(*second));
+  ASSERT_EQ(receiver.getLastReceived(), 2);
+  ASSERT_EQ(receiver.getPeerSession(), 1);
+
+  // a new peer session starts counting from the beginning
+  RetransmitWindow restarted(3);
+  ASSERT_TRUE(receiver.accept(*sendChars(restarted, "c")));
+  ASSERT_EQ(receiver.getPeerSession(), 3);
+  ASSERT_EQ(receiver.getLastReceived(), 1);
+}
+
+TEST(RetransmitWindowTest, ReplaysUnacknowledgedFrames) {
+  RetransmitWindow sender(1);
+  RetransmitWindow receiver(2);
+  for (int i = 0; i < 5; i++) {
+    auto frame = sendChars(sender, std::to_string(i));
+    if (i < 3) receiver.accept(*frame);
+  }
+  // the receiver acknowledges on its next frame
+  sender.accept(*sendChars(receiver, "x"));
+  ASSERT_EQ(sender.pending(), 2);
+
+  auto frames = sender.resume(*receiver.makeResume(false));
+  ASSERT_EQ(frames.size(), 2);
+  ASSERT_EQ(frames[0]->getSeq(), 4);
+  ASSERT_EQ(frames[1]->getSeq(), 5);
+  ASSERT_TRUE(receiver.accept(*frames[0]));
+  ASSERT_TRUE(receiver.accept(*frames[1]));
+  ASSERT_EQ(receiver.getLastReceived(), 5);
+
+  // a peer that never saw this session gets nothing replayed
+  RetransmitWindow stranger(4);
+  ASSERT_TRUE(sender.resume(*stranger.makeResume(false)).empty());
+  ASSERT_EQ(sender.pending(), 0);
+}
+
+TEST(RetransmitWindowTest, RequestsAcks) {
+  RetransmitWindow sender(1);
+  RetransmitWindow receiver(2);
+  for (uint32_t i = 0; i < RetransmitWindow::ACK_INTERVAL; i++) {
+    ASSERT_FALSE(receiver.ackDue());
+    receiver.accept(*sendChars(sender, "a"));
+  }
+  ASSERT_TRUE(receiver.ackDue());
+  auto ack = receiver.makeAck();
+  ASSERT_FALSE(receiver.ackDue());
+  ASSERT_EQ(ack->getSeq(), 0);
+  ASSERT_FALSE(sender.accept(*ack));
+  ASSERT_EQ(sender.pending(), 0);
+}
+
+TEST(RetransmitWindowTest, BoundsWindowSize) {
+  RetransmitWindow sender(1, 100);
+  for (int i = 0; i < 50; i++)
+    sendChars(sender, std::string(10, 'a'));
+  ASSERT_LE(sender.pending(), 100 / 18 + 1);
+  RetransmitWindow receiver(2);
+  receiver.accept(*sendChars(sender, "b"));
+  auto frames = sender.resume(*MessageFactory::create<ResumeMessage>(2, 1, 0));
+  ASSERT_EQ(frames.back()->getSeq(), 51);
+}
+
+TEST(RetransmitWindowTest, CountsFramesLostFromTheWindow) {
+  RetransmitWindow sender(1, 100);
+  RetransmitWindow receiver(2);
+  ASSERT_TRUE(receiver.accept(*sendChars(sender, "a")));
+  for (int i = 0; i < 50; i++)
+    sendChars(sender, std::string(10, 'a'));
+  auto frames = sender.resume(*receiver.makeResume(false));
+  ASSERT_GT(frames.front()->getSeq(), 2);
+  ASSERT_TRUE(receiver.accept(*frames.front()));
+  ASSERT_EQ(receiver.takeLost(), frames.front()->getSeq() - 2);
+  ASSERT_EQ(receiver.takeLost(), 0);
+  for (size_t i = 1; i < frames.size(); i++)
+    ASSERT_TRUE(receiver.accept(*frames[i]));
+  ASSERT_EQ(receiver.takeLost(), 0);
+
+  // a master attaching to a running slave starts in the middle of its stream
+  RetransmitWindow attached(3);
+  ASSERT_TRUE(attached.accept(*sendChars(sender, "b")));
+  ASSERT_EQ(attached.takeLost(), 0);
+}
+
+TEST(RetransmitWindowTest, ResumesAheadOfNewFrames) {
+  RetransmitWindow master(1);
+  RetransmitWindow slave(2);
+  slave.accept(*sendChars(master, "a"));
+  master.accept(*sendChars(slave, "1"));
+  auto key = sendChars(master, "b");
+  sendChars(slave, "2");
+
+  // the request goes out with the frames the slave may have missed
+  auto resume = master.startResume();
+  ASSERT_EQ(resume.size(), 2);
+  ASSERT_TRUE(resume[0]->getId() == ResumeMessage::id);
+  ASSERT_TRUE(slave.accept(resume[1]->cast<SequencedMessage>()));
+  ASSERT_FALSE(slave.accept(*key));
+
+  // output sent before the slave got the request waits for the replay
+  auto early = sendChars(slave, "3");
+  ASSERT_FALSE(master.accept(*early));
+  auto frames = slave.resume(resume[0]->cast<ResumeMessage>());
+  ASSERT_EQ(frames.size(), 2);
+  ASSERT_TRUE(master.resume(*slave.makeResume(true)).empty());
+  for (auto &frame : frames)
+    ASSERT_TRUE(master.accept(*frame));
+  ASSERT_EQ(master.getLastReceived(), 3);
+  ASSERT_EQ(master.takeLost(), 0);
+}
+
+TEST(RetransmitWindowTest, TracksWhatThePeerHadReceived) {
+  RetransmitWindow master(1);
+  RetransmitWindow slave(2);
+  // output of the slave from before the master attached, such as its scrollback
+  auto early = sendChars(slave, "a");
+  master.accept(*early);
+  ASSERT_EQ(master.getPeerAck(), 0);
+
+  auto announce = sendChars(master, "w");
+  sendChars(master, "x");
+  slave.accept(*announce);
+  master.accept(*sendChars(slave, "b"));
+  ASSERT_EQ(master.getPeerAck(), announce->getSeq());
+
+  // frames the slave sent while it followed another master carry acks of that one
+  RetransmitWindow earlier(3);
+  slave.accept(*sendChars(earlier, "y"));
+  master.accept(*sendChars(slave, "c"));
+  ASSERT_EQ(master.getPeerAck(), 0);
+}
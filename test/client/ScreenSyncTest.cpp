@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "client/ScreenSync.h"
+
+#include <random>
+
+/**
+ * @brief the screen a master terminal shows, rebuilt from frames, has to match the slave screen
+ */
+static void expectSameScreen(const Screen &slave, const Screen &master) {
+  ASSERT_EQ(slave.width(), master.width());
+  ASSERT_EQ(slave.height(), master.height());
+  for (int y = 0; y < slave.height(); y++)
+    for (int x = 0; x < slave.width(); x++) {
+      auto &expected = slave.row(y)[x];
+      auto &actual = master.row(y)[x];
+      ASSERT_EQ(expected.glyph, actual.glyph) << "at " << x << "," << y;
+      ASSERT_EQ(expected.attributes.bg, actual.attributes.bg) << "at " << x << "," << y;
+      ASSERT_EQ(expected.attributes.flags, actual.attributes.flags) << "at " << x << "," << y;
+      if (expected.glyph != " ") {
+        ASSERT_EQ(expected.attributes.fg, actual.attributes.fg) << "at " << x << "," << y;
+      }
+    }
+  ASSERT_EQ(slave.cursorX(), master.cursorX());
+  ASSERT_EQ(slave.cursorY(), master.cursorY());
+  ASSERT_EQ(slave.cursorVisible(), master.cursorVisible());
+}
+
+TEST(ScreenSyncTest, FramesRebuildScreen) {
+  Screen slave(40, 10), master(40, 10);
+  ScreenSync sync(1000);
+  auto now = ScreenSync::Clock::now();
+  std::string outputs[] = {
+    "user@host:~$ ls --color\r\n\x1b[01;34mbin\x1b[0m  \x1b[01;32mrun.sh\x1b[0m  notes.txt\r\nuser@host:~$ ",
+    "\x1b[?1049h\x1b[H\x1b[2J\x1b[7m top - 10:00:00 up 1 day \x1b[m\r\n\x1b[1mPID USER\x1b[m\r\n  1 root\x1b[K",
+    "\x1b[2;1H\x1b[44m  2 www-data \x1b[m\x1b[?25l",
+    "\x1b[?1049l\x1b[?25h\x1b]0;done\x07",
+    "\xe4\xb8\xad\xe6\x96\x87 wide\r\n\x1b[38;2;10;20;30mrgb\x1b[m",
+  };
+  for (auto &output : outputs) {
+    slave.write(output);
+    sync.touch();
+    now += std::chrono::seconds(1);
+    ASSERT_TRUE(sync.due(now));
+    master.write(sync.frame(slave, now));
+    expectSameScreen(slave, master);
+    ASSERT_EQ(master.title(), slave.title());
+  }
+  ASSERT_EQ(sync.getStats().fullFrames, 1);
+}
+
+TEST(ScreenSyncTest, ScrollingOutputIsSentAsLineFeeds) {
+  Screen slave(20, 6), master(20, 6);
+  ScreenSync sync(1000);
+  auto now = ScreenSync::Clock::now();
+  for (int i = 0; i < 6; i++) slave.write("line " + std::to_string(i) + "\r\n");
+  master.write(sync.frame(slave, now));
+  slave.write("line 6\r\nline 7\r\n");
+  now += std::chrono::seconds(1);
+  auto frame = sync.frame(slave, now);
+  master.write(frame);
+  expectSameScreen(slave, master);
+  ASSERT_EQ(sync.getStats().scrolledLines, 2);
+  ASSERT_LT(frame.size(), 64);
+}
+
+TEST(ScreenSyncTest, FloodIsBoundedByFrameRate) {
+  Screen slave(80, 24), master(80, 24);
+  ScreenSync sync(10);
+  auto now = ScreenSync::Clock::now();
+  size_t output = 0, sent = 0;
+  // one second of a fast build log, fed in 1 ms slices
+  for (int ms = 0; ms < 1000; ms++) {
+    for (int i = 0; i < 20; i++) {
+      auto text = "[" + std::to_string(ms * 20 + i) + "] compiling src/module" + std::to_string(i) + ".cpp\r\n";
+      slave.write(text);
+      output += text.size();
+    }
+    sync.touch();
+    now += std::chrono::milliseconds(1);
+    if (sync.due(now)) {
+      auto frame = sync.frame(slave, now);
+      sent += frame.size();
+      master.write(frame);
+    }
+  }
+  master.write(sync.frame(slave, now));
+  expectSameScreen(slave, master);
+  ASSERT_LE(sync.getStats().frames, 12);
+  ASSERT_LT(sent * 10, output);
+}
+
+TEST(ScreenSyncTest, FirstFrameAfterIdleIsImmediate) {
+  Screen slave(20, 4);
+  ScreenSync sync(30);
+  auto now = ScreenSync::Clock::now();
+  sync.frame(slave, now);
+  ASSERT_LT(sync.getTimeout(now).count(), 0);
+  now += std::chrono::seconds(1);
+  slave.write("x");
+  sync.touch();
+  ASSERT_EQ(sync.getTimeout(now).count(), 0);
+  sync.frame(slave, now);
+  slave.write("y");
+  sync.touch();
+  ASSERT_FALSE(sync.due(now + std::chrono::milliseconds(1)));
+  ASSERT_GT(sync.getTimeout(now).count(), 30000);
+}
+
+TEST(ScreenSyncTest, ResizeRepaints) {
+  Screen slave(20, 4), master(20, 4);
+  ScreenSync sync;
+  auto now = ScreenSync::Clock::now();
+  slave.write("prompt$ ");
+  master.write(sync.frame(slave, now));
+  slave.resize(30, 5);
+  master.resize(30, 5);
+  sync.invalidate();
+  master.write(sync.frame(slave, now + std::chrono::seconds(1)));
+  expectSameScreen(slave, master);
+  ASSERT_EQ(sync.getStats().fullFrames, 2);
+}
+
+TEST(ScreenSyncTest, RandomOutputRebuildsScreen) {
+  std::mt19937 random(3);
+  Screen slave(30, 8), master(30, 8);
+  ScreenSync sync(1000);
+  auto now = ScreenSync::Clock::now();
+  const std::vector<std::string> pieces = {
+    "abc", "hello world ", "\r\n", "\r", "\b", "\t", "\x1b[K", "\x1b[1K", "\x1b[J", "\x1b[2P", "\x1b[3@", "\x1b[2L",
+    "\x1b[M", "\x1b[1;31m", "\x1b[0m", "\x1b[7m", "\x1b[44m", "\x1b[38;5;120m", "\xe4\xb8\xad", "e\xcc\x81", "\x1b[S",
+    "\x1b[T", "\x1bM", "\x1b[3X", "\x1b[?25l", "\x1b[?25h", "\x1b[2;6r", "\x1b[r", "\x1b[5b"
+  };
+  for (int i = 0; i < 2000; i++) {
+    auto &piece = pieces[random() % pieces.size()];
+    if (random() % 6 == 0)
+      slave.write("\x1b[" + std::to_string(random() % 8 + 1) + ";" + std::to_string(random() % 30 + 1) + "H");
+    slave.write(piece);
+    sync.touch();
+    if (random() % 5 == 0) {
+      now += std::chrono::seconds(1);
+      master.write(sync.frame(slave, now));
+      expectSameScreen(slave, master);
+    }
+  }
+}
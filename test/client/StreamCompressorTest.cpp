@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "client/StreamCompressor.h"
+#include "message/MessageParser.h"
+
+static std::string listingLine(int i) {
+  return "\x1b[01;34mdirectory" + std::to_string(i) + "\x1b[0m  \x1b[01;32mscript" + std::to_string(i) +
+         ".sh\x1b[0m  notes" + std::to_string(i % 7) + ".txt\r\n";
+}
+
+static std::string expand(StreamDecompressor &decompressor, const Message::Ptr &msg) {
+  if (msg->getId() != CompressedMessage::id)
+    return msg->cast<PutCharMessage>().getChars();
+  std::string payload;
+  if (!decompressor.decompress(msg->cast<CompressedMessage>(), payload)) return "<lost>";
+  MessageParser parser("", "");
+  return parser.parse((const uint8_t *) payload.data(), payload.size())->cast<PutCharMessage>().getChars();
+}
+
+TEST(StreamCompressorTest, RoundTripsTerminalOutput) {
+  StreamCompressor compressor;
+  StreamDecompressor decompressor;
+  std::string sent, received;
+  for (int i = 0; i < 200; i++) {
+    std::string chars;
+    for (int j = 0; j < 10; j++)
+      chars += listingLine(i * 10 + j);
+    sent += chars;
+    received += expand(decompressor, compressor.compress(MessageFactory::create<PutCharMessage>(chars)));
+  }
+  ASSERT_EQ(received, sent);
+  ASSERT_EQ(compressor.getStats().compressedFrames, 200);
+  ASSERT_GT(compressor.getStats().ratio(), 4.0);
+}
+
+TEST(StreamCompressorTest, PassesKeystrokesThrough) {
+  StreamCompressor compressor;
+  auto msg = MessageFactory::create<PutCharMessage>("l");
+  ASSERT_EQ(compressor.compress(msg), msg);
+  ASSERT_EQ(compressor.getStats().compressedFrames, 0);
+}
+
+TEST(StreamCompressorTest, LateReceiverWaitsForReset) {
+  StreamCompressor::Options options;
+  options.resetInterval = 4096;
+  StreamCompressor compressor(options);
+  StreamDecompressor early, late;
+  std::vector<Message::Ptr> frames;
+  for (int i = 0; i < 40; i++)
+    frames.push_back(compressor.compress(MessageFactory::create<PutCharMessage>(listingLine(i) + listingLine(i + 1))));
+
+  // joining mid-stream, the first frames cannot be decompressed, everything after the next reset can
+  size_t firstDecoded = frames.size();
+  for (size_t i = 0; i < frames.size(); i++) {
+    ASSERT_EQ(expand(early, frames[i]), listingLine((int) i) + listingLine((int) i + 1));
+    if (i < 3) continue;
+    auto chars = expand(late, frames[i]);
+    if (chars != "<lost>" && firstDecoded == frames.size()) firstDecoded = i;
+    if (firstDecoded < frames.size()) {
+      ASSERT_EQ(chars, listingLine((int) i) + listingLine((int) i + 1));
+    }
+  }
+  ASSERT_LT(firstDecoded, frames.size());
+  ASSERT_TRUE(frames[firstDecoded]->cast<CompressedMessage>().isReset());
+  ASSERT_GT(compressor.getStats().resets, 1);
+}
+
+TEST(StreamCompressorTest, MissingFrameLosesSyncUntilReset) {
+  StreamCompressor compressor;
+  StreamDecompressor decompressor;
+  auto line = [](int i) { return MessageFactory::create<PutCharMessage>(listingLine(i)); };
+  ASSERT_EQ(expand(decompressor, compressor.compress(line(0))), listingLine(0));
+  compressor.compress(line(1));
+  ASSERT_EQ(expand(decompressor, compressor.compress(line(2))), "<lost>");
+  ASSERT_FALSE(decompressor.synced());
+  compressor.reset();
+  ASSERT_EQ(expand(decompressor, compressor.compress(line(3))), listingLine(3));
+  ASSERT_TRUE(decompressor.synced());
+}
+
+TEST(StreamCompressorTest, TruncatedFrameIsRejected) {
+  StreamCompressor compressor;
+  StreamDecompressor decompressor;
+  auto msg = compressor.compress(MessageFactory::create<PutCharMessage>(listingLine(1) + listingLine(2)));
+  auto compressed = msg->cast<CompressedMessage>();
+  auto data = compressed.getData().substr(0, compressed.getData().size() / 2);
+  CompressedMessage truncated(compressed.getFlags(), compressed.getIndex(), compressed.getOriginalSize(), data);
+  std::string payload;
+  ASSERT_FALSE(decompressor.decompress(truncated, payload));
+  ASSERT_FALSE(decompressor.synced());
+}
@@ -0,0 +1,20 @@
+#include "gtest/gtest.h"
+#include "crypto/CryptoInterface.h"
+
+/**
+ * RFC 4231 test cases
+ */
+
+TEST(HmacTest, SignTest) {
+  auto result = Crypto::HMAC::signData("what do ya want for nothing?", "Jefe");
+  ASSERT_EQ(result, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+  result = Crypto::HMAC::signData("Hi There", std::string(20, '\x0b'));
+  ASSERT_EQ(result, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+}
+
+TEST(HmacTest, CompareTest) {
+  auto signature = Crypto::HMAC::signData("Hi There", "Jefe");
+  ASSERT_TRUE(Crypto::HMAC::compareSignatures(signature, Crypto::HMAC::signData("Hi There", "Jefe")));
+  ASSERT_FALSE(Crypto::HMAC::compareSignatures(signature, Crypto::HMAC::signData("Hi there", "Jefe")));
+  ASSERT_FALSE(Crypto::HMAC::compareSignatures(signature, signature.substr(0, 16)));
+}
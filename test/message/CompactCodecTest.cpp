@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include "message/MessageParser.h"
+#include "message/FrameReader.h"
+
+static std::string toString(const Message::Ptr &msg) {
+  return {(const char *) msg->getBuffer().getDataPtr(), msg->getBuffer().getSize()};
+}
+
+TEST(CompactCodecTest, RoundTripKeepsLayout) {
+  ConnectOptions options(ConnectionType::TypeMaster, "client", true, 7, true);
+  options.setCapabilities(ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING);
+  auto keystroke = MessageFactory::create<PutCharMessage>("x");
+  std::vector<Message::Ptr> messages = {
+    keystroke,
+    MessageFactory::create<PutCharMessage>(""),
+    MessageFactory::create<ResizeTerminalMessage>(80, 24),
+    MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, nlohmann::json{{"version", 1}, {"capabilities", 3}}),
+    MessageFactory::create<ConnectMessage>(options),
+    MessageFactory::create<ExecuteCommandMessage>(7, "uptime", 5000, std::vector<std::string>{"a", "bb"}),
+    MessageFactory::create<CommandOutputMessage>(7, "a", "load average"),
+    MessageFactory::create<CommandResultMessage>(7, "a", CommandStatus::StatusExited, -1, 12),
+    MessageFactory::create<SequencedMessage>(0xDEADBEEF, 300, 0xCAFEBABE, 299, toString(keystroke)),
+    MessageFactory::create<SequencedMessage>(0xDEADBEEF, 0, 0xCAFEBABE, 299),
+    MessageFactory::create<ResumeMessage>(0xDEADBEEF, 0xCAFEBABE, 42, true),
+    MessageFactory::create<ChannelDataMessage>(3, std::string("\x00\x01payload", 9)),
+    MessageFactory::create<OpenChannelMessage>(3, options),
+    MessageFactory::create<CloseChannelMessage>(3),
+    MessageFactory::create<ChannelWindowMessage>(3, 65536),
+    MessageFactory::create<CompressedMessage>(CompressedMessage::FLAG_RESET, 0, 100, "deflated"),
+    MessageFactory::create<CompressionRequestMessage>(CompressionType::Deflate),
+    MessageFactory::create<DisplayModeMessage>(DisplayMode::ScreenSync, 30),
+    MessageFactory::create<WindowUpdateMessage>(128 * 1024, true),
+    MessageFactory::create<HeartbeatMessage>(0x12345678, false),
+    MessageFactory::create<TraceMessage>(7, TraceMessage::Stamps{1, 2, 3, 0, 0, 0, 0xFFFFFFFF}),
+    MessageFactory::create<MasterDetachedMessage>(),
+    MessageFactory::create<BatchMessage>(std::vector<std::string>{
+      toString(MessageFactory::create<SequencedMessage>(1, 2, 3, 1, toString(keystroke))),
+      toString(MessageFactory::create<ResumeMessage>(1, 3, 0, false))}),
+  };
+  for (auto &msg : messages) {
+    std::string compact, legacy;
+    ASSERT_TRUE(CompactCodec::encode(msg->getBuffer().getDataPtr(), msg->getBuffer().getSize(), compact));
+    ASSERT_LT(compact.size(), msg->getBuffer().getSize());
+    ASSERT_TRUE(CompactCodec::decode((const uint8_t *) compact.data(), compact.size(), legacy));
+    ASSERT_EQ(legacy, toString(msg));
+  }
+}
+
+TEST(CompactCodecTest, MessagesWithoutTrailingFields) {
+  // a connect message of a client older than capabilities
+  auto legacy = toString(MessageFactory::create<ConnectMessage>(ConnectOptions(ConnectionType::TypeSlave, "old")));
+  legacy.resize(legacy.size() - 6);
+  std::string compact, decoded;
+  ASSERT_TRUE(CompactCodec::encode((const uint8_t *) legacy.data(), legacy.size(), compact));
+  ASSERT_TRUE(CompactCodec::decode((const uint8_t *) compact.data(), compact.size(), decoded));
+  ASSERT_EQ(decoded, legacy);
+
+  MessageParser messageParser("1ZNDH6P00ABZJN", "dji-alpha");
+  auto result = messageParser.parse((const uint8_t *) decoded.data(), decoded.size());
+  ASSERT_TRUE(result != nullptr);
+  ASSERT_EQ(result->cast<ConnectMessage>().getConnectOptions().getProtocolVersion(), 0);
+  ASSERT_EQ(result->cast<ConnectMessage>().getConnectOptions().getWireFormat(), WireFormat::Legacy);
+}
+
+TEST(CompactCodecTest, RejectsMalformedInput) {
+  std::string out;
+  // unknown id
+  ASSERT_FALSE(CompactCodec::encode((const uint8_t *) "\x01\x02\x03\x04", 4, out));
+  // truncated string length
+  auto legacy = toString(MessageFactory::create<CommandOutputMessage>(1, "client", "chars"));
+  out.clear();
+  ASSERT_FALSE(CompactCodec::encode((const uint8_t *) legacy.data(), 12, out));
+  // unknown type, varint running past five bytes, trailing bytes
+  out.clear();
+  ASSERT_FALSE(CompactCodec::decode((const uint8_t *) "\x7f", 1, out));
+  out.clear();
+  ASSERT_FALSE(CompactCodec::decode((const uint8_t *) "\x0b\xff\xff\xff\xff\xff", 6, out));
+  out.clear();
+  ASSERT_FALSE(CompactCodec::decode((const uint8_t *) "\x0b\x01\x02", 3, out));
+
+  ASSERT_EQ(CompactCodec::getFrameSize((const uint8_t *) "\xf1\x80", 2), 0);
+  ASSERT_EQ(CompactCodec::getFrameSize((const uint8_t *) "\xf1\x80\x01", 3), 3 + 128);
+  ASSERT_EQ(CompactCodec::getFrameSize((const uint8_t *) "\xf1\xff\xff\xff\xff\xff", 6), -1);
+}
+
+TEST(CompactCodecTest, FrameTypesDoNotCollideWithMessageIds) {
+  auto ids = CompactCodec::getIds();
+  ids.push_back((uint32_t) EncryptedMessage::id);
+  for (auto id : ids)
+    ASSERT_FALSE(CompactCodec::isFrameType((uint8_t) id)) << std::hex << id;
+}
+
+TEST(CompactCodecTest, SmallFrameOverhead) {
+  std::string key = "1ZNDH6P00ABZJN";
+  std::string iv = "dji-alpha";
+  MessageParser messageParser(key, iv);
+
+  auto keystroke = MessageFactory::create<PutCharMessage>("x");
+  auto sequenced = MessageFactory::create<SequencedMessage>(0xDEADBEEF, 100, 0xCAFEBABE, 99, toString(keystroke));
+  auto legacy = MessageFactory::create<EncryptedMessage>(sequenced, key, iv);
+  auto compact = MessageFactory::create<EncryptedMessage>(sequenced, key, iv, WireFormat::Compact);
+  // a single cipher block behind a two byte header instead of three
+  ASSERT_EQ(legacy->getBuffer().getSize(), 54);
+  ASSERT_EQ(compact->getBuffer().getSize(), 18);
+
+  auto result = messageParser.parse(compact->getBuffer().getDataPtr(), compact->getBuffer().getSize());
+  ASSERT_TRUE(result != nullptr);
+  auto parsed = result->cast<SequencedMessage>();
+  ASSERT_EQ(parsed.getSession(), 0xDEADBEEF);
+  ASSERT_EQ(parsed.getSeq(), 100);
+  ASSERT_EQ(parsed.getPayload(), toString(keystroke));
+}
+
+TEST(CompactCodecTest, FrameReaderSplitsMixedFormats) {
+  std::string key = "1ZNDH6P00ABZJN";
+  std::string iv = "dji-alpha";
+  MessageParser messageParser(key, iv);
+
+  auto resize = MessageFactory::create<ResizeTerminalMessage>(80, 24);
+  auto inner = MessageFactory::create<EncryptedMessage>(MessageFactory::create<PutCharMessage>(std::string(300, 'x')), key, iv,
+                                                        WireFormat::Compact);
+  auto channelData = MessageFactory::create<ChannelDataMessage>(5, toString(inner));
+  std::string stream = toString(MessageFactory::create<EncryptedMessage>(resize, key, iv, WireFormat::Compact));
+  stream += toString(MessageFactory::create<EncryptedMessage>(resize, key, iv));
+  stream += CompactCodec::makeFrame(channelData, WireFormat::Compact);
+
+  FrameReader frameReader;
+  Buffer frame;
+  std::vector<Message::Ptr> results;
+  for (auto &c : stream) {
+    frameReader.append((const uint8_t *) &c, 1);
+    while (frameReader.next(frame))
+      results.push_back(messageParser.parse(frame.getDataPtr(), frame.getSize()));
+  }
+  ASSERT_FALSE(frameReader.failed());
+  ASSERT_EQ(results.size(), 3);
+  ASSERT_EQ(results[0]->cast<ResizeTerminalMessage>().getWidth(), 80);
+  ASSERT_EQ(results[1]->cast<ResizeTerminalMessage>().getHeight(), 24);
+  auto payload = results[2]->cast<ChannelDataMessage>().getPayload();
+  ASSERT_EQ(payload, toString(inner));
+  auto nested = messageParser.parse((const uint8_t *) payload.data(), payload.size());
+  ASSERT_TRUE(nested != nullptr);
+  ASSERT_EQ(nested->cast<PutCharMessage>().getChars(), std::string(300, 'x'));
+}
@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include "message/MessageParser.h"
+#include "message/FrameReader.h"
+
+TEST(FrameReaderTest, SplitAndCoalescedFrames) {
+  std::string key = "1ZNDH6P00ABZJN";
+  std::string iv = "dji-alpha";
+  MessageParser messageParser(key, iv);
+
+  auto first = MessageFactory::create<EncryptedMessage>(MessageFactory::create<PutCharMessage>("hello"), key, iv);
+  auto second = MessageFactory::create<EncryptedMessage>(MessageFactory::create<ResizeTerminalMessage>(80, 24), key, iv);
+  std::string stream((char *) first->getBuffer().getDataPtr(), first->getBuffer().getSize());
+  stream.append((char *) second->getBuffer().getDataPtr(), second->getBuffer().getSize());
+
+  FrameReader frameReader;
+  Buffer frame;
+  // feed byte by byte, frames must only appear once complete
+  std::vector<Message::Ptr> results;
+  for (auto &c : stream) {
+    frameReader.append((const uint8_t *) &c, 1);
+    while (frameReader.next(frame))
+      results.push_back(messageParser.parse(frame.getDataPtr(), frame.getSize()));
+  }
+  ASSERT_FALSE(frameReader.failed());
+  ASSERT_EQ(frameReader.pending(), 0);
+  ASSERT_EQ(results.size(), 2);
+  ASSERT_EQ(results[0]->cast<PutCharMessage>().getChars(), "hello");
+  ASSERT_EQ(results[1]->cast<ResizeTerminalMessage>().getWidth(), 80);
+
+  // both frames in one chunk
+  frameReader.append((const uint8_t *) stream.data(), stream.size());
+  ASSERT_TRUE(frameReader.next(frame));
+  ASSERT_EQ(frame.getSize(), first->getBuffer().getSize());
+  ASSERT_TRUE(frameReader.next(frame));
+  ASSERT_EQ(frame.getSize(), second->getBuffer().getSize());
+  ASSERT_FALSE(frameReader.next(frame));
+
+  frameReader.append((const uint8_t *) "\x01\x02\x03\x04\x05", 5);
+  ASSERT_FALSE(frameReader.next(frame));
+  ASSERT_TRUE(frameReader.failed());
+}
+
+TEST(FrameReaderTest, ChannelEnvelopeAroundLargestFrame) {
+  std::string key = "1ZNDH6P00ABZJN";
+  std::string iv = "dji-alpha";
+  MessageParser messageParser(key, iv);
+
+  auto inner = MessageFactory::create<EncryptedMessage>(MessageFactory::create<PutCharMessage>(std::string(65500, 'x')), key, iv);
+  std::string payload((char *) inner->getBuffer().getDataPtr(), inner->getBuffer().getSize());
+  auto envelope = MessageFactory::create<ChannelDataMessage>(3, payload);
+  ASSERT_GT(envelope->getBuffer().getSize(), 0xffff);
+
+  FrameReader frameReader;
+  Buffer frame;
+  frameReader.append(envelope->getBuffer().getDataPtr(), envelope->getBuffer().getSize());
+  ASSERT_TRUE(frameReader.next(frame));
+  ASSERT_EQ(frame.getSize(), envelope->getBuffer().getSize());
+  auto result = messageParser.parse(frame.getDataPtr(), frame.getSize());
+  ASSERT_TRUE(result != nullptr);
+  ASSERT_EQ(result->cast<ChannelDataMessage>().getPayload(), payload);
+  result = messageParser.parse((const uint8_t *) payload.data(), payload.size());
+  ASSERT_TRUE(result != nullptr);
+  ASSERT_EQ(result->cast<PutCharMessage>().getChars().size(), 65500);
+}
@@ -107,3 +107,229 @@ TEST(MessageTest, ParserTest) {
 }
 
 
+
+TEST(MessageTest, CommandMessagesTest) {
+  std::string key = "1ZNDHA1009QX2M";
+  std::string iv = "dji-zeta";
+  MessageParser messageParser(key, iv);
+  Message::Ptr parseResult;
+
+  //test execute command message
+  std::vector<std::string> targets = {"slave-1", "slave-2"};
+  auto executeMessage = MessageFactory::create<ExecuteCommandMessage>(7, "uname -a", 1500, targets);
+  auto encryptedMessage = MessageFactory::create<EncryptedMessage>(executeMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->getId(), executeMessage->getId());
+  ASSERT_EQ(parseResult->cast<ExecuteCommandMessage>().getRequestId(), 7);
+  ASSERT_EQ(parseResult->cast<ExecuteCommandMessage>().getTimeoutMs(), 1500);
+  ASSERT_EQ(parseResult->cast<ExecuteCommandMessage>().getCommand(), "uname -a");
+  ASSERT_EQ(parseResult->cast<ExecuteCommandMessage>().getTargets(), targets);
+
+  //test command output message
+  std::string output("line\r\n\0binary", 13);
+  auto outputMessage = MessageFactory::create<CommandOutputMessage>(7, "slave-1", output);
+  encryptedMessage = MessageFactory::create<EncryptedMessage>(outputMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<CommandOutputMessage>().getRequestId(), 7);
+  ASSERT_EQ(parseResult->cast<CommandOutputMessage>().getClientId(), "slave-1");
+  ASSERT_EQ(parseResult->cast<CommandOutputMessage>().getChars(), output);
+
+  //test command result message
+  auto resultMessage = MessageFactory::create<CommandResultMessage>(7, "slave-2", CommandStatus::StatusExited, 3, 42);
+  encryptedMessage = MessageFactory::create<EncryptedMessage>(resultMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<CommandResultMessage>().getClientId(), "slave-2");
+  ASSERT_EQ(parseResult->cast<CommandResultMessage>().getStatus(), CommandStatus::StatusExited);
+  ASSERT_EQ(parseResult->cast<CommandResultMessage>().getExitCode(), 3);
+  ASSERT_EQ(parseResult->cast<CommandResultMessage>().getElapsedMs(), 42);
+
+  //test execute command message announcing more targets than it holds
+  Buffer flood;
+  flood.append(ExecuteCommandMessage::id);
+  flood.append((uint32_t) 7);
+  flood.append((uint32_t) 1500);
+  flood.append((uint32_t) 0);
+  flood.append((uint32_t) 0xFFFFFFFF);
+  ASSERT_TRUE(messageParser.parse(flood.getDataPtr(), flood.getSize()) == nullptr);
+}
+
+TEST(MessageTest, SessionMessagesTest) {
+  std::string key = "1ZNDHB400RM7QE";
+  std::string iv = "dji-eta";
+  MessageParser messageParser(key, iv);
+  Message::Ptr parseResult;
+
+  //test sequenced message carrying a put char message
+  auto putCharMessage = MessageFactory::create<PutCharMessage>("ls\r");
+  std::string payload((const char *) putCharMessage->getBuffer().getDataPtr(), putCharMessage->getBuffer().getSize());
+  auto sequencedMessage = MessageFactory::create<SequencedMessage>(11, 12, 13, 14, payload);
+  auto encryptedMessage = MessageFactory::create<EncryptedMessage>(sequencedMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  auto sequenced = parseResult->cast<SequencedMessage>();
+  ASSERT_EQ(sequenced.getSession(), 11);
+  ASSERT_EQ(sequenced.getSeq(), 12);
+  ASSERT_EQ(sequenced.getPeerSession(), 13);
+  ASSERT_EQ(sequenced.getAck(), 14);
+  parseResult = messageParser.parse((const uint8_t *) sequenced.getPayload().data(), sequenced.getPayload().size());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<PutCharMessage>().getChars(), "ls\r");
+
+  //test resume message
+  auto resumeMessage = MessageFactory::create<ResumeMessage>(21, 22, 23, true);
+  encryptedMessage = MessageFactory::create<EncryptedMessage>(resumeMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<ResumeMessage>().getSession(), 21);
+  ASSERT_EQ(parseResult->cast<ResumeMessage>().getPeerSession(), 22);
+  ASSERT_EQ(parseResult->cast<ResumeMessage>().getLastReceived(), 23);
+  ASSERT_TRUE(parseResult->cast<ResumeMessage>().isReply());
+
+  //test resuming connect message
+  ConnectOptions connectOptions(ConnectionType::TypeMaster, "test", true, 300, true);
+  connectOptions.setCapabilities(ConnectOptions::CAPABILITY_COMPACT | ConnectOptions::CAPABILITY_BATCHING);
+  auto connectMessage = MessageFactory::create<ConnectMessage>(connectOptions);
+  parseResult = messageParser.parse(connectMessage->getBuffer().getDataPtr(),
+                                    connectMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<ConnectMessage>().getConnectOptions().keepAliveInterval(), 300);
+  ASSERT_TRUE(parseResult->cast<ConnectMessage>().getConnectOptions().isResume());
+  ASSERT_EQ(parseResult->cast<ConnectMessage>().getConnectOptions().getProtocolVersion(), 1);
+  ASSERT_TRUE(parseResult->cast<ConnectMessage>().getConnectOptions().hasCapability(ConnectOptions::CAPABILITY_BATCHING));
+  ASSERT_TRUE(parseResult->cast<ConnectMessage>().getConnectOptions().getWireFormat() == WireFormat::Compact);
+
+  //test connect message of a client older than capabilities
+  std::string oldConnect((const char *) connectMessage->getBuffer().getDataPtr(), connectMessage->getBuffer().getSize() - 6);
+  parseResult = messageParser.parse((const uint8_t *) oldConnect.data(), oldConnect.size());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_TRUE(parseResult->cast<ConnectMessage>().getConnectOptions().isResume());
+  ASSERT_EQ(parseResult->cast<ConnectMessage>().getConnectOptions().getProtocolVersion(), 0);
+  ASSERT_EQ(parseResult->cast<ConnectMessage>().getConnectOptions().getCapabilities(), 0);
+}
+
+TEST(MessageTest, ChannelMessagesTest) {
+  std::string key = "1ZNDHB400RM7QE";
+  std::string iv = "dji-eta";
+  MessageParser messageParser(key, iv);
+  Message::Ptr parseResult;
+
+  //test channel data carrying an encrypted frame as is
+  auto putCharMessage = MessageFactory::create<PutCharMessage>("ls\r");
+  auto encryptedMessage = MessageFactory::create<EncryptedMessage>(putCharMessage, key, iv);
+  std::string payload((const char *) encryptedMessage->getBuffer().getDataPtr(), encryptedMessage->getBuffer().getSize());
+  auto channelDataMessage = MessageFactory::create<ChannelDataMessage>(7, payload);
+  parseResult = messageParser.parse(channelDataMessage->getBuffer().getDataPtr(),
+                                    channelDataMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<ChannelDataMessage>().getChannel(), 7);
+  ASSERT_EQ(parseResult->cast<ChannelDataMessage>().getPayload(), payload);
+  parseResult = messageParser.parse((const uint8_t *) payload.data(), payload.size());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<PutCharMessage>().getChars(), "ls\r");
+
+  //test open channel message
+  ConnectOptions connectOptions(ConnectionType::TypeMaster, "test");
+  connectOptions.setResume(true);
+  connectOptions.setCapabilities(ConnectOptions::CAPABILITY_COMPACT);
+  auto openChannelMessage = MessageFactory::create<OpenChannelMessage>(8, connectOptions);
+  encryptedMessage = MessageFactory::create<EncryptedMessage>(openChannelMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  auto openChannel = parseResult->cast<OpenChannelMessage>();
+  ASSERT_EQ(openChannel.getChannel(), 8);
+  ASSERT_EQ(openChannel.getConnectOptions().getConnectionType(), ConnectionType::TypeMaster);
+  ASSERT_EQ(openChannel.getConnectOptions().getClientId(), "test");
+  ASSERT_TRUE(openChannel.getConnectOptions().isResume());
+  ASSERT_EQ(openChannel.getConnectOptions().getCapabilities(), (uint32_t) ConnectOptions::CAPABILITY_COMPACT);
+
+  //test close channel and window messages
+  auto closeChannelMessage = MessageFactory::create<CloseChannelMessage>(9);
+  parseResult = messageParser.parse(closeChannelMessage->getBuffer().getDataPtr(),
+                                    closeChannelMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<CloseChannelMessage>().getChannel(), 9);
+  auto channelWindowMessage = MessageFactory::create<ChannelWindowMessage>(10, 65536);
+  parseResult = messageParser.parse(channelWindowMessage->getBuffer().getDataPtr(),
+                                    channelWindowMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<ChannelWindowMessage>().getChannel(), 10);
+  ASSERT_EQ(parseResult->cast<ChannelWindowMessage>().getCredit(), 65536);
+
+  //test compression messages
+  auto compressedMessage = MessageFactory::create<CompressedMessage>(CompressedMessage::FLAG_RESET, 3, 120, std::string("\x00\x01z", 3));
+  encryptedMessage = MessageFactory::create<EncryptedMessage>(compressedMessage, key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  auto compressed = parseResult->cast<CompressedMessage>();
+  ASSERT_TRUE(compressed.isReset());
+  ASSERT_EQ(compressed.getIndex(), 3);
+  ASSERT_EQ(compressed.getOriginalSize(), 120);
+  ASSERT_EQ(compressed.getData(), std::string("\x00\x01z", 3));
+  auto compressionRequestMessage = MessageFactory::create<CompressionRequestMessage>(CompressionType::Deflate);
+  parseResult = messageParser.parse(compressionRequestMessage->getBuffer().getDataPtr(),
+                                    compressionRequestMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<CompressionRequestMessage>().getType(), CompressionType::Deflate);
+
+  //test display mode message
+  auto displayModeMessage = MessageFactory::create<DisplayModeMessage>(DisplayMode::ScreenSync, 30);
+  parseResult = messageParser.parse(displayModeMessage->getBuffer().getDataPtr(),
+                                    displayModeMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<DisplayModeMessage>().getMode(), DisplayMode::ScreenSync);
+  ASSERT_EQ(parseResult->cast<DisplayModeMessage>().getFrameRate(), 30);
+
+  //test batch message
+  std::vector<std::string> batched = {std::string((const char *) displayModeMessage->getBuffer().getDataPtr(),
+                                                   displayModeMessage->getBuffer().getSize()), ""};
+  encryptedMessage = MessageFactory::create<EncryptedMessage>(MessageFactory::create<BatchMessage>(batched), key, iv);
+  parseResult = messageParser.parse(encryptedMessage->getBuffer().getDataPtr(),
+                                    encryptedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<BatchMessage>().getMessages(), batched);
+  ASSERT_TRUE(messageParser.parse((const uint8_t *) "\xd4\x91\x3a\x6c\xff\xff\xff\xff", 8) == nullptr);
+
+  //test window update message
+  auto windowUpdateMessage = MessageFactory::create<WindowUpdateMessage>(4096, true);
+  parseResult = messageParser.parse(windowUpdateMessage->getBuffer().getDataPtr(),
+                                    windowUpdateMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<WindowUpdateMessage>().getCredit(), 4096);
+  ASSERT_TRUE(parseResult->cast<WindowUpdateMessage>().isReset());
+
+  //test heartbeat message
+  auto heartbeatMessage = MessageFactory::create<HeartbeatMessage>(0xFFFFFFF0, true);
+  parseResult = messageParser.parse(heartbeatMessage->getBuffer().getDataPtr(),
+                                    heartbeatMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_EQ(parseResult->cast<HeartbeatMessage>().getTimestamp(), 0xFFFFFFF0);
+  ASSERT_TRUE(parseResult->cast<HeartbeatMessage>().isReply());
+
+  //test trace message
+  auto traceMessage = MessageFactory::create<TraceMessage>(42, TraceMessage::Stamps{100, 0, 0, 0, 0, 0, 0})
+    ->stamp(TraceStamp::ServerReceive, 150);
+  parseResult = messageParser.parse(traceMessage->getBuffer().getDataPtr(), traceMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  auto trace = parseResult->cast<TraceMessage>();
+  ASSERT_EQ(trace.getTraceId(), 42);
+  ASSERT_EQ(trace.getStamp(TraceStamp::MasterSend), 100);
+  ASSERT_EQ(trace.getStamp(TraceStamp::ServerReceive), 150);
+  ASSERT_EQ(trace.getStamp(TraceStamp::ServerDeliver), 0);
+
+  //test master detached message
+  auto masterDetachedMessage = MessageFactory::create<MasterDetachedMessage>();
+  parseResult = messageParser.parse(masterDetachedMessage->getBuffer().getDataPtr(),
+                                    masterDetachedMessage->getBuffer().getSize());
+  ASSERT_TRUE(parseResult != nullptr);
+  ASSERT_TRUE(parseResult->getId() == MasterDetachedMessage::id);
+}
@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+#include "message/MessageParser.h"
+
+static nlohmann::json makeProgress() {
+  nlohmann::json progress;
+  progress["request"] = 42;
+  progress["completed"] = 17;
+  progress["failed"] = 2;
+  progress["total"] = 300;
+  progress["hosts"] = {{"web-1", "exit 0"}, {"web-2", "timed out"}};
+  progress["sessions"] = std::vector<std::string>{"dji-alpha", "dji-beta", "dji-gamma"};
+  progress["owner"] = "controller-7";
+  return progress;
+}
+
+static Message::Ptr parse(MessageParser &parser, const Message::Ptr &msg) {
+  return parser.parse(msg->getBuffer().getDataPtr(), msg->getBuffer().getSize());
+}
+
+TEST(ResponseMessageTest, BothEncodingsRoundTrip) {
+  MessageParser messageParser("1ZNDH6P00ABZJN", "dji-alpha");
+  auto progress = makeProgress();
+  auto binary = MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, progress);
+  auto text = MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, progress, MetaDataEncoding::Text);
+  ASSERT_LT(binary->getBuffer().getSize(), text->getBuffer().getSize());
+
+  for (auto &msg : {binary, text}) {
+    auto result = parse(messageParser, msg);
+    ASSERT_TRUE(result != nullptr);
+    auto response = result->cast<ResponseMessage>();
+    ASSERT_TRUE(response.getEncoding() == msg->getEncoding());
+    ASSERT_TRUE(response.getResponseCode() == ResponseCode::ResponseOk);
+    ASSERT_EQ(response.getMetaData(), progress);
+  }
+}
+
+TEST(ResponseMessageTest, MissingOrMalformedMetaData) {
+  MessageParser messageParser("1ZNDH6P00ABZJN", "dji-alpha");
+  auto result = parse(messageParser, MessageFactory::create<ResponseMessage>(ResponseCode::ResponseErr));
+  ASSERT_TRUE(result != nullptr);
+  ASSERT_TRUE(result->cast<ResponseMessage>().getMetaData().is_null());
+
+  std::string garbage = "{\"request\": 4";
+  result = parse(messageParser, MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk,
+                                                                          (const uint8_t *) garbage.data(), garbage.size()));
+  ASSERT_TRUE(result != nullptr);
+  ASSERT_TRUE(result->cast<ResponseMessage>().getMetaData().is_null());
+
+  // a map announcing more entries than it holds
+  uint8_t truncated[] = {0x83, 0xA1, 'a', 0x01};
+  auto response = ResponseMessage(ResponseCode::ResponseOk, truncated, sizeof(truncated));
+  uint64_t value;
+  ASSERT_FALSE(response.getUnsigned("b", value));
+  ASSERT_TRUE(response.getMetaData().is_null());
+}
+
+TEST(ResponseMessageTest, ReadsFieldsInPlace) {
+  MessageParser messageParser("1ZNDH6P00ABZJN", "dji-alpha");
+  auto progress = makeProgress();
+  for (auto encoding : {MetaDataEncoding::Binary, MetaDataEncoding::Text}) {
+    auto result = parse(messageParser, MessageFactory::create<ResponseMessage>(ResponseCode::ResponseOk, progress, encoding));
+    auto response = result->cast<ResponseMessage>();
+    uint64_t value;
+    ASSERT_TRUE(response.getUnsigned("total", value));
+    ASSERT_EQ(value, 300);
+    ASSERT_TRUE(response.getUnsigned("failed", value));
+    ASSERT_EQ(value, 2);
+    ASSERT_FALSE(response.getUnsigned("owner", value));
+    ASSERT_FALSE(response.getUnsigned("missing", value));
+
+    const char *data;
+    size_t size;
+    // found behind the nested values
+    ASSERT_TRUE(response.getString("owner", data, size));
+    ASSERT_EQ(std::string(data, size), "controller-7");
+    ASSERT_FALSE(response.getString("total", data, size));
+    if (encoding == MetaDataEncoding::Binary) {
+      auto begin = (const char *) response.getBuffer().getDataPtr();
+      ASSERT_TRUE(data > begin && data + size <= begin + response.getBuffer().getSize());
+    }
+  }
+}
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+#include "metrics/Metrics.h"
+
+#include <thread>
+#include <vector>
+
+TEST(MetricsTest, CountersMergeThreads) {
+  Counter counter;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < 10000; j++)
+        counter.add();
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  ASSERT_EQ(counter.value(), 80000u);
+}
+
+TEST(MetricsTest, HistogramBuckets) {
+  for (uint64_t value : {0ul, 7ul, 8ul, 9ul, 100ul, 1000ul, 123456ul, 1ul << 30}) {
+    auto bucket = Histogram::getBucket(value);
+    ASSERT_LT(value, Histogram::getUpperBound(bucket));
+    if (bucket > 0) {
+      ASSERT_GE(value, Histogram::getUpperBound(bucket - 1));
+    }
+    // within one sub bucket of the value
+    ASSERT_LE(Histogram::getUpperBound(bucket), value + value / 8 + 1);
+  }
+  ASSERT_EQ(Histogram::getBucket(UINT64_MAX), Histogram::BUCKET_COUNT - 1);
+}
+
+TEST(MetricsTest, HistogramSnapshot) {
+  Histogram histogram;
+  std::thread other([&histogram] {
+    for (int i = 0; i < 99; i++)
+      histogram.record(std::chrono::microseconds(10));
+  });
+  other.join();
+  histogram.record(std::chrono::microseconds(5000));
+  auto snapshot = histogram.snapshot();
+  ASSERT_EQ(snapshot.count, 100u);
+  ASSERT_EQ(snapshot.sum, 99u * 10 + 5000);
+  ASSERT_EQ(snapshot.countBelow(16), 99u);
+  ASSERT_EQ(snapshot.countBelow(8192), 100u);
+  ASSERT_EQ(snapshot.percentile(0.5), 11u);
+  ASSERT_GE(snapshot.percentile(1), 5000u);
+}
+
+TEST(MetricsTest, RegistryGroupsFamilies) {
+  MetricRegistry registry;
+  auto reads = registry.counter("reads_total", "reads", "lane=\"bulk\"");
+  registry.counter("reads_total", "reads", "lane=\"interactive\"");
+  registry.gauge("open", "open things", "", [] { return 3.0; });
+  reads->add(2);
+  auto families = registry.getFamilies();
+  ASSERT_EQ(families.size(), 2u);
+  ASSERT_EQ(families[0].metrics.size(), 2u);
+  ASSERT_EQ(families[0].metrics[0].counter->value(), 2u);
+  ASSERT_EQ(families[1].metrics[0].callback(), 3.0);
+}
@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include "metrics/PrometheusExporter.h"
+
+TEST(PrometheusExporterTest, Format) {
+  MetricRegistry registry;
+  registry.counter("terminus_frames_total", "Frames")->add(3);
+  registry.gauge("terminus_sessions", "Sessions", "type=\"slave\"")->set(2);
+  auto latency = registry.histogram("terminus_relay_seconds", "Relay time");
+  latency->record(std::chrono::microseconds(10));
+  latency->record(std::chrono::microseconds(3000));
+  auto text = PrometheusExporter::format(registry);
+  ASSERT_NE(text.find("# TYPE terminus_frames_total counter\nterminus_frames_total 3\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_sessions{type=\"slave\"} 2\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_relay_seconds_bucket{le=\"8e-06\"} 0\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_relay_seconds_bucket{le=\"1.6e-05\"} 1\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_relay_seconds_bucket{le=\"0.004096\"} 2\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_relay_seconds_bucket{le=\"+Inf\"} 2\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_relay_seconds_sum 0.00301\n"), std::string::npos);
+  ASSERT_NE(text.find("terminus_relay_seconds_count 2\n"), std::string::npos);
+}
+
+TEST(PrometheusExporterTest, ServesSocket) {
+  auto registry = std::make_shared<MetricRegistry>();
+  registry->counter("terminus_frames_total", "Frames")->add(5);
+  std::string path = "/tmp/terminus-metrics-test-" + std::to_string(getpid());
+  PrometheusExporter exporter(registry);
+  ASSERT_TRUE(exporter.start(path));
+
+  auto scrape = [&path](const std::string &request) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    auto sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    std::string reply;
+    if (connect(sock, (sockaddr *) &address, sizeof(address)) == 0) {
+      send(sock, request.data(), request.size(), 0);
+      char buffer[4096];
+      ssize_t size;
+      while ((size = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+        reply.append(buffer, size);
+    }
+    close(sock);
+    return reply;
+  };
+
+  auto http = scrape("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  ASSERT_EQ(http.compare(0, 15, "HTTP/1.0 200 OK"), 0);
+  ASSERT_NE(http.find("text/plain; version=0.0.4"), std::string::npos);
+  ASSERT_NE(http.find("\r\n\r\n# HELP terminus_frames_total Frames\n"), std::string::npos);
+  auto text = scrape("\n");
+  ASSERT_EQ(text.compare(0, 6, "# HELP"), 0);
+  ASSERT_NE(text.find("terminus_frames_total 5\n"), std::string::npos);
+
+  exporter.stop();
+  ASSERT_NE(access(path.c_str(), F_OK), 0);
+}
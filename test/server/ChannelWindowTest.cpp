@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+#include "server/ChannelWindow.h"
+
+#include <atomic>
+#include <thread>
+
+TEST(ChannelWindowTest, BlocksUntilCreditIsGranted) {
+  ChannelWindow window(100);
+  ASSERT_TRUE(window.acquire(60));
+  // the last bit of credit lets a larger frame through
+  ASSERT_TRUE(window.acquire(60));
+  ASSERT_EQ(window.available(), -20);
+
+  std::atomic<bool> sent(false);
+  std::thread sender([&] {
+    sent = window.acquire(10);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(sent);
+  window.grant(20);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(sent);
+  window.grant(1);
+  sender.join();
+  ASSERT_TRUE(sent);
+  ASSERT_EQ(window.available(), -9);
+}
+
+TEST(ChannelWindowTest, CloseReleasesWaitingSender) {
+  ChannelWindow window(0);
+  window.consume(5);
+  std::atomic<bool> done(false);
+  bool sent = true;
+  std::thread sender([&] {
+    sent = window.acquire(10);
+    done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(done);
+  window.close();
+  sender.join();
+  ASSERT_FALSE(sent);
+}
@@ -0,0 +1,31 @@
+#include "gtest/gtest.h"
+#include "server/CommandFilter.h"
+
+static std::string toString(const Message::Ptr &msg) {
+  return {(const char *) msg->getBuffer().getDataPtr(), msg->getBuffer().getSize()};
+}
+
+TEST(CommandFilterTest, MasterCannotInjectCommands) {
+  MessageParser parser("login", "key");
+  auto command = MessageFactory::create<ExecuteCommandMessage>(1, "touch /tmp/owned", 1000, std::vector<std::string>{});
+  auto keystroke = MessageFactory::create<PutCharMessage>("l");
+  // as a master would send them, on their own, in its session and batched with keystrokes
+  std::vector<Message::Ptr> injected = {
+    command,
+    MessageFactory::create<CommandResultMessage>(1, "", CommandStatus::StatusExited, 0),
+    MessageFactory::create<SequencedMessage>(1, 1, 2, 0, toString(command)),
+    MessageFactory::create<BatchMessage>(std::vector<std::string>{
+      toString(MessageFactory::create<SequencedMessage>(1, 2, 2, 0, toString(keystroke))),
+      toString(MessageFactory::create<SequencedMessage>(1, 3, 2, 0, toString(command)))}),
+  };
+  for (auto &msg : injected) {
+    auto encrypted = MessageFactory::create<EncryptedMessage>(msg, "login", "key", WireFormat::Compact);
+    auto frame = parser.parse(encrypted->getBuffer().getDataPtr(), encrypted->getBuffer().getSize());
+    ASSERT_TRUE(frame != nullptr);
+    ASSERT_TRUE(CommandFilter::carriesCommand(parser, frame));
+  }
+
+  ASSERT_FALSE(CommandFilter::carriesCommand(parser, keystroke));
+  ASSERT_FALSE(CommandFilter::carriesCommand(parser, MessageFactory::create<SequencedMessage>(1, 4, 2, 0, toString(keystroke))));
+  ASSERT_FALSE(CommandFilter::carriesCommand(parser, MessageFactory::create<ResizeTerminalMessage>(80, 24)));
+}
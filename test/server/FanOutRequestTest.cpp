@@ -0,0 +1,28 @@
+#include "gtest/gtest.h"
+#include "server/FanOutRequest.h"
+
+#include <thread>
+
+TEST(FanOutRequestTest, SendsNothingOnceCancelled) {
+  std::vector<uint32_t> sent;
+  FanOutRequest request(3, {"slave-1", "slave-2"}, std::chrono::seconds(10), [&sent](const Message::Ptr &reply) {
+    sent.push_back(reply->getId());
+    return true;
+  });
+  request.output("slave-1", "line\n");
+  ASSERT_TRUE(request.complete("slave-1", CommandStatus::StatusExited, 0));
+  // output, result and progress
+  ASSERT_EQ(sent.size(), 3);
+
+  request.cancel();
+  ASSERT_TRUE(request.finished());
+  request.output("slave-2", "line\n");
+  request.complete("slave-2", CommandStatus::StatusExited, 0);
+  ASSERT_EQ(sent.size(), 3);
+
+  // the controller is gone, waiting for the other hosts is pointless
+  auto started = std::chrono::steady_clock::now();
+  request.wait();
+  ASSERT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(1));
+  ASSERT_EQ(sent.size(), 3);
+}
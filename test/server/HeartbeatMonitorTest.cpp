@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include "server/HeartbeatMonitor.h"
+
+#include <thread>
+
+using namespace std::chrono;
+
+struct Recorder {
+  std::mutex mutex;
+  std::vector<uint32_t> timestamps;
+  std::vector<int> evicted;
+
+  HeartbeatMonitor::SendHandler send() {
+    return [this](int, const Message::Ptr &msg) {
+      std::lock_guard<std::mutex> lock(mutex);
+      timestamps.push_back(msg->cast<HeartbeatMessage>().getTimestamp());
+      return true;
+    };
+  }
+
+  HeartbeatMonitor::EvictHandler evict() {
+    return [this](int sock) {
+      std::lock_guard<std::mutex> lock(mutex);
+      evicted.push_back(sock);
+    };
+  }
+
+  bool wasEvicted(int sock) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::find(evicted.begin(), evicted.end(), sock) != evicted.end();
+  }
+};
+
+TEST(HeartbeatMonitorTest, MeasuresRoundTripAndDropsSilentPeers) {
+  Recorder recorder;
+  HeartbeatMonitor monitor(recorder.send(), recorder.evict());
+  monitor.setMaxMissed(3);
+  monitor.start();
+  auto alive = monitor.add(5, "alive");
+  auto dead = monitor.add(6, "dead");
+  monitor.enableHeartbeat(alive, milliseconds(100));
+  monitor.enableHeartbeat(dead, milliseconds(100));
+
+  for (int i = 0; i < 10; i++) {
+    std::this_thread::sleep_for(milliseconds(100));
+    alive->heard();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    for (auto timestamp : recorder.timestamps)
+      monitor.onHeartbeat(alive, HeartbeatMessage(timestamp, true));
+    recorder.timestamps.clear();
+  }
+  ASSERT_TRUE(recorder.wasEvicted(6));
+  ASSERT_FALSE(recorder.wasEvicted(5));
+  auto roundTrip = monitor.getRoundTrip(alive);
+  ASSERT_GT(roundTrip.samples, 0);
+  ASSERT_LT(roundTrip.min, milliseconds(300));
+  ASSERT_EQ(monitor.getRoundTrips().count(), roundTrip.samples);
+
+  monitor.remove(alive);
+  monitor.remove(dead);
+  ASSERT_EQ(monitor.getTimerCount(), 0);
+}
+
+TEST(HeartbeatMonitorTest, IdlePeersWithoutHeartbeats) {
+  Recorder recorder;
+  HeartbeatMonitor monitor(recorder.send(), recorder.evict());
+  monitor.setIdleTimeout(milliseconds(300));
+  monitor.start();
+  auto idle = monitor.add(5, "idle");
+  auto busy = monitor.add(6, "busy");
+  auto removed = monitor.add(7, "removed");
+  monitor.remove(removed);
+  for (int i = 0; i < 8; i++) {
+    std::this_thread::sleep_for(milliseconds(100));
+    busy->heard();
+  }
+  ASSERT_TRUE(recorder.wasEvicted(5));
+  ASSERT_FALSE(recorder.wasEvicted(6));
+  ASSERT_FALSE(recorder.wasEvicted(7));
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  ASSERT_TRUE(recorder.timestamps.empty());
+}
+
+TEST(HeartbeatMonitorTest, SlowSendHoldsUpNoOtherPeer) {
+  std::mutex mutex;
+  std::condition_variable flag;
+  bool sending = false;
+  bool released = false;
+  HeartbeatMonitor monitor([&](int, const Message::Ptr &) {
+    std::unique_lock<std::mutex> lock(mutex);
+    sending = true;
+    flag.notify_all();
+    flag.wait(lock, [&] { return released; });
+    return true;
+  }, [](int) {});
+  monitor.start();
+  auto stuck = monitor.add(5, "stuck");
+  monitor.enableHeartbeat(stuck, milliseconds(100));
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(flag.wait_for(lock, seconds(5), [&] { return sending; }));
+  }
+
+  // clients come and answer heartbeats while the send to another one is stuck
+  auto started = steady_clock::now();
+  auto other = monitor.add(6, "other");
+  monitor.enableHeartbeat(other, milliseconds(100));
+  monitor.onHeartbeat(other, HeartbeatMessage(0, true));
+  ASSERT_LT(steady_clock::now() - started, seconds(1));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released = true;
+  }
+  flag.notify_all();
+  monitor.remove(other);
+  monitor.remove(stuck);
+  ASSERT_EQ(monitor.getTimerCount(), 0);
+}
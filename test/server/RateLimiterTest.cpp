@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "server/RateLimiter.h"
+
+using namespace std::chrono;
+
+TEST(RateLimiterTest, BucketPaysBackDebt) {
+  auto now = TokenBucket::Clock::now();
+  TokenBucket bucket(1000, 500, now);
+  bucket.consume(500, now);
+  ASSERT_EQ(bucket.getDelay(now), TokenBucket::Clock::duration::zero());
+  // half a second of debt
+  bucket.consume(500, now);
+  ASSERT_NEAR(duration_cast<milliseconds>(bucket.getDelay(now)).count(), 500, 1);
+  ASSERT_NEAR(duration_cast<milliseconds>(bucket.getDelay(now + milliseconds(400))).count(), 100, 1);
+  ASSERT_EQ(bucket.getDelay(now + milliseconds(500)), TokenBucket::Clock::duration::zero());
+  // idle time refills up to the burst only
+  bucket.consume(600, now + seconds(10));
+  ASSERT_NEAR(duration_cast<milliseconds>(bucket.getDelay(now + seconds(10))).count(), 100, 1);
+}
+
+TEST(RateLimiterTest, LongestPrefixIsShared) {
+  RateLimiter rateLimiter;
+  ASSERT_TRUE(rateLimiter.makeShaper("build-1") == nullptr);
+
+  rateLimiter.setBurst(1000);
+  rateLimiter.addPrefixRate("build-", 1000);
+  rateLimiter.addPrefixRate("build-ci-", 1000);
+  auto a = rateLimiter.makeShaper("build-ci-1");
+  auto b = rateLimiter.makeShaper("build-ci-2");
+  auto other = rateLimiter.makeShaper("build-7");
+  ASSERT_TRUE(a != nullptr && b != nullptr && other != nullptr);
+  ASSERT_TRUE(rateLimiter.makeShaper("interactive") == nullptr);
+
+  // the sessions of a prefix draw from one bucket, other prefixes are not affected
+  a->consume(600);
+  b->consume(600);
+  auto start = steady_clock::now();
+  other->throttle();
+  ASSERT_LT(steady_clock::now() - start, milliseconds(50));
+  b->throttle();
+  ASSERT_GE(steady_clock::now() - start, milliseconds(150));
+  ASSERT_EQ(b->getStats().pauses, 1);
+  ASSERT_EQ(other->getStats().pauses, 0);
+}
+
+TEST(RateLimiterTest, SessionAndPrefixLimitsCombine) {
+  RateLimiter rateLimiter;
+  rateLimiter.setBurst(1000);
+  rateLimiter.setSessionRate(10000);
+  rateLimiter.addPrefixRate("bulk", 1000000);
+  auto shaper = rateLimiter.makeShaper("bulk-1");
+  ASSERT_TRUE(shaper != nullptr);
+  ASSERT_TRUE(rateLimiter.makeShaper("other") != nullptr);
+
+  // the slower session limit decides, 2000 bytes at 10000 per second
+  auto start = steady_clock::now();
+  shaper->consume(3000);
+  shaper->throttle();
+  auto paused = steady_clock::now() - start;
+  ASSERT_GE(paused, milliseconds(190));
+  ASSERT_LT(paused, milliseconds(1000));
+}
+
+TEST(RateLimiterTest, ReconnectingSessionKeepsItsDebt) {
+  RateLimiter rateLimiter;
+  rateLimiter.setBurst(1000);
+  rateLimiter.setSessionRate(10000);
+  rateLimiter.makeShaper("slave-1")->consume(3000);
+
+  // the same slave on a new connection, 2000 bytes of debt at 10000 per second
+  auto shaper = rateLimiter.makeShaper("slave-1");
+  auto start = steady_clock::now();
+  ASSERT_TRUE(shaper->throttle());
+  ASSERT_GE(steady_clock::now() - start, milliseconds(150));
+  ASSERT_FALSE(rateLimiter.makeShaper("slave-2")->throttle());
+}
+
+TEST(RateLimiterTest, PausesNoLongerThanAllowed) {
+  RateLimiter rateLimiter;
+  rateLimiter.setBurst(1000);
+  rateLimiter.setSessionRate(1000);
+  auto shaper = rateLimiter.makeShaper("slave-1");
+  shaper->consume(11000);
+
+  // ten seconds of debt, the slave is read again in between
+  auto start = steady_clock::now();
+  ASSERT_TRUE(shaper->throttle(milliseconds(50)));
+  ASSERT_LT(steady_clock::now() - start, milliseconds(500));
+  ASSERT_TRUE(shaper->throttle(milliseconds(50)));
+}
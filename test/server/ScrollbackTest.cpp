@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+#include "server/Scrollback.h"
+
+#include <sys/socket.h>
+
+static std::string readAll(int sock, size_t size) {
+  std::string data;
+  char buf[4096];
+  while (data.size() < size) {
+    auto numBytes = recv(sock, buf, sizeof(buf), 0);
+    if (numBytes <= 0) break;
+    data.append(buf, numBytes);
+  }
+  return data;
+}
+
+TEST(ScrollbackTest, KeepsLatestWholeFrames) {
+  ScrollbackBuffer scrollback(10);
+  ASSERT_TRUE(scrollback.append((const uint8_t *) "aaaa", 4));
+  ASSERT_TRUE(scrollback.append((const uint8_t *) "bbbb", 4));
+  ASSERT_EQ(scrollback.size(), 8);
+  // the oldest frame is dropped entirely, not partially overwritten
+  ASSERT_TRUE(scrollback.append((const uint8_t *) "cccc", 4));
+  ASSERT_EQ(scrollback.size(), 8);
+  ASSERT_EQ(scrollback.frames(), 2);
+
+  iovec iov[2]{};
+  ASSERT_EQ(scrollback.getIoVec(iov), 2);
+  std::string contents((char *) iov[0].iov_base, iov[0].iov_len);
+  contents.append((char *) iov[1].iov_base, iov[1].iov_len);
+  ASSERT_EQ(contents, "bbbbcccc");
+
+  ASSERT_FALSE(scrollback.append((const uint8_t *) "0123456789a", 11));
+  ASSERT_EQ(scrollback.size(), 0);
+}
+
+TEST(ScrollbackTest, ReplaysWrappedRing) {
+  ScrollbackBuffer scrollback(1000);
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    auto frame = std::to_string(i) + std::string(30, 'x');
+    scrollback.append((const uint8_t *) frame.data(), frame.size());
+    expected += frame;
+  }
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+  auto size = scrollback.size();
+  ASSERT_TRUE(scrollback.replay(sockets[0]));
+  auto replayed = readAll(sockets[1], size);
+  ASSERT_EQ(replayed, expected.substr(expected.size() - size));
+  close(sockets[0]);
+  close(sockets[1]);
+}
+
+TEST(ScrollbackTest, IteratesWrappedFrames) {
+  ScrollbackBuffer scrollback(100);
+  for (int i = 0; i < 10; i++) {
+    auto frame = std::to_string(i) + std::string(29, 'x');
+    scrollback.append((const uint8_t *) frame.data(), frame.size());
+  }
+  std::vector<std::string> frames;
+  scrollback.forEachFrame([&](const uint8_t *data, size_t size) {
+    frames.emplace_back((const char *) data, size);
+  });
+  ASSERT_EQ(frames.size(), 3);
+  for (size_t i = 0; i < frames.size(); i++)
+    ASSERT_EQ(frames[i], std::to_string(7 + i) + std::string(29, 'x'));
+}
+
+TEST(ScrollbackTest, StoreRespectsGlobalLimit) {
+  ScrollbackStore store(100, 250);
+  ASSERT_EQ(store.acquire("a")->capacity(), 100);
+  ASSERT_EQ(store.acquire("a")->capacity(), 100);
+  ASSERT_EQ(store.acquire("b")->capacity(), 100);
+  ASSERT_EQ(store.acquire("c")->capacity(), 50);
+  ASSERT_EQ(store.acquire("d"), nullptr);
+  ASSERT_EQ(store.reserved(), 250);
+  store.release("a");
+  ASSERT_EQ(store.find("a"), nullptr);
+  ASSERT_EQ(store.acquire("d")->capacity(), 100);
+  ASSERT_EQ(store.reserved(), 250);
+}
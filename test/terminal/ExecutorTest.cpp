@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "terminal/executor.hpp"
+
+#include <atomic>
+#include <condition_variable>
+
+TEST(ExecutorTest, SingleCommandTest) {
+  auto result = CommandExecutor::execute("echo terminus");
+  ASSERT_TRUE(WIFEXITED(result.first));
+  ASSERT_EQ(WEXITSTATUS(result.first), 0);
+  ASSERT_NE(result.second.find("terminus"), std::string::npos);
+}
+
+TEST(ExecutorTest, ConcurrentCommandsTest) {
+  CommandExecutor executor;
+  std::mutex mutex;
+  std::condition_variable doneFlag;
+  std::map<uint32_t, std::string> outputs;
+  std::map<uint32_t, CommandExecutor::Result> results;
+  auto onOutput = [&](uint32_t id, const std::string &chunk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    outputs[id] += chunk;
+  };
+  auto onExit = [&](uint32_t id, const CommandExecutor::Result &result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    results[id] = result;
+    doneFlag.notify_all();
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 8; i++)
+    ids.push_back(executor.submit("sleep 0.3; echo done " + std::to_string(i) + "; exit " + std::to_string(i), onOutput, onExit));
+  auto slow = executor.submit("echo started; sleep 10", onOutput, onExit, std::chrono::milliseconds(200));
+  ASSERT_NE(slow, 0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  ASSERT_TRUE(doneFlag.wait_for(lock, std::chrono::seconds(5), [&] { return results.size() == ids.size() + 1; }));
+  // commands ran in parallel, not one after another
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+  for (int i = 0; i < (int) ids.size(); i++) {
+    ASSERT_EQ(results[ids[i]].exitCode(), i);
+    ASSERT_FALSE(results[ids[i]].timedOut);
+    ASSERT_NE(outputs[ids[i]].find("done " + std::to_string(i)), std::string::npos);
+  }
+  ASSERT_TRUE(results[slow].timedOut);
+  ASSERT_FALSE(results[slow].exited());
+  ASSERT_NE(outputs[slow].find("started"), std::string::npos);
+  ASSERT_EQ(executor.running(), 0);
+}
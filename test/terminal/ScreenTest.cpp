@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "terminal/screen.hpp"
+
+static std::string line(const Screen &screen, int y) {
+  std::string text;
+  for (auto &cell : screen.row(y)) text += cell.glyph;
+  while (!text.empty() && text.back() == ' ') text.pop_back();
+  return text;
+}
+
+TEST(ScreenTest, PrintsAndWraps) {
+  Screen screen(10, 3);
+  screen.write("hello\r\nworld wide web");
+  ASSERT_EQ(line(screen, 0), "hello");
+  ASSERT_EQ(line(screen, 1), "world wide");
+  ASSERT_EQ(line(screen, 2), " web");
+  ASSERT_EQ(screen.cursorX(), 4);
+  ASSERT_EQ(screen.cursorY(), 2);
+}
+
+TEST(ScreenTest, ScrollsAtBottom) {
+  Screen screen(10, 3);
+  screen.write("1\r\n2\r\n3\r\n4");
+  ASSERT_EQ(line(screen, 0), "2");
+  ASSERT_EQ(line(screen, 2), "4");
+}
+
+TEST(ScreenTest, MovesCursorAndErases) {
+  Screen screen(10, 3);
+  screen.write("aaaaaaaaaa\r\nbbbbbbbbbb\r\ncccccccccc");
+  screen.write("\x1b[2;4H\x1b[K");
+  ASSERT_EQ(line(screen, 1), "bbb");
+  screen.write("\x1b[1;3H\x1b[2P");
+  ASSERT_EQ(line(screen, 0), "aaaaaaaa");
+  screen.write("\x1b[3;1H\x1b[2@x");
+  ASSERT_EQ(line(screen, 2), "x cccccccc");
+  screen.write("\x1b[2J");
+  ASSERT_EQ(line(screen, 0), "");
+  ASSERT_EQ(line(screen, 2), "");
+}
+
+TEST(ScreenTest, KeepsAttributes) {
+  Screen screen(10, 2);
+  screen.write("\x1b[1;31mR\x1b[0;38;5;200;48;2;1;2;3mX\x1b[mN");
+  auto &row = screen.row(0);
+  ASSERT_EQ(row[0].attributes.fg, 1);
+  ASSERT_EQ(row[0].attributes.flags, Screen::Bold);
+  ASSERT_EQ(row[1].attributes.fg, 200);
+  ASSERT_EQ(row[1].attributes.bg, Screen::RGB_COLOR | 0x010203);
+  ASSERT_EQ(row[1].attributes.flags, 0);
+  ASSERT_EQ(row[2].attributes, Screen::Attributes());
+}
+
+TEST(ScreenTest, ScrollRegion) {
+  Screen screen(5, 4);
+  screen.write("top\r\n1\r\n2\r\nbot");
+  screen.write("\x1b[2;3r\x1b[3;1H\nx");
+  ASSERT_EQ(line(screen, 0), "top");
+  ASSERT_EQ(line(screen, 1), "2");
+  ASSERT_EQ(line(screen, 2), "x");
+  ASSERT_EQ(line(screen, 3), "bot");
+}
+
+TEST(ScreenTest, AlternateScreenRestoresPrimary) {
+  Screen screen(10, 3);
+  screen.write("shell$ ");
+  screen.write("\x1b[?1049h\x1b[Hfull screen");
+  ASSERT_EQ(line(screen, 0), "full scree");
+  screen.write("\x1b[?1049l");
+  ASSERT_EQ(line(screen, 0), "shell$");
+  ASSERT_EQ(screen.cursorX(), 7);
+}
+
+TEST(ScreenTest, WideAndCombiningCharacters) {
+  Screen screen(6, 2);
+  screen.write("\xe4\xb8\xad" "e\xcc\x81" "\xe4\xb8\xad");
+  auto &row = screen.row(0);
+  ASSERT_EQ(row[0].glyph, "\xe4\xb8\xad");
+  ASSERT_EQ(row[1].glyph, "");
+  ASSERT_EQ(row[2].glyph, "e\xcc\x81");
+  ASSERT_EQ(row[3].glyph, "\xe4\xb8\xad");
+  ASSERT_EQ(screen.cursorX(), 5);
+  // overwriting half of a wide character clears the other half
+  screen.write("\x1b[1;2Hx");
+  ASSERT_EQ(row[0].glyph, " ");
+  ASSERT_EQ(row[1].glyph, "x");
+}
+
+TEST(ScreenTest, AnswersStatusQueries) {
+  Screen screen(10, 5);
+  screen.write("\x1b[3;4H\x1b[6n\x1b[5n");
+  ASSERT_EQ(screen.takeReplies(), "\x1b[3;4R\x1b[0n");
+  ASSERT_EQ(screen.takeReplies(), "");
+}
+
+TEST(ScreenTest, TracksForwardedModesAndTitle) {
+  Screen screen(10, 2);
+  screen.write("\x1b[?2004h\x1b[?1h\x1b=\x1b]0;build\x07\x1b[?25l");
+  ASSERT_TRUE(screen.mode(2004));
+  ASSERT_TRUE(screen.mode(1));
+  ASSERT_TRUE(screen.keypadMode());
+  ASSERT_FALSE(screen.cursorVisible());
+  ASSERT_EQ(screen.title(), "build");
+  screen.write("\x1b[?2004l");
+  ASSERT_FALSE(screen.mode(2004));
+}
+
+TEST(ScreenTest, ResizeKeepsCursorLine) {
+  Screen screen(10, 4);
+  screen.write("1\r\n2\r\n3\r\n4");
+  screen.resize(5, 2);
+  ASSERT_EQ(line(screen, 0), "3");
+  ASSERT_EQ(line(screen, 1), "4");
+  ASSERT_EQ(screen.cursorY(), 1);
+  screen.resize(8, 3);
+  ASSERT_EQ(screen.width(), 8);
+  ASSERT_EQ(line(screen, 2), "");
+}
+
+TEST(ScreenTest, LineDrawingCharset) {
+  Screen screen(5, 1);
+  screen.write("\x1b(0lqk\x1b(Bq");
+  ASSERT_EQ(line(screen, 0), "┌─┐q");
+}
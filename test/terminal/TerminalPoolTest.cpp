@@ -0,0 +1,27 @@
+#include "gtest/gtest.h"
+#include "terminal/terminal_pool.hpp"
+
+TEST(TerminalPoolTest, AcquireAndRefill) {
+  TerminalPool pool(2, 80, 24, false);
+  pool.start();
+  ASSERT_TRUE(pool.waitReady(std::chrono::seconds(5)));
+  ASSERT_EQ(pool.available(), 2);
+
+  auto terminal = pool.acquire();
+  ASSERT_TRUE(terminal != nullptr);
+  ASSERT_TRUE(terminal->isAlive());
+  terminal->write("echo pooled\n");
+  std::string output;
+  while (output.find("pooled\r\n") == std::string::npos && terminal->waitForData(std::chrono::seconds(5))) {
+    auto buffer = terminal->receive();
+    if (buffer.getSize() == 0) break;
+    output.append((char *) buffer.getDataPtr(), buffer.getSize());
+  }
+  ASSERT_NE(output.find("pooled\r\n"), std::string::npos);
+
+  // the pool refills in the background
+  ASSERT_TRUE(pool.waitReady(std::chrono::seconds(5)));
+  ASSERT_EQ(pool.available(), 2);
+  pool.stop();
+  ASSERT_TRUE(terminal->isAlive());
+}
@@ -0,0 +1,31 @@
+#include "gtest/gtest.h"
+#include "transport/DelayHistogram.h"
+
+TEST(DelayHistogramTest, Percentiles) {
+  DelayHistogram histogram;
+  ASSERT_EQ(histogram.percentile(0.99), 0);
+  for (int i = 0; i < 98; i++)
+    histogram.record(std::chrono::microseconds(20));
+  histogram.record(std::chrono::microseconds(3000));
+  histogram.record(std::chrono::microseconds(-5));
+
+  ASSERT_EQ(histogram.count(), 100);
+  ASSERT_EQ(histogram.max(), 3000);
+  // 20 us lies in the bucket below 32 us
+  ASSERT_EQ(histogram.percentile(0.5), 32);
+  ASSERT_EQ(histogram.percentile(0.99), 32);
+  // never above the largest delay seen
+  ASSERT_EQ(histogram.percentile(0.995), 3000);
+  ASSERT_EQ(histogram.getBucket(0), 1);
+  ASSERT_NEAR(histogram.mean(), (98 * 20 + 3000) / 100.0, 0.01);
+}
+
+TEST(DelayHistogramTest, MergeAndOverflow) {
+  DelayHistogram a, b;
+  a.record(std::chrono::microseconds(1));
+  b.record(std::chrono::hours(24 * 365));
+  a.merge(b);
+  ASSERT_EQ(a.count(), 2);
+  ASSERT_EQ(a.getBucket(DelayHistogram::BUCKET_COUNT - 1), 1);
+  ASSERT_EQ(a.max(), (uint64_t) std::chrono::microseconds(std::chrono::hours(24 * 365)).count());
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "transport/LaneLock.h"
+
+#include <thread>
+#include <vector>
+
+static void waitForWaiting(const LaneLock &laneLock, Lane lane, int count) {
+  while (laneLock.getWaiting(lane) < count)
+    std::this_thread::yield();
+}
+
+TEST(LaneLockTest, ClassifiesBySize) {
+  ASSERT_TRUE(LaneLock::classify(18) == Lane::Interactive);
+  ASSERT_TRUE(LaneLock::classify(LaneLock::INTERACTIVE_FRAME_SIZE) == Lane::Interactive);
+  ASSERT_TRUE(LaneLock::classify(LaneLock::INTERACTIVE_FRAME_SIZE + 1) == Lane::Bulk);
+}
+
+TEST(LaneLockTest, InteractiveSendersGoFirst) {
+  LaneLock laneLock;
+  std::mutex mutex;
+  std::vector<std::string> order;
+  auto sender = [&](Lane lane, const std::string &name) {
+    return std::thread([&laneLock, &mutex, &order, lane, name] {
+      LaneLock::Guard guard(laneLock, lane);
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(name);
+    });
+  };
+
+  std::vector<std::thread> threads;
+  laneLock.lock(Lane::Bulk);
+  threads.push_back(sender(Lane::Bulk, "output-1"));
+  threads.push_back(sender(Lane::Bulk, "output-2"));
+  waitForWaiting(laneLock, Lane::Bulk, 2);
+  // queued last, written first
+  threads.push_back(sender(Lane::Interactive, "ctrl-c"));
+  waitForWaiting(laneLock, Lane::Interactive, 1);
+  laneLock.unlock();
+  for (auto &thread : threads)
+    thread.join();
+
+  ASSERT_EQ(order.size(), 3);
+  ASSERT_EQ(order[0], "ctrl-c");
+  auto stats = laneLock.getStats();
+  ASSERT_EQ(stats.getDelays(Lane::Interactive).count(), 1);
+  ASSERT_EQ(stats.getDelays(Lane::Bulk).count(), 3);
+  ASSERT_EQ(laneLock.getWaiting(Lane::Bulk), 0);
+}
+
+TEST(LaneLockTest, BulkIsNotStarvedWithoutInteractiveSenders) {
+  LaneLock laneLock;
+  int sent = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&laneLock, &sent, i] {
+      for (int j = 0; j < 1000; j++) {
+        LaneLock::Guard guard(laneLock, i % 2 ? Lane::Bulk : Lane::Interactive);
+        sent++;
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  ASSERT_EQ(sent, 4000);
+}
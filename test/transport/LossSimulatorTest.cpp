@@ -0,0 +1,47 @@
+#include "gtest/gtest.h"
+#include "transport/LossSimulator.h"
+
+TEST(LossSimulatorTest, DisabledSendsImmediately) {
+  LossSimulator simulator;
+  int sent = 0;
+  simulator.submit("a", {}, LossSimulator::Clock::now(), [&](const std::string &, const sockaddr_storage &) {
+    sent++;
+  });
+  ASSERT_EQ(sent, 1);
+  ASSERT_EQ(simulator.nextDue(), LossSimulator::Clock::time_point::max());
+}
+
+TEST(LossSimulatorTest, DropsShareAndDelays) {
+  LossSimulator::Options options;
+  options.lossRate = 0.25;
+  options.delay = std::chrono::milliseconds(50);
+  LossSimulator simulator(options);
+  auto now = LossSimulator::Clock::now();
+  int sent = 0;
+  auto send = [&](const std::string &, const sockaddr_storage &) { sent++; };
+  for (int i = 0; i < 4000; i++)
+    simulator.submit("a", {}, now, send);
+  ASSERT_EQ(sent, 0);
+  simulator.flush(now + std::chrono::milliseconds(49), send);
+  ASSERT_EQ(sent, 0);
+  simulator.flush(now + std::chrono::milliseconds(50), send);
+  ASSERT_EQ(sent + simulator.getStats().dropped, 4000);
+  ASSERT_NEAR(simulator.getStats().dropped, 1000, 150);
+}
+
+TEST(LossSimulatorTest, SameSeedSameDrops) {
+  LossSimulator::Options options;
+  options.lossRate = 0.5;
+  options.jitter = std::chrono::milliseconds(20);
+  LossSimulator first(options), second(options);
+  auto now = LossSimulator::Clock::now();
+  std::string firstOrder, secondOrder;
+  for (int i = 0; i < 200; i++) {
+    first.submit(std::to_string(i) + ",", {}, now, {});
+    second.submit(std::to_string(i) + ",", {}, now, {});
+  }
+  first.flush(now + options.jitter, [&](const std::string &data, const sockaddr_storage &) { firstOrder += data; });
+  second.flush(now + options.jitter, [&](const std::string &data, const sockaddr_storage &) { secondOrder += data; });
+  ASSERT_FALSE(firstOrder.empty());
+  ASSERT_EQ(firstOrder, secondOrder);
+}
@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "transport/TimerWheel.h"
+
+#include <random>
+
+using namespace std::chrono;
+
+TEST(TimerWheelTest, FiresOnRoundedUpTick) {
+  auto start = TimerWheel::Clock::now();
+  TimerWheel wheel(milliseconds(10), start);
+  int fired = 0;
+  wheel.schedule(milliseconds(25), [&] { fired++; });
+  ASSERT_EQ(wheel.advance(start + milliseconds(29)), 0);
+  ASSERT_EQ(wheel.advance(start + milliseconds(30)), 1);
+  ASSERT_EQ(fired, 1);
+  ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheelTest, CancelAndReschedule) {
+  auto start = TimerWheel::Clock::now();
+  TimerWheel wheel(milliseconds(1), start);
+  int fired = 0;
+  auto id = wheel.schedule(milliseconds(5), [&] { fired++; });
+  ASSERT_TRUE(wheel.cancel(id));
+  ASSERT_FALSE(wheel.cancel(id));
+
+  // a periodic timer schedules itself again, and may cancel timers due in the same tick
+  TimerWheel::TimerId other = 0;
+  std::function<void()> periodic = [&] {
+    fired++;
+    wheel.cancel(other);
+    if (fired < 3) wheel.schedule(milliseconds(10), periodic);
+  };
+  wheel.schedule(milliseconds(10), periodic);
+  other = wheel.schedule(milliseconds(10), [&] { fired += 100; });
+  wheel.advance(start + milliseconds(100));
+  ASSERT_EQ(fired, 3);
+  ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheelTest, TimersOnEveryLevelFireOnTime) {
+  auto start = TimerWheel::Clock::now();
+  TimerWheel wheel(milliseconds(1), start);
+  std::mt19937 random(7);
+  std::vector<uint64_t> expected, actual;
+  uint64_t now = 0;
+  for (int i = 0; i < 2000; i++) {
+    // spread over all levels, due times on level boundaries included
+    uint64_t delay = i < 8 ? (uint64_t) 1 << (6 * (i % 4)) : std::uniform_int_distribution<uint64_t>(1, 300000)(random);
+    auto index = expected.size();
+    expected.push_back(delay);
+    actual.push_back(0);
+    wheel.schedule(milliseconds(delay), [&, index] { actual[index] = now; });
+  }
+  for (now = 1; now <= 300000; now++)
+    wheel.advance(start + milliseconds(now));
+  ASSERT_EQ(actual, expected);
+}
+
+TEST(TimerWheelTest, ManyTimers) {
+  auto start = TimerWheel::Clock::now();
+  TimerWheel wheel(milliseconds(100), start);
+  std::vector<TimerWheel::TimerId> ids;
+  size_t fired = 0;
+  for (int i = 0; i < 100000; i++)
+    ids.push_back(wheel.schedule(seconds(5 + i % 50), [&] { fired++; }));
+  for (size_t i = 0; i < ids.size(); i += 2)
+    wheel.cancel(ids[i]);
+  ASSERT_EQ(wheel.size(), 50000);
+  wheel.advance(start + seconds(60));
+  ASSERT_EQ(fired, 50000);
+  ASSERT_EQ(wheel.size(), 0);
+}